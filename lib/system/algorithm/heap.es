@@ -32,7 +32,7 @@ def sort_heap(iterable) -> vector;
 def sort_heap(iterable, compare) -> vector;
 
 @builtin
-def is_heap(iterable) -> vector;
+def is_heap(iterable) -> bool;
 
 @builtin
-def is_heap(iterable, compare) -> vector;
+def is_heap(iterable, compare) -> bool;
@@ -0,0 +1,20 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+package system.algorithm;
+
+
+@builtin
+def nth_element(iterable, n) -> vector;
+
+@builtin
+def nth_element(iterable, n, compare) -> vector;
+
+@builtin
+def top_k(iterable, k) -> vector;
+
+@builtin
+def top_k(iterable, k, key) -> vector;
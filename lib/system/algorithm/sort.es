@@ -0,0 +1,20 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+package system.algorithm;
+
+
+@builtin
+def sort(iterable) -> vector;
+
+@builtin
+def sort(iterable, compare) -> vector;
+
+@builtin
+def stable_sort(iterable) -> vector;
+
+@builtin
+def stable_sort(iterable, compare) -> vector;
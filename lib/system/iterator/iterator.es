@@ -0,0 +1,17 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+package system.iterator;
+
+
+@builtin
+def range(stop) -> vector;
+
+@builtin
+def range(start, stop) -> vector;
+
+@builtin
+def range(start, stop, step) -> vector;
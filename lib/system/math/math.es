@@ -0,0 +1,29 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+package system.math;
+
+
+@builtin
+def sqrt(x) -> double;
+
+@builtin
+def exp(x) -> double;
+
+@builtin
+def log(x) -> double;
+
+@builtin
+def pow(x, y) -> double;
+
+@builtin
+def abs(x) -> number;
+
+@builtin
+def min(args...) -> number;
+
+@builtin
+def max(args...) -> number;
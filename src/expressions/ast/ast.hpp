@@ -7,6 +7,8 @@
 #ifndef __EXPRESSIONS_AST_AST_HPP__
 #define __EXPRESSIONS_AST_AST_HPP__
 
+#include <expressions/ast/symbol.hpp>
+
 #include <expressions/support/boost/spirit.hpp>
 #include <expressions/support/boost/variant.hpp>
 
@@ -38,6 +40,7 @@ struct AssignStatement;
 struct LazyAssignStatement;
 struct AugAssignStatement;
 struct ReturnStatement;
+struct YieldStatement;
 struct StatementList;
 struct ExternFunctionDecl;
 struct FunctionDef;
@@ -142,9 +145,10 @@ using ExpressionType
 using StatementType = x3::variant<
     MonoState, x3::forward_ast<AssignStatement>,
     x3::forward_ast<LazyAssignStatement>, x3::forward_ast<AugAssignStatement>,
-    x3::forward_ast<ReturnStatement>, x3::forward_ast<ExternFunctionDecl>,
-    x3::forward_ast<FunctionDef>, x3::forward_ast<IfStatement>,
-    x3::forward_ast<ForStatement>, x3::forward_ast<RangeBasedForStatement>,
+    x3::forward_ast<ReturnStatement>, x3::forward_ast<YieldStatement>,
+    x3::forward_ast<ExternFunctionDecl>, x3::forward_ast<FunctionDef>,
+    x3::forward_ast<IfStatement>, x3::forward_ast<ForStatement>,
+    x3::forward_ast<RangeBasedForStatement>,
     x3::forward_ast<WhileStatement>, x3::forward_ast<Pass>,
     x3::forward_ast<Break>, x3::forward_ast<Continue>,
     x3::forward_ast<StatementList>>;
@@ -181,9 +185,9 @@ using Value = x3::variant<
     // Statement
     x3::forward_ast<AssignStatement>, x3::forward_ast<LazyAssignStatement>,
     x3::forward_ast<AugAssignStatement>, x3::forward_ast<ReturnStatement>,
-    x3::forward_ast<IfStatement>, x3::forward_ast<ForStatement>,
-    x3::forward_ast<RangeBasedForStatement>, x3::forward_ast<WhileStatement>,
-    x3::forward_ast<StatementList>,
+    x3::forward_ast<YieldStatement>, x3::forward_ast<IfStatement>,
+    x3::forward_ast<ForStatement>, x3::forward_ast<RangeBasedForStatement>,
+    x3::forward_ast<WhileStatement>, x3::forward_ast<StatementList>,
 
     // Nop
     x3::forward_ast<Pass>,
@@ -195,8 +199,26 @@ using Value = x3::variant<
     x3::forward_ast<ImportPackage>, x3::forward_ast<PackageName>,
     x3::forward_ast<Entry>>;
 
+// Storage a name refers to at run time, bound by the ScopeResolver.
+enum class NameScope : int32_t {
+    kUnresolved,
+    // Parameter of the innermost function or lambda; the slot is its index.
+    kLocal,
+    // The slot indexes Entry::globals.
+    kGlobal,
+    // Builtin function; the slot is its parser::BuiltinFunction id.
+    kBuiltin,
+    // Function of the embedder, declared by an ExternFunctionDecl and bound
+    // by name and argument count.
+    kExtern,
+};
+
 struct Name {
     std::string value {};
+    NameScope scope {NameScope::kUnresolved};
+    int32_t slot = -1;
+    // The interned value, bound by the ScopeResolver along with the scope.
+    Symbol symbol {};
 };
 
 struct String {
@@ -324,6 +346,12 @@ struct ReturnStatement {
     boost::optional<Value> expr {};
 };
 
+// Makes the function containing it a generator. A yield without an
+// expression yields null.
+struct YieldStatement {
+    boost::optional<Value> expr {};
+};
+
 struct StatementList {
     std::vector<Value> stmts;
 };
@@ -384,6 +412,12 @@ struct Entry {
     // ImportPackages imports {};
     PackageName package {};
     Value node {};
+    // Names of the global slots, filled in by the ScopeResolver.
+    std::vector<std::string> globals {};
+    // Unique among the trees the ScopeResolver produces, so that state kept
+    // for the nodes of a tree is not taken for that of another tree reusing
+    // their addresses.
+    uint64_t id = 0;
 };
 
 }    // namespace expressions::ast
@@ -422,6 +456,7 @@ BOOST_FUSION_ADAPT_STRUCT(expressions::ast::LazyAssignStatement, target, expr)
 BOOST_FUSION_ADAPT_STRUCT(expressions::ast::AugAssignStatement, target, op,
                           expr)
 BOOST_FUSION_ADAPT_STRUCT(expressions::ast::ReturnStatement, expr)
+BOOST_FUSION_ADAPT_STRUCT(expressions::ast::YieldStatement, expr)
 BOOST_FUSION_ADAPT_STRUCT(expressions::ast::StatementList, stmts)
 
 BOOST_FUSION_ADAPT_STRUCT(expressions::ast::ExternFunctionDecl, decorators,
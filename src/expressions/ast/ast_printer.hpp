@@ -226,6 +226,14 @@ public:
             return fmt::format("ReturnStatement[]");
         }
     }
+    ReturnType operator()(const YieldStatement& node) const {
+        if (node.expr.has_value()) {
+            return fmt::format("YieldStatement[expr={}]",
+                               visit(node.expr.value()));
+        } else {
+            return fmt::format("YieldStatement[]");
+        }
+    }
     ReturnType operator()(const StatementList& node) const {
         auto stmts = std::vector<ReturnType> {};
         stmts.reserve(node.stmts.size());
@@ -238,9 +246,32 @@ public:
     }
 
     ReturnType operator()(const ExternFunctionDecl& node) const {
-        (void)node;
+        auto decorators = std::vector<ReturnType> {};
+        decorators.reserve(node.decorators.size());
+        std::transform(node.decorators.begin(), node.decorators.end(),
+                       std::back_inserter(decorators), [&](const auto& v) {
+                           return visit(v);
+                       });
+        auto name = visit(node.name);
+        auto params = std::vector<ReturnType> {};
+        params.reserve(node.params.size());
+        std::transform(node.params.begin(), node.params.end(),
+                       std::back_inserter(params), [&](const auto& v) {
+                           return visit(v);
+                       });
+        auto return_type = visit(node.return_type);
 
-        return fmt::format("ExternFunctionDecl[]");
+        if (decorators.empty()) {
+            return fmt::format(
+                "ExternFunctionDecl[name={}, params=[{}], return_type={}]",
+                name, fmt::join(params, ", "), return_type);
+        } else {
+            return fmt::format(
+                "ExternFunctionDecl[decorators=[{}], name={}, params=[{}], "
+                "return_type={}]",
+                fmt::join(decorators, ", "), name, fmt::join(params, ", "),
+                return_type);
+        }
     }
     ReturnType operator()(const FunctionDef& node) const {
         auto decorators = std::vector<ReturnType> {};
@@ -289,9 +320,13 @@ public:
             init, condition, iter, body);
     }
     ReturnType operator()(const RangeBasedForStatement& node) const {
-        (void)node;
+        auto target = visit(node.target);
+        auto iter = visit(node.iter);
+        auto body = visit(node.body);
 
-        return fmt::format("RangeBasedForStatement[]");
+        return fmt::format(
+            "RangeBasedForStatement[target=[{}], iter=[{}], body=[{}]]",
+            target, iter, body);
     }
     ReturnType operator()(const WhileStatement& node) const {
         auto condition = visit(node.condition);
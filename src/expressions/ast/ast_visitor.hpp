@@ -144,6 +144,9 @@ public:
     ReturnType operator()(const ReturnStatement& node) const {
         return get().return_(node);
     }
+    ReturnType operator()(const YieldStatement& node) const {
+        return get().return_(node);
+    }
     ReturnType operator()(const StatementList& node) const {
         return get().return_(node);
     }
@@ -417,6 +420,13 @@ public:
             return ReturnType {ReturnStatement {}};
         }
     }
+    ReturnType operator()(const YieldStatement& node) const {
+        if (node.expr.has_value()) {
+            return ReturnType {YieldStatement {visit(node.expr.value())}};
+        } else {
+            return ReturnType {YieldStatement {}};
+        }
+    }
     ReturnType operator()(const StatementList& node) const {
         auto new_stmts = std::vector<Value> {};
         new_stmts.reserve(node.stmts.size());
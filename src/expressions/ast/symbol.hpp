@@ -0,0 +1,84 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_AST_SYMBOL_HPP__
+#define __EXPRESSIONS_AST_SYMBOL_HPP__
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+
+namespace expressions::ast {
+
+// An interned identifier. Equal names intern to the same symbol, so symbols
+// compare and hash as pointers, and every distinct name is stored once for
+// the whole process. Interning locks a process-wide table that is never
+// shrunk; copying or reading a symbol does not touch it.
+class Symbol {
+public:
+    // The empty name.
+    Symbol() noexcept = default;
+    explicit Symbol(std::string_view name) : name_ {intern_(name)} {}
+
+    std::string_view name() const noexcept {
+        return name_ ? std::string_view {*name_} : std::string_view {};
+    }
+    const void* id() const noexcept {
+        return name_;
+    }
+
+    bool operator==(const Symbol& rhs) const noexcept {
+        return name_ == rhs.name_;
+    }
+    bool operator!=(const Symbol& rhs) const noexcept {
+        return name_ != rhs.name_;
+    }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const noexcept {
+            return std::hash<std::string_view> {}(name);
+        }
+    };
+
+    static const std::string* intern_(std::string_view name) {
+        if (name.empty()) {
+            return nullptr;
+        }
+
+        static auto mutex = std::mutex {};
+        static auto names
+            = std::unordered_set<std::string, Hash, std::equal_to<>> {};
+
+        auto lock = std::lock_guard {mutex};
+        auto it = names.find(name);
+        if (it == names.end()) {
+            it = names.emplace(name).first;
+        }
+
+        return &*it;
+    }
+
+private:
+    const std::string* name_ = nullptr;
+};
+
+}    // namespace expressions::ast
+
+template<>
+struct std::hash<expressions::ast::Symbol> {
+    size_t operator()(const expressions::ast::Symbol& symbol) const noexcept {
+        return std::hash<const void*> {}(symbol.id());
+    }
+};
+
+#endif
@@ -0,0 +1,100 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_CLOSURE_CLOSURE_HPP__
+#define __EXPRESSIONS_CLOSURE_CLOSURE_HPP__
+
+#include <expressions/interpreter/generator.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace expressions::closure {
+
+using interpreter::BoxedValue;
+
+struct FunctionCode;
+
+struct Global {
+    BoxedValue value {};
+    // Index of the lazy code in Program::functions, if any.
+    int32_t lazy = -1;
+    bool defined = false;
+};
+
+// State of a running program. It is shared by every closure of the program
+// and owned by the ClosureInterpreter.
+struct Runtime {
+    std::vector<Global> globals {};
+    // Arguments of the running functions. A frame addresses its own ones
+    // relative to its base.
+    std::vector<BoxedValue> locals {};
+};
+
+struct Frame {
+    size_t base = 0;
+    // Function whose parameters are visible to dynamic name lookups.
+    const FunctionCode* scope = nullptr;
+    // Value of the last return statement executed in the frame.
+    BoxedValue result {};
+};
+
+// How a statement finished. Anything but kNormal unwinds the enclosing
+// statements up to the loop or the function handling it.
+enum class Completion : int32_t {
+    kNormal,
+    kReturn,
+    kBreak,
+    kContinue,
+};
+
+using Evaluator = std::function<BoxedValue(Runtime&, Frame&)>;
+using Executor = std::function<Completion(Runtime&, Frame&)>;
+// Runs a statement of a generator body, suspending at its yields.
+using Streamer
+    = std::function<interpreter::Stream<Completion>(Runtime&, Frame&)>;
+
+enum class FunctionKind : int32_t {
+    kEntry,
+    kFunction,
+    kLambda,
+    kLazy,
+};
+
+struct FunctionCode {
+    FunctionKind kind {FunctionKind::kFunction};
+    std::string name {};
+    // Parameter names in the order of their local slots.
+    std::vector<std::string> params {};
+    // The same names interned, matched by the name lookups of lazy code.
+    std::vector<ast::Symbol> symbols {};
+    Evaluator body {};
+    // The statements of a generator function, whose body only returns a
+    // Generator running them.
+    Streamer stream {};
+    // Source of the body, for the builtins that evaluate simple callables
+    // natively. Lazy code has none.
+    std::shared_ptr<const ast::Value> source {};
+};
+
+struct Program {
+    // Names of the global slots.
+    std::vector<std::string> globals {};
+    // The same names interned.
+    std::vector<ast::Symbol> symbols {};
+    // functions[0] is the top-level code of the script.
+    std::vector<FunctionCode> functions {};
+};
+
+}    // namespace expressions::closure
+
+#endif
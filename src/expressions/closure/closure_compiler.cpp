@@ -0,0 +1,1532 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/closure/closure_compiler.hpp>
+
+#include <expressions/interpreter/builtins.hpp>
+#include <expressions/interpreter/constant_literal.hpp>
+#include <expressions/interpreter/generator.hpp>
+#include <expressions/interpreter/operators.hpp>
+
+#include <expressions/common/enumerate.hpp>
+#include <expressions/common/scope_exit.hpp>
+#include <expressions/exception/throw_exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+
+namespace expressions::closure {
+
+namespace {
+
+using interpreter::Null;
+
+using BinaryOperator = BoxedValue (*)(const BoxedValue&, const BoxedValue&);
+using UnaryOperator = BoxedValue (*)(const BoxedValue&);
+using Comparator = bool (*)(const BoxedValue&, const BoxedValue&);
+
+// The operators are instantiated for every operator type, so the type is
+// resolved once when the closure is built. Arithmetic and comparisons on the
+// common numeric pairs are handled inline; everything else goes through the
+// generic operators shared with the other engines, and both paths must
+// produce identical results.
+template<ast::BinOpType Op, typename A, typename B>
+BoxedValue arithmetic(A a, B b) {
+    if constexpr (Op == ast::BinOpType::kAdd) {
+        return a + b;
+    } else if constexpr (Op == ast::BinOpType::kSub) {
+        return a - b;
+    } else if constexpr (Op == ast::BinOpType::kMult) {
+        return a * b;
+    } else if constexpr (Op == ast::BinOpType::kTrueDiv) {
+        return a / b;
+    } else if constexpr (Op == ast::BinOpType::kFloorDiv) {
+        return static_cast<int64_t>(a / b);
+    } else if constexpr (Op == ast::BinOpType::kMod) {
+        if constexpr (std::same_as<A, double> || std::same_as<B, double>) {
+            return std::fmod(a, b);
+        } else {
+            return a % b;
+        }
+    } else {
+        return interpreter::power(a, b);
+    }
+}
+
+template<ast::BinOpType Op>
+BoxedValue bin_op(const BoxedValue& left, const BoxedValue& right) {
+    if constexpr (Op != ast::BinOpType::kNone) {
+        if (const auto* lhs = boost::get<int64_t>(&left)) {
+            if (const auto* rhs = boost::get<int64_t>(&right)) {
+                return arithmetic<Op>(*lhs, *rhs);
+            } else if (const auto* rhs_double = boost::get<double>(&right)) {
+                return arithmetic<Op>(*lhs, *rhs_double);
+            }
+        } else if (const auto* lhs_double = boost::get<double>(&left)) {
+            if (const auto* rhs = boost::get<double>(&right)) {
+                return arithmetic<Op>(*lhs_double, *rhs);
+            } else if (const auto* rhs_i64 = boost::get<int64_t>(&right)) {
+                return arithmetic<Op>(*lhs_double, *rhs_i64);
+            }
+        }
+    }
+
+    return interpreter::execute_bin_op(Op, left, right);
+}
+
+BinaryOperator bin_op_for(ast::BinOpType op) {
+    switch (op) {
+        case ast::BinOpType::kAdd: {
+            return bin_op<ast::BinOpType::kAdd>;
+        }
+        case ast::BinOpType::kSub: {
+            return bin_op<ast::BinOpType::kSub>;
+        }
+        case ast::BinOpType::kMult: {
+            return bin_op<ast::BinOpType::kMult>;
+        }
+        case ast::BinOpType::kTrueDiv: {
+            return bin_op<ast::BinOpType::kTrueDiv>;
+        }
+        case ast::BinOpType::kFloorDiv: {
+            return bin_op<ast::BinOpType::kFloorDiv>;
+        }
+        case ast::BinOpType::kMod: {
+            return bin_op<ast::BinOpType::kMod>;
+        }
+        case ast::BinOpType::kPow: {
+            return bin_op<ast::BinOpType::kPow>;
+        }
+        case ast::BinOpType::kNone: {
+            break;
+        }
+    }
+
+    return bin_op<ast::BinOpType::kNone>;
+}
+
+template<ast::CompareOpType Op, typename A, typename B>
+bool comparison(A a, B b) {
+    if constexpr (Op == ast::CompareOpType::kEQ) {
+        return a == b;
+    } else if constexpr (Op == ast::CompareOpType::kNEQ) {
+        return a != b;
+    } else if constexpr (Op == ast::CompareOpType::kLT) {
+        return a < b;
+    } else if constexpr (Op == ast::CompareOpType::kLTE) {
+        return a <= b;
+    } else if constexpr (Op == ast::CompareOpType::kGT) {
+        return a > b;
+    } else {
+        return a >= b;
+    }
+}
+
+template<ast::CompareOpType Op>
+bool compare_op(const BoxedValue& left, const BoxedValue& right) {
+    if constexpr (Op != ast::CompareOpType::kNone
+                  && Op != ast::CompareOpType::kIn
+                  && Op != ast::CompareOpType::kNotIn) {
+        if (const auto* lhs = boost::get<int64_t>(&left)) {
+            if (const auto* rhs = boost::get<int64_t>(&right)) {
+                return comparison<Op>(*lhs, *rhs);
+            } else if (const auto* rhs_double = boost::get<double>(&right)) {
+                return comparison<Op>(*lhs, *rhs_double);
+            }
+        } else if (const auto* lhs_double = boost::get<double>(&left)) {
+            if (const auto* rhs = boost::get<double>(&right)) {
+                return comparison<Op>(*lhs_double, *rhs);
+            } else if (const auto* rhs_i64 = boost::get<int64_t>(&right)) {
+                return comparison<Op>(*lhs_double, *rhs_i64);
+            }
+        }
+    }
+
+    return interpreter::execute_compare_op(Op, left, right);
+}
+
+Comparator compare_op_for(ast::CompareOpType op) {
+    switch (op) {
+        case ast::CompareOpType::kEQ: {
+            return compare_op<ast::CompareOpType::kEQ>;
+        }
+        case ast::CompareOpType::kNEQ: {
+            return compare_op<ast::CompareOpType::kNEQ>;
+        }
+        case ast::CompareOpType::kLT: {
+            return compare_op<ast::CompareOpType::kLT>;
+        }
+        case ast::CompareOpType::kLTE: {
+            return compare_op<ast::CompareOpType::kLTE>;
+        }
+        case ast::CompareOpType::kGT: {
+            return compare_op<ast::CompareOpType::kGT>;
+        }
+        case ast::CompareOpType::kGTE: {
+            return compare_op<ast::CompareOpType::kGTE>;
+        }
+        case ast::CompareOpType::kIn: {
+            return compare_op<ast::CompareOpType::kIn>;
+        }
+        case ast::CompareOpType::kNotIn: {
+            return compare_op<ast::CompareOpType::kNotIn>;
+        }
+        case ast::CompareOpType::kNone: {
+            break;
+        }
+    }
+
+    return compare_op<ast::CompareOpType::kNone>;
+}
+
+template<ast::BoolOpType Op>
+BoxedValue unary_op(const BoxedValue& operand) {
+    if constexpr (Op == ast::BoolOpType::kMinus) {
+        if (const auto* value = boost::get<int64_t>(&operand)) {
+            return -*value;
+        } else if (const auto* value_double = boost::get<double>(&operand)) {
+            return -*value_double;
+        }
+    }
+
+    return interpreter::execute_unary_op(Op, operand);
+}
+
+UnaryOperator unary_op_for(ast::BoolOpType op) {
+    switch (op) {
+        case ast::BoolOpType::kNot: {
+            return unary_op<ast::BoolOpType::kNot>;
+        }
+        case ast::BoolOpType::kPlus: {
+            return unary_op<ast::BoolOpType::kPlus>;
+        }
+        case ast::BoolOpType::kMinus: {
+            return unary_op<ast::BoolOpType::kMinus>;
+        }
+        case ast::BoolOpType::kAnd: {
+            return unary_op<ast::BoolOpType::kAnd>;
+        }
+        case ast::BoolOpType::kOr: {
+            return unary_op<ast::BoolOpType::kOr>;
+        }
+        case ast::BoolOpType::kDefault: {
+            break;
+        }
+    }
+
+    return unary_op<ast::BoolOpType::kDefault>;
+}
+
+bool condition(const BoxedValue& value) {
+    if (const auto* flag = boost::get<bool>(&value)) {
+        return *flag;
+    }
+
+    return interpreter::check_branch_condition(value);
+}
+
+BoxedValue load_global(const Program& program, Runtime& runtime,
+                       const Frame& frame, int32_t slot) {
+    const auto& global = runtime.globals[slot];
+    if (!global.defined) {
+        const auto& name = program.globals[slot];
+        fmt::print("Symbol {} not found.\n", name);
+        return interpreter::Name {name};
+    }
+
+    if (global.lazy < 0) {
+        return global.value;
+    }
+
+    // Lazy code is evaluated on every read, in the scope of the reader.
+    auto reader = Frame {frame.base, frame.scope};
+    return program.functions[global.lazy].body(runtime, reader);
+}
+
+Evaluator constant(BoxedValue value) {
+    return [value = std::move(value)](Runtime&, Frame&) -> BoxedValue {
+        return value;
+    };
+}
+
+// The function a callable value runs, checked to take argc arguments. The
+// name is for errors only.
+const FunctionCode& callable_code(const Program& program,
+                                  const BoxedValue& object,
+                                  std::string_view name, size_t argc) {
+    auto code = -1;
+    auto type_name = std::string {};
+    if (const auto* lambda = boost::get<interpreter::Lambda>(&object)) {
+        code = lambda->code;
+        type_name
+            = boost::typeindex::type_id<decltype(*lambda)>().pretty_name();
+    } else if (const auto* func = boost::get<interpreter::Function>(&object)) {
+        code = func->code;
+        type_name = boost::typeindex::type_id<decltype(*func)>().pretty_name();
+    }
+    if (code < 0) {
+        type_name
+            = boost::typeindex::type_id<decltype(object)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(
+            fmt::format("Object '{}' references to '{}' is not callable.",
+                        name, type_name)));
+    }
+
+    const auto& function = program.functions[code];
+    if (function.params.size() != argc) {
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "Failed to call object '{}' references to '{}'. It "
+            "takes {} arguments "
+            "but {} were given.",
+            name, type_name, function.params.size(), argc)));
+    }
+
+    return function;
+}
+
+// Calls back into the running program from the builtins taking a callable.
+class Callback final : public interpreter::Caller {
+public:
+    Callback(const Program& program, Runtime& runtime)
+        : program_ {program}, runtime_ {runtime} {}
+
+    BoxedValue call(const BoxedValue& callee,
+                    std::span<const BoxedValue> args) const override {
+        const auto& function
+            = callable_code(program_, callee, "callable", args.size());
+
+        auto base = runtime_.locals.size();
+        runtime_.locals.insert(runtime_.locals.end(), args.begin(),
+                               args.end());
+        auto frame = Frame {base, &function};
+        auto result = function.body(runtime_, frame);
+        runtime_.locals.resize(base);
+
+        return result;
+    }
+
+    std::optional<interpreter::CallableSource> source(
+        const BoxedValue& callee) const override {
+        auto code = -1;
+        if (const auto* lambda = boost::get<interpreter::Lambda>(&callee)) {
+            code = lambda->code;
+        } else if (const auto* func
+                   = boost::get<interpreter::Function>(&callee)) {
+            code = func->code;
+        }
+        if (code < 0 || !program_.functions[code].source) {
+            return std::nullopt;
+        }
+
+        const auto& function = program_.functions[code];
+        return interpreter::CallableSource {function.params.size(),
+                                            function.source.get()};
+    }
+
+private:
+    const Program& program_;
+    Runtime& runtime_;
+};
+
+Closure boolean(Predicate test) {
+    auto evaluate = [test](Runtime& runtime, Frame& frame) -> BoxedValue {
+        return test(runtime, frame);
+    };
+
+    return {std::move(evaluate), {}, {}, std::move(test)};
+}
+
+// A single comparison never boxes its result.
+Predicate test_of(Comparator compare, const Closure& left,
+                  const Closure& right) {
+    if (right.constant) {
+        return [compare, left = left.evaluate, right = *right.constant](
+                   Runtime& runtime, Frame& frame) {
+            return compare(left(runtime, frame), right);
+        };
+    }
+
+    return [compare, left = left.evaluate, right = right.evaluate](
+               Runtime& runtime, Frame& frame) {
+        auto lhs = left(runtime, frame);
+        return compare(lhs, right(runtime, frame));
+    };
+}
+
+// Assigns the element a range-based for statement walked to its targets.
+void assign_targets(Runtime& runtime, const std::vector<int32_t>& slots,
+                    std::vector<BoxedValue>& values) {
+    for (size_t index = 0; index < slots.size(); ++index) {
+        auto& global = runtime.globals[slots[index]];
+        global.value = std::move(values[index]);
+        global.lazy = -1;
+        global.defined = true;
+    }
+}
+
+// The statements of generator bodies run as coroutines, suspending at each
+// yield. Statements without a yield run as executors and finish at once.
+// The coroutines refer to the closures they are given, which the program
+// owns.
+using interpreter::Stream;
+
+Stream<Completion> yield_value(const Evaluator& value, Runtime& runtime,
+                               Frame& frame) {
+    co_yield value(runtime, frame);
+    co_return Completion::kNormal;
+}
+
+Stream<Completion> stream_statements(const std::vector<Streamer>& stmts,
+                                     Runtime& runtime, Frame& frame) {
+    for (const auto& stmt : stmts) {
+        auto inner = stmt(runtime, frame);
+        while (inner.next()) {
+            co_yield inner.take();
+        }
+        if (inner.result() != Completion::kNormal) {
+            co_return inner.result();
+        }
+    }
+    co_return Completion::kNormal;
+}
+
+Stream<Completion> stream_branch(const Predicate& test, const Streamer& body,
+                                 const Streamer& or_else, Runtime& runtime,
+                                 Frame& frame) {
+    const auto& branch = test(runtime, frame) ? body : or_else;
+    if (!branch) {
+        co_return Completion::kNormal;
+    }
+    auto inner = branch(runtime, frame);
+    while (inner.next()) {
+        co_yield inner.take();
+    }
+    co_return inner.result();
+}
+
+// A for statement, or a while statement which has no init and no iter.
+Stream<Completion> stream_loop(const Executor& init, const Predicate& test,
+                               const Executor& iter, const Streamer& body,
+                               Runtime& runtime, Frame& frame) {
+    if (init) {
+        init(runtime, frame);
+    }
+    while (test(runtime, frame)) {
+        auto inner = body(runtime, frame);
+        while (inner.next()) {
+            co_yield inner.take();
+        }
+        if (inner.result() == Completion::kBreak) {
+            break;
+        } else if (inner.result() == Completion::kReturn) {
+            co_return Completion::kReturn;
+        }
+        if (iter) {
+            iter(runtime, frame);
+        }
+    }
+    co_return Completion::kNormal;
+}
+
+Stream<Completion> stream_range_loop(
+    const std::function<interpreter::Iterator(Runtime&, Frame&)>& begin,
+    const std::vector<int32_t>& slots, const Streamer& body, Runtime& runtime,
+    Frame& frame) {
+    auto iterator = begin(runtime, frame);
+    auto values = std::vector<BoxedValue>(slots.size());
+    while (iterator.next(values)) {
+        assign_targets(runtime, slots, values);
+        auto inner = body(runtime, frame);
+        while (inner.next()) {
+            co_yield inner.take();
+        }
+        if (inner.result() == Completion::kBreak) {
+            break;
+        } else if (inner.result() == Completion::kReturn) {
+            co_return Completion::kReturn;
+        }
+    }
+    co_return Completion::kNormal;
+}
+
+// A call to a generator function. The arguments are pushed as the locals of
+// the body for each resume, and popped when it suspends again.
+class GeneratorCall : public interpreter::GeneratorState {
+public:
+    GeneratorCall(Runtime& runtime, const FunctionCode& function,
+                  std::vector<BoxedValue> args)
+        : runtime_ {runtime},
+          args_ {std::move(args)},
+          frame_ {0, &function},
+          body_ {function.stream(runtime_, frame_)} {}
+
+private:
+    std::optional<BoxedValue> step_() override {
+        auto& locals = runtime_.locals;
+        auto base = locals.size();
+        locals.insert(locals.end(), args_.begin(), args_.end());
+        frame_.base = base;
+        auto yielded = body_.next();
+        locals.resize(base);
+
+        if (!yielded) {
+            return std::nullopt;
+        }
+
+        return body_.take();
+    }
+
+private:
+    Runtime& runtime_;
+    std::vector<BoxedValue> args_ {};
+    // The body keeps a reference to the frame.
+    Frame frame_ {};
+    Stream<Completion> body_;
+};
+
+struct NodeTypeName : boost::static_visitor<std::string> {
+    NodeTypeName() = default;
+
+    template<typename T>
+    std::string operator()(const T& node) const {
+        (void)node;
+
+        return boost::typeindex::type_id<T>().pretty_name();
+    }
+    template<typename T>
+    std::string operator()(const ast::x3::forward_ast<T>& node) const {
+        return (*this)(node.get());
+    }
+};
+
+// Assignments store to globals, so their target must be a name.
+[[noreturn]] void throw_unsupported_target(const ast::Value& target) {
+    THROW_EXCEPTION(std::runtime_error(
+        fmt::format("[Closure] Cannot assign to the AST node type '{}'",
+                    target.apply_visitor(NodeTypeName {}))));
+}
+
+}    // namespace
+
+auto ClosureCompiler::compile(const ast::Entry& node) const
+    -> std::shared_ptr<Program> {
+    program_ = std::make_shared<Program>();
+    globals_.clear();
+    scope_ = Scope {};
+
+    program_->functions.emplace_back(
+        FunctionCode {FunctionKind::kEntry, node.package.path.value});
+    auto body = (*this)(node).evaluate;
+    program_->functions.front().body = std::move(body);
+
+    auto program = std::move(program_);
+    globals_.clear();
+    scope_ = Scope {};
+
+    return program;
+}
+
+auto ClosureCompiler::operator()(const ast::MonoState& node) const
+    -> ReturnType {
+    (void)node;
+
+    THROW_EXCEPTION(std::logic_error("[Closure] Unexpected empty AST node."));
+}
+
+auto ClosureCompiler::operator()(const ast::Ellipsis& node) const
+    -> ReturnType {
+    (void)node;
+
+    return {constant(interpreter::Ellipsis {}), {}, interpreter::Ellipsis {}};
+}
+
+auto ClosureCompiler::operator()(const ast::Null& node) const -> ReturnType {
+    (void)node;
+
+    return {constant(Null {}), {}, Null {}};
+}
+
+auto ClosureCompiler::operator()(bool value) const -> ReturnType {
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(int64_t value) const -> ReturnType {
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(uint64_t value) const -> ReturnType {
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(double value) const -> ReturnType {
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(const ast::Name& node) const -> ReturnType {
+    return {load_name_(node.value)};
+}
+
+auto ClosureCompiler::operator()(const ast::String& node) const
+    -> ReturnType {
+    return {load_name_(node.value)};
+}
+
+auto ClosureCompiler::operator()(const ast::QuotedString& node) const
+    -> ReturnType {
+    auto value = interpreter::String {node.value};
+
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(const ast::Date& node) const -> ReturnType {
+    auto value = interpreter::Date::from_civil(node.year, node.month, node.day);
+
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(const ast::DateRange& node) const
+    -> ReturnType {
+    auto value = interpreter::DateRange {
+        interpreter::Date::from_civil(node.begin.year, node.begin.month,
+                                      node.begin.day),
+        interpreter::Date::from_civil(node.end.year, node.end.month,
+                                      node.end.day),
+    };
+
+    return {constant(value), {}, value};
+}
+
+auto ClosureCompiler::operator()(const ast::Tuple& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        return {constant(*value), {}, std::move(*value)};
+    }
+
+    auto values = std::vector<Evaluator> {};
+    for (const auto& value : node.values) {
+        values.emplace_back(evaluator_(value));
+    }
+
+    return {[values = std::move(values)](Runtime& runtime,
+                                         Frame& frame) -> BoxedValue {
+        auto result = interpreter::Tuple<BoxedValue> {};
+        auto& elements = result.mutate();
+        elements.reserve(values.size());
+        for (const auto& value : values) {
+            elements.emplace_back(value(runtime, frame));
+        }
+        return result;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::List& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        return {constant(*value), {}, std::move(*value)};
+    }
+
+    auto values = std::vector<Evaluator> {};
+    for (const auto& value : node.values) {
+        values.emplace_back(evaluator_(value));
+    }
+
+    return {[values = std::move(values)](Runtime& runtime,
+                                         Frame& frame) -> BoxedValue {
+        auto result = interpreter::Vector<BoxedValue> {};
+        auto& elements = result.mutate();
+        elements.reserve(values.size());
+        for (const auto& value : values) {
+            elements.emplace_back(value(runtime, frame));
+        }
+        return result;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::Dict& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        return {constant(*value), {}, std::move(*value)};
+    }
+
+    auto items = std::vector<std::pair<Evaluator, Evaluator>> {};
+    for (const auto& item : node.items) {
+        auto key = evaluator_(item.key);
+        items.emplace_back(std::move(key), evaluator_(item.value));
+    }
+
+    return {[items = std::move(items)](Runtime& runtime,
+                                       Frame& frame) -> BoxedValue {
+        auto result = interpreter::Map<BoxedValue, BoxedValue> {};
+        auto& elements = result.mutate();
+        for (const auto& [key, value] : items) {
+            auto k = key(runtime, frame);
+            elements.emplace(std::move(k), value(runtime, frame));
+        }
+        return result;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::Set& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        return {constant(*value), {}, std::move(*value)};
+    }
+
+    auto values = std::vector<Evaluator> {};
+    for (const auto& value : node.values) {
+        values.emplace_back(evaluator_(value));
+    }
+
+    return {[values = std::move(values)](Runtime& runtime,
+                                         Frame& frame) -> BoxedValue {
+        auto result = interpreter::Set<BoxedValue> {};
+        auto& elements = result.mutate();
+        for (const auto& value : values) {
+            elements.emplace(value(runtime, frame));
+        }
+        return result;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::CompareOp& node) const
+    -> ReturnType {
+    auto first = visit_(node.first);
+    if (node.rest.empty()) {
+        return first;
+    } else if (!first.evaluate) {
+        THROW_EXCEPTION(
+            std::runtime_error("[Closure] Operands must be expressions."));
+    }
+    if (node.rest.size() == 1) {
+        auto compare = compare_op_for(node.rest.front().op);
+        auto second = visit_(node.rest.front().operand);
+        if (!second.evaluate) {
+            THROW_EXCEPTION(
+                std::runtime_error("[Closure] Operands must be expressions."));
+        }
+        return boolean(test_of(compare, first, second));
+    }
+
+    // a < b < c evaluates each operand at most once and stops at the first
+    // comparison that fails.
+    auto operands = std::vector<std::pair<Comparator, Evaluator>> {};
+    for (const auto& operand : node.rest) {
+        operands.emplace_back(compare_op_for(operand.op),
+                              evaluator_(operand.operand));
+    }
+
+    return boolean([first = std::move(first.evaluate),
+                    operands = std::move(operands)](Runtime& runtime,
+                                                    Frame& frame) {
+        auto left = first(runtime, frame);
+        for (const auto& [compare, operand] : operands) {
+            auto right = operand(runtime, frame);
+            if (!compare(left, right)) {
+                return false;
+            }
+            left = std::move(right);
+        }
+        return true;
+    });
+}
+
+auto ClosureCompiler::operator()(const ast::BinOp& node) const -> ReturnType {
+    auto op = bin_op_for(node.op);
+    auto left = visit_(node.left);
+    auto right = visit_(node.right);
+    if (!left.evaluate || !right.evaluate) {
+        THROW_EXCEPTION(
+            std::runtime_error("[Closure] Operands must be expressions."));
+    }
+
+    if (right.constant) {
+        return {[op, left = std::move(left.evaluate),
+                 right = std::move(*right.constant)](Runtime& runtime,
+                                                     Frame& frame) {
+            return op(left(runtime, frame), right);
+        }};
+    } else if (left.constant) {
+        return {[op, left = std::move(*left.constant),
+                 right = std::move(right.evaluate)](Runtime& runtime,
+                                                    Frame& frame) {
+            return op(left, right(runtime, frame));
+        }};
+    }
+
+    return {[op, left = std::move(left.evaluate),
+             right = std::move(right.evaluate)](Runtime& runtime,
+                                                Frame& frame) {
+        auto lhs = left(runtime, frame);
+        return op(lhs, right(runtime, frame));
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::Call& node) const -> ReturnType {
+    auto args = std::vector<Evaluator> {};
+    args.reserve(node.args.size());
+    for (const auto& arg : node.args) {
+        args.emplace_back(evaluator_(arg));
+    }
+
+    if (auto function = parser::builtin_function_of(node.name)) {
+        return {[program = program_.get(), args = std::move(args),
+                 builtin = &interpreter::builtin_of(*function)](
+                    Runtime& runtime, Frame& frame) -> BoxedValue {
+            auto values = std::vector<BoxedValue> {};
+            values.reserve(args.size());
+            for (const auto& arg : args) {
+                values.emplace_back(arg(runtime, frame));
+            }
+            return (*builtin)(values, Callback {*program, runtime});
+        }};
+    }
+    if (node.name.scope == ast::NameScope::kExtern) {
+        auto host = hosts_ ? hosts_->bind(node.name.symbol, args.size())
+                           : interpreter::HostFunction {
+                               node.name.value,
+                               static_cast<int32_t>(args.size())};
+        return {[args = std::move(args), host = std::move(host)](
+                    Runtime& runtime, Frame& frame) -> BoxedValue {
+            if (!host.boxed) {
+                interpreter::throw_unbound_host_function(host.name,
+                                                         args.size());
+            }
+
+            auto values = std::vector<BoxedValue> {};
+            values.reserve(args.size());
+            for (const auto& arg : args) {
+                values.emplace_back(arg(runtime, frame));
+            }
+            return host.boxed(values);
+        }};
+    }
+
+    return {[program = program_.get(), args = std::move(args),
+             callee = load_name_(node.name.value),
+             name = node.name.value](Runtime& runtime,
+                                     Frame& frame) -> BoxedValue {
+        // The arguments become the locals of the callee.
+        auto base = runtime.locals.size();
+        for (const auto& arg : args) {
+            auto value = arg(runtime, frame);
+            runtime.locals.emplace_back(std::move(value));
+        }
+        auto object = callee(runtime, frame);
+        const auto& function
+            = callable_code(*program, object, name, args.size());
+
+        auto callee_frame = Frame {base, &function};
+        auto result = function.body(runtime, callee_frame);
+        runtime.locals.resize(base);
+
+        return result;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::Argument& node) const
+    -> ReturnType {
+    return visit_(node.arg);
+}
+
+auto ClosureCompiler::operator()(const ast::KeywordArgument& node) const
+    -> ReturnType {
+    return visit_(node.arg);
+}
+
+auto ClosureCompiler::operator()(const ast::Subscript& node) const
+    -> ReturnType {
+    auto object = evaluator_(node.name);
+    auto subscript = evaluator_(node.expr);
+
+    return {[object = std::move(object), subscript = std::move(subscript)](
+                Runtime& runtime, Frame& frame) {
+        auto value = object(runtime, frame);
+        return interpreter::execute_subscript(value, subscript(runtime, frame));
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::UnaryOp& node) const
+    -> ReturnType {
+    return {[op = unary_op_for(node.op), operand = evaluator_(node.operand)](
+                Runtime& runtime, Frame& frame) {
+        return op(operand(runtime, frame));
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::BoolOp& node) const
+    -> ReturnType {
+    auto operands = std::vector<Predicate> {};
+    for (const auto& operand : node.operands) {
+        operands.emplace_back(predicate_(operand));
+    }
+
+    // Both operators short-circuit and always produce a boolean. The other
+    // operator types evaluate every operand and produce false.
+    switch (node.op) {
+        case ast::BoolOpType::kAnd: {
+            return boolean([operands = std::move(operands)](Runtime& runtime,
+                                                            Frame& frame) {
+                return std::all_of(operands.begin(), operands.end(),
+                                   [&](const auto& operand) {
+                                       return operand(runtime, frame);
+                                   });
+            });
+        }
+        case ast::BoolOpType::kOr: {
+            return boolean([operands = std::move(operands)](Runtime& runtime,
+                                                            Frame& frame) {
+                return std::any_of(operands.begin(), operands.end(),
+                                   [&](const auto& operand) {
+                                       return operand(runtime, frame);
+                                   });
+            });
+        }
+        case ast::BoolOpType::kDefault:
+        case ast::BoolOpType::kNot:
+        case ast::BoolOpType::kPlus:
+        case ast::BoolOpType::kMinus: {
+            break;
+        }
+    }
+
+    return boolean([operands = std::move(operands)](Runtime& runtime,
+                                                    Frame& frame) {
+        for (const auto& operand : operands) {
+            operand(runtime, frame);
+        }
+        return false;
+    });
+}
+
+auto ClosureCompiler::operator()(const ast::Lambda& node) const
+    -> ReturnType {
+    auto function = compile_function_(FunctionKind::kLambda, "<lambda>",
+                                      node.params, node.expr);
+
+    return {make_function_(function)};
+}
+
+auto ClosureCompiler::operator()(const ast::Expression& node) const
+    -> ReturnType {
+    return visit_(node.expr);
+}
+
+auto ClosureCompiler::operator()(const ast::AssignStatement& node) const
+    -> ReturnType {
+    if (!ast::holds_alternative<ast::Name>(node.target)) {
+        throw_unsupported_target(node.target);
+    }
+    const auto& target = ast::get<ast::Name>(node.target);
+    const auto& name = target.value;
+    if (const auto* func = ast::get_if<ast::FunctionDef>(&node.expr)) {
+        auto function = compile_function_(FunctionKind::kFunction,
+                                          func->name.value, func->params,
+                                          func->body);
+        return {{}, store_global_(name, make_function_(function))};
+    } else if (const auto* call
+               = interpreter::in_place_call(target, node.expr)) {
+        auto args = std::vector<Evaluator> {};
+        args.reserve(call->args.size());
+        for (const auto& arg : call->args) {
+            args.emplace_back(evaluator_(arg));
+        }
+
+        // The value of the global is handed over to the call, not copied,
+        // and given back if the call throws.
+        auto value = [program = program_.get(), slot = resolve_global_(name),
+                      args = std::move(args),
+                      builtin = &interpreter::builtin_of(
+                          *parser::builtin_function_of(call->name))](
+                         Runtime& runtime, Frame& frame) -> BoxedValue {
+            auto values = std::vector<BoxedValue> {};
+            values.reserve(args.size());
+            for (const auto& arg : args) {
+                values.emplace_back(arg(runtime, frame));
+            }
+
+            auto& global = runtime.globals[slot];
+            auto handed_over = global.defined && global.lazy < 0
+                               && interpreter::can_hand_over(values,
+                                                             global.value);
+            if (handed_over) {
+                values.front() = std::exchange(global.value, Null {});
+            }
+            auto restore = ScopeExit {[&] {
+                if (handed_over) {
+                    global.value = std::move(values.front());
+                }
+            }};
+            auto result = (*builtin)(values, Callback {*program, runtime});
+            handed_over = false;
+            return result;
+        };
+        return {{}, store_global_(name, std::move(value))};
+    }
+
+    return {{}, store_global_(name, evaluator_(node.expr))};
+}
+
+auto ClosureCompiler::operator()(const ast::LazyAssignStatement& node) const
+    -> ReturnType {
+    if (!ast::holds_alternative<ast::Name>(node.target)) {
+        throw_unsupported_target(node.target);
+    }
+    const auto& name = ast::get<ast::Name>(node.target).value;
+    auto function
+        = compile_function_(FunctionKind::kLazy, name, {}, node.expr);
+
+    return {{}, [slot = resolve_global_(name), function](Runtime& runtime,
+                                                         Frame&) {
+        auto& global = runtime.globals[slot];
+        global.value = Null {};
+        global.lazy = function;
+        global.defined = true;
+        return Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::AugAssignStatement& node) const
+    -> ReturnType {
+    if (!ast::holds_alternative<ast::Name>(node.target)) {
+        throw_unsupported_target(node.target);
+    }
+    const auto& name = ast::get<ast::Name>(node.target).value;
+    if (node.op != ast::BinOpType::kAdd) {
+        auto value = (*this)(ast::BinOp {node.target, node.op, node.expr});
+        return {{}, store_global_(name, std::move(value.evaluate))};
+    }
+
+    // `+=` appends in place to a list or string that the global holds, once
+    // the value read from it is released.
+    return {{}, [slot = resolve_global_(name), op = bin_op_for(node.op),
+                 left = evaluator_(node.target),
+                 right = evaluator_(node.expr)](Runtime& runtime,
+                                                Frame& frame) {
+        auto lhs = left(runtime, frame);
+        auto rhs = right(runtime, frame);
+        auto& global = runtime.globals[slot];
+        if (global.defined && global.lazy < 0
+            && interpreter::shares_contents(lhs, global.value)) {
+            lhs = Null {};
+            if (interpreter::execute_inplace_op(ast::BinOpType::kAdd,
+                                                global.value, rhs)) {
+                return Completion::kNormal;
+            }
+            lhs = global.value;
+        }
+        global.value = op(lhs, rhs);
+        global.lazy = -1;
+        global.defined = true;
+        return Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::ReturnStatement& node) const
+    -> ReturnType {
+    auto value = node.expr ? evaluator_(*node.expr) : constant(Null {});
+
+    return {{}, [value = std::move(value)](Runtime& runtime, Frame& frame) {
+        frame.result = value(runtime, frame);
+        return Completion::kReturn;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::YieldStatement& node) const
+    -> ReturnType {
+    // Yields inside functions are compiled by streamer_.
+    (void)node;
+
+    THROW_EXCEPTION(std::runtime_error("[Closure] 'yield' outside function"));
+}
+
+auto ClosureCompiler::operator()(const ast::StatementList& node) const
+    -> ReturnType {
+    auto stmts = std::vector<Executor> {};
+    for (const auto& stmt : node.stmts) {
+        if (auto execute = executor_(stmt)) {
+            stmts.emplace_back(std::move(execute));
+        }
+    }
+
+    return {{}, [stmts = std::move(stmts)](Runtime& runtime, Frame& frame) {
+        for (const auto& stmt : stmts) {
+            auto completion = stmt(runtime, frame);
+            if (completion != Completion::kNormal) {
+                return completion;
+            }
+        }
+        return Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::ExternFunctionDecl& node) const
+    -> ReturnType {
+    (void)node;
+
+    return {};
+}
+
+auto ClosureCompiler::operator()(const ast::FunctionDef& node) const
+    -> ReturnType {
+    auto function = compile_function_(FunctionKind::kFunction,
+                                      node.name.value, node.params, node.body);
+
+    return {{}, store_global_(node.name.value, make_function_(function))};
+}
+
+auto ClosureCompiler::operator()(const ast::IfStatement& node) const
+    -> ReturnType {
+    auto test = predicate_(node.condition);
+    auto body = executor_(node.body);
+    auto or_else = ast::holds_alternative<ast::MonoState>(node.or_else)
+                       ? Executor {}
+                       : executor_(node.or_else);
+
+    return {{}, [test = std::move(test), body = std::move(body),
+                 or_else = std::move(or_else)](Runtime& runtime,
+                                               Frame& frame) {
+        if (test(runtime, frame)) {
+            return body ? body(runtime, frame) : Completion::kNormal;
+        }
+        return or_else ? or_else(runtime, frame) : Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::ForStatement& node) const
+    -> ReturnType {
+    auto init = executor_(node.init);
+    auto test = predicate_(node.condition);
+    auto iter = executor_(node.iter);
+    ++scope_.loops;
+    auto body = executor_(node.body);
+    --scope_.loops;
+
+    return {{}, [init = std::move(init), test = std::move(test),
+                 iter = std::move(iter),
+                 body = std::move(body)](Runtime& runtime, Frame& frame) {
+        if (init) {
+            init(runtime, frame);
+        }
+        while (test(runtime, frame)) {
+            auto completion = body ? body(runtime, frame) : Completion::kNormal;
+            if (completion == Completion::kBreak) {
+                break;
+            } else if (completion == Completion::kReturn) {
+                return completion;
+            }
+            if (iter) {
+                iter(runtime, frame);
+            }
+        }
+        return Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::RangeBasedForStatement& node) const
+    -> ReturnType {
+    auto begin = iterator_(node.iter);
+    auto slots = std::vector<int32_t> {};
+    for (const auto& target : interpreter::for_targets(node.target)) {
+        slots.emplace_back(resolve_global_(target.value));
+    }
+    ++scope_.loops;
+    auto body = executor_(node.body);
+    --scope_.loops;
+
+    return {{}, [begin = std::move(begin), slots = std::move(slots),
+                 body = std::move(body)](Runtime& runtime, Frame& frame) {
+        auto iterator = begin(runtime, frame);
+        auto values = std::vector<BoxedValue>(slots.size());
+        while (iterator.next(values)) {
+            assign_targets(runtime, slots, values);
+            auto completion = body ? body(runtime, frame) : Completion::kNormal;
+            if (completion == Completion::kBreak) {
+                break;
+            } else if (completion == Completion::kReturn) {
+                return completion;
+            }
+        }
+        return Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::WhileStatement& node) const
+    -> ReturnType {
+    auto test = predicate_(node.condition);
+    ++scope_.loops;
+    auto body = executor_(node.body);
+    --scope_.loops;
+
+    return {{}, [test = std::move(test), body = std::move(body)](
+                    Runtime& runtime, Frame& frame) {
+        while (test(runtime, frame)) {
+            auto completion = body ? body(runtime, frame) : Completion::kNormal;
+            if (completion == Completion::kBreak) {
+                break;
+            } else if (completion == Completion::kReturn) {
+                return completion;
+            }
+        }
+        return Completion::kNormal;
+    }};
+}
+
+auto ClosureCompiler::operator()(const ast::Pass& node) const -> ReturnType {
+    (void)node;
+
+    return {};
+}
+
+auto ClosureCompiler::operator()(const ast::Break& node) const -> ReturnType {
+    (void)node;
+
+    if (scope_.loops == 0) {
+        THROW_EXCEPTION(std::runtime_error("[Closure] 'break' outside loop"));
+    }
+
+    return {{}, [](Runtime&, Frame&) {
+                return Completion::kBreak;
+            }};
+}
+
+auto ClosureCompiler::operator()(const ast::Continue& node) const
+    -> ReturnType {
+    (void)node;
+
+    if (scope_.loops == 0) {
+        THROW_EXCEPTION(
+            std::runtime_error("[Closure] 'continue' outside loop"));
+    }
+
+    return {{}, [](Runtime&, Frame&) {
+                return Completion::kContinue;
+            }};
+}
+
+auto ClosureCompiler::operator()(const ast::ImportPackage& node) const
+    -> ReturnType {
+    (void)node;
+
+    return {};
+}
+
+auto ClosureCompiler::operator()(const ast::PackageName& node) const
+    -> ReturnType {
+    (void)node;
+
+    return {};
+}
+
+auto ClosureCompiler::operator()(const ast::Entry& node) const -> ReturnType {
+    // A script made of a single expression evaluates to its value, any other
+    // script evaluates to null unless it returns explicitly.
+    if (!is_statement_(node.node)) {
+        return {evaluator_(node.node)};
+    }
+
+    auto execute = executor_(node.node);
+    return {[execute = std::move(execute)](Runtime& runtime,
+                                           Frame& frame) -> BoxedValue {
+        if (execute && execute(runtime, frame) == Completion::kReturn) {
+            return std::move(frame.result);
+        }
+        return Null {};
+    }};
+}
+
+Evaluator ClosureCompiler::evaluator_(const ast::Value& node) const {
+    auto closure = visit_(node);
+    if (!closure.evaluate) {
+        THROW_EXCEPTION(std::runtime_error(
+            "[Closure] Expected an expression, but got a statement."));
+    }
+
+    return std::move(closure.evaluate);
+}
+
+Predicate ClosureCompiler::predicate_(const ast::Value& node) const {
+    auto closure = visit_(node);
+    if (closure.test) {
+        return std::move(closure.test);
+    } else if (!closure.evaluate) {
+        THROW_EXCEPTION(std::runtime_error(
+            "[Closure] Expected an expression, but got a statement."));
+    }
+
+    return [evaluate = std::move(closure.evaluate)](Runtime& runtime,
+                                                    Frame& frame) {
+        return condition(evaluate(runtime, frame));
+    };
+}
+
+Executor ClosureCompiler::executor_(const ast::Value& node) const {
+    auto closure = visit_(node);
+    if (closure.execute || !closure.evaluate) {
+        return std::move(closure.execute);
+    }
+    // The value of a literal statement is never observed.
+    if (closure.constant) {
+        return {};
+    }
+
+    return [evaluate = std::move(closure.evaluate)](Runtime& runtime,
+                                                    Frame& frame) {
+        evaluate(runtime, frame);
+        return Completion::kNormal;
+    };
+}
+
+Streamer ClosureCompiler::streamer_(const ast::Value& node) const {
+    if (!interpreter::contains_yield(node)) {
+        return [execute = executor_(node)](Runtime& runtime, Frame& frame) {
+            return Stream {execute ? execute(runtime, frame)
+                                   : Completion::kNormal};
+        };
+    }
+
+    if (const auto* yield = ast::get_if<ast::YieldStatement>(&node)) {
+        auto value = yield->expr ? evaluator_(*yield->expr) : constant(Null {});
+        return [value = std::move(value)](Runtime& runtime, Frame& frame) {
+            return yield_value(value, runtime, frame);
+        };
+    }
+
+    if (const auto* list = ast::get_if<ast::StatementList>(&node)) {
+        auto stmts = std::vector<Streamer> {};
+        stmts.reserve(list->stmts.size());
+        for (const auto& stmt : list->stmts) {
+            stmts.emplace_back(streamer_(stmt));
+        }
+        return [stmts = std::move(stmts)](Runtime& runtime, Frame& frame) {
+            return stream_statements(stmts, runtime, frame);
+        };
+    }
+
+    if (const auto* branch = ast::get_if<ast::IfStatement>(&node)) {
+        auto test = predicate_(branch->condition);
+        auto body = streamer_(branch->body);
+        auto or_else = ast::holds_alternative<ast::MonoState>(branch->or_else)
+                           ? Streamer {}
+                           : streamer_(branch->or_else);
+        return [test = std::move(test), body = std::move(body),
+                or_else = std::move(or_else)](Runtime& runtime, Frame& frame) {
+            return stream_branch(test, body, or_else, runtime, frame);
+        };
+    }
+
+    if (const auto* loop = ast::get_if<ast::ForStatement>(&node)) {
+        auto init = executor_(loop->init);
+        auto test = predicate_(loop->condition);
+        auto iter = executor_(loop->iter);
+        ++scope_.loops;
+        auto body = streamer_(loop->body);
+        --scope_.loops;
+        return [init = std::move(init), test = std::move(test),
+                iter = std::move(iter),
+                body = std::move(body)](Runtime& runtime, Frame& frame) {
+            return stream_loop(init, test, iter, body, runtime, frame);
+        };
+    }
+
+    if (const auto* loop = ast::get_if<ast::WhileStatement>(&node)) {
+        auto test = predicate_(loop->condition);
+        ++scope_.loops;
+        auto body = streamer_(loop->body);
+        --scope_.loops;
+        // The coroutine keeps references to its arguments, so the missing
+        // init and iter live in the closure too.
+        return [test = std::move(test), body = std::move(body),
+                none = Executor {}](Runtime& runtime, Frame& frame) {
+            return stream_loop(none, test, none, body, runtime, frame);
+        };
+    }
+
+    const auto& loop = ast::get<ast::RangeBasedForStatement>(node);
+    auto begin = iterator_(loop.iter);
+    auto slots = std::vector<int32_t> {};
+    for (const auto& target : interpreter::for_targets(loop.target)) {
+        slots.emplace_back(resolve_global_(target.value));
+    }
+    ++scope_.loops;
+    auto body = streamer_(loop.body);
+    --scope_.loops;
+    return [begin = std::move(begin), slots = std::move(slots),
+            body = std::move(body)](Runtime& runtime, Frame& frame) {
+        return stream_range_loop(begin, slots, body, runtime, frame);
+    };
+}
+
+auto ClosureCompiler::iterator_(const ast::Value& iter) const
+    -> std::function<interpreter::Iterator(Runtime&, Frame&)> {
+    // A call to range() is walked without making the list.
+    if (const auto* call = interpreter::range_call(iter)) {
+        auto range = std::vector<Evaluator> {};
+        range.reserve(call->args.size());
+        for (const auto& arg : call->args) {
+            range.emplace_back(evaluator_(arg));
+        }
+        return [range = std::move(range)](Runtime& runtime, Frame& frame) {
+            auto args = std::vector<BoxedValue> {};
+            args.reserve(range.size());
+            for (const auto& arg : range) {
+                args.emplace_back(arg(runtime, frame));
+            }
+            return interpreter::Iterator {interpreter::Range::of(args)};
+        };
+    }
+
+    return [iterable = evaluator_(iter)](Runtime& runtime, Frame& frame) {
+        return interpreter::Iterator {iterable(runtime, frame)};
+    };
+}
+
+Evaluator ClosureCompiler::load_name_(const std::string& name) const {
+    const auto& function = program_->functions[scope_.function];
+    auto slot = resolve_global_(name);
+    if (function.kind == FunctionKind::kLazy) {
+        // Lazy code sees the parameters of whichever function reads it.
+        return [program = program_.get(), slot](Runtime& runtime,
+                                                Frame& frame) -> BoxedValue {
+            const auto& params = frame.scope->symbols;
+            auto it = std::find(params.begin(), params.end(),
+                                program->symbols[slot]);
+            if (it != params.end()) {
+                auto index = std::distance(params.begin(), it);
+                return runtime.locals[frame.base + index];
+            }
+            return load_global(*program, runtime, frame, slot);
+        };
+    }
+
+    auto it = std::find(scope_.params.begin(), scope_.params.end(), name);
+    if (it != scope_.params.end()) {
+        auto index = static_cast<size_t>(
+            std::distance(scope_.params.begin(), it));
+        return [index](Runtime& runtime, Frame& frame) {
+            return runtime.locals[frame.base + index];
+        };
+    }
+
+    return [program = program_.get(), slot](Runtime& runtime, Frame& frame) {
+        return load_global(*program, runtime, frame, slot);
+    };
+}
+
+Executor ClosureCompiler::store_global_(const std::string& name,
+                                        Evaluator value) const {
+    return [slot = resolve_global_(name), value = std::move(value)](
+               Runtime& runtime, Frame& frame) {
+        auto result = value(runtime, frame);
+        auto& global = runtime.globals[slot];
+        global.value = std::move(result);
+        global.lazy = -1;
+        global.defined = true;
+        return Completion::kNormal;
+    };
+}
+
+Evaluator ClosureCompiler::make_function_(int32_t function) const {
+    const auto& code = program_->functions[function];
+    if (code.kind == FunctionKind::kLambda) {
+        return constant(interpreter::Lambda {{}, function});
+    }
+
+    return constant(interpreter::Function {{code.name}, {}, function});
+}
+
+int32_t ClosureCompiler::resolve_global_(const std::string& name) const {
+    auto [it, inserted] = globals_.try_emplace(
+        name, static_cast<int32_t>(program_->globals.size()));
+    if (inserted) {
+        program_->globals.emplace_back(name);
+        program_->symbols.emplace_back(name);
+    }
+
+    return it->second;
+}
+
+int32_t ClosureCompiler::compile_function_(
+    FunctionKind kind, const std::string& name,
+    const std::vector<ast::Value>& params, const ast::Value& body) const {
+    auto function = FunctionCode {kind, name};
+    function.params.reserve(params.size());
+    function.symbols.reserve(params.size());
+    for (const auto& param : params) {
+        function.params.emplace_back(param_name_(param));
+        function.symbols.emplace_back(function.params.back());
+    }
+
+    auto index = static_cast<int32_t>(program_->functions.size());
+    program_->functions.emplace_back(std::move(function));
+
+    auto scope = Scope {index, program_->functions[index].params};
+    std::swap(scope_, scope);
+    auto evaluate = Evaluator {};
+    if (kind != FunctionKind::kLazy) {
+        program_->functions[index].source
+            = std::make_shared<const ast::Value>(body);
+    }
+    if (kind == FunctionKind::kLazy) {
+        evaluate = evaluator_(body);
+    } else if (interpreter::contains_yield(body)) {
+        // Calling a generator function only binds its arguments; the body
+        // runs as the generator is resumed.
+        program_->functions[index].stream = streamer_(body);
+        evaluate = [](Runtime& runtime, Frame& frame) -> BoxedValue {
+            const auto& code = *frame.scope;
+            auto args = std::vector<BoxedValue>(
+                runtime.locals.begin() + static_cast<ptrdiff_t>(frame.base),
+                runtime.locals.begin()
+                    + static_cast<ptrdiff_t>(frame.base
+                                             + code.params.size()));
+            return interpreter::Generator {
+                std::make_shared<GeneratorCall>(runtime, code,
+                                                std::move(args))};
+        };
+    } else {
+        evaluate = [execute = executor_(body)](Runtime& runtime,
+                                               Frame& frame) -> BoxedValue {
+            if (execute && execute(runtime, frame) == Completion::kReturn) {
+                return std::move(frame.result);
+            }
+            return Null {};
+        };
+    }
+    std::swap(scope_, scope);
+    program_->functions[index].body = std::move(evaluate);
+
+    return index;
+}
+
+bool ClosureCompiler::is_statement_(const ast::Value& node) {
+    return ast::holds_any_of<
+        ast::AssignStatement, ast::LazyAssignStatement, ast::AugAssignStatement,
+        ast::ReturnStatement, ast::YieldStatement, ast::StatementList,
+        ast::ExternFunctionDecl,
+        ast::FunctionDef, ast::IfStatement, ast::ForStatement,
+        ast::RangeBasedForStatement, ast::WhileStatement, ast::Pass,
+        ast::Break, ast::Continue, ast::ImportPackage, ast::PackageName>(node);
+}
+
+std::string ClosureCompiler::param_name_(const ast::Value& param) {
+    if (const auto* arg = ast::get_if<ast::Argument>(&param)) {
+        if (const auto* name = ast::get_if<ast::Name>(&arg->arg)) {
+            return name->value;
+        }
+    } else if (const auto* kwarg = ast::get_if<ast::KeywordArgument>(&param)) {
+        return kwarg->name.value;
+    }
+
+    THROW_EXCEPTION(
+        std::runtime_error("[Closure] Invalid parameter declaration."));
+}
+
+}    // namespace expressions::closure
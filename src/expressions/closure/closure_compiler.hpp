@@ -0,0 +1,178 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_CLOSURE_CLOSURE_COMPILER_HPP__
+#define __EXPRESSIONS_CLOSURE_CLOSURE_COMPILER_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/closure/closure.hpp>
+#include <expressions/interpreter/host_functions.hpp>
+#include <expressions/interpreter/iterator.hpp>
+
+#include <expressions/exception/throw_exception.hpp>
+#include <expressions/support/boost/variant.hpp>
+
+#include <fmt/format.h>
+#include <boost/type_index.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::closure {
+
+using Predicate = std::function<bool(Runtime&, Frame&)>;
+
+// A compiled AST node. Expressions evaluate to a value, statements execute
+// and report how they completed.
+struct Closure {
+    Evaluator evaluate {};
+    Executor execute {};
+    // Set for literals, so that their users can capture the value instead of
+    // calling a closure for it.
+    std::optional<BoxedValue> constant {};
+    // Set for expressions producing a boolean, so that branches can test it
+    // without boxing it.
+    Predicate test {};
+};
+
+// Walks the transformed AST once and turns it into a tree of closures. Every
+// decision that does not depend on runtime values is taken here: names are
+// resolved to local or global slots, operators are bound to the code for
+// their type, builtins and host functions are bound to their calls and
+// literals become captured constants. Evaluation then only calls the closures.
+class ClosureCompiler : public boost::static_visitor<Closure> {
+public:
+    ClosureCompiler() = default;
+    // Calls to the names scripts declare extern go to the host functions.
+    explicit ClosureCompiler(
+        std::shared_ptr<const interpreter::HostFunctions> hosts)
+        : hosts_ {std::move(hosts)} {}
+
+    using ReturnType = Closure;
+
+    auto compile(const ast::Entry& node) const -> std::shared_ptr<Program>;
+
+public:
+    ReturnType operator()(const ast::MonoState& node) const;
+
+    ReturnType operator()(const ast::Ellipsis& node) const;
+    ReturnType operator()(const ast::Null& node) const;
+    ReturnType operator()(bool value) const;
+
+    ReturnType operator()(int64_t value) const;
+    ReturnType operator()(uint64_t value) const;
+    ReturnType operator()(double value) const;
+
+    ReturnType operator()(const ast::Name& node) const;
+    ReturnType operator()(const ast::String& node) const;
+    ReturnType operator()(const ast::QuotedString& node) const;
+
+    ReturnType operator()(const ast::Date& node) const;
+    ReturnType operator()(const ast::DateRange& node) const;
+
+    ReturnType operator()(const ast::Tuple& node) const;
+    ReturnType operator()(const ast::List& node) const;
+    ReturnType operator()(const ast::Dict& node) const;
+    ReturnType operator()(const ast::Set& node) const;
+
+    ReturnType operator()(const ast::CompareOp& node) const;
+    ReturnType operator()(const ast::CompareOpOperand& node) const {
+        auto name = boost::typeindex::type_id<decltype(node)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "[Closure] Cannot compile the AST node type '{}'", name)));
+    }
+    ReturnType operator()(const ast::BinOp& node) const;
+    ReturnType operator()(const ast::BinOpIntermediate& node) const {
+        auto name = boost::typeindex::type_id<decltype(node)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "[Closure] Cannot compile the AST node type '{}'", name)));
+    }
+
+    ReturnType operator()(const ast::Call& node) const;
+    ReturnType operator()(const ast::Argument& node) const;
+    ReturnType operator()(const ast::KeywordArgument& node) const;
+
+    ReturnType operator()(const ast::Subscript& node) const;
+
+    ReturnType operator()(const ast::UnaryOp& node) const;
+    ReturnType operator()(const ast::BoolOp& node) const;
+
+    ReturnType operator()(const ast::Lambda& node) const;
+    ReturnType operator()(const ast::Expression& node) const;
+    ReturnType operator()(const ast::AssignStatement& node) const;
+    ReturnType operator()(const ast::LazyAssignStatement& node) const;
+    ReturnType operator()(const ast::AugAssignStatement& node) const;
+    ReturnType operator()(const ast::ReturnStatement& node) const;
+    ReturnType operator()(const ast::YieldStatement& node) const;
+    ReturnType operator()(const ast::StatementList& node) const;
+
+    ReturnType operator()(const ast::ExternFunctionDecl& node) const;
+    ReturnType operator()(const ast::FunctionDef& node) const;
+
+    ReturnType operator()(const ast::IfStatement& node) const;
+    ReturnType operator()(const ast::ForStatement& node) const;
+    ReturnType operator()(const ast::RangeBasedForStatement& node) const;
+    ReturnType operator()(const ast::WhileStatement& node) const;
+
+    ReturnType operator()(const ast::Pass& node) const;
+    ReturnType operator()(const ast::Break& node) const;
+    ReturnType operator()(const ast::Continue& node) const;
+
+    ReturnType operator()(const ast::ImportPackage& node) const;
+    ReturnType operator()(const ast::PackageName& node) const;
+
+    ReturnType operator()(const ast::Entry& node) const;
+
+private:
+    struct Scope {
+        int32_t function = 0;
+        std::vector<std::string> params {};
+        size_t loops = 0;
+    };
+
+    ReturnType visit_(const ast::Value& node) const {
+        return node.apply_visitor(*this);
+    }
+    // Compiles a node in expression or in statement position. Expressions
+    // used as statements discard their value.
+    Evaluator evaluator_(const ast::Value& node) const;
+    Executor executor_(const ast::Value& node) const;
+    Predicate predicate_(const ast::Value& node) const;
+    // Compiles a statement of a generator body.
+    Streamer streamer_(const ast::Value& node) const;
+    // Makes the iterator of a range-based for statement when the loop starts.
+    std::function<interpreter::Iterator(Runtime&, Frame&)> iterator_(
+        const ast::Value& iter) const;
+
+    Evaluator load_name_(const std::string& name) const;
+    Executor store_global_(const std::string& name, Evaluator value) const;
+    Evaluator make_function_(int32_t function) const;
+
+    int32_t resolve_global_(const std::string& name) const;
+    int32_t compile_function_(FunctionKind kind, const std::string& name,
+                              const std::vector<ast::Value>& params,
+                              const ast::Value& body) const;
+
+    static bool is_statement_(const ast::Value& node);
+    static std::string param_name_(const ast::Value& param);
+
+private:
+    std::shared_ptr<const interpreter::HostFunctions> hosts_ {};
+    mutable std::shared_ptr<Program> program_ {};
+    mutable std::unordered_map<std::string, int32_t> globals_ {};
+    mutable Scope scope_ {};
+};
+
+}    // namespace expressions::closure
+
+#endif
@@ -0,0 +1,30 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/closure/closure_interpreter.hpp>
+
+#include <expressions/closure/closure_compiler.hpp>
+
+
+namespace expressions::closure {
+
+BoxedValue ClosureInterpreter::execute(const Program& program) {
+    runtime_.globals.assign(program.globals.size(), Global {});
+    runtime_.locals.clear();
+
+    const auto& entry = program.functions.front();
+    auto frame = Frame {0, &entry};
+
+    return entry.body(runtime_, frame);
+}
+
+BoxedValue ClosureInterpreter::execute(const ast::Entry& node) {
+    auto program = ClosureCompiler {}.compile(node);
+
+    return execute(*program);
+}
+
+}    // namespace expressions::closure
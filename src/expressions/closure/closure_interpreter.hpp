@@ -0,0 +1,32 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_CLOSURE_CLOSURE_INTERPRETER_HPP__
+#define __EXPRESSIONS_CLOSURE_CLOSURE_INTERPRETER_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/closure/closure.hpp>
+
+
+namespace expressions::closure {
+
+// Runs the closure trees produced by ClosureCompiler. A compiled Program is
+// immutable and can be executed any number of times, by any number of
+// interpreters.
+class ClosureInterpreter {
+public:
+    ClosureInterpreter() = default;
+
+    BoxedValue execute(const Program& program);
+    BoxedValue execute(const ast::Entry& node);
+
+private:
+    Runtime runtime_ {};
+};
+
+}    // namespace expressions::closure
+
+#endif
@@ -0,0 +1,36 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_COMMON_SCOPE_EXIT_HPP__
+#define __EXPRESSIONS_COMMON_SCOPE_EXIT_HPP__
+
+#include <utility>
+
+
+namespace expressions {
+
+// Calls the function when the scope is left, whether normally or by an
+// exception.
+template<typename Function>
+class ScopeExit {
+public:
+    explicit ScopeExit(Function function) : function_(std::move(function)) {
+    }
+
+    ScopeExit(const ScopeExit&) = delete;
+    ScopeExit& operator=(const ScopeExit&) = delete;
+
+    ~ScopeExit() {
+        function_();
+    }
+
+private:
+    Function function_;
+};
+
+}    // namespace expressions
+
+#endif
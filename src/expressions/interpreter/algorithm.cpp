@@ -0,0 +1,705 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/algorithm.hpp>
+
+#include <expressions/interpreter/constant_literal.hpp>
+#include <expressions/interpreter/operators.hpp>
+
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+// How the elements get compared.
+enum class Order {
+    kLess,
+    kGreater,
+    // By calling the compare argument.
+    kCall,
+};
+
+const ast::Value& unwrap(const ast::Value& node) {
+    if (const auto* expr = ast::get_if<ast::Expression>(&node)) {
+        return unwrap(expr->expr);
+    }
+
+    return node;
+}
+
+// The expression a callable body made of a single return statement returns.
+// Any other body, a bare expression included, returns null or runs more than
+// one statement.
+const ast::Value* returned_expression(const ast::Value& body) {
+    const auto& node = unwrap(body);
+    if (const auto* stmts = ast::get_if<ast::StatementList>(&node)) {
+        return stmts->stmts.size() == 1
+                   ? returned_expression(stmts->stmts.front())
+                   : nullptr;
+    } else if (const auto* stmt = ast::get_if<ast::ReturnStatement>(&node)) {
+        return stmt->expr ? &unwrap(*stmt->expr) : nullptr;
+    }
+
+    return nullptr;
+}
+
+// The local slot the node reads, or -1.
+int32_t param_slot(const ast::Value& node) {
+    const auto* name = ast::get_if<ast::Name>(&unwrap(node));
+    if (!name || name->scope != ast::NameScope::kLocal) {
+        return -1;
+    }
+
+    return name->slot;
+}
+
+// Recognizes `(a, b) => return a < b;` and `a > b`, in either order of the
+// operands.
+Order order_of(const BoxedValue& compare, const Caller& caller) {
+    auto source = caller.source(compare);
+    if (!source || source->params != 2) {
+        return Order::kCall;
+    }
+    const auto* expr = returned_expression(*source->body);
+    const auto* op = expr ? ast::get_if<ast::CompareOp>(expr) : nullptr;
+    if (!op || op->rest.size() != 1) {
+        return Order::kCall;
+    }
+
+    auto first = param_slot(op->first);
+    auto second = param_slot(op->rest.front().operand);
+    auto less = false;
+    if (first == 0 && second == 1) {
+        less = true;
+    } else if (first != 1 || second != 0) {
+        return Order::kCall;
+    }
+
+    switch (op->rest.front().op) {
+        case ast::CompareOpType::kLT: {
+            return less ? Order::kLess : Order::kGreater;
+        }
+        case ast::CompareOpType::kGT: {
+            return less ? Order::kGreater : Order::kLess;
+        }
+        default: {
+            return Order::kCall;
+        }
+    }
+}
+
+Order order_of(std::span<BoxedValue> args, size_t index,
+               const Caller& caller) {
+    return index < args.size() ? order_of(args[index], caller) : Order::kLess;
+}
+
+// The list of the argument, rearranged where it is and moved out only once
+// done, so that a variable handing it over gets it back if the builtin throws.
+Vector<BoxedValue>& list_arg(std::string_view name, BoxedValue& arg) {
+    if (auto* list = boost::get<Vector<BoxedValue>>(&arg)) {
+        return *list;
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects a list.", name)));
+}
+
+// Runs the algorithm on the elements with a comparator for the order.
+template<typename Elements, typename Algorithm>
+auto apply_to(Elements& elements, Order order, const BoxedValue* compare,
+              const Caller& caller, Algorithm&& algorithm) {
+    using E = typename std::remove_const_t<Elements>::value_type;
+    auto first = elements.begin();
+    auto last = elements.end();
+    switch (order) {
+        case Order::kLess: {
+            if constexpr (std::is_same_v<E, BoxedValue>) {
+                return algorithm(first, last,
+                                 [](const BoxedValue& a, const BoxedValue& b) {
+                                     return execute_compare_op(
+                                         ast::CompareOpType::kLT, a, b);
+                                 });
+            } else {
+                return algorithm(first, last, std::less<E> {});
+            }
+        }
+        case Order::kGreater: {
+            if constexpr (std::is_same_v<E, BoxedValue>) {
+                return algorithm(first, last,
+                                 [](const BoxedValue& a, const BoxedValue& b) {
+                                     return execute_compare_op(
+                                         ast::CompareOpType::kGT, a, b);
+                                 });
+            } else {
+                return algorithm(first, last, std::greater<E> {});
+            }
+        }
+        case Order::kCall: {
+            break;
+        }
+    }
+
+    return algorithm(first, last, [&](const E& a, const E& b) {
+        auto pair = std::array<BoxedValue, 2> {BoxedValue {a}, BoxedValue {b}};
+        return check_branch_condition(caller.call(*compare, pair));
+    });
+}
+
+// Runs the algorithm on the elements of the array in their storage.
+template<typename Array, typename Algorithm>
+auto apply(Array& array, Order order, const BoxedValue* compare,
+           const Caller& caller, Algorithm&& algorithm) {
+    if (auto* values_i64 = array.template get_if<int64_t>()) {
+        return apply_to(*values_i64, order, compare, caller, algorithm);
+    } else if (auto* values_double = array.template get_if<double>()) {
+        return apply_to(*values_double, order, compare, caller, algorithm);
+    } else if (auto* values_bool = array.template get_if<bool>()) {
+        return apply_to(*values_bool, order, compare, caller, algorithm);
+    }
+
+    return apply_to(*array.template get_if<BoxedValue>(), order, compare,
+                    caller, algorithm);
+}
+
+// The list of the first argument, rearranged in place by the algorithm.
+template<typename Algorithm>
+BoxedValue rearrange(std::string_view name, std::span<BoxedValue> args,
+                     const Caller& caller, Algorithm&& algorithm) {
+    auto& list = list_arg(name, args[0]);
+    auto order = order_of(args, 1, caller);
+    const auto* compare = args.size() > 1 ? &args[1] : nullptr;
+    if (!list.empty()) {
+        apply(list.mutate(), order, compare, caller, algorithm);
+    }
+
+    return std::move(list);
+}
+
+// Evaluates a key for an element without calling into the engine.
+using KeyFunction = std::function<BoxedValue(const BoxedValue&)>;
+
+// Compiles an expression of the parameter in the slot made of literals,
+// arithmetic, subscripts and tuples of those. Returns std::nullopt for
+// anything else, like a call or a global.
+std::optional<KeyFunction> compile_key(const ast::Value& node, int32_t slot) {
+    const auto& expr = unwrap(node);
+    if (auto constant = constant_literal(expr)) {
+        return [value = std::move(*constant)](const BoxedValue&) {
+            return value;
+        };
+    }
+
+    if (const auto* name = ast::get_if<ast::Name>(&expr)) {
+        if (name->scope != ast::NameScope::kLocal || name->slot != slot) {
+            return std::nullopt;
+        }
+        return [](const BoxedValue& element) {
+            return element;
+        };
+    } else if (const auto* unary = ast::get_if<ast::UnaryOp>(&expr)) {
+        auto operand = compile_key(unary->operand, slot);
+        if (!operand) {
+            return std::nullopt;
+        }
+        return [type = unary->op,
+                operand = std::move(*operand)](const BoxedValue& element) {
+            return execute_unary_op(type, operand(element));
+        };
+    } else if (const auto* binary = ast::get_if<ast::BinOp>(&expr)) {
+        auto left = compile_key(binary->left, slot);
+        auto right = compile_key(binary->right, slot);
+        if (!left || !right) {
+            return std::nullopt;
+        }
+        return [type = binary->op, left = std::move(*left),
+                right = std::move(*right)](const BoxedValue& element) {
+            return execute_bin_op(type, left(element), right(element));
+        };
+    } else if (const auto* subscript = ast::get_if<ast::Subscript>(&expr)) {
+        auto object = compile_key(subscript->name, slot);
+        auto index = compile_key(subscript->expr, slot);
+        if (!object || !index) {
+            return std::nullopt;
+        }
+        return [object = std::move(*object),
+                index = std::move(*index)](const BoxedValue& element) {
+            return execute_subscript(object(element), index(element));
+        };
+    } else if (const auto* tuple = ast::get_if<ast::Tuple>(&expr)) {
+        auto values = std::vector<KeyFunction> {};
+        values.reserve(tuple->values.size());
+        for (const auto& value : tuple->values) {
+            auto key = compile_key(value, slot);
+            if (!key) {
+                return std::nullopt;
+            }
+            values.emplace_back(std::move(*key));
+        }
+        return [values = std::move(values)](const BoxedValue& element) {
+            auto keys = Tuple<BoxedValue> {};
+            auto& elements = keys.mutate();
+            elements.reserve(values.size());
+            for (const auto& value : values) {
+                elements.emplace_back(value(element));
+            }
+            return BoxedValue {std::move(keys)};
+        };
+    }
+
+    return std::nullopt;
+}
+
+// The keys the elements are sorted by: element i orders before element j if
+// first[i] compares to second[j] in the order. The second keys are left empty
+// when they are the first ones.
+struct Keys {
+    std::vector<BoxedValue> first {};
+    std::vector<BoxedValue> second {};
+    Order order {Order::kLess};
+};
+
+template<typename Array, typename Key>
+std::vector<BoxedValue> evaluate_keys(const Array& array, const Key& key) {
+    auto keys = std::vector<BoxedValue> {};
+    keys.reserve(array.size());
+    for (const auto& element : array) {
+        keys.emplace_back(key(element));
+    }
+
+    return keys;
+}
+
+// The keys for a compare given as a key function, like
+// `(x) => return x[1];`, or as a comparison of keys, like
+// `(a, b) => return a[1] > b[1];`. A key function the engine has to run is
+// called once per element, a comparison only gets keys if both of its sides
+// compile. Returns std::nullopt for any other compare.
+template<typename Array>
+std::vector<BoxedValue> keys_of_key(const BoxedValue& key,
+                                    const std::optional<CallableSource>& source,
+                                    const Caller& caller, const Array& array) {
+    const auto* expr = source ? returned_expression(*source->body) : nullptr;
+    if (auto compiled = expr ? compile_key(*expr, 0) : std::nullopt) {
+        return evaluate_keys(array, *compiled);
+    }
+
+    return evaluate_keys(array, [&](const BoxedValue& element) {
+        return caller.call(key, std::span {&element, 1});
+    });
+}
+
+template<typename Array>
+std::optional<Keys> keys_of(const BoxedValue& compare, const Caller& caller,
+                            const Array& array) {
+    auto source = caller.source(compare);
+    if (source && source->params == 1) {
+        return Keys {keys_of_key(compare, source, caller, array)};
+    }
+
+    const auto* expr = source ? returned_expression(*source->body) : nullptr;
+
+    const auto* op = expr ? ast::get_if<ast::CompareOp>(expr) : nullptr;
+    if (!source || source->params != 2 || !op || op->rest.size() != 1) {
+        return std::nullopt;
+    }
+    auto keys = Keys {};
+    switch (op->rest.front().op) {
+        case ast::CompareOpType::kLT: {
+            keys.order = Order::kLess;
+            break;
+        }
+        case ast::CompareOpType::kGT: {
+            keys.order = Order::kGreater;
+            break;
+        }
+        default: {
+            return std::nullopt;
+        }
+    }
+
+    // Either side may read the first parameter.
+    const auto* left = &op->first;
+    const auto* right = &op->rest.front().operand;
+    auto first = compile_key(*left, 0);
+    auto second = compile_key(*right, 1);
+    if (!first || !second) {
+        first = compile_key(*right, 0);
+        second = compile_key(*left, 1);
+        if (!first || !second) {
+            return std::nullopt;
+        }
+        keys.order
+            = keys.order == Order::kLess ? Order::kGreater : Order::kLess;
+    }
+    keys.first = evaluate_keys(array, *first);
+    keys.second = evaluate_keys(array, *second);
+    if (keys.second == keys.first) {
+        keys.second.clear();
+    }
+
+    return keys;
+}
+
+template<typename E>
+std::optional<std::vector<E>> unboxed_keys(
+    const std::vector<BoxedValue>& keys) {
+    auto values = std::vector<E> {};
+    values.reserve(keys.size());
+    for (const auto& key : keys) {
+        const auto* value = boost::get<E>(&key);
+        if (!value) {
+            return std::nullopt;
+        }
+        values.emplace_back(*value);
+    }
+
+    return values;
+}
+
+// Whether the order is known to be a strict weak one over the elements, which
+// std::sort() and std::nth_element() need, or they may run past the range:
+// numbers compared natively, NaNs aside. Mixed types and script comparators
+// need not give one.
+template<typename Iterator>
+bool is_strict_weak_order(Iterator first, Iterator last, Order order) {
+    using E = std::iter_value_t<Iterator>;
+    if (order == Order::kCall) {
+        return false;
+    }
+    if constexpr (std::is_same_v<E, double>) {
+        return std::none_of(first, last, [](double value) {
+            return std::isnan(value);
+        });
+    } else {
+        return std::is_same_v<E, int64_t> || std::is_same_v<E, bool>;
+    }
+}
+
+// Keys compared to other ones than themselves may not give a strict weak
+// order either.
+template<typename K>
+std::vector<size_t> sorted_positions(const std::vector<K>& first,
+                                     const std::vector<K>& second, Order order,
+                                     bool stable) {
+    const auto& rhs = second.empty() ? first : second;
+    auto positions = std::vector<size_t>(first.size());
+    std::iota(positions.begin(), positions.end(), size_t {0});
+    auto compare = [&](size_t lhs_position, size_t rhs_position) {
+        const auto& a = first[lhs_position];
+        const auto& b = rhs[rhs_position];
+        if constexpr (std::is_same_v<K, BoxedValue>) {
+            return execute_compare_op(order == Order::kLess
+                                          ? ast::CompareOpType::kLT
+                                          : ast::CompareOpType::kGT,
+                                      a, b);
+        } else {
+            return order == Order::kLess ? a < b : a > b;
+        }
+    };
+
+    if (!stable && &rhs == &first
+        && is_strict_weak_order(first.begin(), first.end(), order)) {
+        std::sort(positions.begin(), positions.end(), compare);
+    } else {
+        std::stable_sort(positions.begin(), positions.end(), compare);
+    }
+
+    return positions;
+}
+
+std::vector<size_t> sorted_positions(const Keys& keys, bool stable) {
+    if (auto first_i64 = unboxed_keys<int64_t>(keys.first)) {
+        if (auto second_i64 = unboxed_keys<int64_t>(keys.second)) {
+            return sorted_positions(*first_i64, *second_i64, keys.order,
+                                    stable);
+        }
+    } else if (auto first_double = unboxed_keys<double>(keys.first)) {
+        if (auto second_double = unboxed_keys<double>(keys.second)) {
+            return sorted_positions(*first_double, *second_double, keys.order,
+                                    stable);
+        }
+    }
+
+    return sorted_positions(keys.first, keys.second, keys.order, stable);
+}
+
+// Rearranges the elements into the order of their positions.
+template<typename Array>
+void permute(Array& array, const std::vector<size_t>& positions) {
+    auto reorder = [&](auto& elements) {
+        auto sorted = std::decay_t<decltype(elements)> {};
+        sorted.reserve(elements.size());
+        for (auto position : positions) {
+            sorted.push_back(std::move(elements[position]));
+        }
+        elements = std::move(sorted);
+    };
+
+    if (auto* values_i64 = array.template get_if<int64_t>()) {
+        reorder(*values_i64);
+    } else if (auto* values_double = array.template get_if<double>()) {
+        reorder(*values_double);
+    } else if (auto* values_bool = array.template get_if<bool>()) {
+        reorder(*values_bool);
+    } else {
+        reorder(*array.template get_if<BoxedValue>());
+    }
+}
+
+// The list of the first argument sorted in place, by the compare or the keys
+// derived from it.
+BoxedValue sort_list(std::string_view name, std::span<BoxedValue> args,
+                     const Caller& caller, bool stable) {
+    auto& list = list_arg(name, args[0]);
+    if (list.get().size() < 2) {
+        return std::move(list);
+    }
+
+    auto order = order_of(args, 1, caller);
+    if (order == Order::kCall) {
+        if (auto keys = keys_of(args[1], caller, list.get())) {
+            permute(list.mutate(), sorted_positions(*keys, stable));
+            return std::move(list);
+        }
+    }
+
+    const auto* compare = args.size() > 1 ? &args[1] : nullptr;
+    apply(list.mutate(), order, compare, caller,
+          [&](auto first, auto last, auto compare_elements) {
+              if (!stable && is_strict_weak_order(first, last, order)) {
+                  std::sort(first, last, compare_elements);
+              } else {
+                  std::stable_sort(first, last, compare_elements);
+              }
+          });
+
+    return std::move(list);
+}
+
+// The positions of the count best keys, best first. A key is better than
+// another if it is greater, or equal and earlier, so the selection is the
+// start of a stable sort in descending order. The positions are kept in a
+// heap of count elements with the worst on top, which each key only has to
+// beat to get in.
+template<typename K>
+std::vector<size_t> top_positions(const std::vector<K>& keys, size_t count) {
+    auto greater = [](const K& a, const K& b) {
+        if constexpr (std::is_same_v<K, BoxedValue>) {
+            return execute_compare_op(ast::CompareOpType::kGT, a, b);
+        } else {
+            return a > b;
+        }
+    };
+    auto better = [&](size_t lhs, size_t rhs) {
+        if (greater(keys[lhs], keys[rhs])) {
+            return true;
+        }
+        return lhs < rhs && !greater(keys[rhs], keys[lhs]);
+    };
+
+    auto heap = std::vector<size_t>(std::min(count, keys.size()));
+    std::iota(heap.begin(), heap.end(), size_t {0});
+    if (heap.empty()) {
+        return heap;
+    }
+    std::make_heap(heap.begin(), heap.end(), better);
+    for (auto position = heap.size(); position < keys.size(); ++position) {
+        if (better(position, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = position;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), better);
+
+    return heap;
+}
+
+std::vector<size_t> top_positions(const std::vector<BoxedValue>& keys,
+                                  size_t count) {
+    if (auto keys_i64 = unboxed_keys<int64_t>(keys)) {
+        return top_positions(*keys_i64, count);
+    } else if (auto keys_double = unboxed_keys<double>(keys)) {
+        return top_positions(*keys_double, count);
+    }
+
+    return top_positions<BoxedValue>(keys, count);
+}
+
+// The elements at the positions, as a new list.
+template<typename Array>
+Vector<BoxedValue> gather(const Array& array,
+                          const std::vector<size_t>& positions) {
+    auto list = Vector<BoxedValue> {};
+    auto collect = [&](const auto& elements) {
+        auto selected = std::decay_t<decltype(elements)> {};
+        selected.reserve(positions.size());
+        for (auto position : positions) {
+            selected.push_back(elements[position]);
+        }
+        list.mutate().assign(std::move(selected));
+    };
+
+    if (const auto* values_i64 = array.template get_if<int64_t>()) {
+        collect(*values_i64);
+    } else if (const auto* values_double = array.template get_if<double>()) {
+        collect(*values_double);
+    } else if (const auto* values_bool = array.template get_if<bool>()) {
+        collect(*values_bool);
+    } else {
+        collect(*array.template get_if<BoxedValue>());
+    }
+
+    return list;
+}
+
+int64_t integer_arg(std::string_view name, const BoxedValue& arg) {
+    if (const auto* value_i64 = boost::get<int64_t>(&arg)) {
+        return *value_i64;
+    } else if (const auto* value_u64 = boost::get<uint64_t>(&arg)) {
+        return static_cast<int64_t>(*value_u64);
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects an integer.", name)));
+}
+
+}    // namespace
+
+BoxedValue __builtin_make_heap(std::span<BoxedValue> args,
+                               const Caller& caller) {
+    return rearrange("make_heap", args, caller,
+                     [](auto first, auto last, auto compare) {
+                         std::make_heap(first, last, compare);
+                     });
+}
+
+BoxedValue __builtin_push_heap(std::span<BoxedValue> args,
+                               const Caller& caller) {
+    return rearrange("push_heap", args, caller,
+                     [](auto first, auto last, auto compare) {
+                         std::push_heap(first, last, compare);
+                     });
+}
+
+BoxedValue __builtin_pop_heap(std::span<BoxedValue> args,
+                              const Caller& caller) {
+    return rearrange("pop_heap", args, caller,
+                     [](auto first, auto last, auto compare) {
+                         std::pop_heap(first, last, compare);
+                     });
+}
+
+BoxedValue __builtin_sort_heap(std::span<BoxedValue> args,
+                               const Caller& caller) {
+    return rearrange("sort_heap", args, caller,
+                     [](auto first, auto last, auto compare) {
+                         std::sort_heap(first, last, compare);
+                     });
+}
+
+bool __builtin_is_heap(std::span<BoxedValue> args, const Caller& caller) {
+    const auto* list = boost::get<Vector<BoxedValue>>(&args[0]);
+    if (!list) {
+        THROW_EXCEPTION(std::invalid_argument("is_heap() expects a list."));
+    }
+
+    auto order = order_of(args, 1, caller);
+    const auto* compare = args.size() > 1 ? &args[1] : nullptr;
+
+    return apply(list->get(), order, compare, caller,
+                 [](auto first, auto last, auto compare_elements) {
+                     return std::is_heap(first, last, compare_elements);
+                 });
+}
+
+BoxedValue __builtin_sort(std::span<BoxedValue> args, const Caller& caller) {
+    return sort_list("sort", args, caller, false);
+}
+
+BoxedValue __builtin_stable_sort(std::span<BoxedValue> args,
+                                 const Caller& caller) {
+    return sort_list("stable_sort", args, caller, true);
+}
+
+BoxedValue __builtin_nth_element(std::span<BoxedValue> args,
+                                 const Caller& caller) {
+    auto& list = list_arg("nth_element", args[0]);
+    auto nth = integer_arg("nth_element", args[1]);
+    if (nth < 0 || static_cast<size_t>(nth) >= list.get().size()) {
+        THROW_EXCEPTION(
+            std::out_of_range("nth_element() index out of range."));
+    }
+
+    // Sorting the elements up to the nth one is slower than selecting it,
+    // but stays in the range whatever the compare.
+    auto order = order_of(args, 2, caller);
+    const auto* compare = args.size() > 2 ? &args[2] : nullptr;
+    apply(list.mutate(), order, compare, caller,
+          [&](auto first, auto last, auto compare_elements) {
+              if (is_strict_weak_order(first, last, order)) {
+                  std::nth_element(first, first + nth, last,
+                                   compare_elements);
+              } else {
+                  std::partial_sort(first, first + nth + 1, last,
+                                    compare_elements);
+              }
+          });
+
+    return std::move(list);
+}
+
+BoxedValue __builtin_top_k(std::span<BoxedValue> args, const Caller& caller) {
+    const auto* list = boost::get<Vector<BoxedValue>>(&args[0]);
+    if (!list) {
+        THROW_EXCEPTION(std::invalid_argument("top_k() expects a list."));
+    }
+    auto count = integer_arg("top_k", args[1]);
+    if (count < 0) {
+        THROW_EXCEPTION(std::invalid_argument(
+            "top_k() expects a non-negative count."));
+    }
+
+    const auto& array = list->get();
+    auto positions = std::vector<size_t> {};
+    if (args.size() > 2) {
+        auto keys = keys_of_key(args[2], caller.source(args[2]), caller, array);
+        positions = top_positions(keys, static_cast<size_t>(count));
+    } else if (const auto* values_i64 = array.get_if<int64_t>()) {
+        positions = top_positions(*values_i64, static_cast<size_t>(count));
+    } else if (const auto* values_double = array.get_if<double>()) {
+        positions = top_positions(*values_double, static_cast<size_t>(count));
+    } else if (const auto* values_bool = array.get_if<bool>()) {
+        positions = top_positions(*values_bool, static_cast<size_t>(count));
+    } else {
+        positions = top_positions<BoxedValue>(*array.get_if<BoxedValue>(),
+                                              static_cast<size_t>(count));
+    }
+
+    return gather(array, positions);
+}
+
+}    // namespace expressions::interpreter
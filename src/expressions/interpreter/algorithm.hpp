@@ -0,0 +1,75 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_ALGORITHM_HPP__
+#define __EXPRESSIONS_INTERPRETER_ALGORITHM_HPP__
+
+#include <expressions/interpreter/caller.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <span>
+
+
+namespace expressions::interpreter {
+
+// The builtins of system.algorithm, after their namesakes in <algorithm>.
+// Each takes a list and an optional compare, a callable returning whether its
+// first argument orders before its second one; without it, elements are
+// ordered by `<`. A compare of the form `(a, b) => return a < b;` or `a > b`
+// never gets called: the elements are compared natively, and lists of int64_t
+// or double are rearranged in their unboxed storage.
+//
+// The builtins returning a list rearrange the one they are given, which is
+// copied first only if it is still shared. See Builtin::in_place.
+
+// make_heap(list[, compare]): the list rearranged into a max-heap.
+BoxedValue __builtin_make_heap(std::span<BoxedValue> args,
+                               const Caller& caller);
+
+// push_heap(list[, compare]): the heap with its last element moved into the
+// heap made of the others.
+BoxedValue __builtin_push_heap(std::span<BoxedValue> args,
+                               const Caller& caller);
+
+// pop_heap(list[, compare]): the heap with its top moved to the end, and the
+// others made a heap again.
+BoxedValue __builtin_pop_heap(std::span<BoxedValue> args,
+                              const Caller& caller);
+
+// sort_heap(list[, compare]): the heap sorted in ascending order.
+BoxedValue __builtin_sort_heap(std::span<BoxedValue> args,
+                               const Caller& caller);
+
+// is_heap(list[, compare]): whether the list is a max-heap.
+bool __builtin_is_heap(std::span<BoxedValue> args, const Caller& caller);
+
+// sort(list[, compare]): the list sorted in ascending order. The compare may
+// also be a key, a callable of one element: the list is then sorted by the
+// keys of its elements, computed once each. A key, or a compare comparing
+// keys like `(a, b) => return a[1] > b[1];`, built of subscripts, arithmetic
+// and literals is evaluated natively as well, and the keys sorted without
+// calling into the script.
+BoxedValue __builtin_sort(std::span<BoxedValue> args, const Caller& caller);
+
+// stable_sort(list[, compare]): sort(), keeping equivalent elements in their
+// order.
+BoxedValue __builtin_stable_sort(std::span<BoxedValue> args,
+                                 const Caller& caller);
+
+// nth_element(list, n[, compare]): the list rearranged so that its nth
+// element is the one sorting would put there, with no element after it
+// ordering before it.
+BoxedValue __builtin_nth_element(std::span<BoxedValue> args,
+                                 const Caller& caller);
+
+// top_k(list, k[, key]): a new list of the k greatest elements of the list,
+// or of those with the greatest keys, greatest first and equal ones in their
+// order. The list is scanned once, keeping the best k so far in a heap.
+BoxedValue __builtin_top_k(std::span<BoxedValue> args, const Caller& caller);
+
+}    // namespace expressions::interpreter
+
+#endif
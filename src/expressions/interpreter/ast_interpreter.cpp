@@ -5,170 +5,145 @@
 //
 
 #include <expressions/interpreter/ast_interpreter.hpp>
+#include <expressions/interpreter/builtins.hpp>
+#include <expressions/interpreter/constant_literal.hpp>
+#include <expressions/interpreter/generator.hpp>
+#include <expressions/interpreter/iterator.hpp>
+#include <expressions/interpreter/operators.hpp>
 
 #include <expressions/common/enumerate.hpp>
-#include <expressions/common/visitor.hpp>
+#include <expressions/common/scope_exit.hpp>
 #include <expressions/exception/throw_exception.hpp>
-
-#include <cmath>
+#include <expressions/parser/transform/scope_resolver.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <utility>
 
 
 namespace expressions::interpreter {
 
-void __builtin_print(const std::vector<BoxedValue>& args) {
-    auto printer = SelfVisitableVisitor {
-        [](auto&&, interpreter::Null) {
-            return std::string {"null"};
-        },
-        [](auto&&, bool value) {
-            return fmt::format("{}", value);
-        },
-        [](auto&&, int64_t value) {
-            return fmt::format("{}", value);
-        },
-        [](auto&&, uint64_t value) {
-            return fmt::format("{}", value);
-        },
-        [](auto&&, double value) {
-            return fmt::format("{}", value);
-        },
-        [](auto&&, const interpreter::Name& value) {
-            return value.value;
-        },
-        [](auto&&, const interpreter::String& value) {
-            return fmt::format("{}", value.value);
-        },
-        [](auto&&, const interpreter::Date& value) {
-            return fmt::format("{:04}-{:02}-{:02}", value.year, value.month,
-                               value.day);
-        },
-        [](auto&&, const interpreter::DateRange& value) {
-            return fmt::format("{:04}-{:02}-{:02}-{:04}-{:02}-{:02}",
-                               value.begin.year, value.begin.month,
-                               value.begin.day, value.end.year, value.end.month,
-                               value.end.day);
-        },
-        [](auto&& self, const interpreter::Tuple<interpreter::BoxedValue>& c) {
-            auto buffer = fmt::memory_buffer {};
-            auto output = std::back_inserter(buffer);
-            fmt::format_to(output, "(");
-            for (const auto& [index, item] : enumerate(c)) {
-                if (index > 0) {
-                    fmt::format_to(output, ", ");
-                }
-                fmt::format_to(output, "{}", self.visit(item));
-            }
-            fmt::format_to(output, ")");
-
-            return fmt::to_string(buffer);
-        },
-        [](auto&& self, const interpreter::Vector<interpreter::BoxedValue>& c) {
-            auto buffer = fmt::memory_buffer {};
-            auto output = std::back_inserter(buffer);
-            fmt::format_to(output, "[");
-            for (const auto& [index, item] : enumerate(c)) {
-                if (index > 0) {
-                    fmt::format_to(output, ", ");
-                }
-                fmt::format_to(output, "{}", self.visit(item));
-            }
-            fmt::format_to(output, "]");
-
-            return fmt::to_string(buffer);
-        },
-        [](auto&& self, const interpreter::Set<interpreter::BoxedValue>& c) {
-            auto buffer = fmt::memory_buffer {};
-            auto output = std::back_inserter(buffer);
-            fmt::format_to(output, "<<?");
-            for (const auto& [index, item] : enumerate(c)) {
-                if (index > 0) {
-                    fmt::format_to(output, ", ");
-                }
-                fmt::format_to(output, "{}", self.visit(item));
-            }
-            fmt::format_to(output, "?>>");
-
-            return fmt::to_string(buffer);
-        },
-        [](auto&&, const interpreter::Map<interpreter::BoxedValue,
-                                          interpreter::BoxedValue>& c) {
-            (void)c;
-            return std::string {};
-        },
-        [](auto&&, const auto& value) {
-            auto name
-                = boost::typeindex::type_id<decltype(value)>().pretty_name();
-            return fmt::format("{}", name);
-        },
-    };
+namespace {
 
-    auto output = std::vector<std::string> {};
-    output.reserve(args.size());
-    for (const auto& arg : args) {
-        output.emplace_back(printer.visit(arg));
-    }
-    fmt::print("{}\n", fmt::join(output, " "));
-}
-
-uint64_t __builtin_len(const std::vector<BoxedValue>& args) {
-    auto visitor = SelfVisitableVisitor {
-        [](auto&&, interpreter::Null) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, bool) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, int64_t) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, uint64_t) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, double) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, const interpreter::Name&) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, const interpreter::String& value) -> uint64_t {
-            return value.value.size();
-        },
-        [](auto&&, const interpreter::Date&) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&, const interpreter::DateRange&) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-        [](auto&&,
-           const interpreter::Tuple<interpreter::BoxedValue>& c) -> uint64_t {
-            return c.size();
-        },
-        [](auto&&,
-           const interpreter::Vector<interpreter::BoxedValue>& c) -> uint64_t {
-            return c.size();
-        },
-        [](auto&&,
-           const interpreter::Set<interpreter::BoxedValue>& c) -> uint64_t {
-            return c.size();
-        },
-        [](auto&&,
-           const interpreter::Map<interpreter::BoxedValue,
-                                  interpreter::BoxedValue>& c) -> uint64_t {
-            return c.size();
-        },
-        [](auto&&, const auto&) -> uint64_t {
-            THROW_EXCEPTION(std::invalid_argument("not iterable."));
-        },
-    };
+template<typename T>
+TaggedValue make_object(T value) {
+    return TaggedValue {BoxedValue {std::move(value)}};
+}
+
+std::shared_ptr<const CallableBody> make_body(
+    const std::vector<ast::Value>& params, const ast::Value& body) {
+    return std::make_shared<const CallableBody>(params, body,
+                                                contains_yield(body));
+}
 
-    if (args.size() != 1) {
-        THROW_EXCEPTION(std::invalid_argument("len() only takes 1 argument."));
+jit::ValueType jit_type_of(const TaggedValue& value) {
+    switch (value.tag()) {
+        case TaggedValue::Tag::kBool: {
+            return jit::ValueType::kBool;
+        }
+        case TaggedValue::Tag::kInt64: {
+            return jit::ValueType::kInt64;
+        }
+        case TaggedValue::Tag::kDouble: {
+            return jit::ValueType::kDouble;
+        }
+        default: {
+            return jit::ValueType::kUndefined;
+        }
     }
+}
 
-    return visitor.visit(args[0]);
+uint64_t jit_bits_of(const TaggedValue& value) {
+    switch (value.tag()) {
+        case TaggedValue::Tag::kBool: {
+            return value.as_bool() ? 1 : 0;
+        }
+        case TaggedValue::Tag::kInt64: {
+            return static_cast<uint64_t>(value.as_int64());
+        }
+        case TaggedValue::Tag::kDouble: {
+            return std::bit_cast<uint64_t>(value.as_double());
+        }
+        default: {
+            return 0;
+        }
+    }
 }
 
+struct NodeTypeName : boost::static_visitor<std::string> {
+    NodeTypeName() = default;
+
+    template<typename T>
+    std::string operator()(const T& node) const {
+        (void)node;
+
+        return boost::typeindex::type_id<T>().pretty_name();
+    }
+    template<typename T>
+    std::string operator()(const ast::x3::forward_ast<T>& node) const {
+        return (*this)(node.get());
+    }
+};
+
+// Only names can be assigned to.
+[[noreturn]] void throw_unsupported_target(const ast::Value& target) {
+    THROW_EXCEPTION(std::runtime_error(
+        fmt::format("[Interpreter] Cannot assign to the AST node type '{}'",
+                    target.apply_visitor(NodeTypeName {}))));
+}
+
+}    // namespace
+
+// The state of a call to a generator function. The arguments are kept aside
+// while the call is suspended, and its frame is carved out of the buffer
+// again on every resume, so that the frames of other calls come and go in
+// between.
+class ASTInterpreter::GeneratorCall : public GeneratorState {
+public:
+    GeneratorCall(const ASTInterpreter& interpreter,
+                  std::shared_ptr<const CallableBody> callable,
+                  std::vector<TaggedValue> args)
+        : interpreter_ {interpreter},
+          callable_ {std::move(callable)},
+          args_ {std::move(args)},
+          body_ {interpreter_.yielding_stream_(callable_->body)} {}
+
+private:
+    std::optional<BoxedValue> step_() override {
+        auto& slots = interpreter_.slots_;
+        auto base = slots.size();
+        slots.insert(slots.end(), args_.begin(), args_.end());
+        interpreter_.stack_.emplace_back(Frame {base, &callable_->params});
+        auto yielded = [&] {
+            auto frame = ScopeExit {[&] {
+                interpreter_.stack_.pop_back();
+                slots.resize(base);
+            }};
+            return body_.next();
+        }();
+
+        if (!yielded) {
+            // The value of a return statement ending the body is dropped.
+            interpreter_.completion_ = Completion::kNormal;
+            interpreter_.return_value_and_reset_();
+            return std::nullopt;
+        }
+
+        return body_.take();
+    }
+
+private:
+    const ASTInterpreter& interpreter_;
+    std::shared_ptr<const CallableBody> callable_ {};
+    std::vector<TaggedValue> args_ {};
+    Stream<Completion> body_;
+};
+
 auto ASTInterpreter::operator()(const ast::MonoState& node) const
     -> ReturnType {
     (void)node;
@@ -205,67 +180,43 @@ auto ASTInterpreter::operator()(double value) const -> ReturnType {
 }
 
 auto ASTInterpreter::operator()(const ast::Name& node) const -> ReturnType {
-    auto it = std::optional<Context::iterator> {};
-    if (stack_.empty()) {
-        it = context_.find(node.value);
-        if (it.value() == context_.end()) {
-            fmt::print("Symbol {} not found.\n", node.value);
-            return Name {node.value};
-        }
-    } else {
-        auto& frame = stack_.back();
-        it = frame.find(node.value);
-        if (it.value() == frame.end()) {
-            it = context_.find(node.value);
-            if (it.value() == context_.end()) {
-                fmt::print("Symbol {} not found.\n", node.value);
-                return Name {node.value};
-            }
-        }
+    const auto* value = find_(node);
+    if (!value) {
+        fmt::print("Symbol {} not found.\n", node.value);
+        return make_object(Name {node.value});
     }
 
-    if (ast::holds_alternative<Code>(it.value()->second)) {
-        auto code = ast::get<Code>(it.value()->second);
-        return visit_(code.code);
+    if (value->holds<Code>()) {
+        // The code may replace the value holding it while it runs.
+        auto code = *value;
+        return visit_(*code.get_if<Code>()->code);
     } else {
-        return it.value()->second;
+        return *value;
     }
 }
 
 auto ASTInterpreter::operator()(const ast::String& node) const -> ReturnType {
-    auto it = std::optional<Context::iterator> {};
-    if (stack_.empty()) {
-        it = context_.find(node.value);
-        if (it.value() == context_.end()) {
-            return Name {node.value};
-        }
-    } else {
-        auto& frame = stack_.back();
-        it = frame.find(node.value);
-        if (it.value() == frame.end()) {
-            it = context_.find(node.value);
-            if (it.value() == context_.end()) {
-                return Name {node.value};
-            }
-        }
+    const auto* value = find_(ast::Symbol {node.value});
+    if (!value) {
+        return make_object(Name {node.value});
     }
 
-    if (ast::holds_alternative<Code>(it.value()->second)) {
-        auto code = ast::get<Code>(it.value()->second);
-        return visit_(code.code);
+    if (value->holds<Code>()) {
+        auto code = *value;
+        return visit_(*code.get_if<Code>()->code);
     } else {
-        return it.value()->second;
+        return *value;
     }
 }
 
 auto ASTInterpreter::operator()(const ast::QuotedString& node) const
     -> ReturnType {
-    return String {node.value};
+    return *constant_(node);
 }
 
 auto ASTInterpreter::operator()(const ast::Date& node) const -> ReturnType {
     // return String {node.to_string()};
-    return Date {node.year, node.month, node.day};
+    return Date::from_civil(node.year, node.month, node.day);
 }
 
 auto ASTInterpreter::operator()(const ast::DateRange& node) const
@@ -273,193 +224,80 @@ auto ASTInterpreter::operator()(const ast::DateRange& node) const
     // return fmt::format("{}-{}", node.begin.to_string(),
     // node.end.to_string());
     return DateRange {
-        {node.begin.year, node.begin.month, node.begin.day},
-        {node.end.year, node.end.month, node.end.day},
+        Date::from_civil(node.begin.year, node.begin.month, node.begin.day),
+        Date::from_civil(node.end.year, node.end.month, node.end.day),
     };
 }
 
 auto ASTInterpreter::operator()(const ast::Tuple& node) const -> ReturnType {
+    if (const auto* value = constant_(node)) {
+        return *value;
+    }
+
     auto values = Tuple<BoxedValue> {};
+    auto& elements = values.mutate();
+    elements.reserve(node.values.size());
     for (const auto& value : node.values) {
-        values.emplace_back(visit_(value));
+        elements.emplace_back(visit_(value).to_boxed());
     }
 
-    return BoxedValue {std::move(values)};
+    return make_object(std::move(values));
 }
 
 auto ASTInterpreter::operator()(const ast::List& node) const -> ReturnType {
+    if (const auto* value = constant_(node)) {
+        return *value;
+    }
+
     auto values = Vector<BoxedValue> {};
+    auto& elements = values.mutate();
+    elements.reserve(node.values.size());
     for (const auto& value : node.values) {
-        values.emplace_back(visit_(value));
+        elements.emplace_back(visit_(value).to_boxed());
     }
 
-    return BoxedValue {std::move(values)};
+    return make_object(std::move(values));
 }
 
 auto ASTInterpreter::operator()(const ast::Dict& node) const -> ReturnType {
+    if (const auto* value = constant_(node)) {
+        return *value;
+    }
+
     auto items = Map<BoxedValue, BoxedValue> {};
+    auto& elements = items.mutate();
     for (const auto& item : node.items) {
-        items.emplace(visit_(item.key), visit_(item.value));
+        elements.emplace(visit_(item.key).to_boxed(),
+                         visit_(item.value).to_boxed());
     }
 
-    return BoxedValue {std::move(items)};
+    return make_object(std::move(items));
 }
 
 auto ASTInterpreter::operator()(const ast::Set& node) const -> ReturnType {
+    if (const auto* value = constant_(node)) {
+        return *value;
+    }
+
     auto values = Set<BoxedValue> {};
+    auto& elements = values.mutate();
     for (const auto& value : node.values) {
-        values.emplace(visit_(value));
+        elements.emplace(visit_(value).to_boxed());
     }
 
-    return BoxedValue {std::move(values)};
+    return make_object(std::move(values));
 }
 
 auto ASTInterpreter::operator()(const ast::CompareOp& node) const
     -> ReturnType {
     auto left = visit_(node.first);
-    auto rest = std::vector<ast::CompareOpOperand> {};
-    rest.reserve(node.rest.size());
-
-    auto generic_compare = [](const auto& a, const auto& b, auto&& op) -> bool {
-        bool result = false;
-
-        if (ast::holds_any_of<int64_t, uint64_t, double>(a)
-            && ast::holds_any_of<int64_t, uint64_t, double>(b)) {
-            if (boost::get<int64_t>(&a)) {
-                auto* lhs = boost::get<int64_t>(&a);
-                if (auto* rhs_i64 = boost::get<int64_t>(&b)) {
-                    result = op(*lhs, *rhs_i64);
-                } else if (auto* rhs_u64 = boost::get<uint64_t>(&b)) {
-                    result = op(static_cast<uint64_t>(*lhs), *rhs_u64);
-                } else if (auto* rhs_double = boost::get<double>(&b)) {
-                    result = op(*lhs, *rhs_double);
-                }
-            } else if (boost::get<uint64_t>(&a)) {
-                auto* lhs = boost::get<uint64_t>(&a);
-                if (auto* rhs_i64 = boost::get<int64_t>(&b)) {
-                    result = op(*lhs, static_cast<uint64_t>(*rhs_i64));
-                } else if (auto* rhs_u64 = boost::get<uint64_t>(&b)) {
-                    result = op(*lhs, *rhs_u64);
-                } else if (auto* rhs_double = boost::get<double>(&b)) {
-                    result = op(*lhs, *rhs_double);
-                }
-            } else if (boost::get<double>(&a)) {
-                auto* lhs = boost::get<double>(&a);
-                if (auto* rhs_i64 = boost::get<int64_t>(&b)) {
-                    result = op(*lhs, *rhs_i64);
-                } else if (auto* rhs_u64 = boost::get<uint64_t>(&b)) {
-                    result = op(*lhs, *rhs_u64);
-                } else if (auto* rhs_double = boost::get<double>(&b)) {
-                    result = op(*lhs, *rhs_double);
-                }
-            }
-        } else if (ast::holds_alternative<String>(a)
-                   && ast::holds_alternative<String>(b)) {
-            auto* lhs = boost::get<String>(&a);
-            auto* rhs = boost::get<String>(&b);
-            return op(lhs->value, rhs->value);
-        } else {
-            result = op(a, b);
-        }
-
-        return result;
-    };
-
     for (const auto& operand : node.rest) {
-        auto right = visit_(operand.operand);
-
-        bool result = false;
-        switch (operand.op) {
-            case ast::CompareOpType::kNone: {
-                return {};
-            }
-            case ast::CompareOpType::kEQ: {
-                result = generic_compare(left, right,
-                                         [](const auto& a, const auto& b) {
-                                             return a == b;
-                                         });
-                break;
-            }
-            case ast::CompareOpType::kNEQ: {
-                result = generic_compare(left, right,
-                                         [](const auto& a, const auto& b) {
-                                             return a != b;
-                                         });
-                break;
-            }
-            case ast::CompareOpType::kLT: {
-                result = generic_compare(left, right,
-                                         [](const auto& a, const auto& b) {
-                                             return a < b;
-                                         });
-                break;
-            }
-            case ast::CompareOpType::kLTE: {
-                result = generic_compare(left, right,
-                                         [](const auto& a, const auto& b) {
-                                             return a <= b;
-                                         });
-                break;
-            }
-            case ast::CompareOpType::kGT: {
-                result = generic_compare(left, right,
-                                         [](const auto& a, const auto& b) {
-                                             return a > b;
-                                         });
-                break;
-            }
-            case ast::CompareOpType::kGTE: {
-                result = generic_compare(left, right,
-                                         [](const auto& a, const auto& b) {
-                                             return a >= b;
-                                         });
-                break;
-            }
-            case ast::CompareOpType::kIn: {
-                auto visitor = Visitor {
-                    [&](const Tuple<BoxedValue>& t) -> bool {
-                        return std::find(t.begin(), t.end(), left) != t.end();
-                    },
-                    [&](const Vector<BoxedValue>& v) -> bool {
-                        return std::find(v.begin(), v.end(), left) != v.end();
-                    },
-                    [&](const Set<BoxedValue>& s) -> bool {
-                        return s.contains(left);
-                    },
-                    [&](const Map<BoxedValue, BoxedValue>& m) -> bool {
-                        return m.contains(left);
-                    },
-                    [&](const BoxedValue&) -> bool {
-                        return false;
-                    },
-                };
-                result = boost::apply_visitor(visitor, right);
-                break;
-            }
-            case ast::CompareOpType::kNotIn: {
-                auto visitor = Visitor {
-                    [&](const Tuple<BoxedValue>& t) -> bool {
-                        return std::find(t.begin(), t.end(), left) == t.end();
-                    },
-                    [&](const Vector<BoxedValue>& v) -> bool {
-                        return std::find(v.begin(), v.end(), left) == v.end();
-                    },
-                    [&](const Set<BoxedValue>& s) -> bool {
-                        return !s.contains(left);
-                    },
-                    [&](const Map<BoxedValue, BoxedValue>& m) -> bool {
-                        return !m.contains(left);
-                    },
-                    [&](const BoxedValue&) -> bool {
-                        return false;
-                    },
-                };
-                result = boost::apply_visitor(visitor, right);
-                break;
-            }
+        if (operand.op == ast::CompareOpType::kNone) {
+            return {};
         }
 
-        if (!result) {
+        auto right = visit_(operand.operand);
+        if (!execute_compare_op(operand.op, left, right)) {
             return false;
         }
 
@@ -473,102 +311,83 @@ auto ASTInterpreter::operator()(const ast::BinOp& node) const -> ReturnType {
     auto left = visit_(node.left);
     auto right = visit_(node.right);
 
-    return execute_bin_op_(node.op, std::move(left), std::move(right));
+    return execute_bin_op(node.op, left, right);
 }
 
 auto ASTInterpreter::operator()(const ast::Call& node) const -> ReturnType {
-    if (node.name.value == "print") {
+    if (auto builtin = parser::builtin_function_of(node.name)) {
         auto args = std::vector<ReturnType> {};
         args.reserve(node.args.size());
         for (const auto& arg : node.args) {
             args.emplace_back(visit_(arg));
         }
-        __builtin_print(args);
 
-        return Null {};
-    } else if (node.name.value == "len") {
+        return builtin_of(*builtin)(args, *this);
+    }
+    if (node.name.scope == ast::NameScope::kExtern) {
         auto args = std::vector<ReturnType> {};
         args.reserve(node.args.size());
         for (const auto& arg : node.args) {
             args.emplace_back(visit_(arg));
         }
-        return_value_ = __builtin_len(args);
 
-        return return_value_and_reset_();
-    }
-
-    auto it = std::optional<Context::iterator> {};
-    if (stack_.empty()) {
-        it = context_.find(node.name.value);
-        if (it.value() == context_.end()) {
-            THROW_EXCEPTION(std::runtime_error(
-                fmt::format("Object not found: {}", node.name.value)));
-        }
-    } else {
-        auto& frame = stack_.back();
-        it = frame.find(node.name.value);
-        if (it.value() == frame.end()) {
-            it = context_.find(node.name.value);
-            if (it.value() == context_.end()) {
-                THROW_EXCEPTION(std::runtime_error(
-                    fmt::format("Object not found: {}", node.name.value)));
-            }
+        const auto* host
+            = hosts_ ? hosts_->find(node.name.symbol, args.size()) : nullptr;
+        if (!host) {
+            throw_unbound_host_function(node.name.value, args.size());
         }
+
+        return host->tagged(args);
     }
 
-    std::vector<ast::Value>* params = nullptr;
-    ast::Value* body = nullptr;
-    auto& object = it.value()->second;
-    auto type_name = std::string {};
-    if (auto* lambda = ast::get_if<Lambda>(&object)) {
-        params = &lambda->params;
-        body = &lambda->body;
-        type_name
-            = boost::typeindex::type_id<decltype(*lambda)>().pretty_name();
-    } else if (auto* func = ast::get_if<Function>(&object)) {
-        params = &func->params;
-        body = &func->body;
-        type_name = boost::typeindex::type_id<decltype(*func)>().pretty_name();
-    } else {
-        type_name = boost::typeindex::type_id<decltype(object)>().pretty_name();
+    const auto* found = find_(node.name);
+    if (!found) {
         THROW_EXCEPTION(std::runtime_error(
-            fmt::format("Object '{}' references to '{}' is not callable.",
-                        node.name.value, type_name)));
+            fmt::format("Object not found: {}", node.name.value)));
     }
+    // The callee stays alive even if the call replaces the value holding it,
+    // or if that value lives in the frame buffer and the buffer moves.
+    auto callee = *found;
+    const auto& callable = callable_(callee, node.name.value, node.args.size());
+    const auto* params = &callable->params;
+    const auto* body = &callable->body;
+
+    if (callable->generator) {
+        auto args = std::vector<TaggedValue> {};
+        args.reserve(node.args.size());
+        for (const auto& argument : node.args) {
+            args.emplace_back(visit_(argument));
+        }
 
-    if (params->size() != node.args.size()) {
-        THROW_EXCEPTION(std::runtime_error(fmt::format(
-            "Failed to call object '{}' references to '{}'. It "
-            "takes {} arguments "
-            "but {} were given.",
-            node.name.value, type_name, params->size(), node.args.size())));
+        return make_object(Generator {
+            std::make_shared<GeneratorCall>(*this, callable, std::move(args))});
     }
 
-    auto locals = Context {};
-    for (const auto& [index, argument] : enumerate(node.args)) {
-        auto name = std::string {};
-        if (auto* parg_def = ast::get_if<ast::Argument>(&params->at(index))) {
-            name = ast::get<ast::Name>(parg_def->arg).value;
-        } else if (auto* kwarg_def
-                   = ast::get_if<ast::KeywordArgument>(&params->at(index))) {
-            name = kwarg_def->name.value;
-        } else {
-            THROW_EXCEPTION(std::runtime_error(
-                fmt::format("Failed to call object '{}'. Invalid argument "
-                            "type at position {}.",
-                            node.name.value, index)));
-        }
-        locals.insert_or_assign(name, visit_(argument));
+    // The arguments become the slots of the new frame. Calls made while
+    // evaluating them leave the buffer as they found it.
+    auto base = slots_.size();
+    for (const auto& argument : node.args) {
+        slots_.emplace_back(visit_(argument));
     }
 
-    stack_.emplace_back(std::move(locals));
-    try {
-        visit_(*body);
-    } catch (const ReturnException&) {
+    if (jit_) {
+        auto& spot = hot_spots_[body];
+        if (++spot.count >= policy_.call_threshold) {
+            if (!spot.linked || spot.epoch != epoch_) {
+                link_(spot, {node.name.value, param_names_(*params).value(),
+                             {callable, body}});
+            }
+            auto args = std::span<const TaggedValue> {slots_}.subspan(base);
+            if (auto result = run_compiled_(spot, args)) {
+                slots_.resize(base);
+                return std::move(*result);
+            }
+            // Try again once the function has got hot for other types.
+            spot.count = 0;
+        }
     }
-    stack_.pop_back();
 
-    return return_value_and_reset_();
+    return run_body_(*callable, base);
 }
 
 auto ASTInterpreter::operator()(const ast::Argument& node) const -> ReturnType {
@@ -587,91 +406,15 @@ auto ASTInterpreter::operator()(const ast::Subscript& node) const
     //     // TODO: throw error
     //     return {};
     // }
-    auto boxed_subscript = visit_(node.expr);
-    auto subscript = 0ll;
-    if (ast::holds_alternative<int64_t>(boxed_subscript)) {
-        subscript = ast::get<int64_t>(boxed_subscript);
-    } else if (ast::holds_alternative<uint64_t>(boxed_subscript)) {
-        subscript = static_cast<int64_t>(ast::get<uint64_t>(boxed_subscript));
-    } else {
-        // TODO: throw error
-        return {};
-    }
+    auto subscript = visit_(node.expr);
 
-    auto visitor = SelfVisitableVisitor {
-        [&](auto&&, const Tuple<BoxedValue>& value) {
-            return value.at(subscript);
-        },
-        [&](auto&&, const Vector<BoxedValue>& value) {
-            return value.at(subscript);
-        },
-        [](auto&&, const auto& value) {
-            auto name
-                = boost::typeindex::type_id<decltype(value)>().pretty_name();
-            fmt::print("{}\n", name);
-            return BoxedValue {};
-        },
-    };
-
-    auto element = visitor.visit(object);
-
-    return element;
+    return execute_subscript(object, subscript);
 }
 
 auto ASTInterpreter::operator()(const ast::UnaryOp& node) const -> ReturnType {
     auto value = visit_(node.operand);
 
-    auto generic_unary_op
-        = [](auto type, const auto& operand, auto&& op) -> BoxedValue {
-        if (ast::holds_any_of<int64_t, uint64_t, double>(operand)) {
-            if (boost::get<int64_t>(&operand)) {
-                return op(boost::get<int64_t>(operand));
-            } else if (boost::get<uint64_t>(&operand)) {
-                return op(boost::get<uint64_t>(operand));
-            } else if (boost::get<double>(&operand)) {
-                return op(boost::get<double>(operand));
-            }
-        } else if (type == ast::BoolOpType::kNot) {
-            if (boost::get<bool>(&operand)) {
-                return !boost::get<bool>(operand);
-            } else if (boost::get<Null>(&operand)) {
-                return true;
-            } else if (auto* str = boost::get<String>(&operand)) {
-                return str->value.empty();
-            }
-        }
-
-        // TODO: throw type error
-        return {};
-    };
-
-    switch (node.op) {
-        case ast::BoolOpType::kPlus: {
-            return generic_unary_op(node.op, value,
-                                    [](const auto& operand) -> BoxedValue {
-                                        return operand;
-                                    });
-        }
-        case ast::BoolOpType::kMinus: {
-            return generic_unary_op(node.op, value,
-                                    [](const auto& operand) -> BoxedValue {
-                                        return -operand;
-                                    });
-        }
-        case ast::BoolOpType::kNot: {
-            return generic_unary_op(node.op, value,
-                                    [](const auto& operand) -> BoxedValue {
-                                        return !operand;
-                                    });
-        }
-        case ast::BoolOpType::kDefault:
-        case ast::BoolOpType::kAnd:
-        case ast::BoolOpType::kOr: {
-            break;
-        }
-    }
-
-    return {};
+    return execute_unary_op(node.op, value);
 }
 
 auto ASTInterpreter::operator()(const ast::BoolOp& node) const -> ReturnType {
@@ -684,13 +427,13 @@ auto ASTInterpreter::operator()(const ast::BoolOp& node) const -> ReturnType {
         auto result = visit_(operand);
         switch (node.op) {
             case ast::BoolOpType::kAnd: {
-                if (!check_branch_condition_(result)) {
+                if (!check_branch_condition(result)) {
                     return false;
                 }
                 break;
             }
             case ast::BoolOpType::kOr: {
-                if (check_branch_condition_(result)) {
+                if (check_branch_condition(result)) {
                     return true;
                 }
                 break;
@@ -708,7 +451,9 @@ auto ASTInterpreter::operator()(const ast::BoolOp& node) const -> ReturnType {
 }
 
 auto ASTInterpreter::operator()(const ast::Lambda& node) const -> ReturnType {
-    return Lambda {node.params, node.expr};
+    return definition_(&node, [&] {
+        return Lambda {make_body(node.params, node.expr)};
+    });
 }
 
 auto ASTInterpreter::operator()(const ast::Expression& node) const
@@ -719,20 +464,47 @@ auto ASTInterpreter::operator()(const ast::Expression& node) const
 auto ASTInterpreter::operator()(const ast::AssignStatement& node) const
     -> ReturnType {
     if (!ast::holds_alternative<ast::Name>(node.target)) {
-        // TODO: throw error
-        return {};
+        throw_unsupported_target(node.target);
     }
-    auto name = ast::get<ast::Name>(node.target);
+    const auto& name = ast::get<ast::Name>(node.target);
     if (const auto* lambda = ast::get_if<ast::Lambda>(&node.expr)) {
-        auto value = Lambda {lambda->params, lambda->expr};
-        context_.insert_or_assign(std::move(name.value), std::move(value));
+        auto value = definition_(lambda, [&] {
+            return Lambda {make_body(lambda->params, lambda->expr)};
+        });
+        assign_(global_(name), std::move(value));
     } else if (const auto* func = ast::get_if<ast::FunctionDef>(&node.expr)) {
-        auto value
-            = Function {Name {func->name.value}, func->params, func->body};
-        context_.insert_or_assign(std::move(name.value), std::move(value));
+        auto value = definition_(func, [&] {
+            return Function {Name {func->name.value},
+                             make_body(func->params, func->body)};
+        });
+        assign_(global_(name), std::move(value));
+    } else if (const auto* call = in_place_call(name, node.expr)) {
+        auto args = std::vector<ReturnType> {};
+        args.reserve(call->args.size());
+        for (const auto& arg : call->args) {
+            args.emplace_back(visit_(arg));
+        }
+
+        // The value of the global is handed over to the call, not copied,
+        // and given back if the call throws.
+        auto& global = global_(name);
+        auto handed_over = global.defined && can_hand_over(args, global.value);
+        if (handed_over) {
+            args.front() = std::exchange(global.value, {});
+        }
+        auto restore = ScopeExit {[&] {
+            if (handed_over) {
+                global.value = std::move(args.front());
+            }
+        }};
+        const auto& builtin
+            = builtin_of(*parser::builtin_function_of(call->name));
+        auto value = builtin(args, *this);
+        handed_over = false;
+        assign_(global, std::move(value));
     } else {
         auto value = visit_(node.expr);
-        context_.insert_or_assign(std::move(name.value), std::move(value));
+        assign_(global_(name), std::move(value));
     }
 
     return {};
@@ -741,12 +513,13 @@ auto ASTInterpreter::operator()(const ast::AssignStatement& node) const
 auto ASTInterpreter::operator()(const ast::LazyAssignStatement& node) const
     -> ReturnType {
     if (!ast::holds_alternative<ast::Name>(node.target)) {
-        // TODO: throw error
-        return {};
+        throw_unsupported_target(node.target);
     }
-    auto name = ast::get<ast::Name>(node.target);
-    auto value = Code {node.expr};
-    context_.insert_or_assign(std::move(name.value), std::move(value));
+    const auto& name = ast::get<ast::Name>(node.target);
+    auto value = definition_(&node, [&] {
+        return Code {std::make_shared<const ast::Value>(node.expr)};
+    });
+    assign_(global_(name), std::move(value));
 
     return {};
 }
@@ -754,39 +527,64 @@ auto ASTInterpreter::operator()(const ast::LazyAssignStatement& node) const
 auto ASTInterpreter::operator()(const ast::AugAssignStatement& node) const
     -> ReturnType {
     if (!ast::holds_alternative<ast::Name>(node.target)) {
-        // TODO: throw error
-        return {};
+        throw_unsupported_target(node.target);
     }
 
+    // An undefined name reads as itself, and is left undefined.
     auto left = visit_(node.target);
-    if (ast::holds_alternative<Name>(left)) {
-        // TODO: throw error
+    if (left.holds<Name>()) {
         return {};
     }
     auto right = visit_(node.expr);
-    auto value = execute_bin_op_(node.op, std::move(left), std::move(right));
 
-    auto name = ast::get<ast::Name>(node.target).value;
-    context_.insert_or_assign(std::move(name), std::move(value));
+    // Appending to the list or string the global still holds mutates it in
+    // place, which is amortized O(1) once this copy no longer shares it.
+    auto& global = global_(ast::get<ast::Name>(node.target));
+    if (left.is_object() && global.value.is_object()
+        && &left.object() == &global.value.object()) {
+        left = TaggedValue {};
+        if (execute_inplace_op(node.op, global.value, right)) {
+            return {};
+        }
+        left = global.value;
+    }
+    auto value = execute_bin_op(node.op, left, right);
+
+    assign_(global, std::move(value));
 
     return {};
 }
 
 auto ASTInterpreter::operator()(const ast::ReturnStatement& node) const
     -> ReturnType {
-    return_value_ = visit_(node.expr);
+    if (node.expr) {
+        return_value_ = visit_(*node.expr);
+    } else {
+        return_value_ = Null {};
+    }
+    completion_ = Completion::kReturn;
+
+    return Null {};
+}
+
+auto ASTInterpreter::operator()(const ast::YieldStatement& node) const
+    -> ReturnType {
+    // The yields of a generator body run in stream_().
+    (void)node;
 
-    throw ReturnException {};
-    // return return_value_and_reset_();
+    THROW_EXCEPTION(
+        std::runtime_error("[Interpreter] 'yield' outside function"));
 }
 
 auto ASTInterpreter::operator()(const ast::StatementList& node) const
     -> ReturnType {
     for (const auto& n : node.stmts) {
         visit_(n);
+        if (completion_ != Completion::kNormal) {
+            break;
+        }
     }
 
-    // return return_value_and_reset_();
     return Null {};
 }
 
@@ -799,8 +597,10 @@ auto ASTInterpreter::operator()(const ast::ExternFunctionDecl& node) const
 
 auto ASTInterpreter::operator()(const ast::FunctionDef& node) const
     -> ReturnType {
-    auto func = Function {{node.name.value}, node.params, node.body};
-    context_.insert_or_assign(node.name.value, std::move(func));
+    auto func = definition_(&node, [&] {
+        return Function {{node.name.value}, make_body(node.params, node.body)};
+    });
+    assign_(global_(node.name), std::move(func));
 
     return Null {};
 }
@@ -808,68 +608,73 @@ auto ASTInterpreter::operator()(const ast::FunctionDef& node) const
 auto ASTInterpreter::operator()(const ast::IfStatement& node) const
     -> ReturnType {
     auto condition = visit_(node.condition);
-    auto flag = check_branch_condition_(condition);
+    auto flag = check_branch_condition(condition);
 
-    try {
-        if (flag) {
-            return visit_(node.body);
-        } else if (!ast::holds_alternative<ast::MonoState>(node.or_else)) {
-            return visit_(node.or_else);
-        }
-    } catch (const ReturnException&) {
-        return return_value_and_reset_();
+    if (flag) {
+        visit_(node.body);
+    } else if (!ast::holds_alternative<ast::MonoState>(node.or_else)) {
+        visit_(node.or_else);
     }
 
-    return return_value_and_reset_();
+    return Null {};
 }
 
 auto ASTInterpreter::operator()(const ast::ForStatement& node) const
     -> ReturnType {
     visit_(node.init);
+    auto* spot = jit_ ? &hot_spots_[&node] : nullptr;
     while (true) {
         auto condition = visit_(node.condition);
-        if (!check_branch_condition_(condition)) {
+        if (!check_branch_condition(condition)
+            || !execute_loop_body_(node.body)) {
             break;
         }
-        try {
-            visit_(node.body);
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-        } catch (const ReturnException&) {
+        visit_(node.iter);
+
+        if (spot && ++spot->count >= policy_.loop_threshold
+            && tier_up_loop_(*spot, node)) {
             break;
         }
-        visit_(node.iter);
     }
 
-    return return_value_and_reset_();
+    return Null {};
 }
 
 auto ASTInterpreter::operator()(const ast::RangeBasedForStatement& node) const
     -> ReturnType {
-    (void)node;
+    auto iterator = iterate_(node.iter);
+    auto targets = for_targets(node.target);
+    auto values = std::vector<BoxedValue>(targets.size());
+    while (iterator.next(values)) {
+        for (size_t index = 0; index < targets.size(); ++index) {
+            assign_(global_(targets[index]),
+                    TaggedValue {std::move(values[index])});
+        }
+        if (!execute_loop_body_(node.body)) {
+            break;
+        }
+    }
 
-    return {};
+    return Null {};
 }
 
 auto ASTInterpreter::operator()(const ast::WhileStatement& node) const
     -> ReturnType {
+    auto* spot = jit_ ? &hot_spots_[&node] : nullptr;
     while (true) {
         auto condition = visit_(node.condition);
-        if (!check_branch_condition_(condition)) {
+        if (!check_branch_condition(condition)
+            || !execute_loop_body_(node.body)) {
             break;
         }
-        try {
-            visit_(node.body);
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-        } catch (const ReturnException&) {
+
+        if (spot && ++spot->count >= policy_.loop_threshold
+            && tier_up_loop_(*spot, node)) {
             break;
         }
     }
 
-    return return_value_and_reset_();
+    return Null {};
 }
 
 auto ASTInterpreter::operator()(const ast::Pass& node) const -> ReturnType {
@@ -880,14 +685,16 @@ auto ASTInterpreter::operator()(const ast::Pass& node) const -> ReturnType {
 
 auto ASTInterpreter::operator()(const ast::Break& node) const -> ReturnType {
     (void)node;
+    completion_ = Completion::kBreak;
 
-    throw BreakException {};
+    return Null {};
 }
 
 auto ASTInterpreter::operator()(const ast::Continue& node) const -> ReturnType {
     (void)node;
+    completion_ = Completion::kContinue;
 
-    throw ContinueException {};
+    return Null {};
 }
 
 auto ASTInterpreter::operator()(const ast::ImportPackage& node) const
@@ -905,163 +712,573 @@ auto ASTInterpreter::operator()(const ast::PackageName& node) const
 }
 
 auto ASTInterpreter::operator()(const ast::Entry& node) const -> ReturnType {
-    try {
-        return visit_(node.node);
-    } catch (const BreakException&) {
-    } catch (const ContinueException&) {
-    } catch (const ReturnException&) {
+    auto result = visit_(node.node);
+    auto completion = std::exchange(completion_, Completion::kNormal);
+    if (completion == Completion::kReturn) {
+        return return_value_and_reset_();
+    }
+
+    return result;
+}
+
+BoxedValue ASTInterpreter::call(const BoxedValue& callee,
+                                std::span<const BoxedValue> args) const {
+    auto value = TaggedValue {callee};
+    const auto& callable = callable_(value, "callable", args.size());
+    if (callable->generator) {
+        auto values = std::vector<TaggedValue> {args.begin(), args.end()};
+        return Generator {std::make_shared<GeneratorCall>(*this, callable,
+                                                          std::move(values))};
     }
 
+    auto base = slots_.size();
+    for (const auto& arg : args) {
+        slots_.emplace_back(TaggedValue {arg});
+    }
+
+    return run_body_(*callable, base).to_boxed();
+}
+
+std::optional<CallableSource> ASTInterpreter::source(
+    const BoxedValue& callee) const {
+    const CallableBody* callable = nullptr;
+    if (const auto* lambda = boost::get<Lambda>(&callee)) {
+        callable = lambda->body.get();
+    } else if (const auto* func = boost::get<Function>(&callee)) {
+        callable = func->body.get();
+    }
+    if (!callable) {
+        return std::nullopt;
+    }
+
+    return CallableSource {callable->params.size(), &callable->body};
+}
+
+const std::shared_ptr<const CallableBody>& ASTInterpreter::callable_(
+    const TaggedValue& callee, std::string_view name, size_t argc) const {
+    const std::shared_ptr<const CallableBody>* callable = nullptr;
+    // Type names are only spelled out for errors, as demangling allocates.
+    auto type = boost::typeindex::type_index {};
+    if (const auto* lambda = callee.get_if<Lambda>()) {
+        callable = &lambda->body;
+        type = boost::typeindex::type_id<decltype(*lambda)>();
+    } else if (const auto* func = callee.get_if<Function>()) {
+        callable = &func->body;
+        type = boost::typeindex::type_id<decltype(*func)>();
+    } else {
+        type = boost::typeindex::type_id<BoxedValue>();
+        THROW_EXCEPTION(std::runtime_error(
+            fmt::format("Object '{}' references to '{}' is not callable.",
+                        name, type.pretty_name())));
+    }
+    const auto& params = (*callable)->params;
+
+    if (params.size() != argc) {
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "Failed to call object '{}' references to '{}'. It "
+            "takes {} arguments "
+            "but {} were given.",
+            name, type.pretty_name(), params.size(), argc)));
+    }
+
+    for (const auto& [index, param] : enumerate(params)) {
+        if (!param_name_(param)) {
+            THROW_EXCEPTION(std::runtime_error(
+                fmt::format("Failed to call object '{}'. Invalid argument "
+                            "type at position {}.",
+                            name, index)));
+        }
+    }
+
+    return *callable;
+}
+
+TaggedValue ASTInterpreter::run_body_(const CallableBody& callable,
+                                      size_t base) const {
+    stack_.emplace_back(Frame {base, &callable.params});
+    visit_(callable.body);
+    stack_.pop_back();
+    slots_.resize(base);
+    completion_ = Completion::kNormal;
+
     return return_value_and_reset_();
 }
 
-auto ASTInterpreter::execute_bin_op_(ast::BinOpType op, BoxedValue&& left,
-                                     BoxedValue&& right) const -> ReturnType {
-    if (!ast::holds_any_of<int64_t, uint64_t, double, String,
-                           Vector<BoxedValue>>(left)) {
-        fmt::print("--------1 {}, {}\n", static_cast<int32_t>(op),
-                   left.which());
-        return {};
+Iterator ASTInterpreter::iterate_(const ast::Value& iter) const {
+    if (const auto* call = range_call(iter)) {
+        auto args = std::vector<BoxedValue> {};
+        args.reserve(call->args.size());
+        for (const auto& arg : call->args) {
+            args.emplace_back(visit_(arg).to_boxed());
+        }
+        return Iterator {Range::of(args)};
     }
-    if (!ast::holds_any_of<int64_t, uint64_t, double, String,
-                           Vector<BoxedValue>>(right)) {
-        fmt::print("--------2 {}, {}\n", static_cast<int32_t>(op),
-                   right.which());
-        return {};
+
+    return Iterator {visit_(iter).to_boxed()};
+}
+
+auto ASTInterpreter::stream_(const ast::Value& node) const
+    -> Stream<Completion> {
+    auto [it, inserted] = yields_.try_emplace(&node, false);
+    if (inserted) {
+        it->second = contains_yield(node);
+    }
+    if (it->second) {
+        return yielding_stream_(node);
     }
 
-    auto generic_bin_op = [](auto type, const auto& a, const auto& b,
-                             auto&& op_func) -> BoxedValue {
-        if (ast::holds_any_of<int64_t, uint64_t, double>(a)
-            && ast::holds_any_of<int64_t, uint64_t, double>(b)) {
-            if (boost::get<int64_t>(&a)) {
-                auto* lhs = boost::get<int64_t>(&a);
-                if (auto* rhs_i64 = boost::get<int64_t>(&b)) {
-                    return op_func(*lhs, *rhs_i64);
-                } else if (auto* rhs_u64 = boost::get<uint64_t>(&b)) {
-                    return op_func(*lhs, *rhs_u64);
-                } else if (auto* rhs_double = boost::get<double>(&b)) {
-                    return op_func(*lhs, *rhs_double);
-                }
-            } else if (boost::get<uint64_t>(&a)) {
-                auto* lhs = boost::get<uint64_t>(&a);
-                if (auto* rhs_i64 = boost::get<int64_t>(&b)) {
-                    return op_func(*lhs, *rhs_i64);
-                } else if (auto* rhs_u64 = boost::get<uint64_t>(&b)) {
-                    return op_func(*lhs, *rhs_u64);
-                } else if (auto* rhs_double = boost::get<double>(&b)) {
-                    return op_func(*lhs, *rhs_double);
-                }
-            } else if (boost::get<double>(&a)) {
-                auto* lhs = boost::get<double>(&a);
-                if (auto* rhs_i64 = boost::get<int64_t>(&b)) {
-                    return op_func(*lhs, *rhs_i64);
-                } else if (auto* rhs_u64 = boost::get<uint64_t>(&b)) {
-                    return op_func(*lhs, *rhs_u64);
-                } else if (auto* rhs_double = boost::get<double>(&b)) {
-                    return op_func(*lhs, *rhs_double);
-                }
+    visit_(node);
+    return Stream {std::exchange(completion_, Completion::kNormal)};
+}
+
+auto ASTInterpreter::yielding_stream_(const ast::Value& node) const
+    -> Stream<Completion> {
+    if (const auto* yield = ast::get_if<ast::YieldStatement>(&node)) {
+        // Evaluated before the co_yield, which does not keep temporaries
+        // alive across the suspension reliably.
+        auto value = yield->expr ? visit_(*yield->expr).to_boxed()
+                                 : BoxedValue {Null {}};
+        co_yield std::move(value);
+        co_return Completion::kNormal;
+    }
+
+    if (const auto* list = ast::get_if<ast::StatementList>(&node)) {
+        for (const auto& stmt : list->stmts) {
+            auto inner = stream_(stmt);
+            while (inner.next()) {
+                co_yield inner.take();
+            }
+            if (inner.result() != Completion::kNormal) {
+                co_return inner.result();
             }
-        } else if (type == ast::BinOpType::kAdd
-                   && ast::holds_alternative<String>(a)
-                   && ast::holds_alternative<String>(b)) {
-            auto* lhs = boost::get<String>(&a);
-            auto* rhs = boost::get<String>(&b);
-            return String {lhs->value + rhs->value};
-        } else if (type == ast::BinOpType::kAdd
-                   && ast::holds_alternative<Vector<BoxedValue>>(a)
-                   && ast::holds_alternative<Vector<BoxedValue>>(b)) {
-            auto* lhs = boost::get<Vector<BoxedValue>>(&a);
-            auto* rhs = boost::get<Vector<BoxedValue>>(&b);
-
-            auto output = Vector<BoxedValue> {};
-            output.reserve(lhs->size() + rhs->size());
-            std::copy(lhs->begin(), lhs->end(), std::back_inserter(output));
-            std::copy(rhs->begin(), rhs->end(), std::back_inserter(output));
-
-            return output;
         }
+        co_return Completion::kNormal;
+    }
 
-        return {};
-    };
+    if (const auto* branch = ast::get_if<ast::IfStatement>(&node)) {
+        auto condition = visit_(branch->condition);
+        const auto& taken = check_branch_condition(condition)
+                                ? branch->body
+                                : branch->or_else;
+        if (ast::holds_alternative<ast::MonoState>(taken)) {
+            co_return Completion::kNormal;
+        }
+        auto inner = stream_(taken);
+        while (inner.next()) {
+            co_yield inner.take();
+        }
+        co_return inner.result();
+    }
 
-    switch (op) {
-        case ast::BinOpType::kNone: {
-            return {};
+    // The loops stop on a break or a return; a return also ends the body.
+    if (const auto* loop = ast::get_if<ast::ForStatement>(&node)) {
+        visit_(loop->init);
+        while (check_branch_condition(visit_(loop->condition))) {
+            auto body = stream_(loop->body);
+            while (body.next()) {
+                co_yield body.take();
+            }
+            if (body.result() == Completion::kBreak) {
+                break;
+            } else if (body.result() == Completion::kReturn) {
+                co_return Completion::kReturn;
+            }
+            visit_(loop->iter);
         }
-        case ast::BinOpType::kAdd: {
-            return generic_bin_op(op, left, right, [](auto a, auto b) {
-                return a + b;
-            });
+        co_return Completion::kNormal;
+    }
+
+    if (const auto* loop = ast::get_if<ast::WhileStatement>(&node)) {
+        while (check_branch_condition(visit_(loop->condition))) {
+            auto body = stream_(loop->body);
+            while (body.next()) {
+                co_yield body.take();
+            }
+            if (body.result() == Completion::kBreak) {
+                break;
+            } else if (body.result() == Completion::kReturn) {
+                co_return Completion::kReturn;
+            }
         }
-        case ast::BinOpType::kSub: {
-            return generic_bin_op(op, left, right, [](auto a, auto b) {
-                return a - b;
-            });
+        co_return Completion::kNormal;
+    }
+
+    const auto& loop = ast::get<ast::RangeBasedForStatement>(node);
+    auto iterator = iterate_(loop.iter);
+    auto targets = for_targets(loop.target);
+    auto values = std::vector<BoxedValue>(targets.size());
+    while (iterator.next(values)) {
+        for (size_t index = 0; index < targets.size(); ++index) {
+            assign_(global_(targets[index]),
+                    TaggedValue {std::move(values[index])});
         }
-        case ast::BinOpType::kMult: {
-            return generic_bin_op(op, left, right, [](auto a, auto b) {
-                return a * b;
-            });
+        auto body = stream_(loop.body);
+        while (body.next()) {
+            co_yield body.take();
         }
-        case ast::BinOpType::kTrueDiv: {
-            return generic_bin_op(op, left, right, [](auto a, auto b) {
-                return a / b;
-            });
+        if (body.result() == Completion::kBreak) {
+            break;
+        } else if (body.result() == Completion::kReturn) {
+            co_return Completion::kReturn;
         }
-        case ast::BinOpType::kFloorDiv: {
-            return generic_bin_op(op, left, right, [](auto a, auto b) {
-                return static_cast<int64_t>(a / b);
-            });
+    }
+    co_return Completion::kNormal;
+}
+
+TaggedValue ASTInterpreter::return_value_and_reset_() const {
+    auto result = std::move(return_value_);
+    return_value_ = Null {};
+
+    return result;
+}
+
+bool ASTInterpreter::execute_loop_body_(const ast::Value& body) const {
+    visit_(body);
+    switch (std::exchange(completion_, Completion::kNormal)) {
+        case Completion::kNormal:
+        case Completion::kContinue: {
+            return true;
         }
-        case ast::BinOpType::kMod: {
-            return generic_bin_op(op, left, right, [](auto a, auto b) {
-                if constexpr (
-                    std::same_as<decltype(a),
-                                 double> || std::same_as<decltype(b), double>) {
-                    return std::fmod(a, b);
-                } else {
-                    return a % b;
-                }
-            });
+        case Completion::kBreak: {
+            return false;
         }
-        case ast::BinOpType::kPow: {
-            return generic_bin_op(op, left, right,
-                                  [](const auto& a, const auto& b) {
-                                      return std::pow(a, b);
-                                  });
+        case Completion::kReturn: {
+            // Leave the status for the enclosing call.
+            completion_ = Completion::kReturn;
+            return false;
         }
     }
 
-    return {};
+    return false;
 }
 
-bool ASTInterpreter::check_branch_condition_(const BoxedValue& value) const {
-    bool flag = true;
-    if (ast::get_if<Null>(&value)) {
-        flag = false;
-    } else if (const auto* value_bool = ast::get_if<bool>(&value)) {
-        flag = *value_bool;
-    } else if (const auto* value_i64 = ast::get_if<int64_t>(&value)) {
-        flag = *value_i64 != 0;
-    } else if (const auto* value_u64 = ast::get_if<uint64_t>(&value)) {
-        flag = *value_u64 != 0;
-    } else if (const auto* value_double = ast::get_if<double>(&value)) {
-        flag = *value_double != 0.f;
-    } else if (const auto* value_str = ast::get_if<String>(&value)) {
-        flag = !value_str->value.empty();
-    } else {
-        // TODO:
+void ASTInterpreter::bind_globals_(
+    const std::vector<std::string>& names) const {
+    // Values of the globals set by the trees executed before carry over by
+    // name.
+    auto globals = std::deque<Global>(names.size());
+    auto slots = std::unordered_map<ast::Symbol, size_t> {};
+    for (const auto& [index, name] : enumerate(names)) {
+        slots.emplace(ast::Symbol {name}, index);
+    }
+    for (const auto& [name, slot] : global_slots_) {
+        auto [it, inserted] = slots.try_emplace(name, globals.size());
+        if (inserted) {
+            globals.emplace_back();
+        }
+        globals[it->second] = std::move(globals_[slot]);
     }
 
-    return flag;
+    globals_ = std::move(globals);
+    global_slots_ = std::move(slots);
 }
 
-BoxedValue ASTInterpreter::return_value_and_reset_() const {
-    auto result = std::move(return_value_);
-    return_value_ = Null {};
+const TaggedValue* ASTInterpreter::find_(const ast::Name& name) const {
+    switch (name.scope) {
+        case ast::NameScope::kLocal: {
+            return &slots_[stack_.back().base + static_cast<size_t>(name.slot)];
+        }
+        case ast::NameScope::kGlobal: {
+            const auto& global = globals_[static_cast<size_t>(name.slot)];
+            return global.defined ? &global.value : nullptr;
+        }
+        case ast::NameScope::kUnresolved:
+        case ast::NameScope::kBuiltin:
+        case ast::NameScope::kExtern: {
+            break;
+        }
+    }
+
+    return find_(name.symbol);
+}
+
+const TaggedValue* ASTInterpreter::find_(ast::Symbol name) const {
+    if (!stack_.empty()) {
+        const auto& frame = stack_.back();
+        for (auto index = frame.params->size(); index-- > 0;) {
+            if (param_symbol_((*frame.params)[index]) == name) {
+                return &slots_[frame.base + index];
+            }
+        }
+    }
+
+    return find_global_(name);
+}
+
+const TaggedValue* ASTInterpreter::find_global_(ast::Symbol name) const {
+    auto it = global_slots_.find(name);
+    if (it == global_slots_.end() || !globals_[it->second].defined) {
+        return nullptr;
+    }
+
+    return &globals_[it->second].value;
+}
+
+auto ASTInterpreter::global_(const ast::Name& name) const -> Global& {
+    if (name.scope == ast::NameScope::kGlobal) {
+        return globals_[static_cast<size_t>(name.slot)];
+    }
+
+    return global_(name.symbol);
+}
+
+auto ASTInterpreter::global_(ast::Symbol name) const -> Global& {
+    auto [it, inserted] = global_slots_.try_emplace(name, globals_.size());
+    if (inserted) {
+        globals_.emplace_back();
+    }
+
+    return globals_[it->second];
+}
+
+void ASTInterpreter::assign_(Global& global, TaggedValue value) const {
+    auto is_callable = [](const TaggedValue& object) {
+        return object.holds<Function>() || object.holds<Lambda>();
+    };
+
+    // Compiled code inlines the functions bound to globals, so binding or
+    // replacing one invalidates every hot spot linked so far.
+    if (is_callable(value) || (global.defined && is_callable(global.value))) {
+        ++epoch_;
+    }
+    global.value = std::move(value);
+    global.defined = true;
+}
+
+template<typename Loop>
+bool ASTInterpreter::tier_up_loop_(HotSpot& spot, const Loop& node) const {
+    // The compiled loop takes over at the condition check, after the back
+    // edge. The parameters of the running function are its arguments.
+    auto params = std::vector<std::string> {};
+    auto args = std::vector<TaggedValue> {};
+    if (!stack_.empty()) {
+        const auto& frame = stack_.back();
+        params = param_names_(*frame.params).value();
+        auto begin = slots_.begin() + static_cast<ptrdiff_t>(frame.base);
+        args.assign(begin, begin + static_cast<ptrdiff_t>(params.size()));
+    }
+
+    if (!spot.linked || spot.epoch != epoch_
+        || spot.function.params != params) {
+        auto rest = node;
+        if constexpr (std::same_as<Loop, ast::ForStatement>) {
+            rest.init = ast::Pass {};
+        }
+        // Loops cannot be the name of a function, so the source never gets
+        // inlined into itself.
+        auto name = std::same_as<Loop, ast::ForStatement> ? "for" : "while";
+        link_(spot, {name, std::move(params),
+                     std::make_shared<const ast::Value>(std::move(rest))});
+    }
+
+    // A return would leave the function running the loop, which the
+    // compiled code cannot do.
+    if (!spot.returns && run_compiled_(spot, args)) {
+        return true;
+    }
+    spot.count = 0;
+
+    return false;
+}
+
+bool ASTInterpreter::link_(HotSpot& spot, jit::FunctionSource function) const {
+    // Relinking drops the code compiled for the previous callees.
+    spot = HotSpot {spot.count, epoch_, true};
+
+    auto add_name = [](std::vector<std::string>& names,
+                       const std::string& name) {
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.emplace_back(name);
+        }
+    };
+
+    auto sources = std::vector<const jit::FunctionSource*> {&function};
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const auto& source = *sources[i];
+        auto analysis = jit::JITCompiler::analyze(source.params, *source.body);
+        if (!analysis) {
+            return false;
+        }
+        if (i == 0) {
+            spot.returns = analysis->returns;
+        }
+
+        for (const auto& name : analysis->names) {
+            add_name(spot.names, name);
+        }
+        for (const auto& callee : analysis->callees) {
+            add_name(spot.names, callee);
+            if (spot.callees.contains(callee)) {
+                continue;
+            }
+
+            const auto* object = find_global_(ast::Symbol {callee});
+            if (!object) {
+                return false;
+            }
+
+            auto callable = std::shared_ptr<const CallableBody> {};
+            if (const auto* func = object->get_if<Function>()) {
+                callable = func->body;
+            } else if (const auto* lambda = object->get_if<Lambda>()) {
+                callable = lambda->body;
+            } else {
+                return false;
+            }
+
+            auto names = param_names_(callable->params);
+            if (!names) {
+                return false;
+            }
+            auto& linked = spot.callees[callee];
+            linked = jit::FunctionSource {
+                callee, std::move(*names),
+                std::shared_ptr<const ast::Value> {callable, &callable->body}};
+            sources.emplace_back(&linked);
+        }
+    }
+
+    for (const auto& name : spot.names) {
+        spot.symbols.emplace_back(name);
+        spot.callable.emplace_back(spot.callees.contains(name));
+    }
+    spot.function = std::move(function);
+    spot.supported = true;
+
+    return true;
+}
+
+auto ASTInterpreter::run_compiled_(HotSpot& spot,
+                                   std::span<const TaggedValue> args) const
+    -> std::optional<TaggedValue> {
+    if (!spot.supported) {
+        return std::nullopt;
+    }
+
+    signature_.clear();
+    for (const auto& arg : args) {
+        auto type = jit_type_of(arg);
+        if (type == jit::ValueType::kUndefined) {
+            return std::nullopt;
+        }
+        signature_.emplace_back(type);
+    }
+    inputs_.clear();
+    for (const auto& arg : args) {
+        inputs_.emplace_back(jit_bits_of(arg));
+    }
+    for (const auto& [index, name] : enumerate(spot.symbols)) {
+        const auto* value = find_global_(name);
+        if (spot.callable[index]) {
+            signature_.emplace_back(jit::ValueType::kFunction);
+            inputs_.emplace_back(0);
+        } else if (!value) {
+            signature_.emplace_back(jit::ValueType::kUndefined);
+            inputs_.emplace_back(0);
+        } else if (value->holds<Code>()) {
+            return std::nullopt;
+        } else {
+            signature_.emplace_back(jit_type_of(*value));
+            inputs_.emplace_back(jit_bits_of(*value));
+        }
+    }
+
+    auto& specializations = spot.specializations;
+    auto it = std::find_if(specializations.begin(), specializations.end(),
+                           [&](const auto& specialization) {
+                               return specialization.signature == signature_;
+                           });
+    if (it == specializations.end()) {
+        if (specializations.size() >= kMaxSpecializations) {
+            return std::nullopt;
+        }
+        specializations.emplace_back(Specialization {
+            signature_,
+            jit_->compile(spot.function, spot.callees, spot.names,
+                          signature_),
+        });
+        it = specializations.end() - 1;
+    }
+    if (!it->compiled) {
+        return std::nullopt;
+    }
+
+    const auto& compiled = *it->compiled;
+    outputs_.assign(1 + 2 * spot.names.size(), 0);
+    compiled.entry(inputs_.data(), outputs_.data());
+
+    auto result = TaggedValue {jit::from_bits(outputs_[0], compiled.result)};
+    for (const auto& [index, name] : enumerate(spot.symbols)) {
+        if (outputs_[2 + 2 * index] != 0) {
+            auto value = jit::from_bits(outputs_[1 + 2 * index],
+                                        compiled.stores[index]);
+            assign_(global_(name), TaggedValue {std::move(value)});
+        }
+    }
 
     return result;
 }
 
+template<typename Literal>
+const TaggedValue* ASTInterpreter::constant_(const Literal& node) const {
+    auto [it, inserted] = constants_.try_emplace(&node);
+    if (inserted) {
+        if (auto value = constant_literal(node)) {
+            it->second.emplace(std::move(*value));
+        }
+    }
+
+    return it->second ? &*it->second : nullptr;
+}
+
+template<typename MakeValue>
+const TaggedValue& ASTInterpreter::definition_(const void* node,
+                                               MakeValue&& make_value) const {
+    auto [it, inserted] = definitions_.try_emplace(node);
+    if (inserted) {
+        it->second = make_object(make_value());
+    }
+
+    return it->second;
+}
+
+std::optional<std::vector<std::string>> ASTInterpreter::param_names_(
+    const std::vector<ast::Value>& params) {
+    auto names = std::vector<std::string> {};
+    names.reserve(params.size());
+    for (const auto& param : params) {
+        const auto* name = param_name_(param);
+        if (!name) {
+            return std::nullopt;
+        }
+        names.emplace_back(*name);
+    }
+
+    return names;
+}
+
+const std::string* ASTInterpreter::param_name_(const ast::Value& param) {
+    if (const auto* arg = ast::get_if<ast::Argument>(&param)) {
+        if (const auto* name = ast::get_if<ast::Name>(&arg->arg)) {
+            return &name->value;
+        }
+    } else if (const auto* kwarg = ast::get_if<ast::KeywordArgument>(&param)) {
+        return &kwarg->name.value;
+    }
+
+    return nullptr;
+}
+
+ast::Symbol ASTInterpreter::param_symbol_(const ast::Value& param) {
+    if (const auto* arg = ast::get_if<ast::Argument>(&param)) {
+        if (const auto* name = ast::get_if<ast::Name>(&arg->arg)) {
+            return name->symbol;
+        }
+    } else if (const auto* kwarg = ast::get_if<ast::KeywordArgument>(&param)) {
+        return kwarg->name.symbol;
+    }
+
+    return {};
+}
+
 }    // namespace expressions::interpreter
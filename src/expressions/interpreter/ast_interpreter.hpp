@@ -8,6 +8,13 @@
 #define __EXPRESSIONS_INTERPRETER_AST_INTERPRETER_HPP__
 
 #include <expressions/ast/ast.hpp>
+#include <expressions/interpreter/caller.hpp>
+#include <expressions/interpreter/generator.hpp>
+#include <expressions/interpreter/host_functions.hpp>
+#include <expressions/interpreter/iterator.hpp>
+#include <expressions/interpreter/tagged_value.hpp>
+#include <expressions/interpreter/value.hpp>
+#include <expressions/jit/jit_compiler.hpp>
 
 #include <expressions/exception/throw_exception.hpp>
 
@@ -17,313 +24,79 @@
 #include <boost/mp11.hpp>
 #include <boost/type_index.hpp>
 
-#include <map>
-#include <set>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
-#include <tuple>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 
 namespace expressions::interpreter {
 
-class BreakException : public std::exception {
-public:
-    using exception::exception;
-};
-
-class ContinueException : public std::exception {
-public:
-    using exception::exception;
-};
-
-class ReturnException : public std::exception {
-public:
-    using exception::exception;
-};
-
 class ProgramTerminated : public std::runtime_error {
 public:
     using runtime_error::runtime_error;
 };
 
-struct Ellipsis {
-    bool operator==(const Ellipsis&) const = default;
-    bool operator!=(const Ellipsis&) const = default;
-
-    template<typename T>
-    bool operator==(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator!=(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator<(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator<=(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator>(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator>=(const T&) const {
-        return false;
-    }
+// How the last statement finished. Anything but kNormal skips the rest of the
+// enclosing statements up to the loop or the call handling it.
+enum class Completion : int32_t {
+    kNormal,
+    kReturn,
+    kBreak,
+    kContinue,
 };
 
-struct Null {
-    bool operator==(const Null&) const = default;
-    bool operator!=(const Null&) const = default;
-
-    template<typename T>
-    bool operator==(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator!=(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator<(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator<=(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator>(const T&) const {
-        return false;
-    }
-    template<typename T>
-    bool operator>=(const T&) const {
-        return false;
-    }
+// Execution counts after which the interpreter hands hot code to the JIT
+// compiler. Code that never gets hot is never compiled.
+struct TierPolicy {
+    // Calls of a function before its body is compiled.
+    uint32_t call_threshold = 1000;
+    // Iterations of a loop before the rest of the loop is compiled.
+    uint32_t loop_threshold = 1000;
 };
 
-struct Name {
-    std::string value;
-
-    bool operator==(const Name& rhs) const {
-        return value == rhs.value;
-    }
-    bool operator!=(const Name& rhs) const {
-        return value != rhs.value;
-    }
-    bool operator<(const Name& rhs) const {
-        return value < rhs.value;
-    }
-    bool operator<=(const Name& rhs) const {
-        return value <= rhs.value;
-    }
-    bool operator>(const Name& rhs) const {
-        return value > rhs.value;
-    }
-    bool operator>=(const Name& rhs) const {
-        return value >= rhs.value;
-    }
-};
-
-struct String {
-    std::string value;
-
-    bool operator==(const String& rhs) const {
-        return value == rhs.value;
-    }
-    bool operator!=(const String& rhs) const {
-        return value != rhs.value;
-    }
-    bool operator<(const String& rhs) const {
-        return value < rhs.value;
-    }
-    bool operator<=(const String& rhs) const {
-        return value <= rhs.value;
-    }
-    bool operator>(const String& rhs) const {
-        return value > rhs.value;
-    }
-    bool operator>=(const String& rhs) const {
-        return value >= rhs.value;
-    }
-};
-
-struct Date {
-    int16_t year = 0;
-    int8_t month = 0;
-    int8_t day = 0;
-
-    bool operator==(const Date& rhs) const {
-        return std::make_tuple(year, month, day)
-               == std::make_tuple(rhs.year, rhs.month, rhs.day);
-    }
-    bool operator!=(const Date& rhs) const {
-        return std::make_tuple(year, month, day)
-               != std::make_tuple(rhs.year, rhs.month, rhs.day);
-    }
-    bool operator<(const Date& rhs) const {
-        return std::make_tuple(year, month, day)
-               < std::make_tuple(rhs.year, rhs.month, rhs.day);
-    }
-    bool operator<=(const Date& rhs) const {
-        return std::make_tuple(year, month, day)
-               <= std::make_tuple(rhs.year, rhs.month, rhs.day);
-    }
-    bool operator>(const Date& rhs) const {
-        return std::make_tuple(year, month, day)
-               > std::make_tuple(rhs.year, rhs.month, rhs.day);
-    }
-    bool operator>=(const Date& rhs) const {
-        return std::make_tuple(year, month, day)
-               >= std::make_tuple(rhs.year, rhs.month, rhs.day);
-    }
-};
-
-struct DateRange {
-    Date begin;
-    Date end;
-
-    bool operator==(const DateRange& rhs) const {
-        return begin == rhs.begin && end == rhs.end;
-    }
-    bool operator!=(const DateRange& rhs) const {
-        return begin != rhs.begin || end != rhs.end;
-    }
-    bool operator<(const DateRange& rhs) const {
-        return begin < rhs.begin;
-    }
-    bool operator<=(const DateRange& rhs) const {
-        return begin <= rhs.begin;
-    }
-    bool operator>(const DateRange& rhs) const {
-        return end > rhs.end;
-    }
-    bool operator>=(const DateRange& rhs) const {
-        return end >= rhs.end;
-    }
-};
-
-struct Code {
-    ast::Value code;
-
-    bool operator==(const Code&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '==' for type 'Code'"));
-    }
-    bool operator!=(const Code&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '!=' for type 'Code'"));
-    }
-    bool operator<(const Code&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '<' for type 'Code'"));
-    }
-    bool operator<=(const Code&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '<=' for type 'Code'"));
-    }
-    bool operator>(const Code&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '>' for type 'Code'"));
-    }
-    bool operator>=(const Code&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '>=' for type 'Code'"));
-    }
-};
-
-struct Lambda {
-    std::vector<ast::Value> params {};
-    ast::Value body {};
-
-    bool operator==(const Lambda&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '==' for type 'Lambda'"));
-    }
-    bool operator!=(const Lambda&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '!=' for type 'Lambda'"));
-    }
-    bool operator<(const Lambda&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '<' for type 'Lambda'"));
-    }
-    bool operator<=(const Lambda&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '<=' for type 'Lambda'"));
-    }
-    bool operator>(const Lambda&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '>' for type 'Lambda'"));
-    }
-    bool operator>=(const Lambda&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '>=' for type 'Lambda'"));
-    }
-};
-
-struct Function {
-    Name name {};
-    std::vector<ast::Value> params {};
-    ast::Value body {};
-
-    bool operator==(const Function&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '==' for type 'Function'"));
-    }
-    bool operator!=(const Function&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '!=' for type 'Function'"));
-    }
-    bool operator<(const Function&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '<' for type 'Function'"));
-    }
-    bool operator<=(const Function&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '<=' for type 'Function'"));
-    }
-    bool operator>(const Function&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '>' for type 'Function'"));
-    }
-    bool operator>=(const Function&) const {
-        THROW_EXCEPTION(
-            std::logic_error("Unsupported operator '>=' for type 'Function'"));
-    }
-};
-
-template<typename T>
-struct Tuple : std::vector<T> {};
-
-template<typename T>
-struct Vector : std::vector<T> {};
-
-template<typename T>
-struct Set : std::set<T> {};
-
-template<typename K, typename V>
-struct Map : std::map<K, V> {};
-
-using BoxedValue = boost::make_recursive_variant<
-    Null, bool, int64_t, uint64_t, double, Name, String, Date, DateRange, Code,
-    Lambda, Function, Tuple<boost::recursive_variant_>,
-    Vector<boost::recursive_variant_>, Set<boost::recursive_variant_>,
-    Map<boost::recursive_variant_, boost::recursive_variant_>, Ellipsis>::type;
-
-class ASTInterpreter : public boost::static_visitor<BoxedValue> {
+// Calls back from the builtins taking a callable run on the interpreter.
+class ASTInterpreter : public boost::static_visitor<TaggedValue>,
+                       private Caller {
 public:
     ASTInterpreter() = default;
+    // Calls to the names scripts declare extern go to the host functions.
+    explicit ASTInterpreter(std::shared_ptr<const HostFunctions> hosts)
+        : hosts_ {std::move(hosts)} {}
+    // Functions and loops crossing the thresholds of the policy continue as
+    // native code whenever the JIT supports the types they see, and stay on
+    // the interpreter otherwise.
+    explicit ASTInterpreter(std::shared_ptr<jit::JITCompiler> jit,
+                            TierPolicy policy = {},
+                            std::shared_ptr<const HostFunctions> hosts = {})
+        : jit_ {std::move(jit)}, policy_ {policy}, hosts_ {std::move(hosts)} {}
+
+    using ReturnType = TaggedValue;
+
+    BoxedValue execute(const ast::Entry& node) const {
+        // Hot spots are keyed by the nodes of the tree being executed. A
+        // tree parsed again into the same Entry keeps its address, but not
+        // its id.
+        if (&node != entry_ || node.id != entry_id_) {
+            entry_ = &node;
+            entry_id_ = node.id;
+            ++epoch_;
+            hot_spots_.clear();
+            definitions_.clear();
+            constants_.clear();
+            yields_.clear();
+            bind_globals_(node.globals);
+        }
 
-    using ReturnType = BoxedValue;
-
-    ReturnType execute(const ast::Entry& node) const {
-        return visit_(node);
+        return visit_(node).to_boxed();
     }
 
 private:
@@ -400,6 +173,7 @@ public:
     ReturnType operator()(const ast::LazyAssignStatement& node) const;
     ReturnType operator()(const ast::AugAssignStatement& node) const;
     ReturnType operator()(const ast::ReturnStatement& node) const;
+    ReturnType operator()(const ast::YieldStatement& node) const;
     ReturnType operator()(const ast::StatementList& node) const;
 
     ReturnType operator()(const ast::ExternFunctionDecl& node) const;
@@ -420,16 +194,138 @@ public:
     ReturnType operator()(const ast::Entry& node) const;
 
 private:
-    ReturnType execute_bin_op_(ast::BinOpType op, BoxedValue&& left,
-                               BoxedValue&& right) const;
-    bool check_branch_condition_(const BoxedValue& value) const;
-    BoxedValue return_value_and_reset_() const;
+    struct Specialization {
+        std::vector<jit::ValueType> signature {};
+        // Empty if the code cannot be compiled for the signature.
+        std::optional<jit::CompiledFunction> compiled {};
+    };
+
+    // Profile of a function body or of a loop. Once linked, it holds the
+    // source compiled for it together with every function it calls.
+    struct HotSpot {
+        uint32_t count = 0;
+        // Epoch the spot was linked in. The callees of a spot linked in an
+        // older epoch may have been replaced since.
+        uint64_t epoch = 0;
+        bool linked = false;
+        bool supported = false;
+        bool returns = false;
+        jit::FunctionSource function {};
+        std::unordered_map<std::string, jit::FunctionSource> callees {};
+        std::vector<std::string> names {};
+        // The interned names, in the same order.
+        std::vector<ast::Symbol> symbols {};
+        std::vector<bool> callable {};
+        std::vector<Specialization> specializations {};
+    };
+
+    // Upper bound of the signatures compiled for a single hot spot.
+    static constexpr size_t kMaxSpecializations = 8;
+
+    struct Global {
+        TaggedValue value {};
+        bool defined = false;
+    };
+
+    // A call's slots in the frame buffer, one per parameter in order. The
+    // parameters are the only locals a function has.
+    struct Frame {
+        size_t base = 0;
+        const std::vector<ast::Value>* params = nullptr;
+    };
+
+    BoxedValue call(const BoxedValue& callee,
+                    std::span<const BoxedValue> args) const override;
+    std::optional<CallableSource> source(
+        const BoxedValue& callee) const override;
+
+    class GeneratorCall;
+
+    // The body of a Lambda or a Function taking argc arguments. The name is
+    // for errors only.
+    const std::shared_ptr<const CallableBody>& callable_(
+        const TaggedValue& callee, std::string_view name, size_t argc) const;
+    // Runs the callable on the arguments in the slots from base on, and
+    // drops them.
+    TaggedValue run_body_(const CallableBody& callable, size_t base) const;
+    TaggedValue return_value_and_reset_() const;
+    // Runs a loop body. Returns false if the loop must stop.
+    bool execute_loop_body_(const ast::Value& body) const;
+    // The iterator of a range-based for statement over the expression.
+    Iterator iterate_(const ast::Value& iter) const;
+
+    // Runs a statement of a generator body, suspending at its yields. A
+    // statement that cannot yield runs right away, and the stream returned
+    // is finished.
+    Stream<Completion> stream_(const ast::Value& node) const;
+    Stream<Completion> yielding_stream_(const ast::Value& node) const;
+
+    // Renumbers the globals after the slots of the tree to execute.
+    void bind_globals_(const std::vector<std::string>& names) const;
+    // Return nullptr if the name holds no value.
+    const TaggedValue* find_(const ast::Name& name) const;
+    const TaggedValue* find_(ast::Symbol name) const;
+    const TaggedValue* find_global_(ast::Symbol name) const;
+    Global& global_(const ast::Name& name) const;
+    Global& global_(ast::Symbol name) const;
+    void assign_(Global& global, TaggedValue value) const;
+
+    template<typename Loop>
+    bool tier_up_loop_(HotSpot& spot, const Loop& node) const;
+    bool link_(HotSpot& spot, jit::FunctionSource function) const;
+    // Runs the compiled code of the spot on the arguments. Returns
+    // std::nullopt if there is no native code for the current types.
+    auto run_compiled_(HotSpot& spot, std::span<const TaggedValue> args) const
+        -> std::optional<TaggedValue>;
+
+    // The value of a string literal, or of a collection literal whose
+    // elements are all literals. It is built once, and evaluating the node
+    // again shares it. Returns nullptr if the literal is not constant.
+    template<typename Literal>
+    const TaggedValue* constant_(const Literal& node) const;
+    // The callable or the code a definition node evaluates to. It is made
+    // once, and evaluating the node again shares it.
+    template<typename MakeValue>
+    const TaggedValue& definition_(const void* node,
+                                   MakeValue&& make_value) const;
+
+    static std::optional<std::vector<std::string>> param_names_(
+        const std::vector<ast::Value>& params);
+    // Returns nullptr if the parameter is not a name.
+    static const std::string* param_name_(const ast::Value& param);
+    // The interned name of the parameter, or the empty symbol.
+    static ast::Symbol param_symbol_(const ast::Value& param);
 
 private:
-    using Context = std::unordered_map<std::string, BoxedValue>;
-    mutable Context context_ {};
-    mutable std::vector<Context> stack_ {};
-    mutable BoxedValue return_value_ {};
+    // Slots keep their address while globals get added, since the code
+    // running may live in one of them.
+    mutable std::deque<Global> globals_ {};
+    mutable std::unordered_map<ast::Symbol, size_t> global_slots_ {};
+    // Frames are carved out of one buffer, so that calls allocate nothing
+    // once it has grown to the deepest call chain.
+    mutable std::vector<TaggedValue> slots_ {};
+    mutable std::vector<Frame> stack_ {};
+    mutable TaggedValue return_value_ {};
+    mutable Completion completion_ {Completion::kNormal};
+
+    std::shared_ptr<jit::JITCompiler> jit_ {};
+    TierPolicy policy_ {};
+    std::shared_ptr<const HostFunctions> hosts_ {};
+    mutable const ast::Entry* entry_ = nullptr;
+    mutable uint64_t entry_id_ = 0;
+    // Advanced whenever a global holding a function is replaced, which
+    // invalidates the code inlining it.
+    mutable uint64_t epoch_ = 0;
+    mutable std::unordered_map<const void*, HotSpot> hot_spots_ {};
+    // Keyed by the nodes of the tree being executed.
+    mutable std::unordered_map<const void*, TaggedValue> definitions_ {};
+    mutable std::unordered_map<const void*, std::optional<TaggedValue>>
+        constants_ {};
+    // Whether a statement of a generator body may yield.
+    mutable std::unordered_map<const void*, bool> yields_ {};
+    mutable std::vector<jit::ValueType> signature_ {};
+    mutable std::vector<uint64_t> inputs_ {};
+    mutable std::vector<uint64_t> outputs_ {};
 };
 
 }    // namespace expressions::interpreter
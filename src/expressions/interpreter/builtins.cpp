@@ -0,0 +1,797 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/builtins.hpp>
+
+#include <expressions/interpreter/algorithm.hpp>
+#include <expressions/interpreter/iterator.hpp>
+#include <expressions/interpreter/math.hpp>
+#include <expressions/interpreter/operators.hpp>
+
+#include <expressions/common/enumerate.hpp>
+#include <expressions/common/scope_exit.hpp>
+#include <expressions/common/visitor.hpp>
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+#include <boost/type_index.hpp>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+std::string format_value(const BoxedValue& boxed) {
+    auto printer = SelfVisitableVisitor {
+        [](auto&&, interpreter::Null) {
+            return std::string {"null"};
+        },
+        [](auto&&, bool value) {
+            return fmt::format("{}", value);
+        },
+        [](auto&&, int64_t value) {
+            return fmt::format("{}", value);
+        },
+        [](auto&&, uint64_t value) {
+            return fmt::format("{}", value);
+        },
+        [](auto&&, double value) {
+            return fmt::format("{}", value);
+        },
+        [](auto&&, const interpreter::Name& value) {
+            return value.value;
+        },
+        [](auto&&, const interpreter::String& value) {
+            return fmt::format("{}", value.view());
+        },
+        [](auto&&, const interpreter::Date& value) {
+            auto date = value.to_civil();
+            return fmt::format("{:04}-{:02}-{:02}", date.year, date.month,
+                               date.day);
+        },
+        [](auto&&, const interpreter::DateRange& value) {
+            auto begin = value.begin.to_civil();
+            auto end = value.end.to_civil();
+            return fmt::format("{:04}-{:02}-{:02}-{:04}-{:02}-{:02}",
+                               begin.year, begin.month, begin.day, end.year,
+                               end.month, end.day);
+        },
+        [](auto&& self, const interpreter::Tuple<interpreter::BoxedValue>& c) {
+            auto buffer = fmt::memory_buffer {};
+            auto output = std::back_inserter(buffer);
+            fmt::format_to(output, "(");
+            for (const auto& [index, item] : enumerate(c)) {
+                if (index > 0) {
+                    fmt::format_to(output, ", ");
+                }
+                fmt::format_to(output, "{}", self.visit(item));
+            }
+            fmt::format_to(output, ")");
+
+            return fmt::to_string(buffer);
+        },
+        [](auto&& self, const interpreter::Vector<interpreter::BoxedValue>& c) {
+            auto buffer = fmt::memory_buffer {};
+            auto output = std::back_inserter(buffer);
+            fmt::format_to(output, "[");
+            // Unboxed elements are boxed on access, so they are read by
+            // value rather than through enumerate().
+            for (size_t index = 0; index < c.size(); ++index) {
+                if (index > 0) {
+                    fmt::format_to(output, ", ");
+                }
+                fmt::format_to(output, "{}", self.visit(c.get()[index]));
+            }
+            fmt::format_to(output, "]");
+
+            return fmt::to_string(buffer);
+        },
+        [](auto&& self, const interpreter::Set<interpreter::BoxedValue>& c) {
+            auto buffer = fmt::memory_buffer {};
+            auto output = std::back_inserter(buffer);
+            fmt::format_to(output, "<<?");
+            for (const auto& [index, item] : enumerate(c)) {
+                if (index > 0) {
+                    fmt::format_to(output, ", ");
+                }
+                fmt::format_to(output, "{}", self.visit(item));
+            }
+            fmt::format_to(output, "?>>");
+
+            return fmt::to_string(buffer);
+        },
+        [](auto&&, const interpreter::Map<interpreter::BoxedValue,
+                                          interpreter::BoxedValue>& c) {
+            (void)c;
+            return std::string {};
+        },
+        [](auto&&, const auto& value) {
+            auto name
+                = boost::typeindex::type_id<decltype(value)>().pretty_name();
+            return fmt::format("{}", name);
+        },
+    };
+
+    return printer.visit(boxed);
+}
+
+uint64_t length_of(const BoxedValue& boxed) {
+    auto visitor = SelfVisitableVisitor {
+        [](auto&&, interpreter::Null) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, bool) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, int64_t) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, uint64_t) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, double) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, const interpreter::Name&) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, const interpreter::String& value) -> uint64_t {
+            return value.size();
+        },
+        [](auto&&, const interpreter::Date&) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&, const interpreter::DateRange&) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+        [](auto&&,
+           const interpreter::Tuple<interpreter::BoxedValue>& c) -> uint64_t {
+            return c.size();
+        },
+        [](auto&&,
+           const interpreter::Vector<interpreter::BoxedValue>& c) -> uint64_t {
+            return c.size();
+        },
+        [](auto&&,
+           const interpreter::Set<interpreter::BoxedValue>& c) -> uint64_t {
+            return c.size();
+        },
+        [](auto&&,
+           const interpreter::Map<interpreter::BoxedValue,
+                                  interpreter::BoxedValue>& c) -> uint64_t {
+            return c.size();
+        },
+        [](auto&&, const auto&) -> uint64_t {
+            THROW_EXCEPTION(std::invalid_argument("not iterable."));
+        },
+    };
+
+    return visitor.visit(boxed);
+}
+
+Date date_arg(std::string_view name, const BoxedValue& arg) {
+    if (const auto* date = boost::get<Date>(&arg)) {
+        return *date;
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects a date.", name)));
+}
+
+Date date_arg(std::string_view name, const TaggedValue& arg) {
+    if (arg.tag() == TaggedValue::Tag::kDate) {
+        return arg.as_date();
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects a date.", name)));
+}
+
+DateRange date_range_arg(std::string_view name, const BoxedValue& arg) {
+    if (const auto* range = boost::get<DateRange>(&arg)) {
+        return *range;
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects a date range.", name)));
+}
+
+DateRange date_range_arg(std::string_view name, const TaggedValue& arg) {
+    if (arg.tag() == TaggedValue::Tag::kDateRange) {
+        return arg.as_date_range();
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects a date range.", name)));
+}
+
+int64_t integer_arg(std::string_view name, const BoxedValue& arg) {
+    if (const auto* value_i64 = boost::get<int64_t>(&arg)) {
+        return *value_i64;
+    } else if (const auto* value_u64 = boost::get<uint64_t>(&arg)) {
+        return static_cast<int64_t>(*value_u64);
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects an integer.", name)));
+}
+
+int64_t integer_arg(std::string_view name, const TaggedValue& arg) {
+    if (arg.tag() == TaggedValue::Tag::kInt64) {
+        return arg.as_int64();
+    } else if (arg.tag() == TaggedValue::Tag::kUInt64) {
+        return static_cast<int64_t>(arg.as_uint64());
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects an integer.", name)));
+}
+
+template<typename Value>
+int64_t days_between(std::span<const Value> args) {
+    auto from = date_arg("days_between", args[0]);
+    auto to = date_arg("days_between", args[1]);
+
+    return int64_t {to.days} - from.days;
+}
+
+template<typename Value>
+Date add_days(std::span<const Value> args) {
+    auto date = date_arg("add_days", args[0]);
+    auto days = integer_arg("add_days", args[1]);
+    if (days < int64_t {Date::kMinDays} - date.days
+        || days > int64_t {Date::kMaxDays} - date.days) {
+        THROW_EXCEPTION(std::out_of_range("add_days() date out of range."));
+    }
+
+    return Date {static_cast<int32_t>(date.days + days)};
+}
+
+template<typename Value>
+int64_t weekday(std::span<const Value> args) {
+    return date_arg("weekday", args[0]).weekday();
+}
+
+template<typename Value>
+bool date_in_range(std::span<const Value> args) {
+    auto date = date_arg("date_in_range", args[0]);
+
+    return date_range_arg("date_in_range", args[1]).contains(date);
+}
+
+}    // namespace
+
+void __builtin_print(std::span<const BoxedValue> args) {
+    auto output = std::vector<std::string> {};
+    output.reserve(args.size());
+    for (const auto& arg : args) {
+        output.emplace_back(format_value(arg));
+    }
+    fmt::print("{}\n", fmt::join(output, " "));
+}
+
+void __builtin_print(std::span<const TaggedValue> args) {
+    auto output = std::vector<std::string> {};
+    output.reserve(args.size());
+    for (const auto& arg : args) {
+        switch (arg.tag()) {
+            case TaggedValue::Tag::kNull: {
+                output.emplace_back("null");
+                break;
+            }
+            case TaggedValue::Tag::kBool: {
+                output.emplace_back(fmt::format("{}", arg.as_bool()));
+                break;
+            }
+            case TaggedValue::Tag::kInt64: {
+                output.emplace_back(fmt::format("{}", arg.as_int64()));
+                break;
+            }
+            case TaggedValue::Tag::kUInt64: {
+                output.emplace_back(fmt::format("{}", arg.as_uint64()));
+                break;
+            }
+            case TaggedValue::Tag::kDouble: {
+                output.emplace_back(fmt::format("{}", arg.as_double()));
+                break;
+            }
+            case TaggedValue::Tag::kObject: {
+                output.emplace_back(format_value(arg.object()));
+                break;
+            }
+            case TaggedValue::Tag::kEllipsis:
+            case TaggedValue::Tag::kDate:
+            case TaggedValue::Tag::kDateRange: {
+                output.emplace_back(format_value(arg.to_boxed()));
+                break;
+            }
+        }
+    }
+    fmt::print("{}\n", fmt::join(output, " "));
+}
+
+uint64_t __builtin_len(std::span<const BoxedValue> args) {
+    return length_of(args[0]);
+}
+
+uint64_t __builtin_len(std::span<const TaggedValue> args) {
+    if (!args[0].is_object()) {
+        THROW_EXCEPTION(std::invalid_argument("not iterable."));
+    }
+
+    return length_of(args[0].object());
+}
+
+int64_t __builtin_days_between(std::span<const BoxedValue> args) {
+    return days_between(args);
+}
+
+int64_t __builtin_days_between(std::span<const TaggedValue> args) {
+    return days_between(args);
+}
+
+Date __builtin_add_days(std::span<const BoxedValue> args) {
+    return add_days(args);
+}
+
+Date __builtin_add_days(std::span<const TaggedValue> args) {
+    return add_days(args);
+}
+
+int64_t __builtin_weekday(std::span<const BoxedValue> args) {
+    return weekday(args);
+}
+
+int64_t __builtin_weekday(std::span<const TaggedValue> args) {
+    return weekday(args);
+}
+
+bool __builtin_date_in_range(std::span<const BoxedValue> args) {
+    return date_in_range(args);
+}
+
+bool __builtin_date_in_range(std::span<const TaggedValue> args) {
+    return date_in_range(args);
+}
+
+namespace {
+
+void check_arity(const Builtin& builtin, size_t argc) {
+    auto min = static_cast<size_t>(builtin.min_arity);
+    auto max = static_cast<size_t>(builtin.max_arity);
+    if (argc >= min
+        && (builtin.max_arity == Builtin::kVariadic || argc <= max)) {
+        return;
+    }
+
+    if (builtin.min_arity == builtin.max_arity) {
+        THROW_EXCEPTION(std::invalid_argument(
+            fmt::format("{}() only takes {} argument{}.", builtin.name,
+                        builtin.min_arity, builtin.min_arity == 1 ? "" : "s")));
+    } else if (builtin.max_arity == Builtin::kVariadic) {
+        THROW_EXCEPTION(std::invalid_argument(
+            fmt::format("{}() takes at least {} argument{}.", builtin.name,
+                        builtin.min_arity, builtin.min_arity == 1 ? "" : "s")));
+    }
+    THROW_EXCEPTION(std::invalid_argument(
+        fmt::format("{}() takes {} to {} arguments.", builtin.name,
+                    builtin.min_arity, builtin.max_arity)));
+}
+
+// The tagged entry point of a builtin working on boxed values. Objects the
+// call holds the only reference to are moved rather than copied, and moved
+// back if the builtin throws.
+template<BoxedValue (*Function)(std::span<BoxedValue>, const Caller&)>
+TaggedValue boxed_entry(std::span<TaggedValue> args, const Caller& caller) {
+    auto boxed = std::vector<BoxedValue> {};
+    boxed.reserve(args.size());
+    for (auto& arg : args) {
+        if (arg.is_object()) {
+            boxed.emplace_back(std::move(arg.mutable_object()));
+        } else {
+            boxed.emplace_back(arg.to_boxed());
+        }
+    }
+
+    auto returned = false;
+    auto give_back = ScopeExit {[&] {
+        if (returned) {
+            return;
+        }
+        for (size_t index = 0; index < args.size(); ++index) {
+            if (args[index].is_object()) {
+                args[index].mutable_object() = std::move(boxed[index]);
+            }
+        }
+    }};
+    auto result = Function(boxed, caller);
+    returned = true;
+    return TaggedValue {std::move(result)};
+}
+
+// Indexed by parser::BuiltinFunction.
+constexpr auto kBuiltins = std::array {
+    Builtin {
+        "print",
+        0,
+        Builtin::kVariadic,
+        false,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            __builtin_print(args);
+            return Null {};
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            __builtin_print(args);
+            return Null {};
+        },
+    },
+    Builtin {
+        "len",
+        1,
+        1,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_len(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_len(args);
+        },
+    },
+    Builtin {
+        "days_between",
+        2,
+        2,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_days_between(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_days_between(args);
+        },
+    },
+    Builtin {
+        "add_days",
+        2,
+        2,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_add_days(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_add_days(args);
+        },
+    },
+    Builtin {
+        "weekday",
+        1,
+        1,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_weekday(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_weekday(args);
+        },
+    },
+    Builtin {
+        "date_in_range",
+        2,
+        2,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_date_in_range(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_date_in_range(args);
+        },
+    },
+    Builtin {
+        "make_heap",
+        1,
+        2,
+        false,
+        true,
+        &__builtin_make_heap,
+        &boxed_entry<__builtin_make_heap>,
+    },
+    Builtin {
+        "push_heap",
+        1,
+        2,
+        false,
+        true,
+        &__builtin_push_heap,
+        &boxed_entry<__builtin_push_heap>,
+    },
+    Builtin {
+        "pop_heap",
+        1,
+        2,
+        false,
+        true,
+        &__builtin_pop_heap,
+        &boxed_entry<__builtin_pop_heap>,
+    },
+    Builtin {
+        "sort_heap",
+        1,
+        2,
+        false,
+        true,
+        &__builtin_sort_heap,
+        &boxed_entry<__builtin_sort_heap>,
+    },
+    Builtin {
+        "is_heap",
+        1,
+        2,
+        false,
+        false,
+        [](std::span<BoxedValue> args, const Caller& caller) -> BoxedValue {
+            return __builtin_is_heap(args, caller);
+        },
+        [](std::span<TaggedValue> args, const Caller& caller) -> TaggedValue {
+            auto boxed = std::vector<BoxedValue> {};
+            boxed.reserve(args.size());
+            for (const auto& arg : args) {
+                boxed.emplace_back(arg.to_boxed());
+            }
+            return __builtin_is_heap(boxed, caller);
+        },
+    },
+    Builtin {
+        "sqrt",
+        1,
+        1,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_sqrt(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_sqrt(args);
+        },
+    },
+    Builtin {
+        "exp",
+        1,
+        1,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_exp(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_exp(args);
+        },
+    },
+    Builtin {
+        "log",
+        1,
+        1,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_log(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_log(args);
+        },
+    },
+    Builtin {
+        "pow",
+        2,
+        2,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_pow(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_pow(args);
+        },
+    },
+    Builtin {
+        "abs",
+        1,
+        1,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_abs(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_abs(args);
+        },
+    },
+    Builtin {
+        "min",
+        1,
+        Builtin::kVariadic,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_min(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_min(args);
+        },
+    },
+    Builtin {
+        "max",
+        1,
+        Builtin::kVariadic,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_max(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            return __builtin_max(args);
+        },
+    },
+    Builtin {
+        "sort",
+        1,
+        2,
+        false,
+        true,
+        &__builtin_sort,
+        &boxed_entry<__builtin_sort>,
+    },
+    Builtin {
+        "stable_sort",
+        1,
+        2,
+        false,
+        true,
+        &__builtin_stable_sort,
+        &boxed_entry<__builtin_stable_sort>,
+    },
+    Builtin {
+        "nth_element",
+        2,
+        3,
+        false,
+        true,
+        &__builtin_nth_element,
+        &boxed_entry<__builtin_nth_element>,
+    },
+    Builtin {
+        "top_k",
+        2,
+        3,
+        false,
+        false,
+        &__builtin_top_k,
+        [](std::span<TaggedValue> args, const Caller& caller) -> TaggedValue {
+            auto boxed = std::vector<BoxedValue> {};
+            boxed.reserve(args.size());
+            for (const auto& arg : args) {
+                boxed.emplace_back(arg.to_boxed());
+            }
+            return TaggedValue {__builtin_top_k(boxed, caller)};
+        },
+    },
+    Builtin {
+        "range",
+        1,
+        3,
+        true,
+        false,
+        [](std::span<BoxedValue> args, const Caller&) -> BoxedValue {
+            return __builtin_range(args);
+        },
+        [](std::span<TaggedValue> args, const Caller&) -> TaggedValue {
+            auto boxed = std::vector<BoxedValue> {};
+            boxed.reserve(args.size());
+            for (const auto& arg : args) {
+                boxed.emplace_back(arg.to_boxed());
+            }
+            return TaggedValue {__builtin_range(boxed)};
+        },
+    },
+};
+
+constexpr bool follows_parser_names() {
+    if (kBuiltins.size() != parser::kBuiltinFunctionNames.size()) {
+        return false;
+    }
+    for (size_t index = 0; index < kBuiltins.size(); ++index) {
+        if (kBuiltins[index].name != parser::kBuiltinFunctionNames[index]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+static_assert(follows_parser_names(),
+              "The builtin registry must follow parser::BuiltinFunction.");
+
+}    // namespace
+
+BoxedValue Builtin::operator()(std::span<BoxedValue> args,
+                               const Caller& caller) const {
+    check_arity(*this, args.size());
+    return boxed(args, caller);
+}
+
+TaggedValue Builtin::operator()(std::span<TaggedValue> args,
+                                const Caller& caller) const {
+    check_arity(*this, args.size());
+    return tagged(args, caller);
+}
+
+const Builtin& builtin_of(parser::BuiltinFunction function) {
+    return kBuiltins[static_cast<size_t>(function)];
+}
+
+const ast::Call* in_place_call(const ast::Name& target,
+                               const ast::Value& expr) {
+    const auto* node = &expr;
+    while (const auto* inner = ast::get_if<ast::Expression>(node)) {
+        node = &inner->expr;
+    }
+    const auto* call = ast::get_if<ast::Call>(node);
+    if (!call || call->args.empty()
+        || target.scope != ast::NameScope::kGlobal) {
+        return nullptr;
+    }
+    auto builtin = parser::builtin_function_of(call->name);
+    if (!builtin || !builtin_of(*builtin).in_place) {
+        return nullptr;
+    }
+
+    const auto* arg = &call->args.front();
+    if (const auto* argument = ast::get_if<ast::Argument>(arg)) {
+        arg = &argument->arg;
+    }
+    while (const auto* inner = ast::get_if<ast::Expression>(arg)) {
+        arg = &inner->expr;
+    }
+    const auto* name = ast::get_if<ast::Name>(arg);
+    if (!name || name->scope != ast::NameScope::kGlobal
+        || name->slot != target.slot) {
+        return nullptr;
+    }
+
+    return call;
+}
+
+bool can_hand_over(std::span<const BoxedValue> args, const BoxedValue& value) {
+    auto callable = [](const BoxedValue& arg) {
+        return boost::get<Lambda>(&arg) || boost::get<Function>(&arg);
+    };
+
+    return !args.empty() && shares_contents(args.front(), value)
+           && std::none_of(args.begin(), args.end(), callable);
+}
+
+bool can_hand_over(std::span<const TaggedValue> args,
+                   const TaggedValue& value) {
+    auto callable = [](const TaggedValue& arg) {
+        return arg.holds<Lambda>() || arg.holds<Function>();
+    };
+
+    return !args.empty() && args.front().is_object() && value.is_object()
+           && &args.front().object() == &value.object()
+           && std::none_of(args.begin(), args.end(), callable);
+}
+
+}    // namespace expressions::interpreter
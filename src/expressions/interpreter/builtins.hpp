@@ -0,0 +1,98 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_BUILTINS_HPP__
+#define __EXPRESSIONS_INTERPRETER_BUILTINS_HPP__
+
+#include <expressions/interpreter/caller.hpp>
+#include <expressions/interpreter/tagged_value.hpp>
+#include <expressions/interpreter/value.hpp>
+#include <expressions/parser/transform/scope_resolver.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+
+namespace expressions::interpreter {
+
+// The entry points of the builtins. They expect as many arguments as their
+// registry entry declares; the engines call them through builtin_of().
+
+void __builtin_print(std::span<const BoxedValue> args);
+void __builtin_print(std::span<const TaggedValue> args);
+
+uint64_t __builtin_len(std::span<const BoxedValue> args);
+uint64_t __builtin_len(std::span<const TaggedValue> args);
+
+// days_between(from, to): the number of days from the first date to the
+// second, negative if the second is earlier.
+int64_t __builtin_days_between(std::span<const BoxedValue> args);
+int64_t __builtin_days_between(std::span<const TaggedValue> args);
+
+// add_days(date, days): the date the given number of days later.
+Date __builtin_add_days(std::span<const BoxedValue> args);
+Date __builtin_add_days(std::span<const TaggedValue> args);
+
+// weekday(date): 0 for Monday through 6 for Sunday.
+int64_t __builtin_weekday(std::span<const BoxedValue> args);
+int64_t __builtin_weekday(std::span<const TaggedValue> args);
+
+// date_in_range(date, range): whether the range includes the date, like
+// `date in range`.
+bool __builtin_date_in_range(std::span<const BoxedValue> args);
+bool __builtin_date_in_range(std::span<const TaggedValue> args);
+
+// An entry of the builtin registry. The engines resolve each call site to its
+// entry once, when the program is compiled, so that calling a builtin is an
+// indirect call through the entry instead of a lookup by name.
+struct Builtin {
+    std::string_view name {};
+    // The range of the number of arguments; max_arity may be kVariadic.
+    int32_t min_arity = 0;
+    int32_t max_arity = kVariadic;
+    // Whether the result depends on the arguments alone and calling it has
+    // no side effects.
+    bool pure = false;
+    // Whether the result is the first argument, modified. Engines hand over
+    // the value of a variable assigned the result of a call on itself, as in
+    // `heap = push_heap(heap)`, so that it gets modified without a copy; the
+    // variable holds null until the call returns or throws, when it gets its
+    // value back.
+    bool in_place = false;
+    // The arguments belong to the call, which may move from them.
+    BoxedValue (*boxed)(std::span<BoxedValue> args,
+                        const Caller& caller) = nullptr;
+    TaggedValue (*tagged)(std::span<TaggedValue> args,
+                          const Caller& caller) = nullptr;
+
+    static constexpr int32_t kVariadic = -1;
+
+    // Checks the number of arguments, then calls the entry point.
+    BoxedValue operator()(std::span<BoxedValue> args,
+                          const Caller& caller) const;
+    TaggedValue operator()(std::span<TaggedValue> args,
+                           const Caller& caller) const;
+};
+
+// The registry is indexed by parser::BuiltinFunction.
+const Builtin& builtin_of(parser::BuiltinFunction function);
+
+// The call of an assignment `target = expr` whose value the engine may hand
+// over to the call: a call to an in_place builtin whose first argument reads
+// the global assigned. Returns nullptr otherwise.
+const ast::Call* in_place_call(const ast::Name& target, const ast::Value& expr);
+
+// Whether a variable holding value may hand it over to an in_place call on
+// the arguments evaluated: the first one must still be that value, and none
+// may be a callable, which could read the variable during the call.
+bool can_hand_over(std::span<const BoxedValue> args, const BoxedValue& value);
+bool can_hand_over(std::span<const TaggedValue> args,
+                   const TaggedValue& value);
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,45 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_CALLER_HPP__
+#define __EXPRESSIONS_INTERPRETER_CALLER_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <span>
+
+
+namespace expressions::interpreter {
+
+// The tree of a callable defined in script code. Names in the body refer to
+// the parameters by their local slots.
+struct CallableSource {
+    size_t params = 0;
+    const ast::Value* body = nullptr;
+};
+
+// Lets the builtins taking a callable, like a comparator, call back into the
+// script. Each engine implements it for the program it runs.
+class Caller {
+public:
+    virtual ~Caller() = default;
+
+    // Calls a Lambda or a Function with the arguments.
+    virtual BoxedValue call(const BoxedValue& callee,
+                            std::span<const BoxedValue> args) const = 0;
+    // The tree of a Lambda or a Function, for the builtins that evaluate
+    // simple callables natively instead of calling them. Returns
+    // std::nullopt if the engine keeps none.
+    virtual std::optional<CallableSource> source(
+        const BoxedValue& callee) const = 0;
+};
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,158 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/constant_literal.hpp>
+#include <expressions/interpreter/operators.hpp>
+
+#include <utility>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+class ConstantLiteral
+    : public boost::static_visitor<std::optional<BoxedValue>> {
+public:
+    ConstantLiteral() = default;
+
+    using ReturnType = std::optional<BoxedValue>;
+
+    ReturnType operator()(const ast::Ellipsis&) const {
+        return Ellipsis {};
+    }
+    ReturnType operator()(const ast::Null&) const {
+        return Null {};
+    }
+    ReturnType operator()(bool value) const {
+        return value;
+    }
+    ReturnType operator()(int64_t value) const {
+        return value;
+    }
+    ReturnType operator()(uint64_t value) const {
+        return value;
+    }
+    ReturnType operator()(double value) const {
+        return value;
+    }
+    ReturnType operator()(const ast::QuotedString& node) const {
+        return String {node.value};
+    }
+    ReturnType operator()(const ast::Date& node) const {
+        return Date::from_civil(node.year, node.month, node.day);
+    }
+    ReturnType operator()(const ast::DateRange& node) const {
+        return DateRange {
+            Date::from_civil(node.begin.year, node.begin.month,
+                             node.begin.day),
+            Date::from_civil(node.end.year, node.end.month, node.end.day),
+        };
+    }
+    ReturnType operator()(const ast::UnaryOp& node) const {
+        if (node.op != ast::BoolOpType::kPlus
+            && node.op != ast::BoolOpType::kMinus) {
+            return std::nullopt;
+        }
+
+        auto operand = node.operand.apply_visitor(*this);
+        if (!operand
+            || !ast::holds_any_of<int64_t, uint64_t, double>(*operand)) {
+            return std::nullopt;
+        }
+
+        return execute_unary_op(node.op, *operand);
+    }
+
+    ReturnType operator()(const ast::Tuple& node) const {
+        return sequence_<Tuple<BoxedValue>>(node.values);
+    }
+    ReturnType operator()(const ast::List& node) const {
+        return sequence_<Vector<BoxedValue>>(node.values);
+    }
+    ReturnType operator()(const ast::Dict& node) const {
+        auto items = Map<BoxedValue, BoxedValue> {};
+        auto& elements = items.mutate();
+        for (const auto& item : node.items) {
+            auto key = item.key.apply_visitor(*this);
+            auto value = item.value.apply_visitor(*this);
+            if (!key || !value) {
+                return std::nullopt;
+            }
+            elements.emplace(std::move(*key), std::move(*value));
+        }
+
+        return items;
+    }
+    ReturnType operator()(const ast::Set& node) const {
+        auto values = Set<BoxedValue> {};
+        auto& elements = values.mutate();
+        for (const auto& value : node.values) {
+            auto element = value.apply_visitor(*this);
+            if (!element) {
+                return std::nullopt;
+            }
+            elements.emplace(std::move(*element));
+        }
+
+        return values;
+    }
+
+    template<typename T>
+    ReturnType operator()(const T&) const {
+        return std::nullopt;
+    }
+    template<typename T>
+    ReturnType operator()(const boost::spirit::x3::forward_ast<T>& node) const {
+        return (*this)(node.get());
+    }
+
+private:
+    template<typename Sequence>
+    ReturnType sequence_(const std::vector<ast::Value>& nodes) const {
+        auto values = Sequence {};
+        auto& elements = values.mutate();
+        elements.reserve(nodes.size());
+        for (const auto& node : nodes) {
+            auto element = node.apply_visitor(*this);
+            if (!element) {
+                return std::nullopt;
+            }
+            elements.emplace_back(std::move(*element));
+        }
+
+        return values;
+    }
+};
+
+}    // namespace
+
+std::optional<BoxedValue> constant_literal(const ast::Value& node) {
+    return node.apply_visitor(ConstantLiteral {});
+}
+
+std::optional<BoxedValue> constant_literal(const ast::QuotedString& node) {
+    return ConstantLiteral {}(node);
+}
+
+std::optional<BoxedValue> constant_literal(const ast::Tuple& node) {
+    return ConstantLiteral {}(node);
+}
+
+std::optional<BoxedValue> constant_literal(const ast::List& node) {
+    return ConstantLiteral {}(node);
+}
+
+std::optional<BoxedValue> constant_literal(const ast::Dict& node) {
+    return ConstantLiteral {}(node);
+}
+
+std::optional<BoxedValue> constant_literal(const ast::Set& node) {
+    return ConstantLiteral {}(node);
+}
+
+}    // namespace expressions::interpreter
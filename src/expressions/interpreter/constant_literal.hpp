@@ -0,0 +1,33 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_CONSTANT_LITERAL_HPP__
+#define __EXPRESSIONS_INTERPRETER_CONSTANT_LITERAL_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <optional>
+
+
+namespace expressions::interpreter {
+
+// Collection literals whose elements are all literals, nested collections and
+// signed numbers included, evaluate to the same value every time. Engines
+// build that value once and share it: its contents are copy-on-write, so no
+// user of the value can change it for the others. Returns std::nullopt for
+// any other node. String literals are constant as well.
+
+std::optional<BoxedValue> constant_literal(const ast::Value& node);
+std::optional<BoxedValue> constant_literal(const ast::QuotedString& node);
+std::optional<BoxedValue> constant_literal(const ast::Tuple& node);
+std::optional<BoxedValue> constant_literal(const ast::List& node);
+std::optional<BoxedValue> constant_literal(const ast::Dict& node);
+std::optional<BoxedValue> constant_literal(const ast::Set& node);
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,37 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/generator.hpp>
+
+#include <algorithm>
+
+
+namespace expressions::interpreter {
+
+bool contains_yield(const ast::Value& statement) {
+    if (ast::get_if<ast::YieldStatement>(&statement)) {
+        return true;
+    } else if (const auto* list = ast::get_if<ast::StatementList>(&statement)) {
+        return std::any_of(list->stmts.begin(), list->stmts.end(),
+                           [](const ast::Value& stmt) {
+                               return contains_yield(stmt);
+                           });
+    } else if (const auto* branch = ast::get_if<ast::IfStatement>(&statement)) {
+        return contains_yield(branch->body) || contains_yield(branch->or_else);
+    } else if (const auto* loop = ast::get_if<ast::ForStatement>(&statement)) {
+        return contains_yield(loop->body);
+    } else if (const auto* range_loop
+               = ast::get_if<ast::RangeBasedForStatement>(&statement)) {
+        return contains_yield(range_loop->body);
+    } else if (const auto* while_loop
+               = ast::get_if<ast::WhileStatement>(&statement)) {
+        return contains_yield(while_loop->body);
+    }
+
+    return false;
+}
+
+}    // namespace expressions::interpreter
@@ -0,0 +1,156 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_GENERATOR_HPP__
+#define __EXPRESSIONS_INTERPRETER_GENERATOR_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/common/scope_exit.hpp>
+#include <expressions/exception/throw_exception.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+
+namespace expressions::interpreter {
+
+// Runs the body of a generator function for the engine that called it. The
+// body starts on the first resume, not on the call.
+class GeneratorState {
+public:
+    virtual ~GeneratorState() = default;
+
+    // Runs the body up to its next yield and returns the value yielded, or
+    // std::nullopt once the body has returned.
+    std::optional<BoxedValue> resume() {
+        if (done_) {
+            return std::nullopt;
+        }
+        if (running_) {
+            THROW_EXCEPTION(
+                std::runtime_error("Generator is already running."));
+        }
+
+        // A body that threw is over, like one that returned.
+        running_ = true;
+        auto exceptions = std::uncaught_exceptions();
+        auto running = ScopeExit {[&] {
+            running_ = false;
+            done_ = done_ || std::uncaught_exceptions() > exceptions;
+        }};
+        auto value = step_();
+        done_ = !value.has_value();
+
+        return value;
+    }
+
+private:
+    virtual std::optional<BoxedValue> step_() = 0;
+
+private:
+    bool running_ = false;
+    bool done_ = false;
+};
+
+// A coroutine running statements of a generator body, for the engines
+// walking trees. It suspends at each value yielded and finishes with how the
+// statements completed, a Result. Statements without a yield do not need a
+// coroutine: Stream {result} is a finished one.
+template<typename Result>
+class Stream {
+public:
+    struct promise_type {
+        std::optional<BoxedValue> value {};
+        Result result {};
+        std::exception_ptr exception {};
+
+        // Declared so that the promise is never built from the parameters of
+        // the coroutine, as an aggregate would be.
+        promise_type() = default;
+
+        Stream get_return_object() noexcept {
+            return Stream {
+                std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always yield_value(BoxedValue yielded) {
+            value = std::move(yielded);
+            return {};
+        }
+        void return_value(Result completion) noexcept {
+            result = completion;
+        }
+        void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+    };
+
+    explicit Stream(Result result) noexcept : result_ {result} {}
+    Stream(Stream&& rhs) noexcept
+        : handle_ {std::exchange(rhs.handle_, {})}, result_ {rhs.result_} {}
+    Stream& operator=(Stream&& rhs) noexcept {
+        std::swap(handle_, rhs.handle_);
+        std::swap(result_, rhs.result_);
+        return *this;
+    }
+    ~Stream() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    // Runs up to the next yield. Returns false once the statements have
+    // completed, and result() tells how.
+    bool next() {
+        if (!handle_ || handle_.done()) {
+            return false;
+        }
+
+        handle_.resume();
+        auto& promise = handle_.promise();
+        if (promise.exception) {
+            std::rethrow_exception(std::exchange(promise.exception, {}));
+        }
+        if (handle_.done()) {
+            result_ = promise.result;
+            return false;
+        }
+
+        return true;
+    }
+    // The value yielded by the last call to next().
+    BoxedValue take() {
+        return std::move(*handle_.promise().value);
+    }
+    Result result() const noexcept {
+        return result_;
+    }
+
+private:
+    explicit Stream(std::coroutine_handle<promise_type> handle) noexcept
+        : handle_ {handle} {}
+
+private:
+    std::coroutine_handle<promise_type> handle_ {};
+    Result result_ {};
+};
+
+// Whether running the statement may execute a yield statement. The bodies
+// of the functions it defines do not count, as they yield for themselves.
+bool contains_yield(const ast::Value& statement);
+
+}    // namespace expressions::interpreter
+
+#endif
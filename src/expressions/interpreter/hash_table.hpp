@@ -0,0 +1,267 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_HASH_TABLE_HPP__
+#define __EXPRESSIONS_INTERPRETER_HASH_TABLE_HPP__
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+// Open-addressing hash table. The entries are stored densely in insertion
+// order, and a power-of-two table of 32-bit entry indices is probed linearly
+// to find them, so lookups touch few cache lines and iterating is a scan of
+// one array. Keys are hashed with an unqualified call to hash_value(), found
+// through argument-dependent lookup. Entries are never removed.
+template<typename Key, typename Entry, typename KeyOf>
+class HashTable {
+public:
+    using value_type = Entry;
+    using const_iterator = typename std::vector<Entry>::const_iterator;
+    using iterator = const_iterator;
+
+    const_iterator begin() const noexcept {
+        return entries_.begin();
+    }
+    const_iterator end() const noexcept {
+        return entries_.end();
+    }
+    size_t size() const noexcept {
+        return entries_.size();
+    }
+    bool empty() const noexcept {
+        return entries_.empty();
+    }
+
+    void reserve(size_t count) {
+        entries_.reserve(count);
+        hashes_.reserve(count);
+        if (count * 2 > slots_.size()) {
+            rehash_(count * 2);
+        }
+    }
+
+    const_iterator find(const Key& key) const {
+        if (entries_.empty()) {
+            return end();
+        }
+
+        auto hash = hash_value(key);
+        auto index = probe_(key, hash).second;
+
+        return index == kEmpty ? end() : begin() + index;
+    }
+    bool contains(const Key& key) const {
+        return find(key) != end();
+    }
+
+protected:
+    // Returns the entry of the key and whether it was inserted. An entry
+    // already holding the key is kept as it is.
+    std::pair<const_iterator, bool> insert_(Entry entry) {
+        if ((entries_.size() + 1) * 2 > slots_.size()) {
+            rehash_((entries_.size() + 1) * 2);
+        }
+
+        const auto& key = KeyOf {}(entry);
+        auto hash = hash_value(key);
+        auto [slot, index] = probe_(key, hash);
+        if (index != kEmpty) {
+            return {begin() + index, false};
+        }
+
+        slots_[slot] = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back(std::move(entry));
+        hashes_.emplace_back(hash);
+
+        return {end() - 1, true};
+    }
+
+private:
+    static constexpr auto kEmpty = std::numeric_limits<uint32_t>::max();
+
+    // Fibonacci hashing: the slot is taken from the high bits of the
+    // product, which depend on every bit of the hash. Small integers, which
+    // hash to themselves, get spread over the whole table.
+    size_t home_(size_t hash) const noexcept {
+        return (hash * 0x9e3779b97f4a7c15ull) >> shift_;
+    }
+
+    // Returns the slot holding the key, or the empty slot ending its probe
+    // sequence, together with the index of its entry or kEmpty.
+    std::pair<size_t, uint32_t> probe_(const Key& key, size_t hash) const {
+        auto mask = slots_.size() - 1;
+        for (auto slot = home_(hash);; slot = (slot + 1) & mask) {
+            auto index = slots_[slot];
+            if (index == kEmpty || (hashes_[index] == hash
+                                    && KeyOf {}(entries_[index]) == key)) {
+                return {slot, index};
+            }
+        }
+    }
+
+    void rehash_(size_t capacity) {
+        capacity = std::bit_ceil(std::max<size_t>(capacity, 8));
+        slots_.assign(capacity, kEmpty);
+        shift_ = 64 - std::countr_zero(capacity);
+
+        auto mask = capacity - 1;
+        for (size_t index = 0; index < hashes_.size(); ++index) {
+            auto slot = home_(hashes_[index]);
+            while (slots_[slot] != kEmpty) {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = static_cast<uint32_t>(index);
+        }
+    }
+
+private:
+    std::vector<Entry> entries_ {};
+    std::vector<size_t> hashes_ {};
+    std::vector<uint32_t> slots_ {};
+    int32_t shift_ = 64;
+};
+
+struct KeyOfElement {
+    template<typename T>
+    const T& operator()(const T& element) const noexcept {
+        return element;
+    }
+};
+
+struct KeyOfItem {
+    template<typename K, typename V>
+    const K& operator()(const std::pair<K, V>& item) const noexcept {
+        return item.first;
+    }
+};
+
+template<typename T>
+class HashSet : public HashTable<T, T, KeyOfElement> {
+public:
+    template<typename... Args>
+    std::pair<typename HashSet::const_iterator, bool> emplace(Args&&... args) {
+        return this->insert_(T {std::forward<Args>(args)...});
+    }
+
+    bool operator==(const HashSet& rhs) const {
+        return this->size() == rhs.size() && is_subset_of(rhs);
+    }
+    bool operator!=(const HashSet& rhs) const {
+        return !(*this == rhs);
+    }
+    // Sets compare their sorted elements lexicographically, as std::set does,
+    // which keeps the order total whatever the order of insertion.
+    bool operator<(const HashSet& rhs) const {
+        auto lhs_elements = sorted_();
+        auto rhs_elements = rhs.sorted_();
+        return std::lexicographical_compare(
+            lhs_elements.begin(), lhs_elements.end(), rhs_elements.begin(),
+            rhs_elements.end(),
+            [](const T* left, const T* right) { return *left < *right; });
+    }
+    bool operator<=(const HashSet& rhs) const {
+        return !(rhs < *this);
+    }
+    bool operator>(const HashSet& rhs) const {
+        return rhs < *this;
+    }
+    bool operator>=(const HashSet& rhs) const {
+        return !(*this < rhs);
+    }
+
+    bool is_subset_of(const HashSet& rhs) const {
+        return std::all_of(this->begin(), this->end(), [&](const T& element) {
+            return rhs.contains(element);
+        });
+    }
+
+private:
+    std::vector<const T*> sorted_() const {
+        auto elements = std::vector<const T*> {};
+        elements.reserve(this->size());
+        for (const auto& element : *this) {
+            elements.emplace_back(&element);
+        }
+        std::sort(elements.begin(), elements.end(),
+                  [](const T* left, const T* right) {
+                      return *left < *right;
+                  });
+
+        return elements;
+    }
+};
+
+template<typename K, typename V>
+class HashMap : public HashTable<K, std::pair<K, V>, KeyOfItem> {
+public:
+    template<typename Key, typename Value>
+    std::pair<typename HashMap::const_iterator, bool> emplace(Key&& key,
+                                                              Value&& value) {
+        return this->insert_(std::pair<K, V> {std::forward<Key>(key),
+                                              std::forward<Value>(value)});
+    }
+
+    bool operator==(const HashMap& rhs) const {
+        if (this->size() != rhs.size()) {
+            return false;
+        }
+
+        return std::all_of(this->begin(), this->end(), [&](const auto& item) {
+            auto it = rhs.find(item.first);
+            return it != rhs.end() && it->second == item.second;
+        });
+    }
+    bool operator!=(const HashMap& rhs) const {
+        return !(*this == rhs);
+    }
+    // Maps compare their items sorted by key lexicographically, as std::map
+    // does.
+    bool operator<(const HashMap& rhs) const {
+        auto lhs_items = sorted_();
+        auto rhs_items = rhs.sorted_();
+        return std::lexicographical_compare(
+            lhs_items.begin(), lhs_items.end(), rhs_items.begin(),
+            rhs_items.end(), [](const auto* left, const auto* right) {
+                return *left < *right;
+            });
+    }
+    bool operator<=(const HashMap& rhs) const {
+        return !(rhs < *this);
+    }
+    bool operator>(const HashMap& rhs) const {
+        return rhs < *this;
+    }
+    bool operator>=(const HashMap& rhs) const {
+        return !(*this < rhs);
+    }
+
+private:
+    std::vector<const std::pair<K, V>*> sorted_() const {
+        auto items = std::vector<const std::pair<K, V>*> {};
+        items.reserve(this->size());
+        for (const auto& item : *this) {
+            items.emplace_back(&item);
+        }
+        std::sort(items.begin(), items.end(),
+                  [](const auto* left, const auto* right) {
+                      return left->first < right->first;
+                  });
+
+        return items;
+    }
+};
+
+}    // namespace expressions::interpreter
+
+#endif
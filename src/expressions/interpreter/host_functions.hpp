@@ -0,0 +1,281 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_HOST_FUNCTIONS_HPP__
+#define __EXPRESSIONS_INTERPRETER_HOST_FUNCTIONS_HPP__
+
+#include <expressions/ast/symbol.hpp>
+#include <expressions/interpreter/tagged_value.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+// A C++ function of the embedder, marshalled for both value representations.
+struct HostFunction {
+    std::string name {};
+    // The number of arguments, or kVariadic.
+    int32_t arity = kVariadic;
+    // Empty if nothing is bound.
+    std::function<BoxedValue(std::span<const BoxedValue>)> boxed {};
+    std::function<TaggedValue(std::span<const TaggedValue>)> tagged {};
+
+    static constexpr int32_t kVariadic = -1;
+};
+
+[[noreturn]] inline void throw_unbound_host_function(std::string_view name,
+                                                     size_t argc) {
+    THROW_EXCEPTION(std::runtime_error(fmt::format(
+        "No host function bound to {}() with {} arguments.", name, argc)));
+}
+
+// The C++ functions an embedder exposes to scripts. A script declares those
+// it calls, as in `@builtin def lookup(key) -> double;`, and each call to a
+// declared name binds, when the program is compiled, to the function defined
+// under that name for the number of arguments of the call. Defining a name
+// again with another arity adds an overload.
+//
+// Parameters and results may be bool, integers, floating point numbers, Date,
+// strings or BoxedValue, which takes any value. Scalars pass unboxed wherever
+// the engine keeps them unboxed. A function taking a single
+// std::span<const BoxedValue> is variadic.
+class HostFunctions {
+public:
+    template<typename F>
+    void define(std::string_view name, F function) {
+        define_(name, std::function {std::move(function)});
+    }
+
+    // Prefers the overload taking exactly argc arguments to a variadic one.
+    const HostFunction* find(ast::Symbol name, size_t argc) const {
+        auto it = functions_.find(name);
+        if (it == functions_.end()) {
+            return nullptr;
+        }
+
+        const HostFunction* variadic = nullptr;
+        for (const auto& function : it->second) {
+            if (function.arity == static_cast<int32_t>(argc)) {
+                return &function;
+            } else if (function.arity == HostFunction::kVariadic) {
+                variadic = &function;
+            }
+        }
+
+        return variadic;
+    }
+
+    // The function a call site binds to, or one that throws when called if
+    // nothing is bound.
+    HostFunction bind(ast::Symbol name, size_t argc) const {
+        if (const auto* function = find(name, argc)) {
+            return *function;
+        }
+
+        return HostFunction {std::string {name.name()},
+                             static_cast<int32_t>(argc)};
+    }
+
+private:
+    template<typename R, typename... Args>
+    void define_(std::string_view name, std::function<R(Args...)> function) {
+        auto host = HostFunction {std::string {name}};
+        if constexpr (std::is_same_v<std::tuple<std::remove_cvref_t<Args>...>,
+                                     std::tuple<std::span<const BoxedValue>>>) {
+            host.boxed = [function](std::span<const BoxedValue> args) {
+                return marshal_<BoxedValue>(function, args);
+            };
+            host.tagged = [function](std::span<const TaggedValue> args) {
+                auto boxed = std::vector<BoxedValue> {};
+                boxed.reserve(args.size());
+                for (const auto& arg : args) {
+                    boxed.emplace_back(arg.to_boxed());
+                }
+                return marshal_<TaggedValue>(
+                    function, std::span<const BoxedValue> {boxed});
+            };
+        } else {
+            host.arity = static_cast<int32_t>(sizeof...(Args));
+            host.boxed = [name = host.name,
+                          function](std::span<const BoxedValue> args) {
+                return call_<BoxedValue>(name, function, args,
+                                         std::index_sequence_for<Args...> {});
+            };
+            host.tagged = [name = host.name,
+                           function](std::span<const TaggedValue> args) {
+                return call_<TaggedValue>(name, function, args,
+                                          std::index_sequence_for<Args...> {});
+            };
+        }
+
+        auto& overloads = functions_[ast::Symbol {name}];
+        for (auto& overload : overloads) {
+            if (overload.arity == host.arity) {
+                overload = std::move(host);
+                return;
+            }
+        }
+        overloads.emplace_back(std::move(host));
+    }
+
+    template<typename Value, typename R, typename... Args, size_t... I>
+    static Value call_([[maybe_unused]] const std::string& name,
+                       const std::function<R(Args...)>& function,
+                       [[maybe_unused]] std::span<const Value> args,
+                       std::index_sequence<I...>) {
+        return marshal_<Value>(
+            function, arg_<std::remove_cvref_t<Args>>(name, I, args[I])...);
+    }
+
+    template<typename Value, typename F, typename... Args>
+    static Value marshal_(const F& function, Args&&... args) {
+        using R = std::invoke_result_t<const F&, Args...>;
+        if constexpr (std::is_void_v<R>) {
+            function(std::forward<Args>(args)...);
+            return Value {Null {}};
+        } else {
+            return result_<Value>(function(std::forward<Args>(args)...));
+        }
+    }
+
+    template<typename E>
+    static std::optional<E> scalar_(const BoxedValue& arg) {
+        if (const auto* value = boost::get<E>(&arg)) {
+            return *value;
+        }
+
+        return std::nullopt;
+    }
+    template<typename E>
+    static std::optional<E> scalar_(const TaggedValue& arg) {
+        using Tag = TaggedValue::Tag;
+        if constexpr (std::is_same_v<E, bool>) {
+            if (arg.tag() == Tag::kBool) {
+                return arg.as_bool();
+            }
+        } else if constexpr (std::is_same_v<E, int64_t>) {
+            if (arg.tag() == Tag::kInt64) {
+                return arg.as_int64();
+            }
+        } else if constexpr (std::is_same_v<E, uint64_t>) {
+            if (arg.tag() == Tag::kUInt64) {
+                return arg.as_uint64();
+            }
+        } else if constexpr (std::is_same_v<E, double>) {
+            if (arg.tag() == Tag::kDouble) {
+                return arg.as_double();
+            }
+        } else if constexpr (std::is_same_v<E, Date>) {
+            if (arg.tag() == Tag::kDate) {
+                return arg.as_date();
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    static const String* string_(const BoxedValue& arg) {
+        return boost::get<String>(&arg);
+    }
+    static const String* string_(const TaggedValue& arg) {
+        return arg.get_if<String>();
+    }
+
+    template<typename T, typename Value>
+    static T arg_(std::string_view name, size_t index, const Value& arg) {
+        auto expected = std::string_view {};
+        if constexpr (std::is_same_v<T, BoxedValue>) {
+            if constexpr (std::is_same_v<Value, BoxedValue>) {
+                return arg;
+            } else {
+                return arg.to_boxed();
+            }
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (auto value = scalar_<bool>(arg)) {
+                return *value;
+            }
+            expected = "a bool";
+        } else if constexpr (std::is_integral_v<T>) {
+            if (auto value = scalar_<int64_t>(arg)) {
+                return static_cast<T>(*value);
+            } else if (auto value_u64 = scalar_<uint64_t>(arg)) {
+                return static_cast<T>(*value_u64);
+            }
+            expected = "an integer";
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (auto value = scalar_<double>(arg)) {
+                return static_cast<T>(*value);
+            } else if (auto value_i64 = scalar_<int64_t>(arg)) {
+                return static_cast<T>(*value_i64);
+            } else if (auto value_u64 = scalar_<uint64_t>(arg)) {
+                return static_cast<T>(*value_u64);
+            }
+            expected = "a number";
+        } else if constexpr (std::is_same_v<T, Date>) {
+            if (auto value = scalar_<Date>(arg)) {
+                return *value;
+            }
+            expected = "a date";
+        } else {
+            static_assert(std::is_constructible_v<T, std::string_view>,
+                          "Unsupported host function parameter type");
+            if (const auto* value = string_(arg)) {
+                return T {value->view()};
+            }
+            expected = "a string";
+        }
+
+        THROW_EXCEPTION(std::invalid_argument(fmt::format(
+            "{}() expects {} as argument {}.", name, expected, index + 1)));
+    }
+
+    template<typename Value, typename R>
+    static Value result_(R&& result) {
+        using T = std::remove_cvref_t<R>;
+        if constexpr (std::is_same_v<T, BoxedValue>) {
+            return Value {std::forward<R>(result)};
+        } else if constexpr (std::is_same_v<T, bool>
+                             || std::is_same_v<T, Date>) {
+            return Value {result};
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            return Value {static_cast<int64_t>(result)};
+        } else if constexpr (std::is_integral_v<T>) {
+            return Value {static_cast<uint64_t>(result)};
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return Value {static_cast<double>(result)};
+        } else {
+            static_assert(std::is_constructible_v<std::string, R>,
+                          "Unsupported host function result type");
+            return Value {
+                BoxedValue {String {std::string {std::forward<R>(result)}}}};
+        }
+    }
+
+private:
+    std::unordered_map<ast::Symbol, std::vector<HostFunction>> functions_ {};
+};
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,242 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/iterator.hpp>
+
+#include <expressions/interpreter/generator.hpp>
+
+#include <expressions/common/visitor.hpp>
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+int64_t range_arg(const BoxedValue& arg) {
+    if (const auto* value_i64 = boost::get<int64_t>(&arg)) {
+        return *value_i64;
+    } else if (const auto* value_u64 = boost::get<uint64_t>(&arg)) {
+        return static_cast<int64_t>(*value_u64);
+    }
+
+    THROW_EXCEPTION(std::invalid_argument("range() expects an integer."));
+}
+
+[[noreturn]] void throw_cannot_unpack(size_t count) {
+    THROW_EXCEPTION(std::invalid_argument(
+        fmt::format("Cannot unpack the element into {} targets.", count)));
+}
+
+void unpack(BoxedValue element, std::span<BoxedValue> targets) {
+    if (targets.size() == 1) {
+        targets[0] = std::move(element);
+        return;
+    }
+
+    if (const auto* tuple = boost::get<Tuple<BoxedValue>>(&element)) {
+        if (tuple->size() != targets.size()) {
+            throw_cannot_unpack(targets.size());
+        }
+        std::copy(tuple->begin(), tuple->end(), targets.begin());
+    } else if (const auto* list = boost::get<Vector<BoxedValue>>(&element)) {
+        const auto& elements = list->get();
+        if (elements.size() != targets.size()) {
+            throw_cannot_unpack(targets.size());
+        }
+        for (size_t index = 0; index < targets.size(); ++index) {
+            targets[index] = elements[index];
+        }
+    } else {
+        throw_cannot_unpack(targets.size());
+    }
+}
+
+// The length of the UTF-8 sequence the byte starts. A byte that cannot start
+// one is taken alone.
+size_t sequence_length(char lead) {
+    auto byte = static_cast<unsigned char>(lead);
+    if (byte >= 0xF8) {
+        return 1;
+    } else if (byte >= 0xF0) {
+        return 4;
+    } else if (byte >= 0xE0) {
+        return 3;
+    } else if (byte >= 0xC0) {
+        return 2;
+    }
+
+    return 1;
+}
+
+}    // namespace
+
+Range Range::of(std::span<const BoxedValue> args) {
+    switch (args.size()) {
+        case 1: {
+            return {0, range_arg(args[0]), 1};
+        }
+        case 2: {
+            return {range_arg(args[0]), range_arg(args[1]), 1};
+        }
+        case 3: {
+            auto range = Range {range_arg(args[0]), range_arg(args[1]),
+                                range_arg(args[2])};
+            if (range.step == 0) {
+                THROW_EXCEPTION(
+                    std::invalid_argument("range() step must not be zero."));
+            }
+            return range;
+        }
+        default: {
+            THROW_EXCEPTION(
+                std::invalid_argument("range() takes 1 to 3 arguments."));
+        }
+    }
+}
+
+size_t Range::size() const noexcept {
+    // The distances are taken unsigned, which holds any of them.
+    if (step > 0 && start < stop) {
+        auto distance
+            = static_cast<uint64_t>(stop) - static_cast<uint64_t>(start);
+        return (distance - 1) / static_cast<uint64_t>(step) + 1;
+    } else if (step < 0 && start > stop) {
+        auto distance
+            = static_cast<uint64_t>(start) - static_cast<uint64_t>(stop);
+        return (distance - 1) / (0 - static_cast<uint64_t>(step)) + 1;
+    }
+
+    return 0;
+}
+
+BoxedValue __builtin_range(std::span<const BoxedValue> args) {
+    auto range = Range::of(args);
+
+    auto elements = std::vector<int64_t> {};
+    elements.reserve(range.size());
+    for (size_t index = 0; index < range.size(); ++index) {
+        elements.emplace_back(range[index]);
+    }
+
+    auto list = TypedArray<BoxedValue> {};
+    list.assign(std::move(elements));
+    return Vector<BoxedValue> {std::move(list)};
+}
+
+Iterator::Iterator(BoxedValue iterable) {
+    auto assign = [this](auto&& container) {
+        size_ = container.size();
+        iterable_ = std::forward<decltype(container)>(container);
+    };
+
+    if (auto* list = boost::get<Vector<BoxedValue>>(&iterable)) {
+        assign(std::move(*list));
+    } else if (auto* tuple = boost::get<Tuple<BoxedValue>>(&iterable)) {
+        assign(std::move(*tuple));
+    } else if (auto* set = boost::get<Set<BoxedValue>>(&iterable)) {
+        assign(std::move(*set));
+    } else if (auto* map = boost::get<Map<BoxedValue, BoxedValue>>(&iterable)) {
+        assign(std::move(*map));
+    } else if (auto* string = boost::get<String>(&iterable)) {
+        assign(std::move(*string));
+    } else if (auto* generator = boost::get<Generator>(&iterable)) {
+        iterable_ = std::move(*generator);
+    } else {
+        THROW_EXCEPTION(std::invalid_argument("not iterable."));
+    }
+}
+
+bool Iterator::next(std::span<BoxedValue> targets) {
+    if (auto* generator = std::get_if<Generator>(&iterable_)) {
+        auto value = generator->state->resume();
+        if (!value) {
+            return false;
+        }
+        unpack(std::move(*value), targets);
+        return true;
+    }
+
+    if (index_ == size_) {
+        return false;
+    }
+
+    // The index of a string is that of the byte its next character starts.
+    if (const auto* string = std::get_if<String>(&iterable_)) {
+        auto text = string->view().substr(index_);
+        auto length = std::min(sequence_length(text.front()), text.size());
+        index_ += length;
+        unpack(String {std::string {text.substr(0, length)}}, targets);
+        return true;
+    }
+
+    auto index = index_++;
+    std::visit(
+        Visitor {
+            [&](const Range& range) {
+                unpack(range[index], targets);
+            },
+            [&](const Tuple<BoxedValue>& tuple) {
+                unpack(tuple.get()[index], targets);
+            },
+            [&](const Vector<BoxedValue>& list) {
+                unpack(list.get()[index], targets);
+            },
+            [&](const Set<BoxedValue>& set) {
+                auto it = set.begin() + static_cast<ptrdiff_t>(index);
+                unpack(*it, targets);
+            },
+            [&](const Map<BoxedValue, BoxedValue>& map) {
+                const auto& item
+                    = *(map.begin() + static_cast<ptrdiff_t>(index));
+                if (targets.size() == 2) {
+                    targets[0] = item.first;
+                    targets[1] = item.second;
+                } else {
+                    unpack(item.first, targets);
+                }
+            },
+            [](const String&) {},
+            [](const Generator&) {},
+        },
+        iterable_);
+
+    return true;
+}
+
+std::vector<ast::Name> for_targets(const ast::Value& target) {
+    auto names = std::vector<ast::Name> {};
+    if (const auto* name = ast::get_if<ast::Name>(&target)) {
+        names.emplace_back(*name);
+    } else if (const auto* list = ast::get_if<ast::List>(&target)) {
+        for (const auto& value : list->values) {
+            names.emplace_back(ast::get<ast::Name>(value));
+        }
+    }
+
+    return names;
+}
+
+const ast::Call* range_call(const ast::Value& iter) {
+    const auto* call = ast::get_if<ast::Call>(&iter);
+    if (call
+        && parser::builtin_function_of(call->name)
+               == parser::BuiltinFunction::kRange) {
+        return call;
+    }
+
+    return nullptr;
+}
+
+}    // namespace expressions::interpreter
@@ -0,0 +1,85 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_ITERATOR_HPP__
+#define __EXPRESSIONS_INTERPRETER_ITERATOR_HPP__
+
+#include <expressions/interpreter/value.hpp>
+#include <expressions/parser/transform/scope_resolver.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <variant>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+// The integers of range(start, stop, step): start, start + step, ... up to
+// but excluding stop. range(stop) starts at 0 and range(start, stop) steps by
+// 1; a negative step counts down.
+struct Range {
+    int64_t start = 0;
+    int64_t stop = 0;
+    int64_t step = 1;
+
+    // The range given by the arguments of a call to range().
+    static Range of(std::span<const BoxedValue> args);
+
+    size_t size() const noexcept;
+    int64_t operator[](size_t index) const noexcept {
+        return static_cast<int64_t>(static_cast<uint64_t>(start)
+                                    + index * static_cast<uint64_t>(step));
+    }
+};
+
+// range(start, stop, step): the list of the integers of the range. A
+// range-based for statement over a call to range() walks the range without
+// making the list.
+BoxedValue __builtin_range(std::span<const BoxedValue> args);
+
+// Walks the elements of a range-based for statement: the elements of a list
+// or a tuple, the elements of a set or the keys of a map in insertion order,
+// the UTF-8 characters of a string as strings, the integers of a range, or
+// the values a generator yields as it is resumed.
+//
+// The iterator holds a copy of the container, which is O(1); assigning to the
+// container while walking it clones its contents, and the iterator goes on
+// over the elements it had when the loop started.
+class Iterator {
+public:
+    // Throws std::invalid_argument if the value is not iterable.
+    explicit Iterator(BoxedValue iterable);
+    explicit Iterator(Range range) noexcept : iterable_ {range} {
+        size_ = range.size();
+    }
+
+    // Assigns the next element to the targets and returns true, or returns
+    // false once every element has been walked. An element is unpacked into
+    // several targets, which takes a tuple or a list of as many elements; a
+    // map unpacks into a key and its value.
+    bool next(std::span<BoxedValue> targets);
+
+private:
+    std::variant<Range, Tuple<BoxedValue>, Vector<BoxedValue>, Set<BoxedValue>,
+                 Map<BoxedValue, BoxedValue>, String, Generator>
+        iterable_ {};
+    size_t index_ = 0;
+    size_t size_ = 0;
+};
+
+// The names a range-based for statement assigns: its target, or each name
+// of its target list.
+std::vector<ast::Name> for_targets(const ast::Value& target);
+
+// The iterated expression of a range-based for statement if it is a call to
+// range(), which the engines walk as a Range.
+const ast::Call* range_call(const ast::Value& iter);
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,554 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/math.hpp>
+
+#include <expressions/interpreter/operators.hpp>
+
+#include <expressions/common/visitor.hpp>
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+// Kernels over unboxed elements. Each vector loop leaves the elements that
+// do not fill a whole register to the scalar loop, which computes the same.
+
+void sqrt_all(std::span<double> values) {
+    size_t index = 0;
+#if defined(__AVX2__)
+    for (; index + 4 <= values.size(); index += 4) {
+        auto x = _mm256_loadu_pd(&values[index]);
+        _mm256_storeu_pd(&values[index], _mm256_sqrt_pd(x));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; index + 2 <= values.size(); index += 2) {
+        vst1q_f64(&values[index], vsqrtq_f64(vld1q_f64(&values[index])));
+    }
+#endif
+    for (; index < values.size(); ++index) {
+        values[index] = std::sqrt(values[index]);
+    }
+}
+
+void square_all(std::span<double> values) {
+    size_t index = 0;
+#if defined(__AVX2__)
+    for (; index + 4 <= values.size(); index += 4) {
+        auto x = _mm256_loadu_pd(&values[index]);
+        _mm256_storeu_pd(&values[index], _mm256_mul_pd(x, x));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; index + 2 <= values.size(); index += 2) {
+        auto x = vld1q_f64(&values[index]);
+        vst1q_f64(&values[index], vmulq_f64(x, x));
+    }
+#endif
+    for (; index < values.size(); ++index) {
+        values[index] *= values[index];
+    }
+}
+
+int64_t absolute(int64_t value) {
+    // Wraps around for the least int64_t, like the vector code.
+    return value < 0 ? static_cast<int64_t>(0 - static_cast<uint64_t>(value))
+                     : value;
+}
+
+void abs_all(std::span<double> values) {
+    size_t index = 0;
+#if defined(__AVX2__)
+    auto sign = _mm256_set1_pd(-0.0);
+    for (; index + 4 <= values.size(); index += 4) {
+        auto x = _mm256_loadu_pd(&values[index]);
+        _mm256_storeu_pd(&values[index], _mm256_andnot_pd(sign, x));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; index + 2 <= values.size(); index += 2) {
+        vst1q_f64(&values[index], vabsq_f64(vld1q_f64(&values[index])));
+    }
+#endif
+    for (; index < values.size(); ++index) {
+        values[index] = std::fabs(values[index]);
+    }
+}
+
+void abs_all(std::span<int64_t> values) {
+    size_t index = 0;
+#if defined(__AVX2__)
+    auto zero = _mm256_setzero_si256();
+    for (; index + 4 <= values.size(); index += 4) {
+        auto* lanes = reinterpret_cast<__m256i*>(&values[index]);
+        auto x = _mm256_loadu_si256(lanes);
+        auto sign = _mm256_cmpgt_epi64(zero, x);
+        _mm256_storeu_si256(
+            lanes, _mm256_sub_epi64(_mm256_xor_si256(x, sign), sign));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; index + 2 <= values.size(); index += 2) {
+        vst1q_s64(&values[index], vabsq_s64(vld1q_s64(&values[index])));
+    }
+#endif
+    for (; index < values.size(); ++index) {
+        values[index] = absolute(values[index]);
+    }
+}
+
+// Whether x replaces best as the extremum so far. A NaN replaces anything
+// and nothing replaces it.
+template<bool Max>
+bool replaces(double best, double x) {
+    return (Max ? x > best : x < best) || std::isnan(x);
+}
+template<bool Max>
+bool replaces(int64_t best, int64_t x) {
+    return Max ? x > best : x < best;
+}
+
+// The extremum of a non-empty array. The vector loop keeps one per lane,
+// which are then folded in order.
+template<bool Max, typename E>
+E extremum_of(std::span<const E> values) {
+    auto best = values[0];
+    size_t index = 1;
+#if defined(__AVX2__)
+    if (values.size() >= 8) {
+        E lanes[4];
+        if constexpr (std::is_same_v<E, double>) {
+            auto extrema = _mm256_loadu_pd(values.data());
+            for (index = 4; index + 4 <= values.size(); index += 4) {
+                auto x = _mm256_loadu_pd(&values[index]);
+                auto ordered
+                    = _mm256_cmp_pd(x, extrema, Max ? _CMP_GT_OQ : _CMP_LT_OQ);
+                auto nan = _mm256_cmp_pd(x, x, _CMP_UNORD_Q);
+                extrema
+                    = _mm256_blendv_pd(extrema, x, _mm256_or_pd(ordered, nan));
+            }
+            _mm256_storeu_pd(lanes, extrema);
+        } else {
+            auto extrema = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(values.data()));
+            for (index = 4; index + 4 <= values.size(); index += 4) {
+                auto x = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(&values[index]));
+                auto ordered = Max ? _mm256_cmpgt_epi64(x, extrema)
+                                   : _mm256_cmpgt_epi64(extrema, x);
+                extrema = _mm256_blendv_epi8(extrema, x, ordered);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), extrema);
+        }
+        best = lanes[0];
+        for (size_t lane = 1; lane < 4; ++lane) {
+            if (replaces<Max>(best, lanes[lane])) {
+                best = lanes[lane];
+            }
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    if (values.size() >= 4) {
+        E lanes[2];
+        if constexpr (std::is_same_v<E, double>) {
+            auto extrema = vld1q_f64(values.data());
+            for (index = 2; index + 2 <= values.size(); index += 2) {
+                auto x = vld1q_f64(&values[index]);
+                auto ordered = Max ? vcgtq_f64(x, extrema)
+                                   : vcltq_f64(x, extrema);
+                auto nan = vreinterpretq_u64_u32(
+                    vmvnq_u32(vreinterpretq_u32_u64(vceqq_f64(x, x))));
+                extrema = vbslq_f64(vorrq_u64(ordered, nan), x, extrema);
+            }
+            vst1q_f64(lanes, extrema);
+        } else {
+            auto extrema = vld1q_s64(values.data());
+            for (index = 2; index + 2 <= values.size(); index += 2) {
+                auto x = vld1q_s64(&values[index]);
+                auto ordered = Max ? vcgtq_s64(x, extrema)
+                                   : vcltq_s64(x, extrema);
+                extrema = vbslq_s64(ordered, x, extrema);
+            }
+            vst1q_s64(lanes, extrema);
+        }
+        best = replaces<Max>(lanes[0], lanes[1]) ? lanes[1] : lanes[0];
+    }
+#endif
+    for (; index < values.size(); ++index) {
+        if (replaces<Max>(best, values[index])) {
+            best = values[index];
+        }
+    }
+
+    return best;
+}
+
+// A number argument.
+using Number = std::variant<int64_t, uint64_t, double>;
+
+std::optional<Number> number_of(const BoxedValue& arg) {
+    if (const auto* value_i64 = boost::get<int64_t>(&arg)) {
+        return *value_i64;
+    } else if (const auto* value_u64 = boost::get<uint64_t>(&arg)) {
+        return *value_u64;
+    } else if (const auto* value_double = boost::get<double>(&arg)) {
+        return *value_double;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<Number> number_of(const TaggedValue& arg) {
+    switch (arg.tag()) {
+        case TaggedValue::Tag::kInt64: {
+            return arg.as_int64();
+        }
+        case TaggedValue::Tag::kUInt64: {
+            return arg.as_uint64();
+        }
+        case TaggedValue::Tag::kDouble: {
+            return arg.as_double();
+        }
+        default: {
+            return std::nullopt;
+        }
+    }
+}
+
+const Vector<BoxedValue>* list_of(const BoxedValue& arg) {
+    return boost::get<Vector<BoxedValue>>(&arg);
+}
+
+const Vector<BoxedValue>* list_of(const TaggedValue& arg) {
+    return arg.get_if<Vector<BoxedValue>>();
+}
+
+double real_of(Number number) {
+    return std::visit([](auto value) { return static_cast<double>(value); },
+                      number);
+}
+
+template<typename Value>
+Value value_of(Number number) {
+    return std::visit([](auto value) { return Value {value}; }, number);
+}
+
+template<typename Value>
+Value value_of(Vector<BoxedValue> list) {
+    return Value {BoxedValue {std::move(list)}};
+}
+
+template<typename E>
+Vector<BoxedValue> list_of_unboxed(std::vector<E> elements) {
+    auto list = Vector<BoxedValue> {};
+    list.mutate().assign(std::move(elements));
+
+    return list;
+}
+
+[[noreturn]] void throw_not_numbers(std::string_view name) {
+    THROW_EXCEPTION(std::invalid_argument(fmt::format(
+        "{}() expects a number or a list of numbers.", name)));
+}
+
+template<typename Value>
+Number number_arg(std::string_view name, const Value& arg) {
+    if (auto number = number_of(arg)) {
+        return *number;
+    }
+
+    THROW_EXCEPTION(
+        std::invalid_argument(fmt::format("{}() expects a number.", name)));
+}
+
+Number element_of(std::string_view name, const BoxedValue& element) {
+    if (auto number = number_of(element)) {
+        return *number;
+    }
+
+    throw_not_numbers(name);
+}
+
+// The elements of a list as doubles.
+std::vector<double> reals_of(std::string_view name,
+                             const Vector<BoxedValue>& list) {
+    const auto& array = list.get();
+    if (const auto* values = array.get_if<double>()) {
+        return *values;
+    } else if (const auto* values_i64 = array.get_if<int64_t>()) {
+        return {values_i64->begin(), values_i64->end()};
+    }
+
+    auto reals = std::vector<double> {};
+    reals.reserve(array.size());
+    for (size_t index = 0; index < array.size(); ++index) {
+        reals.emplace_back(real_of(element_of(name, array[index])));
+    }
+
+    return reals;
+}
+
+// Applies a function of a double to a number, or to each element of a list
+// through the kernel.
+template<typename Value, typename Scalar, typename Kernel>
+Value map_reals(std::string_view name, const Value& arg, Scalar&& scalar,
+                Kernel&& kernel) {
+    if (auto number = number_of(arg)) {
+        return Value {scalar(real_of(*number))};
+    } else if (const auto* list = list_of(arg)) {
+        auto reals = reals_of(name, *list);
+        kernel(std::span<double> {reals});
+        return value_of<Value>(list_of_unboxed(std::move(reals)));
+    }
+
+    throw_not_numbers(name);
+}
+
+Number absolute(Number number) {
+    return std::visit(
+        Visitor {
+            [](int64_t value) -> Number {
+                return absolute(value);
+            },
+            [](uint64_t value) -> Number {
+                return value;
+            },
+            [](double value) -> Number {
+                return std::fabs(value);
+            },
+        },
+        number);
+}
+
+template<typename Value>
+Value abs(const Value& arg) {
+    if (auto number = number_of(arg)) {
+        return value_of<Value>(absolute(*number));
+    }
+    const auto* list = list_of(arg);
+    if (!list) {
+        throw_not_numbers("abs");
+    }
+
+    const auto& array = list->get();
+    if (const auto* values = array.template get_if<double>()) {
+        auto results = *values;
+        abs_all(std::span<double> {results});
+        return value_of<Value>(list_of_unboxed(std::move(results)));
+    } else if (const auto* values_i64 = array.template get_if<int64_t>()) {
+        auto results = *values_i64;
+        abs_all(std::span<int64_t> {results});
+        return value_of<Value>(list_of_unboxed(std::move(results)));
+    }
+
+    auto results = Vector<BoxedValue> {};
+    auto& elements = results.mutate();
+    elements.reserve(array.size());
+    for (size_t index = 0; index < array.size(); ++index) {
+        elements.push_back(
+            value_of<BoxedValue>(absolute(element_of("abs", array[index]))));
+    }
+
+    return value_of<Value>(std::move(results));
+}
+
+// The extremum of two numbers: an int64_t if both are, a double otherwise.
+template<bool Max>
+Number extremum(Number best, Number x) {
+    const auto* best_i64 = std::get_if<int64_t>(&best);
+    const auto* x_i64 = std::get_if<int64_t>(&x);
+    if (best_i64 && x_i64) {
+        return replaces<Max>(*best_i64, *x_i64) ? x : best;
+    }
+
+    auto best_real = real_of(best);
+    auto x_real = real_of(x);
+    return replaces<Max>(best_real, x_real) ? x_real : best_real;
+}
+
+template<bool Max>
+Number extremum_of(std::string_view name, const Vector<BoxedValue>& list) {
+    const auto& array = list.get();
+    if (array.empty()) {
+        THROW_EXCEPTION(std::invalid_argument(
+            fmt::format("{}() expects a non-empty list.", name)));
+    }
+
+    if (const auto* values = array.get_if<double>()) {
+        return extremum_of<Max>(std::span<const double> {*values});
+    } else if (const auto* values_i64 = array.get_if<int64_t>()) {
+        return extremum_of<Max>(std::span<const int64_t> {*values_i64});
+    }
+
+    auto best = element_of(name, array[0]);
+    for (size_t index = 1; index < array.size(); ++index) {
+        best = extremum<Max>(best, element_of(name, array[index]));
+    }
+
+    return best;
+}
+
+template<bool Max, typename Value>
+Value extremum(std::string_view name, std::span<const Value> args) {
+    if (args.size() == 1) {
+        if (const auto* list = list_of(args[0])) {
+            return value_of<Value>(extremum_of<Max>(name, *list));
+        }
+    }
+
+    auto number_arg_of = [&](const Value& arg) {
+        if (auto number = number_of(arg)) {
+            return *number;
+        }
+        THROW_EXCEPTION(std::invalid_argument(fmt::format(
+            "{}() expects numbers or a list of numbers.", name)));
+    };
+    auto best = number_arg_of(args[0]);
+    for (const auto& arg : args.subspan(1)) {
+        best = extremum<Max>(best, number_arg_of(arg));
+    }
+
+    return value_of<Value>(best);
+}
+
+template<typename Value>
+Value pow(std::span<const Value> args) {
+    auto exponent = real_of(number_arg("pow", args[1]));
+
+    return map_reals(
+        "pow", args[0],
+        [&](double base) {
+            return power(base, exponent);
+        },
+        [&](std::span<double> bases) {
+            if (exponent == 2.0) {
+                square_all(bases);
+                return;
+            }
+            for (auto& base : bases) {
+                base = std::pow(base, exponent);
+            }
+        });
+}
+
+template<typename Value>
+Value sqrt(std::span<const Value> args) {
+    return map_reals(
+        "sqrt", args[0],
+        [](double x) {
+            return std::sqrt(x);
+        },
+        [](std::span<double> values) {
+            sqrt_all(values);
+        });
+}
+
+template<typename Value>
+Value exp(std::span<const Value> args) {
+    return map_reals(
+        "exp", args[0],
+        [](double x) {
+            return std::exp(x);
+        },
+        [](std::span<double> values) {
+            for (auto& x : values) {
+                x = std::exp(x);
+            }
+        });
+}
+
+template<typename Value>
+Value log(std::span<const Value> args) {
+    return map_reals(
+        "log", args[0],
+        [](double x) {
+            return std::log(x);
+        },
+        [](std::span<double> values) {
+            for (auto& x : values) {
+                x = std::log(x);
+            }
+        });
+}
+
+}    // namespace
+
+BoxedValue __builtin_sqrt(std::span<const BoxedValue> args) {
+    return sqrt(args);
+}
+
+TaggedValue __builtin_sqrt(std::span<const TaggedValue> args) {
+    return sqrt(args);
+}
+
+BoxedValue __builtin_exp(std::span<const BoxedValue> args) {
+    return exp(args);
+}
+
+TaggedValue __builtin_exp(std::span<const TaggedValue> args) {
+    return exp(args);
+}
+
+BoxedValue __builtin_log(std::span<const BoxedValue> args) {
+    return log(args);
+}
+
+TaggedValue __builtin_log(std::span<const TaggedValue> args) {
+    return log(args);
+}
+
+BoxedValue __builtin_pow(std::span<const BoxedValue> args) {
+    return pow(args);
+}
+
+TaggedValue __builtin_pow(std::span<const TaggedValue> args) {
+    return pow(args);
+}
+
+BoxedValue __builtin_abs(std::span<const BoxedValue> args) {
+    return abs(args[0]);
+}
+
+TaggedValue __builtin_abs(std::span<const TaggedValue> args) {
+    return abs(args[0]);
+}
+
+BoxedValue __builtin_min(std::span<const BoxedValue> args) {
+    return extremum<false>("min", args);
+}
+
+TaggedValue __builtin_min(std::span<const TaggedValue> args) {
+    return extremum<false>("min", args);
+}
+
+BoxedValue __builtin_max(std::span<const BoxedValue> args) {
+    return extremum<true>("max", args);
+}
+
+TaggedValue __builtin_max(std::span<const TaggedValue> args) {
+    return extremum<true>("max", args);
+}
+
+}    // namespace expressions::interpreter
@@ -0,0 +1,55 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_MATH_HPP__
+#define __EXPRESSIONS_INTERPRETER_MATH_HPP__
+
+#include <expressions/interpreter/tagged_value.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <span>
+
+
+namespace expressions::interpreter {
+
+// The builtins of system.math. Given a list instead of a number, sqrt, exp,
+// log, pow and abs return the list of their results for each element, and
+// min and max the extremum of its elements. Lists of int64_t or double are
+// processed in their unboxed storage, with SIMD kernels where the target has
+// them; the results are the same as element by element.
+
+// sqrt(x): the square root of x, as a double.
+BoxedValue __builtin_sqrt(std::span<const BoxedValue> args);
+TaggedValue __builtin_sqrt(std::span<const TaggedValue> args);
+
+// exp(x): e raised to the power x.
+BoxedValue __builtin_exp(std::span<const BoxedValue> args);
+TaggedValue __builtin_exp(std::span<const TaggedValue> args);
+
+// log(x): the natural logarithm of x.
+BoxedValue __builtin_log(std::span<const BoxedValue> args);
+TaggedValue __builtin_log(std::span<const TaggedValue> args);
+
+// pow(x, y): x ** y, for a number y.
+BoxedValue __builtin_pow(std::span<const BoxedValue> args);
+TaggedValue __builtin_pow(std::span<const TaggedValue> args);
+
+// abs(x): the absolute value of x, of the same type.
+BoxedValue __builtin_abs(std::span<const BoxedValue> args);
+TaggedValue __builtin_abs(std::span<const TaggedValue> args);
+
+// min(x, ...) and max(x, ...): the least or the greatest of the numbers, or
+// of the elements of a single list. The result is an int64_t if every
+// number is one, and a double otherwise. A NaN makes the result NaN.
+BoxedValue __builtin_min(std::span<const BoxedValue> args);
+TaggedValue __builtin_min(std::span<const TaggedValue> args);
+
+BoxedValue __builtin_max(std::span<const BoxedValue> args);
+TaggedValue __builtin_max(std::span<const TaggedValue> args);
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,566 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/operators.hpp>
+
+#include <expressions/common/visitor.hpp>
+
+#include <fmt/format.h>
+#include <boost/type_index.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <type_traits>
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+template<typename F>
+decltype(auto) visit_number(const BoxedValue& value, F&& func) {
+    if (const auto* value_i64 = boost::get<int64_t>(&value)) {
+        return func(*value_i64);
+    } else if (const auto* value_u64 = boost::get<uint64_t>(&value)) {
+        return func(*value_u64);
+    }
+
+    return func(boost::get<double>(value));
+}
+
+template<typename F>
+decltype(auto) visit_number(const TaggedValue& value, F&& func) {
+    switch (value.tag()) {
+        case TaggedValue::Tag::kInt64: {
+            return func(value.as_int64());
+        }
+        case TaggedValue::Tag::kUInt64: {
+            return func(value.as_uint64());
+        }
+        default: {
+            return func(value.as_double());
+        }
+    }
+}
+
+// Results follow the usual arithmetic conversions, except that floor
+// division always yields an int64_t and power always yields a double.
+template<typename R, typename A, typename B>
+R arithmetic(ast::BinOpType op, A a, B b) {
+    switch (op) {
+        case ast::BinOpType::kNone: {
+            break;
+        }
+        case ast::BinOpType::kAdd: {
+            return a + b;
+        }
+        case ast::BinOpType::kSub: {
+            return a - b;
+        }
+        case ast::BinOpType::kMult: {
+            return a * b;
+        }
+        case ast::BinOpType::kTrueDiv: {
+            return a / b;
+        }
+        case ast::BinOpType::kFloorDiv: {
+            return static_cast<int64_t>(a / b);
+        }
+        case ast::BinOpType::kMod: {
+            if constexpr (std::same_as<A, double> || std::same_as<B, double>) {
+                return std::fmod(a, b);
+            } else {
+                return a % b;
+            }
+        }
+        case ast::BinOpType::kPow: {
+            return power(a, b);
+        }
+    }
+
+    return R {};
+}
+
+// Signed and unsigned integers are compared as unsigned.
+template<typename A, typename B>
+bool compare_numbers(ast::CompareOpType op, A a, B b) {
+    if constexpr (std::is_integral_v<A> && std::is_integral_v<B>
+                  && !std::same_as<A, B>) {
+        return compare_numbers(op, static_cast<uint64_t>(a),
+                               static_cast<uint64_t>(b));
+    } else {
+        switch (op) {
+            case ast::CompareOpType::kEQ: {
+                return a == b;
+            }
+            case ast::CompareOpType::kNEQ: {
+                return a != b;
+            }
+            case ast::CompareOpType::kLT: {
+                return a < b;
+            }
+            case ast::CompareOpType::kLTE: {
+                return a <= b;
+            }
+            case ast::CompareOpType::kGT: {
+                return a > b;
+            }
+            case ast::CompareOpType::kGTE: {
+                return a >= b;
+            }
+            case ast::CompareOpType::kNone:
+            case ast::CompareOpType::kIn:
+            case ast::CompareOpType::kNotIn: {
+                break;
+            }
+        }
+
+        return false;
+    }
+}
+
+// Borrows the boxed value of an object and boxes a scalar into the storage.
+const BoxedValue& boxed_of(const TaggedValue& value, BoxedValue& storage) {
+    if (value.is_object()) {
+        return value.object();
+    }
+    storage = value.to_boxed();
+
+    return storage;
+}
+
+}    // namespace
+
+BoxedValue execute_bin_op(ast::BinOpType op, const BoxedValue& left,
+                          const BoxedValue& right) {
+    if (!ast::holds_any_of<int64_t, uint64_t, double, String,
+                           Vector<BoxedValue>>(left)) {
+        fmt::print("--------1 {}, {}\n", static_cast<int32_t>(op),
+                   left.which());
+        return {};
+    }
+    if (!ast::holds_any_of<int64_t, uint64_t, double, String,
+                           Vector<BoxedValue>>(right)) {
+        fmt::print("--------2 {}, {}\n", static_cast<int32_t>(op),
+                   right.which());
+        return {};
+    }
+
+    if (op == ast::BinOpType::kNone) {
+        return {};
+    }
+
+    if (ast::holds_any_of<int64_t, uint64_t, double>(left)
+        && ast::holds_any_of<int64_t, uint64_t, double>(right)) {
+        return visit_number(left, [&](auto a) {
+            return visit_number(right, [&](auto b) {
+                return arithmetic<BoxedValue>(op, a, b);
+            });
+        });
+    } else if (op == ast::BinOpType::kAdd
+               && ast::holds_alternative<String>(left)
+               && ast::holds_alternative<String>(right)) {
+        auto* lhs = boost::get<String>(&left);
+        auto* rhs = boost::get<String>(&right);
+        return *lhs + rhs->view();
+    } else if (op == ast::BinOpType::kAdd
+               && ast::holds_alternative<Vector<BoxedValue>>(left)
+               && ast::holds_alternative<Vector<BoxedValue>>(right)) {
+        auto* lhs = boost::get<Vector<BoxedValue>>(&left);
+        auto* rhs = boost::get<Vector<BoxedValue>>(&right);
+
+        auto output = Vector<BoxedValue> {};
+        auto& elements = output.mutate();
+        elements.reserve(lhs->size() + rhs->size());
+        elements.append(lhs->get());
+        elements.append(rhs->get());
+
+        return output;
+    }
+
+    return {};
+}
+
+TaggedValue execute_bin_op(ast::BinOpType op, const TaggedValue& left,
+                           const TaggedValue& right) {
+    if (op != ast::BinOpType::kNone && left.is_number() && right.is_number()) {
+        return visit_number(left, [&](auto a) {
+            return visit_number(right, [&](auto b) {
+                return arithmetic<TaggedValue>(op, a, b);
+            });
+        });
+    }
+
+    auto lhs = BoxedValue {};
+    auto rhs = BoxedValue {};
+
+    return TaggedValue {
+        execute_bin_op(op, boxed_of(left, lhs), boxed_of(right, rhs))};
+}
+
+bool execute_compare_op(ast::CompareOpType op, const BoxedValue& left,
+                        const BoxedValue& right) {
+    if (ast::holds_any_of<int64_t, uint64_t, double>(left)
+        && ast::holds_any_of<int64_t, uint64_t, double>(right)) {
+        return visit_number(left, [&](auto a) {
+            return visit_number(right, [&](auto b) {
+                return compare_numbers(op, a, b);
+            });
+        });
+    }
+
+    auto generic_compare = [](const auto& a, const auto& b,
+                              auto&& compare) -> bool {
+        if (ast::holds_alternative<String>(a)
+            && ast::holds_alternative<String>(b)) {
+            auto* lhs = boost::get<String>(&a);
+            auto* rhs = boost::get<String>(&b);
+            return compare(lhs->view(), rhs->view());
+        }
+
+        return compare(a, b);
+    };
+
+    switch (op) {
+        case ast::CompareOpType::kNone: {
+            return false;
+        }
+        case ast::CompareOpType::kEQ: {
+            return generic_compare(left, right,
+                                   [](const auto& a, const auto& b) {
+                                       return a == b;
+                                   });
+        }
+        case ast::CompareOpType::kNEQ: {
+            return generic_compare(left, right,
+                                   [](const auto& a, const auto& b) {
+                                       return a != b;
+                                   });
+        }
+        case ast::CompareOpType::kLT: {
+            return generic_compare(left, right,
+                                   [](const auto& a, const auto& b) {
+                                       return a < b;
+                                   });
+        }
+        case ast::CompareOpType::kLTE: {
+            return generic_compare(left, right,
+                                   [](const auto& a, const auto& b) {
+                                       return a <= b;
+                                   });
+        }
+        case ast::CompareOpType::kGT: {
+            return generic_compare(left, right,
+                                   [](const auto& a, const auto& b) {
+                                       return a > b;
+                                   });
+        }
+        case ast::CompareOpType::kGTE: {
+            return generic_compare(left, right,
+                                   [](const auto& a, const auto& b) {
+                                       return a >= b;
+                                   });
+        }
+        case ast::CompareOpType::kIn: {
+            auto visitor = Visitor {
+                [&](const Tuple<BoxedValue>& t) -> bool {
+                    return std::find(t.begin(), t.end(), left) != t.end();
+                },
+                [&](const Vector<BoxedValue>& v) -> bool {
+                    return v.get().contains(left);
+                },
+                [&](const Set<BoxedValue>& s) -> bool {
+                    return s.get().contains(left);
+                },
+                [&](const Map<BoxedValue, BoxedValue>& m) -> bool {
+                    return m.get().contains(left);
+                },
+                [&](const DateRange& range) -> bool {
+                    const auto* date = boost::get<Date>(&left);
+                    return (date && range.contains(*date));
+                },
+                [&](const BoxedValue&) -> bool {
+                    return false;
+                },
+            };
+            return boost::apply_visitor(visitor, right);
+        }
+        case ast::CompareOpType::kNotIn: {
+            auto visitor = Visitor {
+                [&](const Tuple<BoxedValue>& t) -> bool {
+                    return std::find(t.begin(), t.end(), left) == t.end();
+                },
+                [&](const Vector<BoxedValue>& v) -> bool {
+                    return !v.get().contains(left);
+                },
+                [&](const Set<BoxedValue>& s) -> bool {
+                    return !s.get().contains(left);
+                },
+                [&](const Map<BoxedValue, BoxedValue>& m) -> bool {
+                    return !m.get().contains(left);
+                },
+                [&](const DateRange& range) -> bool {
+                    const auto* date = boost::get<Date>(&left);
+                    return !(date && range.contains(*date));
+                },
+                [&](const BoxedValue&) -> bool {
+                    return false;
+                },
+            };
+            return boost::apply_visitor(visitor, right);
+        }
+    }
+
+    return false;
+}
+
+bool execute_compare_op(ast::CompareOpType op, const TaggedValue& left,
+                        const TaggedValue& right) {
+    if (left.is_number() && right.is_number()) {
+        return visit_number(left, [&](auto a) {
+            return visit_number(right, [&](auto b) {
+                return compare_numbers(op, a, b);
+            });
+        });
+    }
+    if (left.tag() == TaggedValue::Tag::kDate
+        && right.tag() == TaggedValue::Tag::kDateRange) {
+        if (op == ast::CompareOpType::kIn) {
+            return right.as_date_range().contains(left.as_date());
+        } else if (op == ast::CompareOpType::kNotIn) {
+            return !right.as_date_range().contains(left.as_date());
+        }
+    }
+
+    auto lhs = BoxedValue {};
+    auto rhs = BoxedValue {};
+
+    return execute_compare_op(op, boxed_of(left, lhs), boxed_of(right, rhs));
+}
+
+BoxedValue execute_unary_op(ast::BoolOpType op, const BoxedValue& operand) {
+    auto generic_unary_op
+        = [](auto type, const auto& value, auto&& op_func) -> BoxedValue {
+        if (ast::holds_any_of<int64_t, uint64_t, double>(value)) {
+            if (boost::get<int64_t>(&value)) {
+                return op_func(boost::get<int64_t>(value));
+            } else if (boost::get<uint64_t>(&value)) {
+                return op_func(boost::get<uint64_t>(value));
+            } else if (boost::get<double>(&value)) {
+                return op_func(boost::get<double>(value));
+            }
+        } else if (type == ast::BoolOpType::kNot) {
+            if (boost::get<bool>(&value)) {
+                return !boost::get<bool>(value);
+            } else if (boost::get<Null>(&value)) {
+                return true;
+            } else if (auto* str = boost::get<String>(&value)) {
+                return str->empty();
+            }
+        }
+
+        // TODO: throw type error
+        return {};
+    };
+
+    switch (op) {
+        case ast::BoolOpType::kPlus: {
+            return generic_unary_op(op, operand,
+                                    [](const auto& value) -> BoxedValue {
+                                        return value;
+                                    });
+        }
+        case ast::BoolOpType::kMinus: {
+            return generic_unary_op(op, operand,
+                                    [](const auto& value) -> BoxedValue {
+                                        return -value;
+                                    });
+        }
+        case ast::BoolOpType::kNot: {
+            return generic_unary_op(op, operand,
+                                    [](const auto& value) -> BoxedValue {
+                                        return !value;
+                                    });
+        }
+        case ast::BoolOpType::kDefault:
+        case ast::BoolOpType::kAnd:
+        case ast::BoolOpType::kOr: {
+            break;
+        }
+    }
+
+    return {};
+}
+
+TaggedValue execute_unary_op(ast::BoolOpType op, const TaggedValue& operand) {
+    if (operand.is_number()) {
+        switch (op) {
+            case ast::BoolOpType::kPlus: {
+                return operand;
+            }
+            case ast::BoolOpType::kMinus: {
+                return visit_number(operand, [](auto value) {
+                    return TaggedValue {-value};
+                });
+            }
+            case ast::BoolOpType::kNot: {
+                return visit_number(operand, [](auto value) {
+                    return TaggedValue {!value};
+                });
+            }
+            case ast::BoolOpType::kDefault:
+            case ast::BoolOpType::kAnd:
+            case ast::BoolOpType::kOr: {
+                return {};
+            }
+        }
+    }
+
+    auto storage = BoxedValue {};
+
+    return TaggedValue {execute_unary_op(op, boxed_of(operand, storage))};
+}
+
+BoxedValue execute_subscript(const BoxedValue& object,
+                             const BoxedValue& subscript) {
+    auto index = 0ll;
+    if (ast::holds_alternative<int64_t>(subscript)) {
+        index = ast::get<int64_t>(subscript);
+    } else if (ast::holds_alternative<uint64_t>(subscript)) {
+        index = static_cast<int64_t>(ast::get<uint64_t>(subscript));
+    } else {
+        // TODO: throw error
+        return {};
+    }
+
+    auto visitor = SelfVisitableVisitor {
+        [&](auto&&, const Tuple<BoxedValue>& value) {
+            return value.get().at(index);
+        },
+        [&](auto&&, const Vector<BoxedValue>& value) {
+            return value.get().at(index);
+        },
+        [](auto&&, const auto& value) {
+            auto name
+                = boost::typeindex::type_id<decltype(value)>().pretty_name();
+            fmt::print("{}\n", name);
+            return BoxedValue {};
+        },
+    };
+
+    return visitor.visit(object);
+}
+
+TaggedValue execute_subscript(const TaggedValue& object,
+                              const TaggedValue& subscript) {
+    auto lhs = BoxedValue {};
+    auto rhs = BoxedValue {};
+
+    return TaggedValue {
+        execute_subscript(boxed_of(object, lhs), boxed_of(subscript, rhs))};
+}
+
+bool check_branch_condition(const BoxedValue& value) {
+    bool flag = true;
+    if (ast::get_if<Null>(&value)) {
+        flag = false;
+    } else if (const auto* value_bool = ast::get_if<bool>(&value)) {
+        flag = *value_bool;
+    } else if (const auto* value_i64 = ast::get_if<int64_t>(&value)) {
+        flag = *value_i64 != 0;
+    } else if (const auto* value_u64 = ast::get_if<uint64_t>(&value)) {
+        flag = *value_u64 != 0;
+    } else if (const auto* value_double = ast::get_if<double>(&value)) {
+        flag = *value_double != 0.f;
+    } else if (const auto* value_str = ast::get_if<String>(&value)) {
+        flag = !value_str->empty();
+    } else {
+        // TODO:
+    }
+
+    return flag;
+}
+
+bool check_branch_condition(const TaggedValue& value) {
+    switch (value.tag()) {
+        case TaggedValue::Tag::kNull: {
+            return false;
+        }
+        case TaggedValue::Tag::kBool: {
+            return value.as_bool();
+        }
+        case TaggedValue::Tag::kInt64: {
+            return value.as_int64() != 0;
+        }
+        case TaggedValue::Tag::kUInt64: {
+            return value.as_uint64() != 0;
+        }
+        case TaggedValue::Tag::kDouble: {
+            return value.as_double() != 0.f;
+        }
+        case TaggedValue::Tag::kObject: {
+            return check_branch_condition(value.object());
+        }
+        case TaggedValue::Tag::kEllipsis:
+        case TaggedValue::Tag::kDate:
+        case TaggedValue::Tag::kDateRange: {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool execute_inplace_op(ast::BinOpType op, BoxedValue& target,
+                        const BoxedValue& operand) {
+    if (op != ast::BinOpType::kAdd) {
+        return false;
+    }
+
+    if (auto* str = boost::get<String>(&target)) {
+        if (const auto* suffix = boost::get<String>(&operand)) {
+            *str += suffix->view();
+            return true;
+        }
+    } else if (auto* list = boost::get<Vector<BoxedValue>>(&target)) {
+        if (const auto* tail = boost::get<Vector<BoxedValue>>(&operand)) {
+            // Cloning shared contents first keeps tail valid even if it is
+            // the same list.
+            list->mutate().append(tail->get());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool shares_contents(const BoxedValue& lhs, const BoxedValue& rhs) {
+    if (const auto* list = boost::get<Vector<BoxedValue>>(&lhs)) {
+        const auto* other = boost::get<Vector<BoxedValue>>(&rhs);
+        return other && &list->get() == &other->get();
+    } else if (const auto* str = boost::get<String>(&lhs)) {
+        const auto* other = boost::get<String>(&rhs);
+        return other && str->view().data() == other->view().data()
+               && str->size() == other->size();
+    }
+
+    return false;
+}
+
+bool execute_inplace_op(ast::BinOpType op, TaggedValue& target,
+                        const TaggedValue& operand) {
+    auto appendable = (target.holds<String>() && operand.holds<String>())
+                      || (target.holds<Vector<BoxedValue>>()
+                          && operand.holds<Vector<BoxedValue>>());
+    if (op != ast::BinOpType::kAdd || !appendable) {
+        return false;
+    }
+
+    return execute_inplace_op(op, target.mutable_object(), operand.object());
+}
+
+}    // namespace expressions::interpreter
@@ -0,0 +1,72 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_OPERATORS_HPP__
+#define __EXPRESSIONS_INTERPRETER_OPERATORS_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/interpreter/tagged_value.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <cmath>
+
+
+namespace expressions::interpreter {
+
+// Value operations shared by every execution engine. The AST interpreter and
+// the bytecode virtual machine must agree on the semantics of each operator,
+// so both of them delegate here instead of implementing their own. The
+// TaggedValue overloads compute on numbers directly and box any other operand
+// for the BoxedValue ones.
+
+BoxedValue execute_bin_op(ast::BinOpType op, const BoxedValue& left,
+                          const BoxedValue& right);
+
+// base ** exponent. Squares are multiplied out, which std::pow() would round
+// the same, only slower.
+inline double power(double base, double exponent) {
+    return exponent == 2.0 ? base * base : std::pow(base, exponent);
+}
+
+bool execute_compare_op(ast::CompareOpType op, const BoxedValue& left,
+                        const BoxedValue& right);
+
+BoxedValue execute_unary_op(ast::BoolOpType op, const BoxedValue& operand);
+
+BoxedValue execute_subscript(const BoxedValue& object,
+                             const BoxedValue& subscript);
+
+bool check_branch_condition(const BoxedValue& value);
+
+// Computes `target op= operand` by mutating target. Only appending a list to
+// a list or a string to a string has an in-place form: any other operation
+// returns false and leaves target untouched.
+bool execute_inplace_op(ast::BinOpType op, BoxedValue& target,
+                        const BoxedValue& operand);
+
+// Whether both values are the same list or string, rather than equal ones.
+// Appending in place to one of them is then `+` for the other as well.
+bool shares_contents(const BoxedValue& lhs, const BoxedValue& rhs);
+
+TaggedValue execute_bin_op(ast::BinOpType op, const TaggedValue& left,
+                           const TaggedValue& right);
+
+bool execute_compare_op(ast::CompareOpType op, const TaggedValue& left,
+                        const TaggedValue& right);
+
+TaggedValue execute_unary_op(ast::BoolOpType op, const TaggedValue& operand);
+
+TaggedValue execute_subscript(const TaggedValue& object,
+                              const TaggedValue& subscript);
+
+bool check_branch_condition(const TaggedValue& value);
+
+bool execute_inplace_op(ast::BinOpType op, TaggedValue& target,
+                        const TaggedValue& operand);
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,85 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/tagged_value.hpp>
+
+
+namespace expressions::interpreter {
+
+TaggedValue::TaggedValue(BoxedValue value) {
+    if (ast::get_if<Null>(&value)) {
+        return;
+    } else if (ast::get_if<Ellipsis>(&value)) {
+        tag_ = Tag::kEllipsis;
+    } else if (const auto* flag = ast::get_if<bool>(&value)) {
+        tag_ = Tag::kBool;
+        payload_.flag = *flag;
+    } else if (const auto* value_i64 = ast::get_if<int64_t>(&value)) {
+        tag_ = Tag::kInt64;
+        payload_.i64 = *value_i64;
+    } else if (const auto* value_u64 = ast::get_if<uint64_t>(&value)) {
+        tag_ = Tag::kUInt64;
+        payload_.u64 = *value_u64;
+    } else if (const auto* value_double = ast::get_if<double>(&value)) {
+        tag_ = Tag::kDouble;
+        payload_.f64 = *value_double;
+    } else if (const auto* date = ast::get_if<Date>(&value)) {
+        tag_ = Tag::kDate;
+        payload_.date = *date;
+    } else if (const auto* range = ast::get_if<DateRange>(&value)) {
+        tag_ = Tag::kDateRange;
+        payload_.range = *range;
+    } else {
+        payload_.object = new Object {1, std::move(value)};
+        tag_ = Tag::kObject;
+    }
+}
+
+BoxedValue& TaggedValue::mutable_object() {
+    if (payload_.object->references > 1) {
+        auto* object = new Object {1, payload_.object->value};
+        --payload_.object->references;
+        payload_.object = object;
+    }
+
+    return payload_.object->value;
+}
+
+BoxedValue TaggedValue::to_boxed() const {
+    switch (tag_) {
+        case Tag::kNull: {
+            return Null {};
+        }
+        case Tag::kEllipsis: {
+            return Ellipsis {};
+        }
+        case Tag::kBool: {
+            return payload_.flag;
+        }
+        case Tag::kInt64: {
+            return payload_.i64;
+        }
+        case Tag::kUInt64: {
+            return payload_.u64;
+        }
+        case Tag::kDouble: {
+            return payload_.f64;
+        }
+        case Tag::kDate: {
+            return payload_.date;
+        }
+        case Tag::kDateRange: {
+            return payload_.range;
+        }
+        case Tag::kObject: {
+            return payload_.object->value;
+        }
+    }
+
+    return {};
+}
+
+}    // namespace expressions::interpreter
@@ -0,0 +1,183 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_TAGGED_VALUE_HPP__
+#define __EXPRESSIONS_INTERPRETER_TAGGED_VALUE_HPP__
+
+#include <expressions/interpreter/value.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+
+namespace expressions::interpreter {
+
+// 16-byte value of the AST interpreter. Scalars are stored inline, while
+// strings, collections, callables and code live in a reference-counted boxed
+// value on the heap, so copying any value never copies more than a pointer.
+// Boxed values are immutable once shared. The reference count is not atomic:
+// a value must not be shared across threads.
+class TaggedValue {
+public:
+    enum class Tag : uint8_t {
+        kNull,
+        kEllipsis,
+        kBool,
+        kInt64,
+        kUInt64,
+        kDouble,
+        kDate,
+        kDateRange,
+        kObject,
+    };
+
+    TaggedValue() noexcept = default;
+    TaggedValue(Null) noexcept {}
+    TaggedValue(Ellipsis) noexcept : tag_ {Tag::kEllipsis} {}
+    TaggedValue(bool value) noexcept : tag_ {Tag::kBool} {
+        payload_.flag = value;
+    }
+    TaggedValue(int64_t value) noexcept : tag_ {Tag::kInt64} {
+        payload_.i64 = value;
+    }
+    TaggedValue(uint64_t value) noexcept : tag_ {Tag::kUInt64} {
+        payload_.u64 = value;
+    }
+    TaggedValue(double value) noexcept : tag_ {Tag::kDouble} {
+        payload_.f64 = value;
+    }
+    TaggedValue(Date value) noexcept : tag_ {Tag::kDate} {
+        payload_.date = value;
+    }
+    TaggedValue(DateRange value) noexcept : tag_ {Tag::kDateRange} {
+        payload_.range = value;
+    }
+    // Unboxes scalars and moves everything else to the heap.
+    explicit TaggedValue(BoxedValue value);
+
+    TaggedValue(const TaggedValue& other) noexcept
+        : payload_ {other.payload_}, tag_ {other.tag_} {
+        if (tag_ == Tag::kObject) {
+            ++payload_.object->references;
+        }
+    }
+    TaggedValue(TaggedValue&& other) noexcept
+        : payload_ {other.payload_},
+          tag_ {std::exchange(other.tag_, Tag::kNull)} {}
+    ~TaggedValue() {
+        release_();
+    }
+
+    TaggedValue& operator=(const TaggedValue& other) noexcept {
+        if (this != &other) {
+            auto copy = other;
+            swap(copy);
+        }
+
+        return *this;
+    }
+    TaggedValue& operator=(TaggedValue&& other) noexcept {
+        if (this != &other) {
+            release_();
+            payload_ = other.payload_;
+            tag_ = std::exchange(other.tag_, Tag::kNull);
+        }
+
+        return *this;
+    }
+
+    void swap(TaggedValue& other) noexcept {
+        std::swap(payload_, other.payload_);
+        std::swap(tag_, other.tag_);
+    }
+
+    Tag tag() const noexcept {
+        return tag_;
+    }
+    bool is_number() const noexcept {
+        return tag_ == Tag::kInt64 || tag_ == Tag::kUInt64
+               || tag_ == Tag::kDouble;
+    }
+    bool is_object() const noexcept {
+        return tag_ == Tag::kObject;
+    }
+
+    bool as_bool() const noexcept {
+        return payload_.flag;
+    }
+    int64_t as_int64() const noexcept {
+        return payload_.i64;
+    }
+    uint64_t as_uint64() const noexcept {
+        return payload_.u64;
+    }
+    double as_double() const noexcept {
+        return payload_.f64;
+    }
+    Date as_date() const noexcept {
+        return payload_.date;
+    }
+    DateRange as_date_range() const noexcept {
+        return payload_.range;
+    }
+    // The boxed value of an object.
+    const BoxedValue& object() const noexcept {
+        return payload_.object->value;
+    }
+    // The boxed value of an object, copied first if other values share it.
+    BoxedValue& mutable_object();
+
+    // Returns nullptr unless the value is an object of type T.
+    template<typename T>
+    const T* get_if() const noexcept {
+        if (tag_ != Tag::kObject) {
+            return nullptr;
+        }
+
+        return boost::get<T>(&payload_.object->value);
+    }
+    template<typename T>
+    bool holds() const noexcept {
+        return get_if<T>() != nullptr;
+    }
+
+    BoxedValue to_boxed() const;
+
+private:
+    struct Object {
+        size_t references = 1;
+        BoxedValue value {};
+    };
+
+    union Payload {
+        bool flag;
+        int64_t i64;
+        uint64_t u64;
+        double f64;
+        Date date;
+        DateRange range;
+        Object* object;
+    };
+
+    void release_() noexcept {
+        if (tag_ == Tag::kObject && --payload_.object->references == 0) {
+            delete payload_.object;
+        }
+    }
+
+private:
+    Payload payload_ {.i64 = 0};
+    Tag tag_ {Tag::kNull};
+};
+
+static_assert(sizeof(TaggedValue) == 16);
+static_assert(std::is_nothrow_move_constructible_v<TaggedValue>);
+
+}    // namespace expressions::interpreter
+
+#endif
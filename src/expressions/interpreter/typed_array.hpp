@@ -0,0 +1,315 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_TYPED_ARRAY_HPP__
+#define __EXPRESSIONS_INTERPRETER_TYPED_ARRAY_HPP__
+
+#include <expressions/support/boost/variant.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+enum class ElementType : uint8_t {
+    kBoxed,
+    kInt64,
+    kDouble,
+    kBool,
+};
+
+// Elements of a list. While every element is an int64_t, a double or a bool,
+// they are stored unboxed in a plain array of that type, which takes a
+// fraction of the memory of boxed values and can be processed in bulk through
+// get_if(). Writing an element of any other type converts the array to boxed
+// storage for good. An empty array takes the type of its first element.
+//
+// Elements are read by value: iterators and at() box unboxed elements on the
+// fly. T is the boxed value type, a boost::variant.
+template<typename T>
+class TypedArray {
+public:
+    using value_type = T;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = T;
+
+        const_iterator() = default;
+        const_iterator(const TypedArray* array, size_t index) noexcept
+            : array_ {array}, index_ {index} {}
+
+        T operator*() const {
+            return (*array_)[index_];
+        }
+        const_iterator& operator++() noexcept {
+            ++index_;
+            return *this;
+        }
+        const_iterator operator++(int) noexcept {
+            auto tmp = *this;
+            ++index_;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& rhs) const noexcept {
+            return index_ == rhs.index_;
+        }
+        bool operator!=(const const_iterator& rhs) const noexcept {
+            return index_ != rhs.index_;
+        }
+
+    private:
+        const TypedArray* array_ = nullptr;
+        size_t index_ = 0;
+    };
+    using iterator = const_iterator;
+
+    ElementType element_type() const noexcept {
+        return static_cast<ElementType>(storage_.index());
+    }
+    // Returns nullptr unless the elements are stored unboxed as E, or boxed
+    // if E is T.
+    template<typename E>
+    const std::vector<E>* get_if() const noexcept {
+        return std::get_if<std::vector<E>>(&storage_);
+    }
+    // The same storage, to rearrange or overwrite the elements in place.
+    template<typename E>
+    std::vector<E>* get_if() noexcept {
+        return std::get_if<std::vector<E>>(&storage_);
+    }
+    // Replaces the elements with ones stored as E, which is T or one of the
+    // unboxed types.
+    template<typename E>
+    void assign(std::vector<E> elements) {
+        storage_.template emplace<std::vector<E>>(std::move(elements));
+    }
+
+    size_t size() const noexcept {
+        return std::visit([](const auto& elements) { return elements.size(); },
+                          storage_);
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+    size_t capacity() const noexcept {
+        return std::visit(
+            [](const auto& elements) { return elements.capacity(); },
+            storage_);
+    }
+
+    const_iterator begin() const noexcept {
+        return {this, 0};
+    }
+    const_iterator end() const noexcept {
+        return {this, size()};
+    }
+
+    T operator[](size_t index) const {
+        return std::visit(
+            [&](const auto& elements) {
+                using E = typename std::decay_t<decltype(elements)>::value_type;
+                return T {static_cast<E>(elements[index])};
+            },
+            storage_);
+    }
+    T at(size_t index) const {
+        if (index >= size()) {
+            throw std::out_of_range("TypedArray::at");
+        }
+
+        return (*this)[index];
+    }
+
+    bool contains(const T& value) const {
+        return std::visit(
+            [&](const auto& elements) {
+                using E = typename std::decay_t<decltype(elements)>::value_type;
+                if constexpr (std::is_same_v<E, T>) {
+                    return std::find(elements.begin(), elements.end(), value)
+                           != elements.end();
+                } else {
+                    const auto* element = boost::get<E>(&value);
+                    return element != nullptr
+                           && std::find(elements.begin(), elements.end(),
+                                        *element)
+                                  != elements.end();
+                }
+            },
+            storage_);
+    }
+
+    void reserve(size_t count) {
+        std::visit([&](auto& elements) { elements.reserve(count); },
+                   storage_);
+    }
+
+    void push_back(T value) {
+        if (empty()) {
+            retype_(element_type_of_(value));
+        }
+
+        auto pushed = std::visit(
+            [&](auto& elements) {
+                using E = typename std::decay_t<decltype(elements)>::value_type;
+                if constexpr (std::is_same_v<E, T>) {
+                    elements.emplace_back(std::move(value));
+                    return true;
+                } else if (const auto* element = boost::get<E>(&value)) {
+                    elements.emplace_back(*element);
+                    return true;
+                } else {
+                    return false;
+                }
+            },
+            storage_);
+        if (!pushed) {
+            box_(size() + 1).emplace_back(std::move(value));
+        }
+    }
+    template<typename... Args>
+    void emplace_back(Args&&... args) {
+        push_back(T {std::forward<Args>(args)...});
+    }
+
+    void append(const TypedArray& tail) {
+        if (&tail == this) {
+            auto copy = tail;
+            append(copy);
+            return;
+        }
+        if (tail.empty()) {
+            return;
+        }
+        if (empty()) {
+            retype_(tail.element_type());
+        }
+
+        if (storage_.index() != tail.storage_.index()) {
+            auto& elements = box_(size() + tail.size());
+            elements.insert(elements.end(), tail.begin(), tail.end());
+            return;
+        }
+
+        std::visit(
+            [&](auto& elements) {
+                const auto& rest = std::get<std::decay_t<decltype(elements)>>(
+                    tail.storage_);
+                elements.insert(elements.end(), rest.begin(), rest.end());
+            },
+            storage_);
+    }
+
+    bool operator==(const TypedArray& rhs) const {
+        if (storage_.index() == rhs.storage_.index()) {
+            return storage_ == rhs.storage_;
+        }
+
+        return size() == rhs.size()
+               && std::equal(begin(), end(), rhs.begin());
+    }
+    bool operator!=(const TypedArray& rhs) const {
+        return !(*this == rhs);
+    }
+    bool operator<(const TypedArray& rhs) const {
+        if (storage_.index() == rhs.storage_.index()) {
+            return storage_ < rhs.storage_;
+        }
+
+        return std::lexicographical_compare(begin(), end(), rhs.begin(),
+                                            rhs.end());
+    }
+    bool operator<=(const TypedArray& rhs) const {
+        return !(rhs < *this);
+    }
+    bool operator>(const TypedArray& rhs) const {
+        return rhs < *this;
+    }
+    bool operator>=(const TypedArray& rhs) const {
+        return !(*this < rhs);
+    }
+
+private:
+    static ElementType element_type_of_(const T& value) noexcept {
+        if (boost::get<int64_t>(&value)) {
+            return ElementType::kInt64;
+        } else if (boost::get<double>(&value)) {
+            return ElementType::kDouble;
+        } else if (boost::get<bool>(&value)) {
+            return ElementType::kBool;
+        }
+
+        return ElementType::kBoxed;
+    }
+
+    // Switches an empty array to storage of another type, keeping the
+    // reserved capacity.
+    void retype_(ElementType type) {
+        if (type == element_type()) {
+            return;
+        }
+
+        auto count = capacity();
+        switch (type) {
+            case ElementType::kBoxed: {
+                storage_.template emplace<std::vector<T>>();
+                break;
+            }
+            case ElementType::kInt64: {
+                storage_.template emplace<std::vector<int64_t>>();
+                break;
+            }
+            case ElementType::kDouble: {
+                storage_.template emplace<std::vector<double>>();
+                break;
+            }
+            case ElementType::kBool: {
+                storage_.template emplace<std::vector<bool>>();
+                break;
+            }
+        }
+        reserve(count);
+    }
+
+    // Converts the elements to boxed storage with room for count elements.
+    // Boxed storage is returned as is: the insertions that follow grow it
+    // geometrically, where reserving the exact count on every append would
+    // copy the whole array each time.
+    std::vector<T>& box_(size_t count) {
+        if (auto* elements = std::get_if<std::vector<T>>(&storage_)) {
+            return *elements;
+        }
+
+        auto boxed = std::vector<T> {};
+        boxed.reserve(count);
+        boxed.insert(boxed.end(), begin(), end());
+
+        return storage_.template emplace<std::vector<T>>(std::move(boxed));
+    }
+
+private:
+    // Indexed by ElementType.
+    std::variant<std::vector<T>, std::vector<int64_t>, std::vector<double>,
+                 std::vector<bool>>
+        storage_ {};
+};
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,112 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/value.hpp>
+
+#include <expressions/common/visitor.hpp>
+
+#include <boost/container_hash/hash.hpp>
+
+#include <functional>
+#include <string_view>
+
+
+namespace expressions::interpreter {
+
+namespace {
+
+template<typename Range>
+size_t hash_sequence(const Range& range) {
+    auto seed = size_t {range.size()};
+    for (const auto& element : range) {
+        boost::hash_combine(seed, hash_value(element));
+    }
+
+    return seed;
+}
+
+}    // namespace
+
+size_t hash_value(const BoxedValue& value) {
+    auto visitor = Visitor {
+        [](Null) -> size_t {
+            return 0;
+        },
+        [](Ellipsis) -> size_t {
+            return 0;
+        },
+        [](bool flag) -> size_t {
+            return flag ? 1 : 0;
+        },
+        [](int64_t value_i64) -> size_t {
+            return std::hash<int64_t> {}(value_i64);
+        },
+        [](uint64_t value_u64) -> size_t {
+            return std::hash<uint64_t> {}(value_u64);
+        },
+        [](double value_double) -> size_t {
+            return std::hash<double> {}(value_double);
+        },
+        [](const Name& name) -> size_t {
+            return std::hash<std::string_view> {}(name.value);
+        },
+        [](const String& str) -> size_t {
+            return std::hash<std::string_view> {}(str.view());
+        },
+        [](const Date& date) -> size_t {
+            return std::hash<int32_t> {}(date.days);
+        },
+        [](const DateRange& range) -> size_t {
+            auto seed = std::hash<int32_t> {}(range.begin.days);
+            boost::hash_combine(seed, range.end.days);
+            return seed;
+        },
+        [](const Code& code) -> size_t {
+            return std::hash<const void*> {}(code.code.get());
+        },
+        [](const Lambda& lambda) -> size_t {
+            return std::hash<const void*> {}(lambda.body.get())
+                   ^ std::hash<int32_t> {}(lambda.code);
+        },
+        [](const Function& func) -> size_t {
+            return std::hash<const void*> {}(func.body.get())
+                   ^ std::hash<int32_t> {}(func.code);
+        },
+        [](const Generator& generator) -> size_t {
+            return std::hash<const void*> {}(generator.state.get());
+        },
+        [](const Tuple<BoxedValue>& tuple) -> size_t {
+            return hash_sequence(tuple);
+        },
+        [](const Vector<BoxedValue>& vector) -> size_t {
+            return hash_sequence(vector);
+        },
+        [](const Set<BoxedValue>& set) -> size_t {
+            // Equal sets may hold their elements in different orders.
+            auto seed = size_t {set.size()};
+            for (const auto& element : set) {
+                seed += hash_value(element);
+            }
+            return seed;
+        },
+        [](const Map<BoxedValue, BoxedValue>& map) -> size_t {
+            auto seed = size_t {map.size()};
+            for (const auto& [key, item] : map) {
+                auto hash = hash_value(key);
+                boost::hash_combine(hash, hash_value(item));
+                seed += hash;
+            }
+            return seed;
+        },
+    };
+
+    auto seed = static_cast<size_t>(value.which());
+    boost::hash_combine(seed, boost::apply_visitor(visitor, value));
+
+    return seed;
+}
+
+}    // namespace expressions::interpreter
@@ -0,0 +1,530 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_INTERPRETER_VALUE_HPP__
+#define __EXPRESSIONS_INTERPRETER_VALUE_HPP__
+
+#include <expressions/ast/ast.hpp>
+
+#include <expressions/exception/throw_exception.hpp>
+#include <expressions/interpreter/hash_table.hpp>
+#include <expressions/interpreter/typed_array.hpp>
+
+#include <expressions/support/boost/variant.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::interpreter {
+
+// Shares its contents between copies, so copying is O(1). Mutating a copy
+// whose contents are still shared clones them first. The contents are
+// allocated on the first mutation; until then the container is empty.
+template<typename Container>
+class CopyOnWrite {
+public:
+    CopyOnWrite() = default;
+    CopyOnWrite(Container contents)
+        : contents_ {std::make_shared<Container>(std::move(contents))} {}
+
+    const Container& get() const noexcept {
+        if (!contents_) {
+            static const auto empty = Container {};
+            return empty;
+        }
+
+        return *contents_;
+    }
+    Container& mutate() {
+        if (!contents_) {
+            contents_ = std::make_shared<Container>();
+        } else if (contents_.use_count() > 1) {
+            contents_ = std::make_shared<Container>(*contents_);
+        }
+
+        return *contents_;
+    }
+    // Whether a mutation would not have to clone the contents.
+    bool unique() const noexcept {
+        return !contents_ || contents_.use_count() == 1;
+    }
+
+    auto begin() const noexcept {
+        return get().begin();
+    }
+    auto end() const noexcept {
+        return get().end();
+    }
+    auto size() const noexcept {
+        return get().size();
+    }
+    bool empty() const noexcept {
+        return get().empty();
+    }
+
+    bool operator==(const CopyOnWrite& rhs) const {
+        return contents_ == rhs.contents_ || get() == rhs.get();
+    }
+    bool operator!=(const CopyOnWrite& rhs) const {
+        return !(*this == rhs);
+    }
+    bool operator<(const CopyOnWrite& rhs) const {
+        return get() < rhs.get();
+    }
+    bool operator<=(const CopyOnWrite& rhs) const {
+        return get() <= rhs.get();
+    }
+    bool operator>(const CopyOnWrite& rhs) const {
+        return get() > rhs.get();
+    }
+    bool operator>=(const CopyOnWrite& rhs) const {
+        return get() >= rhs.get();
+    }
+
+private:
+    std::shared_ptr<Container> contents_ {};
+};
+
+struct Ellipsis {
+    bool operator==(const Ellipsis&) const = default;
+    bool operator!=(const Ellipsis&) const = default;
+
+    template<typename T>
+    bool operator==(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator!=(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator<(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator<=(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator>(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator>=(const T&) const {
+        return false;
+    }
+};
+
+struct Null {
+    bool operator==(const Null&) const = default;
+    bool operator!=(const Null&) const = default;
+
+    template<typename T>
+    bool operator==(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator!=(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator<(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator<=(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator>(const T&) const {
+        return false;
+    }
+    template<typename T>
+    bool operator>=(const T&) const {
+        return false;
+    }
+};
+
+struct Name {
+    std::string value;
+
+    bool operator==(const Name& rhs) const {
+        return value == rhs.value;
+    }
+    bool operator!=(const Name& rhs) const {
+        return value != rhs.value;
+    }
+    bool operator<(const Name& rhs) const {
+        return value < rhs.value;
+    }
+    bool operator<=(const Name& rhs) const {
+        return value <= rhs.value;
+    }
+    bool operator>(const Name& rhs) const {
+        return value > rhs.value;
+    }
+    bool operator>=(const Name& rhs) const {
+        return value >= rhs.value;
+    }
+};
+
+// Text of a string value. Copies share an append-only buffer, each one
+// seeing the prefix of its own length. Appending to a string that ends where
+// its buffer ends extends the buffer in place, which leaves the other strings
+// sharing it untouched, so building a string by repeated concatenation costs
+// amortized time in the length of the pieces rather than of the whole
+// string. Reading a string never has to flatten anything.
+class String {
+public:
+    String() = default;
+    String(std::string text)
+        : buffer_ {std::make_shared<std::string>(std::move(text))},
+          size_ {buffer_->size()} {}
+
+    std::string_view view() const noexcept {
+        if (!buffer_) {
+            return {};
+        }
+
+        return {buffer_->data(), size_};
+    }
+    size_t size() const noexcept {
+        return size_;
+    }
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    String& operator+=(std::string_view suffix) {
+        if (buffer_ && buffer_->size() != size_ && buffer_.use_count() == 1) {
+            buffer_->resize(size_);
+        }
+        if (!buffer_ || buffer_->size() != size_) {
+            // Another string has extended the buffer past this one.
+            auto text = std::string {};
+            text.reserve(size_ + suffix.size());
+            text.append(view());
+            buffer_ = std::make_shared<std::string>(std::move(text));
+        }
+
+        buffer_->append(suffix);
+        size_ += suffix.size();
+
+        return *this;
+    }
+    friend String operator+(String lhs, std::string_view rhs) {
+        lhs += rhs;
+        return lhs;
+    }
+
+    bool operator==(const String& rhs) const {
+        return view() == rhs.view();
+    }
+    bool operator!=(const String& rhs) const {
+        return view() != rhs.view();
+    }
+    bool operator<(const String& rhs) const {
+        return view() < rhs.view();
+    }
+    bool operator<=(const String& rhs) const {
+        return view() <= rhs.view();
+    }
+    bool operator>(const String& rhs) const {
+        return view() > rhs.view();
+    }
+    bool operator>=(const String& rhs) const {
+        return view() >= rhs.view();
+    }
+
+private:
+    std::shared_ptr<std::string> buffer_ {};
+    size_t size_ = 0;
+};
+
+// A calendar date as its year, month (1-12) and day of the month (1-31).
+struct CivilDate {
+    int32_t year = 1970;
+    int32_t month = 1;
+    int32_t day = 1;
+};
+
+// A date in the proleptic Gregorian calendar, packed as the number of days
+// since 1970-01-01, so that dates compare, subtract and offset as integers.
+struct Date {
+    // The day numbers that to_civil() converts without overflowing.
+    static constexpr int32_t kMinDays = std::numeric_limits<int32_t>::min();
+    static constexpr int32_t kMaxDays
+        = std::numeric_limits<int32_t>::max() - 719468;
+
+    int32_t days = 0;
+
+    // The conversions follow Howard Hinnant's days_from_civil and
+    // civil_from_days, which count in 400-year eras starting on March 1st.
+    static constexpr Date from_civil(int32_t year, int32_t month,
+                                     int32_t day) noexcept {
+        year -= month <= 2 ? 1 : 0;
+        auto era = (year >= 0 ? year : year - 399) / 400;
+        auto year_of_era = year - era * 400;
+        auto day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5
+                           + day - 1;
+        auto day_of_era = year_of_era * 365 + year_of_era / 4
+                          - year_of_era / 100 + day_of_year;
+
+        return Date {era * 146097 + day_of_era - 719468};
+    }
+
+    constexpr CivilDate to_civil() const noexcept {
+        auto shifted = days + 719468;
+        auto era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+        auto day_of_era = shifted - era * 146097;
+        auto year_of_era = (day_of_era - day_of_era / 1460
+                            + day_of_era / 36524 - day_of_era / 146096)
+                           / 365;
+        auto day_of_year = day_of_era
+                           - (365 * year_of_era + year_of_era / 4
+                              - year_of_era / 100);
+        auto month_index = (5 * day_of_year + 2) / 153;
+        auto day = day_of_year - (153 * month_index + 2) / 5 + 1;
+        auto month = month_index < 10 ? month_index + 3 : month_index - 9;
+        auto year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+        return CivilDate {year, month, day};
+    }
+
+    // 0 for Monday through 6 for Sunday. 1970-01-01 was a Thursday.
+    constexpr int32_t weekday() const noexcept {
+        auto weekday = (days + 3) % 7;
+        return weekday < 0 ? weekday + 7 : weekday;
+    }
+
+    bool operator==(const Date& rhs) const {
+        return days == rhs.days;
+    }
+    bool operator!=(const Date& rhs) const {
+        return days != rhs.days;
+    }
+    bool operator<(const Date& rhs) const {
+        return days < rhs.days;
+    }
+    bool operator<=(const Date& rhs) const {
+        return days <= rhs.days;
+    }
+    bool operator>(const Date& rhs) const {
+        return days > rhs.days;
+    }
+    bool operator>=(const Date& rhs) const {
+        return days >= rhs.days;
+    }
+};
+
+// Both ends are included.
+struct DateRange {
+    Date begin;
+    Date end;
+
+    bool contains(Date date) const noexcept {
+        return begin.days <= date.days && date.days <= end.days;
+    }
+
+    bool operator==(const DateRange& rhs) const {
+        return begin == rhs.begin && end == rhs.end;
+    }
+    bool operator!=(const DateRange& rhs) const {
+        return begin != rhs.begin || end != rhs.end;
+    }
+    bool operator<(const DateRange& rhs) const {
+        return begin < rhs.begin;
+    }
+    bool operator<=(const DateRange& rhs) const {
+        return begin <= rhs.begin;
+    }
+    bool operator>(const DateRange& rhs) const {
+        return end > rhs.end;
+    }
+    bool operator>=(const DateRange& rhs) const {
+        return end >= rhs.end;
+    }
+};
+
+// Parameters and body of a lambda or a function. Every callable created from
+// the same definition shares one, so creating or passing a callable never
+// copies its tree.
+struct CallableBody {
+    std::vector<ast::Value> params {};
+    ast::Value body {};
+    // Whether the body yields, which makes a call return a Generator.
+    bool generator = false;
+};
+
+struct Code {
+    std::shared_ptr<const ast::Value> code {};
+
+    bool operator==(const Code&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '==' for type 'Code'"));
+    }
+    bool operator!=(const Code&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '!=' for type 'Code'"));
+    }
+    bool operator<(const Code&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<' for type 'Code'"));
+    }
+    bool operator<=(const Code&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<=' for type 'Code'"));
+    }
+    bool operator>(const Code&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>' for type 'Code'"));
+    }
+    bool operator>=(const Code&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>=' for type 'Code'"));
+    }
+};
+
+struct Lambda {
+    // Null for the callables of the engines running compiled code.
+    std::shared_ptr<const CallableBody> body {};
+    // Index of the compiled body in vm::Program::functions, if any.
+    int32_t code = -1;
+
+    bool operator==(const Lambda&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '==' for type 'Lambda'"));
+    }
+    bool operator!=(const Lambda&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '!=' for type 'Lambda'"));
+    }
+    bool operator<(const Lambda&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<' for type 'Lambda'"));
+    }
+    bool operator<=(const Lambda&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<=' for type 'Lambda'"));
+    }
+    bool operator>(const Lambda&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>' for type 'Lambda'"));
+    }
+    bool operator>=(const Lambda&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>=' for type 'Lambda'"));
+    }
+};
+
+struct Function {
+    Name name {};
+    // Null for the callables of the engines running compiled code.
+    std::shared_ptr<const CallableBody> body {};
+    // Index of the compiled body in vm::Program::functions, if any.
+    int32_t code = -1;
+
+    bool operator==(const Function&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '==' for type 'Function'"));
+    }
+    bool operator!=(const Function&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '!=' for type 'Function'"));
+    }
+    bool operator<(const Function&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<' for type 'Function'"));
+    }
+    bool operator<=(const Function&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<=' for type 'Function'"));
+    }
+    bool operator>(const Function&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>' for type 'Function'"));
+    }
+    bool operator>=(const Function&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>=' for type 'Function'"));
+    }
+};
+
+class GeneratorState;
+
+// The call of a generator function, which the range-based for statements
+// over it resume up to its next yield. Copies share the state, so the
+// values are yielded once whichever copy is walked.
+struct Generator {
+    std::shared_ptr<GeneratorState> state {};
+
+    bool operator==(const Generator&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '==' for type 'Generator'"));
+    }
+    bool operator!=(const Generator&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '!=' for type 'Generator'"));
+    }
+    bool operator<(const Generator&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<' for type 'Generator'"));
+    }
+    bool operator<=(const Generator&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '<=' for type 'Generator'"));
+    }
+    bool operator>(const Generator&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>' for type 'Generator'"));
+    }
+    bool operator>=(const Generator&) const {
+        THROW_EXCEPTION(
+            std::logic_error("Unsupported operator '>=' for type 'Generator'"));
+    }
+};
+
+template<typename T>
+struct Tuple : CopyOnWrite<std::vector<T>> {
+    using CopyOnWrite<std::vector<T>>::CopyOnWrite;
+};
+
+template<typename T>
+struct Vector : CopyOnWrite<TypedArray<T>> {
+    using CopyOnWrite<TypedArray<T>>::CopyOnWrite;
+};
+
+template<typename T>
+struct Set : CopyOnWrite<HashSet<T>> {
+    using CopyOnWrite<HashSet<T>>::CopyOnWrite;
+};
+
+template<typename K, typename V>
+struct Map : CopyOnWrite<HashMap<K, V>> {
+    using CopyOnWrite<HashMap<K, V>>::CopyOnWrite;
+};
+
+using BoxedValue = boost::make_recursive_variant<
+    Null, bool, int64_t, uint64_t, double, Name, String, Date, DateRange, Code,
+    Lambda, Function, Generator, Tuple<boost::recursive_variant_>,
+    Vector<boost::recursive_variant_>, Set<boost::recursive_variant_>,
+    Map<boost::recursive_variant_, boost::recursive_variant_>, Ellipsis>::type;
+
+// Equal values hash equally. Values of different types never compare equal,
+// so the type takes part in the hash. Callables and code hash by identity.
+size_t hash_value(const BoxedValue& value);
+
+}    // namespace expressions::interpreter
+
+#endif
@@ -0,0 +1,1222 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/jit/code_generator.hpp>
+
+#include <expressions/common/enumerate.hpp>
+
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/Verifier.h>
+
+#include <algorithm>
+#include <utility>
+
+
+namespace expressions::jit {
+
+namespace {
+
+std::string_view type_name(ValueType type) {
+    switch (type) {
+        case ValueType::kUndefined: {
+            return "undefined";
+        }
+        case ValueType::kNull: {
+            return "null";
+        }
+        case ValueType::kBool: {
+            return "bool";
+        }
+        case ValueType::kInt64: {
+            return "int64";
+        }
+        case ValueType::kDouble: {
+            return "double";
+        }
+        case ValueType::kFunction: {
+            return "function";
+        }
+    }
+
+    return "unknown";
+}
+
+bool is_numeric(const TypedValue& value) {
+    return value.type == ValueType::kInt64 || value.type == ValueType::kDouble;
+}
+
+// The builtins compiled to native code, the math functions on numbers.
+bool is_native(parser::BuiltinFunction function) {
+    switch (function) {
+        case parser::BuiltinFunction::kSqrt:
+        case parser::BuiltinFunction::kExp:
+        case parser::BuiltinFunction::kLog:
+        case parser::BuiltinFunction::kPow:
+        case parser::BuiltinFunction::kAbs:
+        case parser::BuiltinFunction::kMin:
+        case parser::BuiltinFunction::kMax: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+}    // namespace
+
+auto FunctionAnalyzer::analyze(const ast::Value& body) const
+    -> std::optional<FunctionAnalysis> {
+    supported_ = true;
+    analysis_ = FunctionAnalysis {};
+
+    visit_(body);
+    if (!supported_) {
+        return std::nullopt;
+    }
+
+    return std::move(analysis_);
+}
+
+auto FunctionAnalyzer::operator()(bool value) const -> ReturnType {
+    (void)value;
+}
+
+auto FunctionAnalyzer::operator()(int64_t value) const -> ReturnType {
+    (void)value;
+}
+
+auto FunctionAnalyzer::operator()(double value) const -> ReturnType {
+    (void)value;
+}
+
+auto FunctionAnalyzer::operator()(const ast::Name& node) const -> ReturnType {
+    read_(node.value);
+}
+
+auto FunctionAnalyzer::operator()(const ast::String& node) const
+    -> ReturnType {
+    read_(node.value);
+}
+
+auto FunctionAnalyzer::operator()(const ast::CompareOp& node) const
+    -> ReturnType {
+    visit_(node.first);
+    for (const auto& operand : node.rest) {
+        if (operand.op == ast::CompareOpType::kNone
+            || operand.op == ast::CompareOpType::kIn
+            || operand.op == ast::CompareOpType::kNotIn) {
+            supported_ = false;
+        }
+        visit_(operand.operand);
+    }
+}
+
+auto FunctionAnalyzer::operator()(const ast::BinOp& node) const
+    -> ReturnType {
+    if (node.op == ast::BinOpType::kNone) {
+        supported_ = false;
+    }
+    visit_(node.left);
+    visit_(node.right);
+}
+
+auto FunctionAnalyzer::operator()(const ast::UnaryOp& node) const
+    -> ReturnType {
+    if (node.op != ast::BoolOpType::kPlus && node.op != ast::BoolOpType::kMinus
+        && node.op != ast::BoolOpType::kNot) {
+        supported_ = false;
+    }
+    visit_(node.operand);
+}
+
+auto FunctionAnalyzer::operator()(const ast::BoolOp& node) const
+    -> ReturnType {
+    if (node.op != ast::BoolOpType::kAnd && node.op != ast::BoolOpType::kOr) {
+        supported_ = false;
+    }
+    for (const auto& operand : node.operands) {
+        visit_(operand);
+    }
+}
+
+auto FunctionAnalyzer::operator()(const ast::Call& node) const -> ReturnType {
+    // Apart from the math functions, neither the builtins nor the host
+    // functions can be called from compiled code, and a parameter may hold any
+    // callable.
+    const auto& name = node.name.value;
+    if (auto builtin = parser::builtin_function_of(node.name)) {
+        if (!is_native(*builtin)) {
+            supported_ = false;
+            return;
+        }
+        for (const auto& arg : node.args) {
+            visit_(arg);
+        }
+        return;
+    }
+    if (node.name.scope == ast::NameScope::kExtern
+        || std::find(params_.begin(), params_.end(), name) != params_.end()) {
+        supported_ = false;
+        return;
+    }
+
+    add_name_(analysis_.callees, name);
+    for (const auto& arg : node.args) {
+        visit_(arg);
+    }
+}
+
+auto FunctionAnalyzer::operator()(const ast::Argument& node) const
+    -> ReturnType {
+    visit_(node.arg);
+}
+
+auto FunctionAnalyzer::operator()(const ast::KeywordArgument& node) const
+    -> ReturnType {
+    visit_(node.arg);
+}
+
+auto FunctionAnalyzer::operator()(const ast::Expression& node) const
+    -> ReturnType {
+    visit_(node.expr);
+}
+
+auto FunctionAnalyzer::operator()(const ast::AssignStatement& node) const
+    -> ReturnType {
+    visit_(node.expr);
+    write_(node.target);
+}
+
+auto FunctionAnalyzer::operator()(const ast::AugAssignStatement& node) const
+    -> ReturnType {
+    if (const auto* name = ast::get_if<ast::Name>(&node.target)) {
+        read_(name->value);
+    }
+    visit_(node.expr);
+    write_(node.target);
+}
+
+auto FunctionAnalyzer::operator()(const ast::ReturnStatement& node) const
+    -> ReturnType {
+    analysis_.returns = true;
+    if (node.expr) {
+        visit_(*node.expr);
+    }
+}
+
+auto FunctionAnalyzer::operator()(const ast::StatementList& node) const
+    -> ReturnType {
+    for (const auto& stmt : node.stmts) {
+        visit_(stmt);
+    }
+}
+
+auto FunctionAnalyzer::operator()(const ast::IfStatement& node) const
+    -> ReturnType {
+    visit_(node.condition);
+    visit_(node.body);
+    if (!ast::holds_alternative<ast::MonoState>(node.or_else)) {
+        visit_(node.or_else);
+    }
+}
+
+auto FunctionAnalyzer::operator()(const ast::ForStatement& node) const
+    -> ReturnType {
+    visit_(node.init);
+    visit_(node.condition);
+    visit_(node.iter);
+    visit_(node.body);
+}
+
+auto FunctionAnalyzer::operator()(const ast::WhileStatement& node) const
+    -> ReturnType {
+    visit_(node.condition);
+    visit_(node.body);
+}
+
+auto FunctionAnalyzer::operator()(const ast::Pass& node) const -> ReturnType {
+    (void)node;
+}
+
+auto FunctionAnalyzer::operator()(const ast::Break& node) const -> ReturnType {
+    (void)node;
+}
+
+auto FunctionAnalyzer::operator()(const ast::Continue& node) const
+    -> ReturnType {
+    (void)node;
+}
+
+void FunctionAnalyzer::read_(const std::string& name) const {
+    if (std::find(params_.begin(), params_.end(), name) == params_.end()) {
+        add_name_(analysis_.names, name);
+    }
+}
+
+void FunctionAnalyzer::write_(const ast::Value& target) const {
+    // Assignments always store into the global scope, even when a parameter
+    // has the same name.
+    if (const auto* name = ast::get_if<ast::Name>(&target)) {
+        add_name_(analysis_.names, name->value);
+    } else {
+        supported_ = false;
+    }
+}
+
+void FunctionAnalyzer::add_name_(std::vector<std::string>& names,
+                                 const std::string& name) {
+    if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.emplace_back(name);
+    }
+}
+
+auto CodeGenerator::generate(
+    const std::string& symbol, const FunctionSource& function,
+    const std::unordered_map<std::string, FunctionSource>& callees,
+    const std::vector<std::string>& names,
+    std::span<const ValueType> signature) const -> CompiledFunction {
+    const auto& params = function.params;
+    if (signature.size() != params.size() + names.size()) {
+        THROW_EXCEPTION(std::logic_error(fmt::format(
+            "[JIT] Signature of '{}' has {} types for {} inputs.", symbol,
+            signature.size(), params.size() + names.size())));
+    }
+
+    auto* i64 = llvm::Type::getInt64Ty(context_);
+    auto* word_ptr = llvm::Type::getInt64PtrTy(context_);
+    auto* function_type = llvm::FunctionType::get(
+        llvm::Type::getVoidTy(context_), {word_ptr, word_ptr}, false);
+    function_ = llvm::Function::Create(
+        function_type, llvm::Function::ExternalLinkage, symbol, module_);
+    function_->addFnAttr(llvm::Attribute::NoUnwind);
+    auto* inputs = function_->getArg(0);
+    auto* outputs = function_->getArg(1);
+    inputs->addAttr(llvm::Attribute::NoAlias);
+    outputs->addAttr(llvm::Attribute::NoAlias);
+
+    builder_ = std::make_unique<llvm::IRBuilder<>>(block_("entry"));
+    params_.clear();
+    indices_.clear();
+    variables_.assign(names.size(), Variable {});
+    defined_.assign(names.size(), false);
+    reachable_ = true;
+    loops_.clear();
+    callees_ = &callees;
+    inlined_.assign(1, function.name);
+    result_type_.reset();
+    exit_defined_.reset();
+
+    auto load_input = [&](size_t index) {
+        auto* address
+            = builder_->CreateConstInBoundsGEP1_64(i64, inputs, index);
+        return builder_->CreateLoad(i64, address);
+    };
+
+    for (const auto& [index, name] : enumerate(params)) {
+        auto type = signature[index];
+        if (type == ValueType::kUndefined || type == ValueType::kNull) {
+            THROW_EXCEPTION(CompileError(fmt::format(
+                "[JIT] Parameter '{}' has the unsupported type '{}'", name,
+                type_name(type))));
+        }
+        params_[name]
+            = TypedValue {from_bits_(load_input(index), type), type};
+    }
+
+    for (const auto& [index, name] : enumerate(names)) {
+        auto& variable = variables_[index];
+        indices_[name] = index;
+
+        variable.stored = alloca_(builder_->getInt1Ty(), name + ".stored");
+        builder_->CreateStore(builder_->getFalse(), variable.stored);
+
+        auto type = signature[params.size() + index];
+        if (type == ValueType::kFunction) {
+            variable.type = type;
+        } else if (type == ValueType::kBool || type == ValueType::kInt64
+                   || type == ValueType::kDouble) {
+            variable.type = type;
+            variable.value = alloca_(type_(type), name);
+            auto* value = from_bits_(load_input(params.size() + index), type);
+            builder_->CreateStore(value, variable.value);
+            defined_[index] = true;
+        }
+    }
+
+    result_ = alloca_(i64, "result");
+    exit_ = block_("exit");
+
+    emit_statement_(*function.body);
+    if (reachable_) {
+        (*this)(ast::ReturnStatement {});
+    }
+
+    builder_->SetInsertPoint(exit_);
+    auto store_output = [&](size_t index, llvm::Value* value) {
+        auto* address
+            = builder_->CreateConstInBoundsGEP1_64(i64, outputs, index);
+        builder_->CreateStore(value, address);
+    };
+    store_output(0, builder_->CreateLoad(i64, result_));
+
+    auto compiled = CompiledFunction {};
+    compiled.result = result_type_.value_or(ValueType::kNull);
+    compiled.stores.reserve(variables_.size());
+    for (const auto& [index, variable] : enumerate(variables_)) {
+        auto stored = builder_->CreateLoad(builder_->getInt1Ty(),
+                                           variable.stored);
+        if (variable.value && variable.type != ValueType::kFunction) {
+            auto* value
+                = builder_->CreateLoad(type_(variable.type), variable.value);
+            store_output(1 + 2 * index, to_bits_({value, variable.type}));
+            store_output(2 + 2 * index, builder_->CreateZExt(stored, i64));
+        } else {
+            store_output(2 + 2 * index, builder_->getInt64(0));
+        }
+        compiled.stores.emplace_back(variable.type);
+    }
+    builder_->CreateRetVoid();
+
+    // Blocks following a return, break or continue have no predecessors.
+    for (auto& block : *function_) {
+        if (!block.getTerminator()) {
+            builder_->SetInsertPoint(&block);
+            builder_->CreateUnreachable();
+        }
+    }
+
+    if (llvm::verifyFunction(*function_)) {
+        THROW_EXCEPTION(std::logic_error(
+            fmt::format("[JIT] Generated invalid code for '{}'", symbol)));
+    }
+
+    return compiled;
+}
+
+auto CodeGenerator::operator()(bool value) const -> ReturnType {
+    return {builder_->getInt1(value), ValueType::kBool};
+}
+
+auto CodeGenerator::operator()(int64_t value) const -> ReturnType {
+    return {builder_->getInt64(static_cast<uint64_t>(value)),
+            ValueType::kInt64};
+}
+
+auto CodeGenerator::operator()(double value) const -> ReturnType {
+    return {llvm::ConstantFP::get(builder_->getDoubleTy(), value),
+            ValueType::kDouble};
+}
+
+auto CodeGenerator::operator()(const ast::Name& node) const -> ReturnType {
+    return load_name_(node.value);
+}
+
+auto CodeGenerator::operator()(const ast::String& node) const -> ReturnType {
+    return load_name_(node.value);
+}
+
+auto CodeGenerator::operator()(const ast::CompareOp& node) const
+    -> ReturnType {
+    // Mirrors the interpreter: every operand is evaluated at most once and the
+    // chain stops at the first comparison that fails.
+    auto left = visit_(node.first);
+    if (node.rest.empty()) {
+        return left;
+    }
+
+    auto* end = block_("compare.end");
+    auto incoming = std::vector<std::pair<llvm::Value*, llvm::BasicBlock*>> {};
+    for (const auto& [index, operand] : enumerate(node.rest)) {
+        auto right = visit_(operand.operand);
+        auto* result = compare_(operand.op, left, right);
+        if (static_cast<size_t>(index) + 1 == node.rest.size()) {
+            incoming.emplace_back(result, builder_->GetInsertBlock());
+            builder_->CreateBr(end);
+        } else {
+            auto* next = block_("compare.next");
+            incoming.emplace_back(builder_->getFalse(),
+                                  builder_->GetInsertBlock());
+            builder_->CreateCondBr(result, next, end);
+            builder_->SetInsertPoint(next);
+        }
+        left = right;
+    }
+
+    builder_->SetInsertPoint(end);
+    auto* phi = builder_->CreatePHI(builder_->getInt1Ty(), incoming.size());
+    for (const auto& [value, block] : incoming) {
+        phi->addIncoming(value, block);
+    }
+
+    return {phi, ValueType::kBool};
+}
+
+auto CodeGenerator::operator()(const ast::BinOp& node) const -> ReturnType {
+    auto left = visit_(node.left);
+    auto right = visit_(node.right);
+
+    return bin_op_(node.op, left, right);
+}
+
+auto CodeGenerator::operator()(const ast::UnaryOp& node) const -> ReturnType {
+    auto operand = visit_(node.operand);
+    switch (node.op) {
+        case ast::BoolOpType::kPlus: {
+            if (is_numeric(operand)) {
+                return operand;
+            }
+            break;
+        }
+        case ast::BoolOpType::kMinus: {
+            if (operand.type == ValueType::kInt64) {
+                return {builder_->CreateNeg(operand.value), operand.type};
+            } else if (operand.type == ValueType::kDouble) {
+                return {builder_->CreateFNeg(operand.value), operand.type};
+            }
+            break;
+        }
+        case ast::BoolOpType::kNot: {
+            if (operand.type == ValueType::kBool) {
+                return {builder_->CreateNot(operand.value), ValueType::kBool};
+            } else if (operand.type == ValueType::kInt64) {
+                return {builder_->CreateICmpEQ(operand.value,
+                                               builder_->getInt64(0)),
+                        ValueType::kBool};
+            } else if (operand.type == ValueType::kDouble) {
+                auto* zero = llvm::ConstantFP::get(builder_->getDoubleTy(), 0);
+                return {builder_->CreateFCmpOEQ(operand.value, zero),
+                        ValueType::kBool};
+            }
+            break;
+        }
+        case ast::BoolOpType::kDefault:
+        case ast::BoolOpType::kAnd:
+        case ast::BoolOpType::kOr: {
+            break;
+        }
+    }
+
+    THROW_EXCEPTION(CompileError(
+        fmt::format("[JIT] Unsupported unary operation on type '{}'",
+                    type_name(operand.type))));
+}
+
+auto CodeGenerator::operator()(const ast::BoolOp& node) const -> ReturnType {
+    if (node.op != ast::BoolOpType::kAnd && node.op != ast::BoolOpType::kOr) {
+        THROW_EXCEPTION(CompileError("[JIT] Unsupported boolean operation"));
+    }
+
+    // Both operators short-circuit and always produce a boolean.
+    auto is_and = node.op == ast::BoolOpType::kAnd;
+    auto* end = block_(is_and ? "and.end" : "or.end");
+    auto incoming = std::vector<std::pair<llvm::Value*, llvm::BasicBlock*>> {};
+    for (const auto& operand : node.operands) {
+        auto* flag = condition_(visit_(operand));
+        auto* next = block_(is_and ? "and.next" : "or.next");
+        incoming.emplace_back(builder_->getInt1(!is_and),
+                              builder_->GetInsertBlock());
+        if (is_and) {
+            builder_->CreateCondBr(flag, next, end);
+        } else {
+            builder_->CreateCondBr(flag, end, next);
+        }
+        builder_->SetInsertPoint(next);
+    }
+    incoming.emplace_back(builder_->getInt1(is_and),
+                          builder_->GetInsertBlock());
+    builder_->CreateBr(end);
+
+    builder_->SetInsertPoint(end);
+    auto* phi = builder_->CreatePHI(builder_->getInt1Ty(), incoming.size());
+    for (const auto& [value, block] : incoming) {
+        phi->addIncoming(value, block);
+    }
+
+    return {phi, ValueType::kBool};
+}
+
+auto CodeGenerator::operator()(const ast::Call& node) const -> ReturnType {
+    if (auto builtin = parser::builtin_function_of(node.name)) {
+        return builtin_(*builtin, node);
+    }
+
+    const auto& name = node.name.value;
+    auto index = indices_.find(name);
+    auto callee = callees_->find(name);
+    if (params_.contains(name) || index == indices_.end()
+        || variables_[index->second].type != ValueType::kFunction
+        || callee == callees_->end()) {
+        THROW_EXCEPTION(
+            CompileError(fmt::format("[JIT] Cannot call '{}'", name)));
+    }
+
+    const auto& function = callee->second;
+    if (function.params.size() != node.args.size()) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] '{}' takes {} arguments but {} were given", name,
+            function.params.size(), node.args.size())));
+    }
+    if (inlined_.size() >= kMaxInlineDepth
+        || std::find(inlined_.begin(), inlined_.end(), name)
+               != inlined_.end()) {
+        THROW_EXCEPTION(CompileError(
+            fmt::format("[JIT] Cannot inline the recursive call to '{}'",
+                        name)));
+    }
+
+    auto args = std::unordered_map<std::string, TypedValue> {};
+    for (const auto& [position, arg] : enumerate(node.args)) {
+        args[function.params[position]] = visit_(arg);
+    }
+
+    // The callee runs in the caller's function with its own parameters and
+    // return target. Free names are globals, so they are shared.
+    auto* end = block_("call.end");
+    auto caller_params = std::exchange(params_, std::move(args));
+    auto caller_loops = std::exchange(loops_, {});
+    auto* caller_result = std::exchange(
+        result_, alloca_(builder_->getInt64Ty(), name + ".result"));
+    auto caller_result_type = std::exchange(result_type_, std::nullopt);
+    auto* caller_exit = std::exchange(exit_, end);
+    auto caller_exit_defined = std::exchange(exit_defined_, std::nullopt);
+    inlined_.emplace_back(name);
+
+    emit_statement_(*function.body);
+    if (reachable_) {
+        (*this)(ast::ReturnStatement {});
+    }
+
+    builder_->SetInsertPoint(end);
+    auto value = TypedValue {nullptr, result_type_.value_or(ValueType::kNull)};
+    if (value.type != ValueType::kNull) {
+        value.value = from_bits_(
+            builder_->CreateLoad(builder_->getInt64Ty(), result_), value.type);
+    }
+    reachable_ = exit_defined_.has_value();
+    if (exit_defined_) {
+        defined_ = std::move(*exit_defined_);
+    }
+
+    inlined_.pop_back();
+    params_ = std::move(caller_params);
+    loops_ = std::move(caller_loops);
+    result_ = caller_result;
+    result_type_ = caller_result_type;
+    exit_ = caller_exit;
+    exit_defined_ = std::move(caller_exit_defined);
+
+    return value;
+}
+
+auto CodeGenerator::operator()(const ast::Argument& node) const
+    -> ReturnType {
+    return visit_(node.arg);
+}
+
+auto CodeGenerator::operator()(const ast::KeywordArgument& node) const
+    -> ReturnType {
+    return visit_(node.arg);
+}
+
+auto CodeGenerator::operator()(const ast::Expression& node) const
+    -> ReturnType {
+    return visit_(node.expr);
+}
+
+auto CodeGenerator::operator()(const ast::AssignStatement& node) const
+    -> ReturnType {
+    store_name_(node.target, visit_(node.expr));
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::AugAssignStatement& node) const
+    -> ReturnType {
+    const auto& name = ast::get<ast::Name>(node.target).value;
+    auto left = load_name_(name);
+    auto right = visit_(node.expr);
+    store_name_(node.target, bin_op_(node.op, left, right));
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::ReturnStatement& node) const
+    -> ReturnType {
+    auto value = TypedValue {nullptr, ValueType::kNull};
+    if (node.expr) {
+        value = visit_(*node.expr);
+    }
+
+    if (result_type_ && *result_type_ != value.type) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Function returns both '{}' and '{}'",
+            type_name(*result_type_), type_name(value.type))));
+    }
+    result_type_ = value.type;
+    if (exit_defined_) {
+        for (size_t i = 0; i < defined_.size(); ++i) {
+            (*exit_defined_)[i] = (*exit_defined_)[i] && defined_[i];
+        }
+    } else {
+        exit_defined_ = defined_;
+    }
+
+    builder_->CreateStore(to_bits_(value), result_);
+    builder_->CreateBr(exit_);
+    reachable_ = false;
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::StatementList& node) const
+    -> ReturnType {
+    for (const auto& stmt : node.stmts) {
+        emit_statement_(stmt);
+    }
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::IfStatement& node) const
+    -> ReturnType {
+    auto* flag = condition_(visit_(node.condition));
+
+    auto has_else = !ast::holds_alternative<ast::MonoState>(node.or_else);
+    auto* then_block = block_("if.then");
+    auto* else_block = has_else ? block_("if.else") : nullptr;
+    auto* end = block_("if.end");
+    builder_->CreateCondBr(flag, then_block, has_else ? else_block : end);
+
+    auto defined = defined_;
+
+    builder_->SetInsertPoint(then_block);
+    emit_statement_(node.body);
+    auto then_reachable = reachable_;
+    auto then_defined = std::move(defined_);
+    if (then_reachable) {
+        builder_->CreateBr(end);
+    }
+
+    auto else_reachable = true;
+    auto else_defined = defined;
+    if (has_else) {
+        builder_->SetInsertPoint(else_block);
+        reachable_ = true;
+        defined_ = defined;
+        emit_statement_(node.or_else);
+        else_reachable = reachable_;
+        else_defined = std::move(defined_);
+        if (else_reachable) {
+            builder_->CreateBr(end);
+        }
+    }
+
+    builder_->SetInsertPoint(end);
+    reachable_ = then_reachable || else_reachable;
+    if (then_reachable && else_reachable) {
+        for (size_t i = 0; i < defined.size(); ++i) {
+            defined[i] = then_defined[i] && else_defined[i];
+        }
+        defined_ = std::move(defined);
+    } else if (then_reachable) {
+        defined_ = std::move(then_defined);
+    } else if (else_reachable) {
+        defined_ = std::move(else_defined);
+    } else {
+        defined_ = std::move(defined);
+    }
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::ForStatement& node) const
+    -> ReturnType {
+    emit_statement_(node.init);
+    if (!reachable_) {
+        return {};
+    }
+
+    // Nothing assigned in the body or the iteration is known to be set after
+    // the loop, as the body may run zero times.
+    auto defined = defined_;
+    auto* condition = block_("for.cond");
+    auto* body = block_("for.body");
+    auto* next = block_("for.next");
+    auto* end = block_("for.end");
+    builder_->CreateBr(condition);
+
+    builder_->SetInsertPoint(condition);
+    builder_->CreateCondBr(condition_(visit_(node.condition)), body, end);
+
+    builder_->SetInsertPoint(body);
+    loops_.emplace_back(Loop {end, next});
+    emit_statement_(node.body);
+    loops_.pop_back();
+    if (reachable_) {
+        builder_->CreateBr(next);
+    }
+
+    builder_->SetInsertPoint(next);
+    reachable_ = true;
+    defined_ = defined;
+    emit_statement_(node.iter);
+    if (reachable_) {
+        builder_->CreateBr(condition);
+    }
+
+    builder_->SetInsertPoint(end);
+    reachable_ = true;
+    defined_ = std::move(defined);
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::WhileStatement& node) const
+    -> ReturnType {
+    auto defined = defined_;
+    auto* condition = block_("while.cond");
+    auto* body = block_("while.body");
+    auto* end = block_("while.end");
+    builder_->CreateBr(condition);
+
+    builder_->SetInsertPoint(condition);
+    builder_->CreateCondBr(condition_(visit_(node.condition)), body, end);
+
+    builder_->SetInsertPoint(body);
+    loops_.emplace_back(Loop {end, condition});
+    emit_statement_(node.body);
+    loops_.pop_back();
+    if (reachable_) {
+        builder_->CreateBr(condition);
+    }
+
+    builder_->SetInsertPoint(end);
+    reachable_ = true;
+    defined_ = std::move(defined);
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::Pass& node) const -> ReturnType {
+    (void)node;
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::Break& node) const -> ReturnType {
+    (void)node;
+
+    if (loops_.empty()) {
+        THROW_EXCEPTION(CompileError("[JIT] 'break' outside loop"));
+    }
+    builder_->CreateBr(loops_.back().exit);
+    reachable_ = false;
+
+    return {};
+}
+
+auto CodeGenerator::operator()(const ast::Continue& node) const
+    -> ReturnType {
+    (void)node;
+
+    if (loops_.empty()) {
+        THROW_EXCEPTION(CompileError("[JIT] 'continue' outside loop"));
+    }
+    builder_->CreateBr(loops_.back().next);
+    reachable_ = false;
+
+    return {};
+}
+
+void CodeGenerator::emit_statement_(const ast::Value& node) const {
+    // Statements after a return, break or continue are never executed.
+    if (reachable_) {
+        visit_(node);
+    }
+}
+
+auto CodeGenerator::load_name_(const std::string& name) const -> ReturnType {
+    if (auto it = params_.find(name); it != params_.end()) {
+        return it->second;
+    }
+
+    auto index = indices_.at(name);
+    if (variables_[index].type == ValueType::kFunction) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Function '{}' can only be called", name)));
+    }
+    if (!defined_[index]) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Name '{}' may be read before it is assigned", name)));
+    }
+
+    const auto& variable = variables_[index];
+    return {builder_->CreateLoad(type_(variable.type), variable.value),
+            variable.type};
+}
+
+void CodeGenerator::store_name_(const ast::Value& target,
+                                TypedValue value) const {
+    const auto& name = ast::get<ast::Name>(target).value;
+    auto index = indices_.at(name);
+    auto& variable = variables_[index];
+    if (variable.type == ValueType::kUndefined) {
+        variable.type = value.type;
+        variable.value = alloca_(type_(value.type), name);
+    } else if (variable.type != value.type) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Name '{}' holds both '{}' and '{}'", name,
+            type_name(variable.type), type_name(value.type))));
+    }
+
+    builder_->CreateStore(value.value, variable.value);
+    builder_->CreateStore(builder_->getTrue(), variable.stored);
+    defined_[index] = true;
+}
+
+auto CodeGenerator::bin_op_(ast::BinOpType op, TypedValue left,
+                            TypedValue right) const -> ReturnType {
+    if (!is_numeric(left) || !is_numeric(right)) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Unsupported binary operation on types '{}' and '{}'",
+            type_name(left.type), type_name(right.type))));
+    }
+
+    // The integer cases follow C++: true division of two integers truncates
+    // and mixed operands are promoted to double.
+    auto integral = left.type == ValueType::kInt64
+                    && right.type == ValueType::kInt64;
+    auto* lhs = integral ? left.value : to_double_(left);
+    auto* rhs = integral ? right.value : to_double_(right);
+    auto type = integral ? ValueType::kInt64 : ValueType::kDouble;
+    switch (op) {
+        case ast::BinOpType::kAdd: {
+            return {integral ? builder_->CreateAdd(lhs, rhs)
+                             : builder_->CreateFAdd(lhs, rhs),
+                    type};
+        }
+        case ast::BinOpType::kSub: {
+            return {integral ? builder_->CreateSub(lhs, rhs)
+                             : builder_->CreateFSub(lhs, rhs),
+                    type};
+        }
+        case ast::BinOpType::kMult: {
+            return {integral ? builder_->CreateMul(lhs, rhs)
+                             : builder_->CreateFMul(lhs, rhs),
+                    type};
+        }
+        case ast::BinOpType::kTrueDiv: {
+            return {integral ? builder_->CreateSDiv(lhs, rhs)
+                             : builder_->CreateFDiv(lhs, rhs),
+                    type};
+        }
+        case ast::BinOpType::kFloorDiv: {
+            if (integral) {
+                return {builder_->CreateSDiv(lhs, rhs), ValueType::kInt64};
+            }
+            return {builder_->CreateFPToSI(builder_->CreateFDiv(lhs, rhs),
+                                           builder_->getInt64Ty()),
+                    ValueType::kInt64};
+        }
+        case ast::BinOpType::kMod: {
+            return {integral ? builder_->CreateSRem(lhs, rhs)
+                             : builder_->CreateFRem(lhs, rhs),
+                    type};
+        }
+        case ast::BinOpType::kPow: {
+            return {pow_(left, right), ValueType::kDouble};
+        }
+        case ast::BinOpType::kNone: {
+            break;
+        }
+    }
+
+    THROW_EXCEPTION(CompileError("[JIT] Unsupported binary operation"));
+}
+
+auto CodeGenerator::builtin_(parser::BuiltinFunction function,
+                             const ast::Call& node) const -> ReturnType {
+    const auto name
+        = parser::kBuiltinFunctionNames[static_cast<size_t>(function)];
+    if (!is_native(function)) {
+        THROW_EXCEPTION(
+            CompileError(fmt::format("[JIT] Cannot call '{}'", name)));
+    }
+
+    // Lists are left to the interpreters, like wrong argument counts.
+    auto args = std::vector<TypedValue> {};
+    for (const auto& arg : node.args) {
+        args.emplace_back(visit_(arg));
+        if (!is_numeric(args.back())) {
+            THROW_EXCEPTION(CompileError(fmt::format(
+                "[JIT] Unsupported call to '{}' with an argument of type '{}'",
+                name, type_name(args.back().type))));
+        }
+    }
+    auto arity = size_t {function == parser::BuiltinFunction::kPow ? 2u : 1u};
+    auto variadic = function == parser::BuiltinFunction::kMin
+                    || function == parser::BuiltinFunction::kMax;
+    if (args.size() < arity || (!variadic && args.size() != arity)) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Wrong number of arguments to '{}'", name)));
+    }
+
+    auto unary = [&](llvm::Intrinsic::ID id) {
+        auto* intrinsic = llvm::Intrinsic::getDeclaration(
+            &module_, id, {builder_->getDoubleTy()});
+        return TypedValue {builder_->CreateCall(intrinsic,
+                                                {to_double_(args[0])}),
+                           ValueType::kDouble};
+    };
+    switch (function) {
+        case parser::BuiltinFunction::kSqrt: {
+            return unary(llvm::Intrinsic::sqrt);
+        }
+        case parser::BuiltinFunction::kExp: {
+            return unary(llvm::Intrinsic::exp);
+        }
+        case parser::BuiltinFunction::kLog: {
+            return unary(llvm::Intrinsic::log);
+        }
+        case parser::BuiltinFunction::kPow: {
+            return {pow_(args[0], args[1]), ValueType::kDouble};
+        }
+        case parser::BuiltinFunction::kAbs: {
+            if (args[0].type == ValueType::kDouble) {
+                return unary(llvm::Intrinsic::fabs);
+            }
+            // The least int64 wraps around, as in the interpreters.
+            auto* abs = llvm::Intrinsic::getDeclaration(
+                &module_, llvm::Intrinsic::abs, {builder_->getInt64Ty()});
+            return {builder_->CreateCall(abs,
+                                         {args[0].value, builder_->getFalse()}),
+                    ValueType::kInt64};
+        }
+        default: {
+            auto max = function == parser::BuiltinFunction::kMax;
+            auto best = args[0];
+            for (size_t index = 1; index < args.size(); ++index) {
+                best = extremum_(max, best, args[index]);
+            }
+            return best;
+        }
+    }
+}
+
+llvm::Value* CodeGenerator::pow_(TypedValue base, TypedValue exponent) const {
+    // Squares are multiplied out, as interpreter::power() does.
+    auto* x = to_double_(base);
+    auto* y = to_double_(exponent);
+    auto* pow = llvm::Intrinsic::getDeclaration(&module_, llvm::Intrinsic::pow,
+                                                {builder_->getDoubleTy()});
+    auto* two = llvm::ConstantFP::get(builder_->getDoubleTy(), 2.0);
+
+    return builder_->CreateSelect(builder_->CreateFCmpOEQ(y, two),
+                                  builder_->CreateFMul(x, x),
+                                  builder_->CreateCall(pow, {x, y}));
+}
+
+auto CodeGenerator::extremum_(bool max, TypedValue best,
+                              TypedValue value) const -> ReturnType {
+    // Same as the interpreters: integers stay integers, anything else is
+    // compared as doubles, and a NaN wins.
+    if (best.type == ValueType::kInt64 && value.type == ValueType::kInt64) {
+        auto* replaces = max ? builder_->CreateICmpSGT(value.value, best.value)
+                             : builder_->CreateICmpSLT(value.value, best.value);
+        return {builder_->CreateSelect(replaces, value.value, best.value),
+                ValueType::kInt64};
+    }
+
+    auto* lhs = to_double_(best);
+    auto* rhs = to_double_(value);
+    auto* ordered = max ? builder_->CreateFCmpOGT(rhs, lhs)
+                        : builder_->CreateFCmpOLT(rhs, lhs);
+    auto* replaces
+        = builder_->CreateOr(ordered, builder_->CreateFCmpUNO(rhs, rhs));
+    return {builder_->CreateSelect(replaces, rhs, lhs), ValueType::kDouble};
+}
+
+llvm::Value* CodeGenerator::compare_(ast::CompareOpType op, TypedValue left,
+                                     TypedValue right) const {
+    if (!is_numeric(left) || !is_numeric(right)) {
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Unsupported comparison of types '{}' and '{}'",
+            type_name(left.type), type_name(right.type))));
+    }
+
+    if (left.type == ValueType::kInt64 && right.type == ValueType::kInt64) {
+        switch (op) {
+            case ast::CompareOpType::kEQ: {
+                return builder_->CreateICmpEQ(left.value, right.value);
+            }
+            case ast::CompareOpType::kNEQ: {
+                return builder_->CreateICmpNE(left.value, right.value);
+            }
+            case ast::CompareOpType::kLT: {
+                return builder_->CreateICmpSLT(left.value, right.value);
+            }
+            case ast::CompareOpType::kLTE: {
+                return builder_->CreateICmpSLE(left.value, right.value);
+            }
+            case ast::CompareOpType::kGT: {
+                return builder_->CreateICmpSGT(left.value, right.value);
+            }
+            case ast::CompareOpType::kGTE: {
+                return builder_->CreateICmpSGE(left.value, right.value);
+            }
+            case ast::CompareOpType::kNone:
+            case ast::CompareOpType::kIn:
+            case ast::CompareOpType::kNotIn: {
+                break;
+            }
+        }
+    } else {
+        auto* lhs = to_double_(left);
+        auto* rhs = to_double_(right);
+        switch (op) {
+            case ast::CompareOpType::kEQ: {
+                return builder_->CreateFCmpOEQ(lhs, rhs);
+            }
+            case ast::CompareOpType::kNEQ: {
+                return builder_->CreateFCmpUNE(lhs, rhs);
+            }
+            case ast::CompareOpType::kLT: {
+                return builder_->CreateFCmpOLT(lhs, rhs);
+            }
+            case ast::CompareOpType::kLTE: {
+                return builder_->CreateFCmpOLE(lhs, rhs);
+            }
+            case ast::CompareOpType::kGT: {
+                return builder_->CreateFCmpOGT(lhs, rhs);
+            }
+            case ast::CompareOpType::kGTE: {
+                return builder_->CreateFCmpOGE(lhs, rhs);
+            }
+            case ast::CompareOpType::kNone:
+            case ast::CompareOpType::kIn:
+            case ast::CompareOpType::kNotIn: {
+                break;
+            }
+        }
+    }
+
+    THROW_EXCEPTION(CompileError("[JIT] Unsupported comparison"));
+}
+
+llvm::Value* CodeGenerator::condition_(TypedValue value) const {
+    // Same truth table as interpreter::check_branch_condition().
+    switch (value.type) {
+        case ValueType::kNull: {
+            return builder_->getFalse();
+        }
+        case ValueType::kBool: {
+            return value.value;
+        }
+        case ValueType::kInt64: {
+            return builder_->CreateICmpNE(value.value, builder_->getInt64(0));
+        }
+        case ValueType::kDouble: {
+            auto* zero = llvm::ConstantFP::get(builder_->getDoubleTy(), 0);
+            return builder_->CreateFCmpUNE(value.value, zero);
+        }
+        case ValueType::kUndefined:
+        case ValueType::kFunction: {
+            break;
+        }
+    }
+
+    THROW_EXCEPTION(CompileError("[JIT] Unsupported branch condition"));
+}
+
+llvm::Type* CodeGenerator::type_(ValueType type) const {
+    switch (type) {
+        case ValueType::kBool: {
+            return builder_->getInt1Ty();
+        }
+        case ValueType::kInt64: {
+            return builder_->getInt64Ty();
+        }
+        case ValueType::kDouble: {
+            return builder_->getDoubleTy();
+        }
+        case ValueType::kUndefined:
+        case ValueType::kNull:
+        case ValueType::kFunction: {
+            break;
+        }
+    }
+
+    THROW_EXCEPTION(CompileError(fmt::format(
+        "[JIT] Values of type '{}' cannot be stored", type_name(type))));
+}
+
+llvm::AllocaInst* CodeGenerator::alloca_(llvm::Type* type,
+                                         const std::string& name) const {
+    // Keep every slot in the entry block so that they are promoted to
+    // registers.
+    auto& entry = function_->getEntryBlock();
+    auto builder = llvm::IRBuilder<> {&entry, entry.begin()};
+
+    return builder.CreateAlloca(type, nullptr, name);
+}
+
+llvm::Value* CodeGenerator::to_bits_(TypedValue value) const {
+    switch (value.type) {
+        case ValueType::kBool: {
+            return builder_->CreateZExt(value.value, builder_->getInt64Ty());
+        }
+        case ValueType::kInt64: {
+            return value.value;
+        }
+        case ValueType::kDouble: {
+            return builder_->CreateBitCast(value.value, builder_->getInt64Ty());
+        }
+        case ValueType::kUndefined:
+        case ValueType::kNull:
+        case ValueType::kFunction: {
+            break;
+        }
+    }
+
+    return builder_->getInt64(0);
+}
+
+llvm::Value* CodeGenerator::from_bits_(llvm::Value* bits,
+                                       ValueType type) const {
+    switch (type) {
+        case ValueType::kBool: {
+            return builder_->CreateICmpNE(bits, builder_->getInt64(0));
+        }
+        case ValueType::kInt64: {
+            return bits;
+        }
+        case ValueType::kDouble: {
+            return builder_->CreateBitCast(bits, builder_->getDoubleTy());
+        }
+        case ValueType::kUndefined:
+        case ValueType::kNull:
+        case ValueType::kFunction: {
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+llvm::Value* CodeGenerator::to_double_(TypedValue value) const {
+    if (value.type == ValueType::kInt64) {
+        return builder_->CreateSIToFP(value.value, builder_->getDoubleTy());
+    }
+
+    return value.value;
+}
+
+llvm::BasicBlock* CodeGenerator::block_(const std::string& name) const {
+    return llvm::BasicBlock::Create(context_, name, function_);
+}
+
+}    // namespace expressions::jit
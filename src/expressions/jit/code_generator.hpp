@@ -0,0 +1,239 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_JIT_CODE_GENERATOR_HPP__
+#define __EXPRESSIONS_JIT_CODE_GENERATOR_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/jit/jit_compiler.hpp>
+#include <expressions/parser/transform/scope_resolver.hpp>
+
+#include <expressions/exception/throw_exception.hpp>
+#include <expressions/support/boost/variant.hpp>
+
+#include <fmt/format.h>
+#include <boost/type_index.hpp>
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace expressions::jit {
+
+// Collects the free names and the callees of a function body and checks that
+// every node in it is supported by the CodeGenerator.
+class FunctionAnalyzer : public boost::static_visitor<void> {
+public:
+    explicit FunctionAnalyzer(const std::vector<std::string>& params)
+        : params_ {params} {}
+
+    using ReturnType = void;
+
+    auto analyze(const ast::Value& body) const
+        -> std::optional<FunctionAnalysis>;
+
+public:
+    template<typename T>
+    ReturnType operator()(const T& node) const {
+        (void)node;
+        supported_ = false;
+    }
+    template<typename T>
+    ReturnType operator()(const boost::spirit::x3::forward_ast<T>& node) const {
+        (*this)(node.get());
+    }
+
+    ReturnType operator()(bool value) const;
+    ReturnType operator()(int64_t value) const;
+    ReturnType operator()(double value) const;
+
+    ReturnType operator()(const ast::Name& node) const;
+    ReturnType operator()(const ast::String& node) const;
+
+    ReturnType operator()(const ast::CompareOp& node) const;
+    ReturnType operator()(const ast::BinOp& node) const;
+    ReturnType operator()(const ast::UnaryOp& node) const;
+    ReturnType operator()(const ast::BoolOp& node) const;
+
+    ReturnType operator()(const ast::Call& node) const;
+    ReturnType operator()(const ast::Argument& node) const;
+    ReturnType operator()(const ast::KeywordArgument& node) const;
+
+    ReturnType operator()(const ast::Expression& node) const;
+    ReturnType operator()(const ast::AssignStatement& node) const;
+    ReturnType operator()(const ast::AugAssignStatement& node) const;
+    ReturnType operator()(const ast::ReturnStatement& node) const;
+    ReturnType operator()(const ast::StatementList& node) const;
+
+    ReturnType operator()(const ast::IfStatement& node) const;
+    ReturnType operator()(const ast::ForStatement& node) const;
+    ReturnType operator()(const ast::WhileStatement& node) const;
+
+    ReturnType operator()(const ast::Pass& node) const;
+    ReturnType operator()(const ast::Break& node) const;
+    ReturnType operator()(const ast::Continue& node) const;
+
+private:
+    void visit_(const ast::Value& node) const {
+        if (supported_) {
+            node.apply_visitor(*this);
+        }
+    }
+    void read_(const std::string& name) const;
+    void write_(const ast::Value& target) const;
+    static void add_name_(std::vector<std::string>& names,
+                          const std::string& name);
+private:
+    const std::vector<std::string>& params_;
+
+    mutable bool supported_ = true;
+    mutable FunctionAnalysis analysis_ {};
+};
+
+struct TypedValue {
+    llvm::Value* value = nullptr;
+    ValueType type {ValueType::kUndefined};
+};
+
+// Lowers a function body into an LLVM function with the EntryPoint calling
+// convention. Types are resolved while generating: every parameter and free
+// name has exactly one type, and a name must be assigned on every path before
+// it is read unless the caller passed a value for it. Calls are inlined, so
+// the callees see the argument types of each call site.
+class CodeGenerator : public boost::static_visitor<TypedValue> {
+public:
+    CodeGenerator(llvm::LLVMContext& context, llvm::Module& module)
+        : context_ {context}, module_ {module} {}
+
+    using ReturnType = TypedValue;
+
+    // Throws CompileError if the body cannot be compiled for the signature.
+    auto generate(
+        const std::string& symbol, const FunctionSource& function,
+        const std::unordered_map<std::string, FunctionSource>& callees,
+        const std::vector<std::string>& names,
+        std::span<const ValueType> signature) const -> CompiledFunction;
+
+public:
+    template<typename T>
+    ReturnType operator()(const T& node) const {
+        auto name = boost::typeindex::type_id<decltype(node)>().pretty_name();
+        THROW_EXCEPTION(CompileError(fmt::format(
+            "[JIT] Cannot compile the AST node type '{}'", name)));
+    }
+    template<typename T>
+    ReturnType operator()(const boost::spirit::x3::forward_ast<T>& node) const {
+        return (*this)(node.get());
+    }
+
+    ReturnType operator()(bool value) const;
+    ReturnType operator()(int64_t value) const;
+    ReturnType operator()(double value) const;
+
+    ReturnType operator()(const ast::Name& node) const;
+    ReturnType operator()(const ast::String& node) const;
+
+    ReturnType operator()(const ast::CompareOp& node) const;
+    ReturnType operator()(const ast::BinOp& node) const;
+    ReturnType operator()(const ast::UnaryOp& node) const;
+    ReturnType operator()(const ast::BoolOp& node) const;
+
+    ReturnType operator()(const ast::Call& node) const;
+    ReturnType operator()(const ast::Argument& node) const;
+    ReturnType operator()(const ast::KeywordArgument& node) const;
+
+    ReturnType operator()(const ast::Expression& node) const;
+    ReturnType operator()(const ast::AssignStatement& node) const;
+    ReturnType operator()(const ast::AugAssignStatement& node) const;
+    ReturnType operator()(const ast::ReturnStatement& node) const;
+    ReturnType operator()(const ast::StatementList& node) const;
+
+    ReturnType operator()(const ast::IfStatement& node) const;
+    ReturnType operator()(const ast::ForStatement& node) const;
+    ReturnType operator()(const ast::WhileStatement& node) const;
+
+    ReturnType operator()(const ast::Pass& node) const;
+    ReturnType operator()(const ast::Break& node) const;
+    ReturnType operator()(const ast::Continue& node) const;
+
+private:
+    // Upper bound of nested inlined calls.
+    static constexpr size_t kMaxInlineDepth = 16;
+
+    struct Variable {
+        ValueType type {ValueType::kUndefined};
+        llvm::AllocaInst* value = nullptr;
+        llvm::AllocaInst* stored = nullptr;
+    };
+
+    struct Loop {
+        llvm::BasicBlock* exit = nullptr;
+        llvm::BasicBlock* next = nullptr;
+    };
+
+    ReturnType visit_(const ast::Value& node) const {
+        return node.apply_visitor(*this);
+    }
+    void emit_statement_(const ast::Value& node) const;
+
+    ReturnType load_name_(const std::string& name) const;
+    void store_name_(const ast::Value& target, TypedValue value) const;
+    ReturnType bin_op_(ast::BinOpType op, TypedValue left,
+                       TypedValue right) const;
+    ReturnType builtin_(parser::BuiltinFunction function,
+                        const ast::Call& node) const;
+    llvm::Value* pow_(TypedValue base, TypedValue exponent) const;
+    ReturnType extremum_(bool max, TypedValue best, TypedValue value) const;
+    llvm::Value* compare_(ast::CompareOpType op, TypedValue left,
+                          TypedValue right) const;
+    llvm::Value* condition_(TypedValue value) const;
+
+    llvm::Type* type_(ValueType type) const;
+    llvm::AllocaInst* alloca_(llvm::Type* type, const std::string& name) const;
+    llvm::Value* to_bits_(TypedValue value) const;
+    llvm::Value* from_bits_(llvm::Value* bits, ValueType type) const;
+    llvm::Value* to_double_(TypedValue value) const;
+    llvm::BasicBlock* block_(const std::string& name) const;
+
+private:
+    llvm::LLVMContext& context_;
+    llvm::Module& module_;
+
+    mutable std::unique_ptr<llvm::IRBuilder<>> builder_ {};
+    mutable llvm::Function* function_ = nullptr;
+
+    mutable std::unordered_map<std::string, TypedValue> params_ {};
+    mutable std::unordered_map<std::string, size_t> indices_ {};
+    mutable std::vector<Variable> variables_ {};
+    // Free names holding a value on every path reaching the current point.
+    mutable std::vector<bool> defined_ {};
+    // Whether the current point can be reached at all.
+    mutable bool reachable_ = true;
+    mutable std::vector<Loop> loops_ {};
+
+    mutable const std::unordered_map<std::string, FunctionSource>* callees_ =
+        nullptr;
+    mutable std::vector<std::string> inlined_ {};
+
+    // Return target of the function being generated.
+    mutable llvm::AllocaInst* result_ = nullptr;
+    mutable std::optional<ValueType> result_type_ {};
+    mutable llvm::BasicBlock* exit_ = nullptr;
+    // Names holding a value on every return so far.
+    mutable std::optional<std::vector<bool>> exit_defined_ {};
+};
+
+}    // namespace expressions::jit
+
+#endif
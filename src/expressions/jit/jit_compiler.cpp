@@ -0,0 +1,181 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/jit/jit_compiler.hpp>
+
+#include <expressions/jit/code_generator.hpp>
+
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <atomic>
+#include <bit>
+#include <stdexcept>
+
+
+namespace expressions::jit {
+
+namespace {
+
+template<typename T>
+T unwrap(llvm::Expected<T> value) {
+    if (!value) {
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "[JIT] {}", llvm::toString(value.takeError()))));
+    }
+
+    return std::move(*value);
+}
+
+void check(llvm::Error error) {
+    if (error) {
+        THROW_EXCEPTION(std::runtime_error(
+            fmt::format("[JIT] {}", llvm::toString(std::move(error)))));
+    }
+}
+
+}    // namespace
+
+ValueType value_type_of(const interpreter::BoxedValue& value) {
+    if (ast::holds_alternative<bool>(value)) {
+        return ValueType::kBool;
+    } else if (ast::holds_alternative<int64_t>(value)) {
+        return ValueType::kInt64;
+    } else if (ast::holds_alternative<double>(value)) {
+        return ValueType::kDouble;
+    }
+
+    return ValueType::kUndefined;
+}
+
+uint64_t to_bits(const interpreter::BoxedValue& value) {
+    if (const auto* flag = boost::get<bool>(&value)) {
+        return *flag ? 1 : 0;
+    } else if (const auto* value_i64 = boost::get<int64_t>(&value)) {
+        return static_cast<uint64_t>(*value_i64);
+    } else if (const auto* value_double = boost::get<double>(&value)) {
+        return std::bit_cast<uint64_t>(*value_double);
+    }
+
+    return 0;
+}
+
+interpreter::BoxedValue from_bits(uint64_t bits, ValueType type) {
+    switch (type) {
+        case ValueType::kBool: {
+            return bits != 0;
+        }
+        case ValueType::kInt64: {
+            return static_cast<int64_t>(bits);
+        }
+        case ValueType::kDouble: {
+            return std::bit_cast<double>(bits);
+        }
+        case ValueType::kNull: {
+            return interpreter::Null {};
+        }
+        case ValueType::kUndefined:
+        case ValueType::kFunction: {
+            break;
+        }
+    }
+
+    return {};
+}
+
+struct JITCompiler::Impl {
+    std::unique_ptr<llvm::orc::LLJIT> jit {};
+    std::unique_ptr<llvm::TargetMachine> target_machine {};
+    std::atomic<uint64_t> counter = 0;
+
+    void optimize(llvm::Module& module) {
+        auto loop_analysis = llvm::LoopAnalysisManager {};
+        auto function_analysis = llvm::FunctionAnalysisManager {};
+        auto cgscc_analysis = llvm::CGSCCAnalysisManager {};
+        auto module_analysis = llvm::ModuleAnalysisManager {};
+
+        auto pass_builder = llvm::PassBuilder {target_machine.get()};
+        pass_builder.registerModuleAnalyses(module_analysis);
+        pass_builder.registerCGSCCAnalyses(cgscc_analysis);
+        pass_builder.registerFunctionAnalyses(function_analysis);
+        pass_builder.registerLoopAnalyses(loop_analysis);
+        pass_builder.crossRegisterProxies(loop_analysis, function_analysis,
+                                          cgscc_analysis, module_analysis);
+
+        auto passes = pass_builder.buildPerModuleDefaultPipeline(
+            llvm::OptimizationLevel::O2);
+        passes.run(module, module_analysis);
+    }
+};
+
+JITCompiler::JITCompiler() : impl_ {std::make_unique<Impl>()} {
+    static const auto initialized = [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        return true;
+    }();
+    (void)initialized;
+
+    auto target = unwrap(llvm::orc::JITTargetMachineBuilder::detectHost());
+    impl_->target_machine = unwrap(target.createTargetMachine());
+    impl_->jit = unwrap(
+        llvm::orc::LLJITBuilder {}.setJITTargetMachineBuilder(target).create());
+
+    // Generated code calls into libm for pow() and fmod().
+    auto prefix = impl_->jit->getDataLayout().getGlobalPrefix();
+    impl_->jit->getMainJITDylib().addGenerator(unwrap(
+        llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            prefix)));
+}
+
+JITCompiler::~JITCompiler() = default;
+
+auto JITCompiler::analyze(const std::vector<std::string>& params,
+                          const ast::Value& body)
+    -> std::optional<FunctionAnalysis> {
+    return FunctionAnalyzer {params}.analyze(body);
+}
+
+auto JITCompiler::compile(
+    const FunctionSource& function,
+    const std::unordered_map<std::string, FunctionSource>& callees,
+    const std::vector<std::string>& names,
+    std::span<const ValueType> signature) -> std::optional<CompiledFunction> {
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto module = std::make_unique<llvm::Module>(function.name, *context);
+    module->setDataLayout(impl_->jit->getDataLayout());
+    module->setTargetTriple(impl_->target_machine->getTargetTriple().str());
+
+    auto symbol = fmt::format("expressions.jit.{}", ++impl_->counter);
+    auto compiled = CompiledFunction {};
+    try {
+        auto generator = CodeGenerator {*context, *module};
+        compiled
+            = generator.generate(symbol, function, callees, names, signature);
+    } catch (const CompileError&) {
+        return std::nullopt;
+    }
+
+    impl_->optimize(*module);
+    check(impl_->jit->addIRModule(
+        llvm::orc::ThreadSafeModule {std::move(module), std::move(context)}));
+
+    auto address = unwrap(impl_->jit->lookup(symbol)).getAddress();
+    compiled.entry = reinterpret_cast<EntryPoint>(address);
+
+    return compiled;
+}
+
+}    // namespace expressions::jit
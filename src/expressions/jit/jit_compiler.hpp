@@ -0,0 +1,113 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_JIT_JIT_COMPILER_HPP__
+#define __EXPRESSIONS_JIT_JIT_COMPILER_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace expressions::jit {
+
+// Types the compiled code keeps in machine registers. Values of any other type
+// are kUndefined to the JIT: a function reading one stays on the interpreter.
+enum class ValueType : int32_t {
+    kUndefined,
+    kNull,
+    kBool,
+    kInt64,
+    kDouble,
+    // A function bound to a global. It can only be called, and the caller
+    // guarantees that the global keeps referring to the same function.
+    kFunction,
+};
+
+// Compiled code passes values as raw 64-bit words. The inputs are the
+// arguments followed by the current values of the free names, the outputs are
+// the result followed by a (value, stored) pair for every free name.
+using EntryPoint = void (*)(const uint64_t* inputs, uint64_t* outputs);
+
+struct CompiledFunction {
+    EntryPoint entry = nullptr;
+    ValueType result {ValueType::kNull};
+    // Type of each free name. Only the names whose stored flag is set in the
+    // outputs have been assigned by the call.
+    std::vector<ValueType> stores {};
+};
+
+struct FunctionSource {
+    std::string name {};
+    std::vector<std::string> params {};
+    std::shared_ptr<const ast::Value> body {};
+};
+
+struct FunctionAnalysis {
+    // Every name the body assigns and every name other than a parameter it
+    // reads, except for the names it calls.
+    std::vector<std::string> names {};
+    // Names of the functions the body calls.
+    std::vector<std::string> callees {};
+    // Whether the body contains a return statement.
+    bool returns = false;
+};
+
+// Raised by the code generator when a function cannot be compiled for the
+// requested signature. JITCompiler::compile() reports it as std::nullopt.
+class CompileError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+ValueType value_type_of(const interpreter::BoxedValue& value);
+uint64_t to_bits(const interpreter::BoxedValue& value);
+interpreter::BoxedValue from_bits(uint64_t bits, ValueType type);
+
+// Compiles function bodies to native code through LLVM ORC. A body is
+// specialized for the types of its arguments and of the globals it refers to,
+// so the generated code never checks a type at runtime.
+class JITCompiler {
+public:
+    JITCompiler();
+    ~JITCompiler();
+
+    JITCompiler(const JITCompiler&) = delete;
+    JITCompiler& operator=(const JITCompiler&) = delete;
+
+    // Returns std::nullopt if the body uses a construct the code generator
+    // does not support.
+    static auto analyze(const std::vector<std::string>& params,
+                        const ast::Value& body)
+        -> std::optional<FunctionAnalysis>;
+
+    // Calls to the functions in callees are inlined. The free names hold the
+    // names of the function and of all its callees; the signature holds the
+    // types of the params followed by the types of the free names.
+    auto compile(
+        const FunctionSource& function,
+        const std::unordered_map<std::string, FunctionSource>& callees,
+        const std::vector<std::string>& names,
+        std::span<const ValueType> signature)
+        -> std::optional<CompiledFunction>;
+
+private:
+    struct Impl;
+
+    std::unique_ptr<Impl> impl_;
+};
+
+}    // namespace expressions::jit
+
+#endif
@@ -4,8 +4,14 @@
 // Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
 //
 
+#include <expressions/closure/closure_compiler.hpp>
+#include <expressions/closure/closure_interpreter.hpp>
 #include <expressions/interpreter/ast_interpreter.hpp>
+#include <expressions/interpreter/host_functions.hpp>
+#include <expressions/jit/jit_compiler.hpp>
 #include <expressions/parser/parser.hpp>
+#include <expressions/vm/compiler.hpp>
+#include <expressions/vm/virtual_machine.hpp>
 
 #include <expressions/common/enumerate.hpp>
 #include <expressions/common/visitor.hpp>
@@ -13,19 +19,34 @@
 #include <fmt/format.h>
 #include <fmt/std.h>
 
+#include <charconv>
 #include <cstdint>
+#include <cstdio>
 #include <fstream>
+#include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 
 
 using ExitValueType = std::variant<std::monostate, bool, int32_t, int64_t,
                                    uint32_t, uint64_t, double, std::string>;
 
-auto execute_script(const std::string_view& input) -> ExitValueType {
+enum class Engine {
+    kAST,
+    kVM,
+    kJIT,
+    kTiered,
+    kClosure,
+};
+
+auto execute_script(const std::string_view& input, Engine engine,
+                    const expressions::interpreter::TierPolicy& policy)
+    -> ExitValueType {
     using namespace expressions;
 
-    auto ifs = std::ifstream {input, std::ios::in};
+    auto ifs = std::ifstream {std::string {input}, std::ios::in};
     if (!ifs.is_open()) {
         return -1;
     }
@@ -38,8 +59,38 @@ auto execute_script(const std::string_view& input) -> ExitValueType {
         return 1;
     }
 
-    auto interp = interpreter::ASTInterpreter {};
-    auto result = interp.execute(*tree);
+    // The host functions of lib/system/console that are not builtins.
+    auto hosts = std::make_shared<interpreter::HostFunctions>();
+    hosts->define("input", [](std::string_view prompt) {
+        fmt::print("{}", prompt);
+        std::fflush(stdout);
+        auto line = std::string {};
+        std::getline(std::cin, line);
+        return line;
+    });
+
+    auto result = interpreter::BoxedValue {};
+    if (engine == Engine::kVM) {
+        auto program = vm::BytecodeCompiler {hosts}.compile(*tree);
+        auto machine = vm::VirtualMachine {};
+        result = machine.execute(*program);
+    } else if (engine == Engine::kJIT) {
+        auto program = vm::BytecodeCompiler {hosts}.compile(*tree);
+        auto machine
+            = vm::VirtualMachine {std::make_shared<jit::JITCompiler>()};
+        result = machine.execute(*program);
+    } else if (engine == Engine::kClosure) {
+        auto program = closure::ClosureCompiler {hosts}.compile(*tree);
+        auto interp = closure::ClosureInterpreter {};
+        result = interp.execute(*program);
+    } else if (engine == Engine::kTiered) {
+        auto interp = interpreter::ASTInterpreter {
+            std::make_shared<jit::JITCompiler>(), policy, hosts};
+        result = interp.execute(*tree);
+    } else {
+        auto interp = interpreter::ASTInterpreter {hosts};
+        result = interp.execute(*tree);
+    }
 
     auto v = SelfVisitableVisitor {
         [](auto&&, interpreter::Null) -> ExitValueType {
@@ -61,17 +112,19 @@ auto execute_script(const std::string_view& input) -> ExitValueType {
             return value.value;
         },
         [](auto&&, const interpreter::String& value) -> ExitValueType {
-            return fmt::format("\"{}\"", value.value);
+            return fmt::format("\"{}\"", value.view());
         },
         [](auto&&, const interpreter::Date& value) -> ExitValueType {
-            return fmt::format("{:04}-{:02}-{:02}", value.year, value.month,
-                               value.day);
+            auto date = value.to_civil();
+            return fmt::format("{:04}-{:02}-{:02}", date.year, date.month,
+                               date.day);
         },
         [](auto&&, const interpreter::DateRange& value) -> ExitValueType {
+            auto begin = value.begin.to_civil();
+            auto end = value.end.to_civil();
             return fmt::format("{:04}-{:02}-{:02}-{:04}-{:02}-{:02}",
-                               value.begin.year, value.begin.month,
-                               value.begin.day, value.end.year, value.end.month,
-                               value.end.day);
+                               begin.year, begin.month, begin.day, end.year,
+                               end.month, end.day);
         },
         [](auto&& self, const interpreter::Tuple<interpreter::BoxedValue>& c)
             -> ExitValueType {
@@ -93,11 +146,13 @@ auto execute_script(const std::string_view& input) -> ExitValueType {
             auto buffer = fmt::memory_buffer {};
             auto output = std::back_inserter(buffer);
             fmt::format_to(output, "[");
-            for (const auto& [index, item] : enumerate(c)) {
+            // Unboxed elements are boxed on access, so they are read by
+            // value rather than through enumerate().
+            for (size_t index = 0; index < c.size(); ++index) {
                 if (index > 0) {
                     fmt::format_to(output, ", ");
                 }
-                fmt::format_to(output, "{}", self.visit(item));
+                fmt::format_to(output, "{}", self.visit(c.get()[index]));
             }
             fmt::format_to(output, "]");
 
@@ -137,14 +192,46 @@ auto execute_script(const std::string_view& input) -> ExitValueType {
 }
 
 int main(int argc, const char* argv[]) {
-    if (argc < 2) {
-        fmt::print("Usage: expressions <filename>\n");
+    auto engine = Engine::kAST;
+    auto policy = expressions::interpreter::TierPolicy {};
+    auto filename = std::string_view {};
+    for (auto i = 1; i < argc; ++i) {
+        auto arg = std::string_view {argv[i]};
+        if (arg == "--engine=ast") {
+            engine = Engine::kAST;
+        } else if (arg == "--engine=vm") {
+            engine = Engine::kVM;
+        } else if (arg == "--engine=jit") {
+            engine = Engine::kJIT;
+        } else if (arg == "--engine=closure") {
+            engine = Engine::kClosure;
+        } else if (arg == "--engine=tiered") {
+            engine = Engine::kTiered;
+        } else if (arg.starts_with("--tier-threshold=")) {
+            auto value = arg.substr(arg.find('=') + 1);
+            auto threshold = uint32_t {};
+            auto [end, error] = std::from_chars(
+                value.data(), value.data() + value.size(), threshold);
+            if (error != std::errc {} || end != value.data() + value.size()) {
+                fmt::print("Invalid tier threshold: {}\n", value);
+                return 1;
+            }
+            policy.call_threshold = threshold;
+            policy.loop_threshold = threshold;
+        } else {
+            filename = arg;
+        }
+    }
+    if (filename.empty()) {
+        fmt::print(
+            "Usage: expressions [--engine=ast|vm|jit|tiered|closure] "
+            "[--tier-threshold=N] <filename>\n");
         return 1;
     }
 
-    fmt::print("Executing {}...\n\n", argv[1]);
-    auto result = execute_script(argv[1]);
-    fmt::print("\n{} has exited with code {}.\n", argv[1], result);
+    fmt::print("Executing {}...\n\n", filename);
+    auto result = execute_script(filename, engine, policy);
+    fmt::print("\n{} has exited with code {}.\n", filename, result);
 
     return 0;
 }
@@ -94,6 +94,8 @@ using aug_assign_statement_type
 
 using return_statement_type
     = rule<struct return_statement_class, ast::ReturnStatement>;
+using yield_statement_type
+    = rule<struct yield_statement_class, ast::YieldStatement>;
 using pass_statement_type = rule<struct pass_statement_class, ast::Pass>;
 using break_statement_type = rule<struct break_statement_class, ast::Break>;
 using continue_statement_type
@@ -173,6 +175,7 @@ static const aug_assign_statement_type aug_assign_statement {
     "aug_assign_statement"};
 
 static const return_statement_type return_statement {"return_statement"};
+static const yield_statement_type yield_statement {"yield_statement"};
 static const pass_statement_type pass_statement {"pass_statement"};
 static const break_statement_type break_statement {"break_statement"};
 static const continue_statement_type continue_statement {"continue_statement"};
@@ -360,7 +363,7 @@ static const auto statement_list_def
 
 static const auto compound_statement_def
     = import_package
-    // | extern_function_decl
+    | extern_function_decl
     | function_def
     | if_statement
     | for_statement
@@ -384,13 +387,16 @@ static const auto decorators
     = +('@' > id)
     ;
 
+// A declaration has no body, which tells it apart from a function definition
+// up to its end. The last parameter may be variadic, as in `args...`.
 static const auto extern_function_decl_raw
-    = x3::distinct("extern") >> x3::distinct("def") >> id
+    = -x3::distinct("extern") >> x3::distinct("def") >> id
         >> x3::confix('(', ')')[-argument_list] >> -("->" >> id)
+        >> !x3::lit('{') >> *x3::lit(';')
     ;
 
 static const auto extern_function_decl_def
-    = decorators > extern_function_decl_raw
+    = (decorators >> extern_function_decl_raw)
     | x3::attr(std::vector<ast::Name> {}) >> extern_function_decl_raw
     ;
 
@@ -400,7 +406,7 @@ static const auto function_def_raw
     ;
 
 static const auto function_def_def
-    = decorators > function_def_raw
+    = (decorators > function_def_raw)
     | x3::attr(std::vector<ast::Name> {}) >> function_def_raw
     ;
 
@@ -458,6 +464,7 @@ static const auto simple_statement_def
     = assign_statement
     | lazy_assign_statement
     | aug_assign_statement
+    | yield_statement
     | expression
     | return_statement
     | pass_statement
@@ -482,6 +489,10 @@ static const auto return_statement_def
     = x3::distinct("return") >> -expression >> *x3::lit(';')
     ;
 
+static const auto yield_statement_def
+    = x3::distinct("yield") >> -expression >> *x3::lit(';')
+    ;
+
 static const auto pass_statement_def
     = x3::distinct("pass") >> *x3::lit(';')
     ;
@@ -789,11 +800,11 @@ BOOST_SPIRIT_DEFINE(entry, package_name, compound_statement, simple_statement,
                     for_iteration, classic_for_statement, for_target,
                     for_targets, range_based_for_statement, while_statement,
                     statement, assign_statement, lazy_assign_statement,
-                    aug_assign_statement, return_statement, pass_statement,
-                    break_statement, continue_statement, statement_list,
-                    expression, lambda_expr, bool_expr, bool_expr_or,
-                    bool_expr_and, unary_expr, compare_ops, compare_op_expr,
-                    bin_op_expr, bin_op_additive_expr,
+                    aug_assign_statement, return_statement, yield_statement,
+                    pass_statement, break_statement, continue_statement,
+                    statement_list, expression, lambda_expr, bool_expr,
+                    bool_expr_or, bool_expr_and, unary_expr, compare_ops,
+                    compare_op_expr, bin_op_expr, bin_op_additive_expr,
                     bin_op_multiplicative_expr, bin_op_exponential_expr,
                     primary, call, subscript, argument, keyword_argument,
                     argument_list, atom, numbers, id, quoted_string, sequence,
@@ -12,6 +12,7 @@
 #include <expressions/parser/transform/bin_op_transformer.hpp>
 #include <expressions/parser/transform/bool_op_transformer.hpp>
 #include <expressions/parser/transform/compare_op_transformer.hpp>
+#include <expressions/parser/transform/scope_resolver.hpp>
 
 #include <expressions/support/boost/spirit.hpp>
 
@@ -69,6 +70,7 @@ bool ExpressionsParser::transform_tree_(ast::Entry& tree) const {
     auto new_tree = BinOpTransformer {}.transform(tree);
     new_tree = CompareOpTransformer {}.transform(new_tree);
     new_tree = BoolOpTransformer {}.transform(new_tree);
+    new_tree = ScopeResolver {}.transform(new_tree);
     if (!ast::holds_alternative<ast::Entry>(new_tree)) {
         return false;
     }
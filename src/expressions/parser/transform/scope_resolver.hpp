@@ -0,0 +1,372 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_PARSER_TRANSFORM_SCOPE_RESOLVER_HPP__
+#define __EXPRESSIONS_PARSER_TRANSFORM_SCOPE_RESOLVER_HPP__
+
+#include <expressions/parser/transform/recursive_node_transformer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::parser {
+
+enum class BuiltinFunction : int32_t {
+    kPrint,
+    kLen,
+    kDaysBetween,
+    kAddDays,
+    kWeekday,
+    kDateInRange,
+    kMakeHeap,
+    kPushHeap,
+    kPopHeap,
+    kSortHeap,
+    kIsHeap,
+    kSqrt,
+    kExp,
+    kLog,
+    kPow,
+    kAbs,
+    kMin,
+    kMax,
+    kSort,
+    kStableSort,
+    kNthElement,
+    kTopK,
+    kRange,
+};
+
+// Indexed by BuiltinFunction.
+inline constexpr auto kBuiltinFunctionNames = std::array<std::string_view, 23> {
+    "print",
+    "len",
+    "days_between",
+    "add_days",
+    "weekday",
+    "date_in_range",
+    "make_heap",
+    "push_heap",
+    "pop_heap",
+    "sort_heap",
+    "is_heap",
+    "sqrt",
+    "exp",
+    "log",
+    "pow",
+    "abs",
+    "min",
+    "max",
+    "sort",
+    "stable_sort",
+    "nth_element",
+    "top_k",
+    "range",
+};
+
+inline std::optional<BuiltinFunction> builtin_function_of(
+    std::string_view name) {
+    auto it = std::find(kBuiltinFunctionNames.begin(),
+                        kBuiltinFunctionNames.end(), name);
+    if (it == kBuiltinFunctionNames.end()) {
+        return std::nullopt;
+    }
+
+    return static_cast<BuiltinFunction>(it - kBuiltinFunctionNames.begin());
+}
+
+// The builtin function a call to the name refers to, if any. The
+// ScopeResolver binds every call to a builtin, carrying it in the slot; the
+// names it leaves unresolved are looked up at run time and never refer to a
+// builtin.
+inline std::optional<BuiltinFunction> builtin_function_of(
+    const ast::Name& name) {
+    switch (name.scope) {
+        case ast::NameScope::kBuiltin: {
+            return static_cast<BuiltinFunction>(name.slot);
+        }
+        case ast::NameScope::kUnresolved:
+        case ast::NameScope::kLocal:
+        case ast::NameScope::kGlobal:
+        case ast::NameScope::kExtern: {
+            break;
+        }
+    }
+
+    return std::nullopt;
+}
+
+// Binds every name to the storage it refers to at run time, so that the
+// interpreter indexes slots instead of looking names up, and interns it.
+//
+// A name read inside a function or a lambda refers to a parameter of the
+// innermost one if there is one, and to a global otherwise. Assignments
+// always write globals. Calls to the functions of the embedder that an extern
+// declaration earlier in the script names never refer to a variable. Calls to
+// builtin functions do not either, unless a parameter or a global the script
+// assigns anywhere shares the name of the builtin: the script's definition
+// shadows it.
+// Names in the expression of a lazy assignment stay unresolved: the
+// expression runs in the frame of whoever reads the target.
+class ScopeResolver : public RecursiveNodeTransformer<ScopeResolver> {
+public:
+    using RecursiveNodeTransformer::operator();
+
+    ast::Value operator()(const ast::Name& node) const {
+        if (lazy_) {
+            return ast::Value {
+                ast::Name {node.value, ast::NameScope::kUnresolved, -1,
+                           ast::Symbol {node.value}}};
+        }
+
+        auto it = std::find(locals_.rbegin(), locals_.rend(), node.value);
+        if (it != locals_.rend()) {
+            auto slot = static_cast<int32_t>(locals_.rend() - it - 1);
+            return ast::Value {
+                ast::Name {node.value, ast::NameScope::kLocal, slot,
+                           ast::Symbol {node.value}}};
+        }
+
+        return ast::Value {global_(node.value)};
+    }
+
+    ast::Value operator()(const ast::Call& node) const {
+        auto args = std::vector<ast::Value> {};
+        args.reserve(node.args.size());
+        for (const auto& arg : node.args) {
+            args.emplace_back(visit(arg));
+        }
+
+        const auto& value = node.name.value;
+        auto local = std::find(locals_.begin(), locals_.end(), value)
+                     != locals_.end();
+        auto builtin = builtin_function_of(value);
+        auto name = ast::Name {};
+        if (!local && externs_.contains(value)) {
+            name = ast::Name {value, ast::NameScope::kExtern, -1,
+                              ast::Symbol {value}};
+        } else if (builtin && !local && !defined_.contains(value)) {
+            name = ast::Name {value, ast::NameScope::kBuiltin,
+                              static_cast<int32_t>(*builtin),
+                              ast::Symbol {value}};
+        } else {
+            name = visit<ast::Name>(node.name);
+        }
+
+        return ast::Value {ast::Call {std::move(name), std::move(args)}};
+    }
+
+    ast::Value operator()(const ast::Lambda& node) const {
+        auto locals = enter_(node.params);
+        auto expr = visit(node.expr);
+        locals_ = std::move(locals);
+
+        return ast::Value {ast::Lambda {params_(node.params), std::move(expr)}};
+    }
+
+    ast::Value operator()(const ast::ExternFunctionDecl& node) const {
+        // The declarations of the builtins themselves, as in lib/system,
+        // leave their calls bound to the builtins.
+        auto declares_builtin
+            = builtin_function_of(node.name.value)
+              && std::any_of(node.decorators.begin(), node.decorators.end(),
+                             [](const ast::Name& decorator) {
+                                 return decorator.value == "builtin";
+                             });
+        if (!declares_builtin) {
+            externs_.emplace(node.name.value);
+        }
+
+        return ast::Value {
+            ast::ExternFunctionDecl {
+                node.decorators,
+                ast::Name {node.name.value, ast::NameScope::kExtern, -1,
+                           ast::Symbol {node.name.value}},
+                node.params,
+                node.return_type,
+            },
+        };
+    }
+
+    ast::Value operator()(const ast::FunctionDef& node) const {
+        auto locals = enter_(node.params);
+        auto body = visit(node.body);
+        locals_ = std::move(locals);
+
+        return ast::Value {
+            ast::FunctionDef {
+                node.decorators,
+                define_(node.name.value),
+                params_(node.params),
+                std::move(body),
+            },
+        };
+    }
+
+    ast::Value operator()(const ast::AssignStatement& node) const {
+        return ast::Value {
+            ast::AssignStatement {target_(node.target), visit(node.expr)}};
+    }
+
+    ast::Value operator()(const ast::LazyAssignStatement& node) const {
+        auto target = target_(node.target);
+        auto lazy = std::exchange(lazy_, true);
+        auto expr = visit(node.expr);
+        lazy_ = lazy;
+
+        return ast::Value {
+            ast::LazyAssignStatement {std::move(target), std::move(expr)}};
+    }
+
+    ast::Value operator()(const ast::AugAssignStatement& node) const {
+        // The target is read like any other name. Writing it goes to the
+        // global of the same name, which must exist.
+        if (const auto* name = ast::get_if<ast::Name>(&node.target)) {
+            define_(name->value);
+        }
+
+        return ast::Value {
+            ast::AugAssignStatement {
+                visit(node.target),
+                node.op,
+                visit(node.expr),
+            },
+        };
+    }
+
+    ast::Value operator()(const ast::RangeBasedForStatement& node) const {
+        // The loop assigns the elements to its targets, which are globals
+        // like the targets of any assignment.
+        auto target = ast::Value {};
+        if (const auto* targets = ast::get_if<ast::List>(&node.target)) {
+            auto names = std::vector<ast::Value> {};
+            names.reserve(targets->values.size());
+            for (const auto& name : targets->values) {
+                names.emplace_back(target_(name));
+            }
+            target = ast::Value {ast::List {std::move(names)}};
+        } else {
+            target = target_(node.target);
+        }
+
+        return ast::Value {
+            ast::RangeBasedForStatement {
+                std::move(target),
+                visit(node.iter),
+                visit(node.body),
+            },
+        };
+    }
+
+    ast::Value operator()(const ast::Entry& node) const {
+        static auto next_id = std::atomic<uint64_t> {0};
+
+        // A first pass collects the names the script defines, so that calls
+        // made before a definition are resolved like the ones after it.
+        defined_.clear();
+        global_slots_.clear();
+        globals_.clear();
+        externs_.clear();
+        visit(node.node);
+
+        global_slots_.clear();
+        globals_.clear();
+        externs_.clear();
+        auto tree = visit(node.node);
+
+        return ast::Value {ast::Entry {node.package, std::move(tree),
+                                       std::move(globals_), ++next_id}};
+    }
+
+private:
+    // Makes the parameters the current locals. Returns the previous ones.
+    std::vector<std::string> enter_(
+        const std::vector<ast::Value>& params) const {
+        auto locals = std::vector<std::string> {};
+        locals.reserve(params.size());
+        for (const auto& param : params) {
+            auto name = std::string {};
+            if (const auto* arg = ast::get_if<ast::Argument>(&param)) {
+                if (const auto* id_name = ast::get_if<ast::Name>(&arg->arg)) {
+                    name = id_name->value;
+                }
+            } else if (const auto* kwarg
+                       = ast::get_if<ast::KeywordArgument>(&param)) {
+                name = kwarg->name.value;
+            }
+            locals.emplace_back(std::move(name));
+        }
+
+        return std::exchange(locals_, std::move(locals));
+    }
+
+    // The parameters with their names interned.
+    static std::vector<ast::Value> params_(
+        const std::vector<ast::Value>& params) {
+        auto result = params;
+        for (auto& param : result) {
+            if (auto* arg = ast::get_if<ast::Argument>(&param)) {
+                if (auto* id_name = ast::get_if<ast::Name>(&arg->arg)) {
+                    id_name->symbol = ast::Symbol {id_name->value};
+                }
+            } else if (auto* kwarg
+                       = ast::get_if<ast::KeywordArgument>(&param)) {
+                kwarg->name.symbol = ast::Symbol {kwarg->name.value};
+            }
+        }
+
+        return result;
+    }
+
+    ast::Value target_(const ast::Value& target) const {
+        if (const auto* name = ast::get_if<ast::Name>(&target)) {
+            return ast::Value {define_(name->value)};
+        }
+
+        return visit(target);
+    }
+
+    // The global of a name the script assigns.
+    ast::Name define_(const std::string& name) const {
+        defined_.emplace(name);
+
+        return global_(name);
+    }
+
+    ast::Name global_(const std::string& name) const {
+        auto [it, inserted] = global_slots_.try_emplace(
+            name, static_cast<int32_t>(globals_.size()));
+        if (inserted) {
+            globals_.emplace_back(name);
+        }
+
+        return ast::Name {name, ast::NameScope::kGlobal, it->second,
+                          ast::Symbol {name}};
+    }
+
+private:
+    mutable std::vector<std::string> locals_ {};
+    mutable bool lazy_ = false;
+    mutable std::unordered_map<std::string, int32_t> global_slots_ {};
+    mutable std::vector<std::string> globals_ {};
+    mutable std::unordered_set<std::string> externs_ {};
+    // Names the script assigns, which shadow the builtins of the same name.
+    mutable std::unordered_set<std::string> defined_ {};
+};
+
+}    // namespace expressions::parser
+
+#endif
@@ -0,0 +1,123 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_VM_BYTECODE_HPP__
+#define __EXPRESSIONS_VM_BYTECODE_HPP__
+
+#include <expressions/interpreter/host_functions.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace expressions::vm {
+
+using interpreter::BoxedValue;
+
+enum class OpCode : int32_t {
+    kNop,
+
+    // Stack manipulation.
+    kLoadConst,    // push constants[operand]
+    kPop,
+
+    // Variables. Locals are the parameters of the running function, globals
+    // are resolved to slots at compile time.
+    kLoadLocal,      // push locals[operand]
+    kLoadGlobal,     // push globals[operand], evaluating lazy code
+    kLoadName,       // dynamic lookup of globals[operand] by name
+    kStoreGlobal,    // globals[operand] = pop
+    kStoreLazy,      // globals[operand] = lazy code functions[extra]
+    // [value, rhs] -> [], globals[operand] = value op rhs with the ast
+    // operator type in extra, appending in place when value is the global's.
+    kInPlaceGlobal,
+
+    // Operators. The operand holds the ast operator type.
+    kBinaryOp,
+    kUnaryOp,
+    kCompareOp,         // [l, r] -> [result]
+    kCompareOpChain,    // [l, r] -> [r, result]
+    kSubscript,         // [object, index] -> [element]
+
+    // Collections. The operand holds the number of elements.
+    kMakeTuple,
+    kMakeList,
+    kMakeSet,
+    kMakeDict,    // operand holds the number of key-value pairs
+
+    // Control flow. The operand holds the absolute target address.
+    kJump,
+    kJumpIfFalse,    // pops the condition
+    kJumpIfTrue,     // pops the condition
+
+    // Range-based for statements. The iterators live on a stack of their
+    // own; kIterNext pushes the extra targets of the next element, or jumps
+    // to the operand once the iterator is exhausted.
+    kIterBegin,    // pops the iterable
+    kIterRange,    // pops the extra arguments of range()
+    kIterNext,
+    kIterEnd,      // drops the innermost iterator
+
+    // Functions.
+    kMakeFunction,    // push a callable for functions[operand]
+    kCall,            // [args..., callee] -> [result], operand holds argc
+    kCallBuiltin,     // operand holds the builtin id, extra holds argc
+    // Like kCallBuiltin, but the kStoreGlobal that follows may hand the value
+    // of its global over to the call as the first argument.
+    kCallBuiltinInPlace,
+    kCallHost,        // operand indexes host_functions, extra holds argc
+    kReturn,
+    kYield,    // pops the value yielded and suspends the generator call
+};
+
+struct Instruction {
+    OpCode op {OpCode::kNop};
+    int32_t operand = 0;
+    int32_t extra = 0;
+};
+
+enum class FunctionKind : int32_t {
+    kEntry,
+    kFunction,
+    kLambda,
+    kLazy,
+};
+
+struct FunctionCode {
+    FunctionKind kind {FunctionKind::kFunction};
+    std::string name {};
+    // Parameter names in the order of their local slots.
+    std::vector<std::string> params {};
+    // The same names interned, matched by the name lookups of lazy code.
+    std::vector<ast::Symbol> symbols {};
+    std::vector<Instruction> code {};
+    // Whether the body yields, which makes a call return a Generator.
+    bool generator = false;
+    // Source of the body, kept for the JIT compiler. Lazy code has none.
+    std::shared_ptr<const ast::Value> body {};
+};
+
+struct Program {
+    // Unique among all programs compiled by the process, so that caches
+    // keyed by a program never outlive it.
+    uint64_t id = 0;
+    std::vector<BoxedValue> constants {};
+    // Names of the global slots.
+    std::vector<std::string> globals {};
+    // The same names interned.
+    std::vector<ast::Symbol> symbols {};
+    // functions[0] is the top-level code of the script.
+    std::vector<FunctionCode> functions {};
+    // The host function each extern call site binds to.
+    std::vector<interpreter::HostFunction> host_functions {};
+};
+
+}    // namespace expressions::vm
+
+#endif
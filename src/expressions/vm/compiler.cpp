@@ -0,0 +1,662 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/vm/compiler.hpp>
+
+#include <expressions/interpreter/builtins.hpp>
+#include <expressions/interpreter/constant_literal.hpp>
+#include <expressions/interpreter/iterator.hpp>
+#include <expressions/parser/transform/scope_resolver.hpp>
+
+#include <expressions/common/enumerate.hpp>
+#include <expressions/exception/throw_exception.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+
+namespace expressions::vm {
+
+namespace {
+
+struct NodeTypeName : boost::static_visitor<std::string> {
+    NodeTypeName() = default;
+
+    template<typename T>
+    std::string operator()(const T& node) const {
+        (void)node;
+
+        return boost::typeindex::type_id<T>().pretty_name();
+    }
+    template<typename T>
+    std::string operator()(const ast::x3::forward_ast<T>& node) const {
+        return (*this)(node.get());
+    }
+};
+
+// Only names can be assigned to.
+[[noreturn]] void throw_unsupported_target(const ast::Value& target) {
+    THROW_EXCEPTION(std::runtime_error(
+        fmt::format("[Compiler] Cannot assign to the AST node type '{}'",
+                    target.apply_visitor(NodeTypeName {}))));
+}
+
+}    // namespace
+
+auto BytecodeCompiler::compile(const ast::Entry& node) const
+    -> std::shared_ptr<Program> {
+    static auto next_id = std::atomic<uint64_t> {0};
+
+    program_ = std::make_shared<Program>();
+    program_->id = ++next_id;
+    globals_.clear();
+    scope_ = Scope {};
+
+    program_->functions.emplace_back(
+        FunctionCode {FunctionKind::kEntry, node.package.path.value});
+    if (is_statement_(node.node)) {
+        // A script made of a single expression returns its value, which the
+        // JIT calling convention does not model.
+        program_->functions.front().body
+            = std::make_shared<const ast::Value>(node.node);
+    }
+    (*this)(node);
+
+    auto program = std::move(program_);
+    globals_.clear();
+    scope_ = Scope {};
+
+    return program;
+}
+
+auto BytecodeCompiler::operator()(const ast::MonoState& node) const
+    -> ReturnType {
+    (void)node;
+
+    THROW_EXCEPTION(std::logic_error("[Compiler] Unexpected empty AST node."));
+}
+
+auto BytecodeCompiler::operator()(const ast::Ellipsis& node) const
+    -> ReturnType {
+    (void)node;
+
+    emit_(OpCode::kLoadConst, add_constant_(interpreter::Ellipsis {}));
+}
+
+auto BytecodeCompiler::operator()(const ast::Null& node) const -> ReturnType {
+    (void)node;
+
+    emit_(OpCode::kLoadConst, add_constant_(interpreter::Null {}));
+}
+
+auto BytecodeCompiler::operator()(bool value) const -> ReturnType {
+    emit_(OpCode::kLoadConst, add_constant_(value));
+}
+
+auto BytecodeCompiler::operator()(int64_t value) const -> ReturnType {
+    emit_(OpCode::kLoadConst, add_constant_(value));
+}
+
+auto BytecodeCompiler::operator()(uint64_t value) const -> ReturnType {
+    emit_(OpCode::kLoadConst, add_constant_(value));
+}
+
+auto BytecodeCompiler::operator()(double value) const -> ReturnType {
+    emit_(OpCode::kLoadConst, add_constant_(value));
+}
+
+auto BytecodeCompiler::operator()(const ast::Name& node) const -> ReturnType {
+    emit_load_name_(node.value);
+}
+
+auto BytecodeCompiler::operator()(const ast::String& node) const
+    -> ReturnType {
+    emit_load_name_(node.value);
+}
+
+auto BytecodeCompiler::operator()(const ast::QuotedString& node) const
+    -> ReturnType {
+    emit_(OpCode::kLoadConst, add_constant_(interpreter::String {node.value}));
+}
+
+auto BytecodeCompiler::operator()(const ast::Date& node) const -> ReturnType {
+    emit_(OpCode::kLoadConst,
+          add_constant_(
+              interpreter::Date::from_civil(node.year, node.month, node.day)));
+}
+
+auto BytecodeCompiler::operator()(const ast::DateRange& node) const
+    -> ReturnType {
+    emit_(OpCode::kLoadConst,
+          add_constant_(interpreter::DateRange {
+              interpreter::Date::from_civil(node.begin.year, node.begin.month,
+                                            node.begin.day),
+              interpreter::Date::from_civil(node.end.year, node.end.month,
+                                            node.end.day),
+          }));
+}
+
+auto BytecodeCompiler::operator()(const ast::Tuple& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        emit_(OpCode::kLoadConst, add_constant_(std::move(*value)));
+        return;
+    }
+    for (const auto& value : node.values) {
+        visit_(value);
+    }
+    emit_(OpCode::kMakeTuple, static_cast<int32_t>(node.values.size()));
+}
+
+auto BytecodeCompiler::operator()(const ast::List& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        emit_(OpCode::kLoadConst, add_constant_(std::move(*value)));
+        return;
+    }
+    for (const auto& value : node.values) {
+        visit_(value);
+    }
+    emit_(OpCode::kMakeList, static_cast<int32_t>(node.values.size()));
+}
+
+auto BytecodeCompiler::operator()(const ast::Dict& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        emit_(OpCode::kLoadConst, add_constant_(std::move(*value)));
+        return;
+    }
+    for (const auto& item : node.items) {
+        visit_(item.key);
+        visit_(item.value);
+    }
+    emit_(OpCode::kMakeDict, static_cast<int32_t>(node.items.size()));
+}
+
+auto BytecodeCompiler::operator()(const ast::Set& node) const -> ReturnType {
+    if (auto value = interpreter::constant_literal(node)) {
+        emit_(OpCode::kLoadConst, add_constant_(std::move(*value)));
+        return;
+    }
+    for (const auto& value : node.values) {
+        visit_(value);
+    }
+    emit_(OpCode::kMakeSet, static_cast<int32_t>(node.values.size()));
+}
+
+auto BytecodeCompiler::operator()(const ast::CompareOp& node) const
+    -> ReturnType {
+    // a < b < c evaluates each operand at most once and stops at the first
+    // comparison that fails, leaving a single boolean on the stack.
+    visit_(node.first);
+
+    auto failures = std::vector<size_t> {};
+    for (const auto& [index, operand] : enumerate(node.rest)) {
+        visit_(operand.operand);
+
+        auto op = static_cast<int32_t>(operand.op);
+        if (static_cast<size_t>(index) + 1 == node.rest.size()) {
+            emit_(OpCode::kCompareOp, op);
+        } else {
+            emit_(OpCode::kCompareOpChain, op);
+            failures.emplace_back(emit_(OpCode::kJumpIfFalse));
+        }
+    }
+
+    if (!failures.empty()) {
+        auto end = emit_(OpCode::kJump);
+        for (auto failure : failures) {
+            patch_(failure);
+        }
+        emit_(OpCode::kPop);
+        emit_(OpCode::kLoadConst, add_constant_(false));
+        patch_(end);
+    }
+}
+
+auto BytecodeCompiler::operator()(const ast::BinOp& node) const -> ReturnType {
+    visit_(node.left);
+    visit_(node.right);
+    emit_(OpCode::kBinaryOp, static_cast<int32_t>(node.op));
+}
+
+auto BytecodeCompiler::operator()(const ast::Call& node) const -> ReturnType {
+    auto argc = static_cast<int32_t>(node.args.size());
+    for (const auto& arg : node.args) {
+        visit_(arg);
+    }
+
+    if (auto builtin = parser::builtin_function_of(node.name)) {
+        emit_(OpCode::kCallBuiltin, static_cast<int32_t>(*builtin), argc);
+    } else if (node.name.scope == ast::NameScope::kExtern) {
+        auto index = static_cast<int32_t>(program_->host_functions.size());
+        program_->host_functions.emplace_back(
+            hosts_ ? hosts_->bind(node.name.symbol, node.args.size())
+                   : interpreter::HostFunction {node.name.value, argc});
+        emit_(OpCode::kCallHost, index, argc);
+    } else {
+        emit_load_name_(node.name.value);
+        emit_(OpCode::kCall, argc,
+              add_constant_(interpreter::Name {node.name.value}));
+    }
+}
+
+auto BytecodeCompiler::operator()(const ast::Argument& node) const
+    -> ReturnType {
+    visit_(node.arg);
+}
+
+auto BytecodeCompiler::operator()(const ast::KeywordArgument& node) const
+    -> ReturnType {
+    visit_(node.arg);
+}
+
+auto BytecodeCompiler::operator()(const ast::Subscript& node) const
+    -> ReturnType {
+    visit_(node.name);
+    visit_(node.expr);
+    emit_(OpCode::kSubscript);
+}
+
+auto BytecodeCompiler::operator()(const ast::UnaryOp& node) const
+    -> ReturnType {
+    visit_(node.operand);
+    emit_(OpCode::kUnaryOp, static_cast<int32_t>(node.op));
+}
+
+auto BytecodeCompiler::operator()(const ast::BoolOp& node) const
+    -> ReturnType {
+    if (node.op != ast::BoolOpType::kAnd && node.op != ast::BoolOpType::kOr) {
+        for (const auto& operand : node.operands) {
+            visit_(operand);
+            emit_(OpCode::kPop);
+        }
+        emit_(OpCode::kLoadConst, add_constant_(false));
+        return;
+    }
+
+    // Both operators short-circuit and always produce a boolean.
+    auto is_and = node.op == ast::BoolOpType::kAnd;
+    auto exits = std::vector<size_t> {};
+    for (const auto& operand : node.operands) {
+        visit_(operand);
+        exits.emplace_back(
+            emit_(is_and ? OpCode::kJumpIfFalse : OpCode::kJumpIfTrue));
+    }
+    emit_(OpCode::kLoadConst, add_constant_(is_and));
+    auto end = emit_(OpCode::kJump);
+    for (auto exit : exits) {
+        patch_(exit);
+    }
+    emit_(OpCode::kLoadConst, add_constant_(!is_and));
+    patch_(end);
+}
+
+auto BytecodeCompiler::operator()(const ast::Lambda& node) const
+    -> ReturnType {
+    auto function = compile_function_(FunctionKind::kLambda, "<lambda>",
+                                      node.params, node.expr);
+    emit_(OpCode::kMakeFunction, function);
+}
+
+auto BytecodeCompiler::operator()(const ast::Expression& node) const
+    -> ReturnType {
+    visit_(node.expr);
+}
+
+auto BytecodeCompiler::operator()(const ast::AssignStatement& node) const
+    -> ReturnType {
+    if (!ast::holds_alternative<ast::Name>(node.target)) {
+        throw_unsupported_target(node.target);
+    }
+    const auto& target = ast::get<ast::Name>(node.target);
+    const auto& name = target.value;
+    if (const auto* func = ast::get_if<ast::FunctionDef>(&node.expr)) {
+        auto function = compile_function_(FunctionKind::kFunction,
+                                          func->name.value, func->params,
+                                          func->body);
+        emit_(OpCode::kMakeFunction, function);
+    } else if (const auto* call
+               = interpreter::in_place_call(target, node.expr)) {
+        for (const auto& arg : call->args) {
+            visit_(arg);
+        }
+        emit_(OpCode::kCallBuiltinInPlace,
+              static_cast<int32_t>(*parser::builtin_function_of(call->name)),
+              static_cast<int32_t>(call->args.size()));
+    } else {
+        visit_(node.expr);
+    }
+    emit_(OpCode::kStoreGlobal, resolve_global_(name));
+}
+
+auto BytecodeCompiler::operator()(const ast::LazyAssignStatement& node) const
+    -> ReturnType {
+    if (!ast::holds_alternative<ast::Name>(node.target)) {
+        throw_unsupported_target(node.target);
+    }
+    const auto& name = ast::get<ast::Name>(node.target).value;
+    auto function
+        = compile_function_(FunctionKind::kLazy, name, {}, node.expr);
+    emit_(OpCode::kStoreLazy, resolve_global_(name), function);
+}
+
+auto BytecodeCompiler::operator()(const ast::AugAssignStatement& node) const
+    -> ReturnType {
+    if (!ast::holds_alternative<ast::Name>(node.target)) {
+        throw_unsupported_target(node.target);
+    }
+    const auto& name = ast::get<ast::Name>(node.target).value;
+    emit_load_name_(name);
+    visit_(node.expr);
+    emit_(OpCode::kInPlaceGlobal, resolve_global_(name),
+          static_cast<int32_t>(node.op));
+}
+
+auto BytecodeCompiler::operator()(const ast::ReturnStatement& node) const
+    -> ReturnType {
+    if (node.expr) {
+        visit_(*node.expr);
+    } else {
+        emit_(OpCode::kLoadConst, add_constant_(interpreter::Null {}));
+    }
+    emit_(OpCode::kReturn);
+}
+
+auto BytecodeCompiler::operator()(const ast::YieldStatement& node) const
+    -> ReturnType {
+    auto& function = program_->functions[scope_.function];
+    if (function.kind == FunctionKind::kEntry) {
+        THROW_EXCEPTION(
+            std::runtime_error("[Compiler] 'yield' outside function"));
+    }
+    function.generator = true;
+
+    if (node.expr) {
+        visit_(*node.expr);
+    } else {
+        emit_(OpCode::kLoadConst, add_constant_(interpreter::Null {}));
+    }
+    emit_(OpCode::kYield);
+}
+
+auto BytecodeCompiler::operator()(const ast::StatementList& node) const
+    -> ReturnType {
+    for (const auto& stmt : node.stmts) {
+        emit_statement_(stmt);
+    }
+}
+
+auto BytecodeCompiler::operator()(const ast::ExternFunctionDecl& node) const
+    -> ReturnType {
+    (void)node;
+}
+
+auto BytecodeCompiler::operator()(const ast::FunctionDef& node) const
+    -> ReturnType {
+    auto function = compile_function_(FunctionKind::kFunction,
+                                      node.name.value, node.params, node.body);
+    emit_(OpCode::kMakeFunction, function);
+    emit_(OpCode::kStoreGlobal, resolve_global_(node.name.value));
+}
+
+auto BytecodeCompiler::operator()(const ast::IfStatement& node) const
+    -> ReturnType {
+    visit_(node.condition);
+    auto or_else = emit_(OpCode::kJumpIfFalse);
+    emit_statement_(node.body);
+    if (ast::holds_alternative<ast::MonoState>(node.or_else)) {
+        patch_(or_else);
+        return;
+    }
+
+    auto end = emit_(OpCode::kJump);
+    patch_(or_else);
+    emit_statement_(node.or_else);
+    patch_(end);
+}
+
+auto BytecodeCompiler::operator()(const ast::ForStatement& node) const
+    -> ReturnType {
+    emit_statement_(node.init);
+
+    auto start = next_address_();
+    visit_(node.condition);
+    auto exit = emit_(OpCode::kJumpIfFalse);
+
+    scope_.loops.emplace_back();
+    emit_statement_(node.body);
+    auto loop = std::move(scope_.loops.back());
+    scope_.loops.pop_back();
+
+    for (auto index : loop.continues) {
+        patch_(index);
+    }
+    emit_statement_(node.iter);
+    emit_(OpCode::kJump, static_cast<int32_t>(start));
+
+    patch_(exit);
+    for (auto index : loop.breaks) {
+        patch_(index);
+    }
+}
+
+auto BytecodeCompiler::operator()(const ast::RangeBasedForStatement& node) const
+    -> ReturnType {
+    if (const auto* call = interpreter::range_call(node.iter)) {
+        for (const auto& arg : call->args) {
+            visit_(arg);
+        }
+        emit_(OpCode::kIterRange, 0, static_cast<int32_t>(call->args.size()));
+    } else {
+        visit_(node.iter);
+        emit_(OpCode::kIterBegin);
+    }
+
+    auto targets = interpreter::for_targets(node.target);
+    auto start = next_address_();
+    auto exit
+        = emit_(OpCode::kIterNext, 0, static_cast<int32_t>(targets.size()));
+    for (auto it = targets.rbegin(); it != targets.rend(); ++it) {
+        emit_(OpCode::kStoreGlobal, resolve_global_(it->value));
+    }
+
+    scope_.loops.emplace_back();
+    emit_statement_(node.body);
+    auto loop = std::move(scope_.loops.back());
+    scope_.loops.pop_back();
+
+    for (auto index : loop.continues) {
+        patch_(index);
+    }
+    emit_(OpCode::kJump, static_cast<int32_t>(start));
+
+    patch_(exit);
+    for (auto index : loop.breaks) {
+        patch_(index);
+    }
+    emit_(OpCode::kIterEnd);
+}
+
+auto BytecodeCompiler::operator()(const ast::WhileStatement& node) const
+    -> ReturnType {
+    auto start = next_address_();
+    visit_(node.condition);
+    auto exit = emit_(OpCode::kJumpIfFalse);
+
+    scope_.loops.emplace_back();
+    emit_statement_(node.body);
+    auto loop = std::move(scope_.loops.back());
+    scope_.loops.pop_back();
+
+    for (auto index : loop.continues) {
+        program_->functions[scope_.function].code[index].operand
+            = static_cast<int32_t>(start);
+    }
+    emit_(OpCode::kJump, static_cast<int32_t>(start));
+
+    patch_(exit);
+    for (auto index : loop.breaks) {
+        patch_(index);
+    }
+}
+
+auto BytecodeCompiler::operator()(const ast::Pass& node) const -> ReturnType {
+    (void)node;
+}
+
+auto BytecodeCompiler::operator()(const ast::Break& node) const -> ReturnType {
+    (void)node;
+
+    if (scope_.loops.empty()) {
+        THROW_EXCEPTION(std::runtime_error("[Compiler] 'break' outside loop"));
+    }
+    scope_.loops.back().breaks.emplace_back(emit_(OpCode::kJump));
+}
+
+auto BytecodeCompiler::operator()(const ast::Continue& node) const
+    -> ReturnType {
+    (void)node;
+
+    if (scope_.loops.empty()) {
+        THROW_EXCEPTION(
+            std::runtime_error("[Compiler] 'continue' outside loop"));
+    }
+    scope_.loops.back().continues.emplace_back(emit_(OpCode::kJump));
+}
+
+auto BytecodeCompiler::operator()(const ast::ImportPackage& node) const
+    -> ReturnType {
+    (void)node;
+}
+
+auto BytecodeCompiler::operator()(const ast::PackageName& node) const
+    -> ReturnType {
+    (void)node;
+}
+
+auto BytecodeCompiler::operator()(const ast::Entry& node) const -> ReturnType {
+    // A script made of a single expression evaluates to its value, any other
+    // script evaluates to null unless it returns explicitly.
+    if (is_statement_(node.node)) {
+        visit_(node.node);
+        emit_(OpCode::kLoadConst, add_constant_(interpreter::Null {}));
+    } else {
+        visit_(node.node);
+    }
+    emit_(OpCode::kReturn);
+}
+
+void BytecodeCompiler::emit_statement_(const ast::Value& node) const {
+    visit_(node);
+    if (!is_statement_(node)) {
+        emit_(OpCode::kPop);
+    }
+}
+
+void BytecodeCompiler::emit_load_name_(const std::string& name) const {
+    const auto& function = program_->functions[scope_.function];
+    if (function.kind == FunctionKind::kLazy) {
+        emit_(OpCode::kLoadName, resolve_global_(name));
+        return;
+    }
+
+    auto it = std::find(scope_.params.begin(), scope_.params.end(), name);
+    if (it != scope_.params.end()) {
+        emit_(OpCode::kLoadLocal,
+              static_cast<int32_t>(std::distance(scope_.params.begin(), it)));
+    } else {
+        emit_(OpCode::kLoadGlobal, resolve_global_(name));
+    }
+}
+
+size_t BytecodeCompiler::emit_(OpCode op, int32_t operand,
+                               int32_t extra) const {
+    auto& code = program_->functions[scope_.function].code;
+    code.emplace_back(Instruction {op, operand, extra});
+
+    return code.size() - 1;
+}
+
+void BytecodeCompiler::patch_(size_t index) const {
+    auto& code = program_->functions[scope_.function].code;
+    code[index].operand = static_cast<int32_t>(code.size());
+}
+
+size_t BytecodeCompiler::next_address_() const {
+    return program_->functions[scope_.function].code.size();
+}
+
+int32_t BytecodeCompiler::add_constant_(BoxedValue value) const {
+    auto& constants = program_->constants;
+    constants.emplace_back(std::move(value));
+
+    return static_cast<int32_t>(constants.size() - 1);
+}
+
+int32_t BytecodeCompiler::resolve_global_(const std::string& name) const {
+    auto [it, inserted] = globals_.try_emplace(
+        name, static_cast<int32_t>(program_->globals.size()));
+    if (inserted) {
+        program_->globals.emplace_back(name);
+        program_->symbols.emplace_back(name);
+    }
+
+    return it->second;
+}
+
+int32_t BytecodeCompiler::compile_function_(
+    FunctionKind kind, const std::string& name,
+    const std::vector<ast::Value>& params, const ast::Value& body) const {
+    auto function = FunctionCode {kind, name};
+    function.params.reserve(params.size());
+    function.symbols.reserve(params.size());
+    for (const auto& param : params) {
+        function.params.emplace_back(param_name_(param));
+        function.symbols.emplace_back(function.params.back());
+    }
+    if (kind != FunctionKind::kLazy) {
+        function.body = std::make_shared<const ast::Value>(body);
+    }
+
+    auto index = static_cast<int32_t>(program_->functions.size());
+    program_->functions.emplace_back(std::move(function));
+
+    auto scope = Scope {index, program_->functions[index].params};
+    std::swap(scope_, scope);
+    if (kind == FunctionKind::kLazy) {
+        visit_(body);
+    } else {
+        emit_statement_(body);
+        emit_(OpCode::kLoadConst, add_constant_(interpreter::Null {}));
+    }
+    emit_(OpCode::kReturn);
+    std::swap(scope_, scope);
+
+    return index;
+}
+
+bool BytecodeCompiler::is_statement_(const ast::Value& node) {
+    return ast::holds_any_of<
+        ast::AssignStatement, ast::LazyAssignStatement, ast::AugAssignStatement,
+        ast::ReturnStatement, ast::YieldStatement, ast::StatementList,
+        ast::ExternFunctionDecl, ast::FunctionDef, ast::IfStatement,
+        ast::ForStatement, ast::RangeBasedForStatement, ast::WhileStatement,
+        ast::Pass, ast::Break, ast::Continue, ast::ImportPackage,
+        ast::PackageName>(node);
+}
+
+std::string BytecodeCompiler::param_name_(const ast::Value& param) {
+    if (const auto* arg = ast::get_if<ast::Argument>(&param)) {
+        if (const auto* name = ast::get_if<ast::Name>(&arg->arg)) {
+            return name->value;
+        }
+    } else if (const auto* kwarg = ast::get_if<ast::KeywordArgument>(&param)) {
+        return kwarg->name.value;
+    }
+
+    THROW_EXCEPTION(
+        std::runtime_error("[Compiler] Invalid parameter declaration."));
+}
+
+}    // namespace expressions::vm
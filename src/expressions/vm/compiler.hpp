@@ -0,0 +1,154 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_VM_COMPILER_HPP__
+#define __EXPRESSIONS_VM_COMPILER_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/vm/bytecode.hpp>
+
+#include <expressions/support/boost/variant.hpp>
+
+#include <fmt/format.h>
+#include <boost/type_index.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::vm {
+
+// Lowers the transformed AST produced by ExpressionsParser::parse_to_ast()
+// into bytecode for the VirtualMachine. Name resolution happens here once:
+// parameters become local slots, every other name becomes a global slot, and
+// calls to the builtins and to host functions are bound to their targets.
+class BytecodeCompiler : public boost::static_visitor<void> {
+public:
+    BytecodeCompiler() = default;
+    // Calls to the names scripts declare extern go to the host functions.
+    explicit BytecodeCompiler(
+        std::shared_ptr<const interpreter::HostFunctions> hosts)
+        : hosts_ {std::move(hosts)} {}
+
+    using ReturnType = void;
+
+    auto compile(const ast::Entry& node) const -> std::shared_ptr<Program>;
+
+public:
+    ReturnType operator()(const ast::MonoState& node) const;
+
+    ReturnType operator()(const ast::Ellipsis& node) const;
+    ReturnType operator()(const ast::Null& node) const;
+    ReturnType operator()(bool value) const;
+
+    ReturnType operator()(int64_t value) const;
+    ReturnType operator()(uint64_t value) const;
+    ReturnType operator()(double value) const;
+
+    ReturnType operator()(const ast::Name& node) const;
+    ReturnType operator()(const ast::String& node) const;
+    ReturnType operator()(const ast::QuotedString& node) const;
+
+    ReturnType operator()(const ast::Date& node) const;
+    ReturnType operator()(const ast::DateRange& node) const;
+
+    ReturnType operator()(const ast::Tuple& node) const;
+    ReturnType operator()(const ast::List& node) const;
+    ReturnType operator()(const ast::Dict& node) const;
+    ReturnType operator()(const ast::Set& node) const;
+
+    ReturnType operator()(const ast::CompareOp& node) const;
+    ReturnType operator()(const ast::CompareOpOperand& node) const {
+        auto name = boost::typeindex::type_id<decltype(node)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "[Compiler] Cannot compile the AST node type '{}'", name)));
+    }
+    ReturnType operator()(const ast::BinOp& node) const;
+    ReturnType operator()(const ast::BinOpIntermediate& node) const {
+        auto name = boost::typeindex::type_id<decltype(node)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "[Compiler] Cannot compile the AST node type '{}'", name)));
+    }
+
+    ReturnType operator()(const ast::Call& node) const;
+    ReturnType operator()(const ast::Argument& node) const;
+    ReturnType operator()(const ast::KeywordArgument& node) const;
+
+    ReturnType operator()(const ast::Subscript& node) const;
+
+    ReturnType operator()(const ast::UnaryOp& node) const;
+    ReturnType operator()(const ast::BoolOp& node) const;
+
+    ReturnType operator()(const ast::Lambda& node) const;
+    ReturnType operator()(const ast::Expression& node) const;
+    ReturnType operator()(const ast::AssignStatement& node) const;
+    ReturnType operator()(const ast::LazyAssignStatement& node) const;
+    ReturnType operator()(const ast::AugAssignStatement& node) const;
+    ReturnType operator()(const ast::ReturnStatement& node) const;
+    ReturnType operator()(const ast::YieldStatement& node) const;
+    ReturnType operator()(const ast::StatementList& node) const;
+
+    ReturnType operator()(const ast::ExternFunctionDecl& node) const;
+    ReturnType operator()(const ast::FunctionDef& node) const;
+
+    ReturnType operator()(const ast::IfStatement& node) const;
+    ReturnType operator()(const ast::ForStatement& node) const;
+    ReturnType operator()(const ast::RangeBasedForStatement& node) const;
+    ReturnType operator()(const ast::WhileStatement& node) const;
+
+    ReturnType operator()(const ast::Pass& node) const;
+    ReturnType operator()(const ast::Break& node) const;
+    ReturnType operator()(const ast::Continue& node) const;
+
+    ReturnType operator()(const ast::ImportPackage& node) const;
+    ReturnType operator()(const ast::PackageName& node) const;
+
+    ReturnType operator()(const ast::Entry& node) const;
+
+private:
+    struct Loop {
+        std::vector<size_t> breaks {};
+        std::vector<size_t> continues {};
+    };
+
+    struct Scope {
+        int32_t function = 0;
+        std::vector<std::string> params {};
+        std::vector<Loop> loops {};
+    };
+
+    void visit_(const ast::Value& node) const {
+        node.apply_visitor(*this);
+    }
+    void emit_statement_(const ast::Value& node) const;
+    void emit_load_name_(const std::string& name) const;
+    size_t emit_(OpCode op, int32_t operand = 0, int32_t extra = 0) const;
+    void patch_(size_t index) const;
+    size_t next_address_() const;
+
+    int32_t add_constant_(BoxedValue value) const;
+    int32_t resolve_global_(const std::string& name) const;
+    int32_t compile_function_(FunctionKind kind, const std::string& name,
+                              const std::vector<ast::Value>& params,
+                              const ast::Value& body) const;
+
+    static bool is_statement_(const ast::Value& node);
+    static std::string param_name_(const ast::Value& param);
+
+private:
+    std::shared_ptr<const interpreter::HostFunctions> hosts_ {};
+    mutable std::shared_ptr<Program> program_ {};
+    mutable std::unordered_map<std::string, int32_t> globals_ {};
+    mutable Scope scope_ {};
+};
+
+}    // namespace expressions::vm
+
+#endif
@@ -0,0 +1,911 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/vm/virtual_machine.hpp>
+
+#include <expressions/interpreter/builtins.hpp>
+#include <expressions/interpreter/generator.hpp>
+#include <expressions/interpreter/operators.hpp>
+#include <expressions/vm/compiler.hpp>
+
+#include <expressions/common/enumerate.hpp>
+#include <expressions/common/scope_exit.hpp>
+#include <expressions/exception/throw_exception.hpp>
+
+#include <fmt/format.h>
+#include <boost/type_index.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+
+namespace expressions::vm {
+
+namespace {
+
+using interpreter::Null;
+
+// Arithmetic on the common numeric pairs is handled inline; everything else
+// goes through the generic operators shared with the AST interpreter. Both
+// paths must produce identical results.
+template<typename A, typename B>
+BoxedValue arithmetic(ast::BinOpType op, A a, B b) {
+    switch (op) {
+        case ast::BinOpType::kAdd: {
+            return a + b;
+        }
+        case ast::BinOpType::kSub: {
+            return a - b;
+        }
+        case ast::BinOpType::kMult: {
+            return a * b;
+        }
+        case ast::BinOpType::kTrueDiv: {
+            return a / b;
+        }
+        case ast::BinOpType::kFloorDiv: {
+            return static_cast<int64_t>(a / b);
+        }
+        case ast::BinOpType::kMod: {
+            if constexpr (std::same_as<A, double> || std::same_as<B, double>) {
+                return std::fmod(a, b);
+            } else {
+                return a % b;
+            }
+        }
+        case ast::BinOpType::kPow: {
+            return interpreter::power(a, b);
+        }
+        case ast::BinOpType::kNone: {
+            break;
+        }
+    }
+
+    return {};
+}
+
+template<typename A, typename B>
+bool comparison(ast::CompareOpType op, A a, B b) {
+    switch (op) {
+        case ast::CompareOpType::kEQ: {
+            return a == b;
+        }
+        case ast::CompareOpType::kNEQ: {
+            return a != b;
+        }
+        case ast::CompareOpType::kLT: {
+            return a < b;
+        }
+        case ast::CompareOpType::kLTE: {
+            return a <= b;
+        }
+        case ast::CompareOpType::kGT: {
+            return a > b;
+        }
+        case ast::CompareOpType::kGTE: {
+            return a >= b;
+        }
+        case ast::CompareOpType::kNone:
+        case ast::CompareOpType::kIn:
+        case ast::CompareOpType::kNotIn: {
+            break;
+        }
+    }
+
+    return false;
+}
+
+BoxedValue bin_op(ast::BinOpType op, const BoxedValue& left,
+                  const BoxedValue& right) {
+    if (const auto* lhs = boost::get<int64_t>(&left)) {
+        if (const auto* rhs = boost::get<int64_t>(&right)) {
+            return arithmetic(op, *lhs, *rhs);
+        } else if (const auto* rhs_double = boost::get<double>(&right)) {
+            return arithmetic(op, *lhs, *rhs_double);
+        }
+    } else if (const auto* lhs_double = boost::get<double>(&left)) {
+        if (const auto* rhs = boost::get<double>(&right)) {
+            return arithmetic(op, *lhs_double, *rhs);
+        } else if (const auto* rhs_i64 = boost::get<int64_t>(&right)) {
+            return arithmetic(op, *lhs_double, *rhs_i64);
+        }
+    }
+
+    return interpreter::execute_bin_op(op, left, right);
+}
+
+bool compare_op(ast::CompareOpType op, const BoxedValue& left,
+                const BoxedValue& right) {
+    if (op != ast::CompareOpType::kIn && op != ast::CompareOpType::kNotIn) {
+        if (const auto* lhs = boost::get<int64_t>(&left)) {
+            if (const auto* rhs = boost::get<int64_t>(&right)) {
+                return comparison(op, *lhs, *rhs);
+            } else if (const auto* rhs_double = boost::get<double>(&right)) {
+                return comparison(op, *lhs, *rhs_double);
+            }
+        } else if (const auto* lhs_double = boost::get<double>(&left)) {
+            if (const auto* rhs = boost::get<double>(&right)) {
+                return comparison(op, *lhs_double, *rhs);
+            } else if (const auto* rhs_i64 = boost::get<int64_t>(&right)) {
+                return comparison(op, *lhs_double, *rhs_i64);
+            }
+        }
+    }
+
+    return interpreter::execute_compare_op(op, left, right);
+}
+
+bool condition(const BoxedValue& value) {
+    if (const auto* flag = boost::get<bool>(&value)) {
+        return *flag;
+    }
+
+    return interpreter::check_branch_condition(value);
+}
+
+// The index of the compiled body of a callable, or -1.
+int32_t code_of(const BoxedValue& callee) {
+    if (const auto* lambda = boost::get<interpreter::Lambda>(&callee)) {
+        return lambda->code;
+    } else if (const auto* func = boost::get<interpreter::Function>(&callee)) {
+        return func->code;
+    }
+
+    return -1;
+}
+
+}    // namespace
+
+// Calls back into the program running on the machine.
+class VirtualMachine::Callback final : public interpreter::Caller {
+public:
+    Callback(VirtualMachine& vm, const Program& program)
+        : vm_ {vm}, program_ {program} {}
+
+    BoxedValue call(const BoxedValue& callee,
+                    std::span<const BoxedValue> args) const override {
+        return vm_.call_(program_, callee, args);
+    }
+
+    std::optional<interpreter::CallableSource> source(
+        const BoxedValue& callee) const override {
+        auto code = code_of(callee);
+        if (code < 0 || !program_.functions[code].body) {
+            return std::nullopt;
+        }
+
+        const auto& function = program_.functions[code];
+        return interpreter::CallableSource {function.params.size(),
+                                            function.body.get()};
+    }
+
+private:
+    VirtualMachine& vm_;
+    const Program& program_;
+};
+
+// The state of a call to a generator function: the arguments, where its code
+// stopped and the iterators of the loops it stopped in. Every resume pushes
+// a frame for it again, which kYield pops, so that the frames of other calls
+// come and go in between.
+class VirtualMachine::GeneratorCall final : public interpreter::GeneratorState {
+public:
+    GeneratorCall(VirtualMachine& vm, const Program& program,
+                  const FunctionCode* function, std::vector<BoxedValue> args)
+        : vm_ {vm},
+          program_ {program},
+          function_ {function},
+          args_ {std::move(args)} {}
+
+private:
+    std::optional<BoxedValue> step_() override {
+        auto base = vm_.stack_.size();
+        vm_.stack_.insert(vm_.stack_.end(), args_.begin(), args_.end());
+        vm_.frames_.emplace_back(Frame {function_, ip_, base, base, function_,
+                                        vm_.iterators_.size()});
+        vm_.iterators_.insert(vm_.iterators_.end(),
+                              std::make_move_iterator(iterators_.begin()),
+                              std::make_move_iterator(iterators_.end()));
+        iterators_.clear();
+
+        vm_.generators_.emplace_back(this);
+        auto value = vm_.dispatch_(program_, vm_.frames_.size() - 1);
+        vm_.generators_.pop_back();
+        if (!std::exchange(suspended_, false)) {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+private:
+    friend class VirtualMachine;
+
+    VirtualMachine& vm_;
+    const Program& program_;
+    const FunctionCode* function_ = nullptr;
+    std::vector<BoxedValue> args_ {};
+    size_t ip_ = 0;
+    std::vector<interpreter::Iterator> iterators_ {};
+    bool suspended_ = false;
+};
+
+BoxedValue VirtualMachine::execute(const Program& program) {
+    return run_(program);
+}
+
+BoxedValue VirtualMachine::execute(const ast::Entry& node) {
+    auto program = BytecodeCompiler {}.compile(node);
+
+    return run_(*program);
+}
+
+BoxedValue VirtualMachine::run_(const Program& program) {
+    stack_.clear();
+    frames_.clear();
+    iterators_.clear();
+    generators_.clear();
+    builtin_depth_ = 0;
+    globals_.assign(program.globals.size(), Global {});
+    if (compiled_program_ != program.id) {
+        compiled_program_ = program.id;
+        compiled_.clear();
+        compiled_.resize(program.functions.size());
+    }
+
+    if (jit_ && call_compiled_(program, 0, 0)) {
+        auto result = std::move(stack_.back());
+        stack_.clear();
+        return result;
+    }
+
+    const auto* entry = &program.functions.front();
+    frames_.emplace_back(Frame {entry, 0, 0, 0, entry, 0});
+
+    return dispatch_(program, 0);
+}
+
+BoxedValue VirtualMachine::dispatch_(const Program& program, size_t depth) {
+    auto* frame = &frames_.back();
+    while (true) {
+        const auto& instruction = frame->function->code[frame->ip++];
+        switch (instruction.op) {
+            case OpCode::kNop: {
+                break;
+            }
+            case OpCode::kLoadConst: {
+                stack_.emplace_back(program.constants[instruction.operand]);
+                break;
+            }
+            case OpCode::kPop: {
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kLoadLocal: {
+                stack_.emplace_back(stack_[frame->base + instruction.operand]);
+                break;
+            }
+            case OpCode::kLoadGlobal: {
+                load_global_(program, instruction.operand);
+                frame = &frames_.back();
+                break;
+            }
+            case OpCode::kLoadName: {
+                auto name = program.symbols[instruction.operand];
+                const auto& params = frame->scope->symbols;
+                auto it = std::find(params.begin(), params.end(), name);
+                if (it != params.end()) {
+                    auto index = std::distance(params.begin(), it);
+                    stack_.emplace_back(stack_[frame->base + index]);
+                } else {
+                    load_global_(program, instruction.operand);
+                    frame = &frames_.back();
+                }
+                break;
+            }
+            case OpCode::kStoreGlobal: {
+                auto& global = globals_[instruction.operand];
+                global.value = std::move(stack_.back());
+                global.lazy = -1;
+                global.defined = true;
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kInPlaceGlobal: {
+                auto& global = globals_[instruction.operand];
+                auto op = static_cast<ast::BinOpType>(instruction.extra);
+                auto& left = stack_[stack_.size() - 2];
+                // Dropping the copy that was loaded leaves the global the only
+                // owner of a list or string, which then grows in amortized
+                // O(1) instead of being copied by every `+=`.
+                auto done = false;
+                if (global.defined && global.lazy < 0
+                    && interpreter::shares_contents(left, global.value)) {
+                    left = Null {};
+                    done = interpreter::execute_inplace_op(op, global.value,
+                                                           stack_.back());
+                    if (!done) {
+                        left = global.value;
+                    }
+                }
+                if (!done) {
+                    global.value = bin_op(op, left, stack_.back());
+                    global.lazy = -1;
+                    global.defined = true;
+                }
+                stack_.resize(stack_.size() - 2);
+                break;
+            }
+            case OpCode::kStoreLazy: {
+                auto& global = globals_[instruction.operand];
+                global.value = Null {};
+                global.lazy = instruction.extra;
+                global.defined = true;
+                break;
+            }
+            case OpCode::kBinaryOp: {
+                auto& left = stack_[stack_.size() - 2];
+                left = bin_op(static_cast<ast::BinOpType>(instruction.operand),
+                              left, stack_.back());
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kUnaryOp: {
+                auto& operand = stack_.back();
+                operand = interpreter::execute_unary_op(
+                    static_cast<ast::BoolOpType>(instruction.operand),
+                    operand);
+                break;
+            }
+            case OpCode::kCompareOp: {
+                auto& left = stack_[stack_.size() - 2];
+                left = compare_op(
+                    static_cast<ast::CompareOpType>(instruction.operand), left,
+                    stack_.back());
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kCompareOpChain: {
+                auto& left = stack_[stack_.size() - 2];
+                auto result = compare_op(
+                    static_cast<ast::CompareOpType>(instruction.operand), left,
+                    stack_.back());
+                left = std::move(stack_.back());
+                stack_.back() = result;
+                break;
+            }
+            case OpCode::kSubscript: {
+                auto& object = stack_[stack_.size() - 2];
+                object = interpreter::execute_subscript(object, stack_.back());
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kMakeTuple: {
+                auto first = stack_.end() - instruction.operand;
+                auto values = interpreter::Tuple<BoxedValue> {};
+                auto& elements = values.mutate();
+                elements.reserve(instruction.operand);
+                std::move(first, stack_.end(), std::back_inserter(elements));
+                stack_.erase(first, stack_.end());
+                stack_.emplace_back(std::move(values));
+                break;
+            }
+            case OpCode::kMakeList: {
+                auto first = stack_.end() - instruction.operand;
+                auto values = interpreter::Vector<BoxedValue> {};
+                auto& elements = values.mutate();
+                elements.reserve(instruction.operand);
+                std::move(first, stack_.end(), std::back_inserter(elements));
+                stack_.erase(first, stack_.end());
+                stack_.emplace_back(std::move(values));
+                break;
+            }
+            case OpCode::kMakeSet: {
+                auto first = stack_.end() - instruction.operand;
+                auto values = interpreter::Set<BoxedValue> {};
+                auto& elements = values.mutate();
+                for (auto it = first; it != stack_.end(); ++it) {
+                    elements.emplace(std::move(*it));
+                }
+                stack_.erase(first, stack_.end());
+                stack_.emplace_back(std::move(values));
+                break;
+            }
+            case OpCode::kMakeDict: {
+                auto first = stack_.end() - 2 * instruction.operand;
+                auto items = interpreter::Map<BoxedValue, BoxedValue> {};
+                auto& elements = items.mutate();
+                for (auto it = first; it != stack_.end(); it += 2) {
+                    elements.emplace(std::move(*it), std::move(*(it + 1)));
+                }
+                stack_.erase(first, stack_.end());
+                stack_.emplace_back(std::move(items));
+                break;
+            }
+            case OpCode::kJump: {
+                frame->ip = instruction.operand;
+                break;
+            }
+            case OpCode::kJumpIfFalse: {
+                if (!condition(stack_.back())) {
+                    frame->ip = instruction.operand;
+                }
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kJumpIfTrue: {
+                if (condition(stack_.back())) {
+                    frame->ip = instruction.operand;
+                }
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kIterBegin: {
+                iterators_.emplace_back(std::move(stack_.back()));
+                stack_.pop_back();
+                break;
+            }
+            case OpCode::kIterRange: {
+                auto argc = static_cast<size_t>(instruction.extra);
+                auto first = stack_.end() - static_cast<ptrdiff_t>(argc);
+                iterators_.emplace_back(interpreter::Range::of(
+                    std::span<const BoxedValue> {first, stack_.end()}));
+                stack_.erase(first, stack_.end());
+                break;
+            }
+            case OpCode::kIterNext: {
+                // A generator resumed by the iterator runs on the stack, so
+                // the values are pushed once it has suspended.
+                auto count = static_cast<size_t>(instruction.extra);
+                auto value = BoxedValue {};
+                auto values = std::vector<BoxedValue> {};
+                auto targets = std::span<BoxedValue> {&value, 1};
+                if (count != 1) {
+                    values.resize(count);
+                    targets = values;
+                }
+
+                auto next = iterators_.back().next(targets);
+                frame = &frames_.back();
+                if (!next) {
+                    frame->ip = instruction.operand;
+                    break;
+                }
+                for (auto& target : targets) {
+                    stack_.emplace_back(std::move(target));
+                }
+                break;
+            }
+            case OpCode::kIterEnd: {
+                iterators_.pop_back();
+                break;
+            }
+            case OpCode::kMakeFunction: {
+                const auto& function = program.functions[instruction.operand];
+                if (function.kind == FunctionKind::kLambda) {
+                    stack_.emplace_back(
+                        interpreter::Lambda {{}, instruction.operand});
+                } else {
+                    stack_.emplace_back(interpreter::Function {
+                        {function.name}, {}, instruction.operand});
+                }
+                break;
+            }
+            case OpCode::kCall: {
+                auto callee = std::move(stack_.back());
+                stack_.pop_back();
+
+                const auto& name = boost::get<interpreter::Name>(
+                                       program.constants[instruction.extra])
+                                       .value;
+                auto code = -1;
+                auto type_name = std::string {};
+                if (auto* lambda = boost::get<interpreter::Lambda>(&callee)) {
+                    code = lambda->code;
+                    type_name = boost::typeindex::type_id<decltype(*lambda)>()
+                                    .pretty_name();
+                } else if (auto* func
+                           = boost::get<interpreter::Function>(&callee)) {
+                    code = func->code;
+                    type_name = boost::typeindex::type_id<decltype(*func)>()
+                                    .pretty_name();
+                }
+                if (code < 0) {
+                    type_name = boost::typeindex::type_id<decltype(callee)>()
+                                    .pretty_name();
+                    THROW_EXCEPTION(std::runtime_error(fmt::format(
+                        "Object '{}' references to '{}' is not callable.",
+                        name, type_name)));
+                }
+
+                const auto* function = &program.functions[code];
+                auto argc = static_cast<size_t>(instruction.operand);
+                if (function->params.size() != argc) {
+                    THROW_EXCEPTION(std::runtime_error(fmt::format(
+                        "Failed to call object '{}' references to '{}'. It "
+                        "takes {} arguments "
+                        "but {} were given.",
+                        name, type_name, function->params.size(), argc)));
+                }
+
+                if (function->generator) {
+                    auto first = stack_.end() - static_cast<ptrdiff_t>(argc);
+                    auto args = std::vector<BoxedValue> {
+                        std::make_move_iterator(first),
+                        std::make_move_iterator(stack_.end())};
+                    stack_.erase(first, stack_.end());
+                    stack_.emplace_back(
+                        interpreter::Generator {std::make_shared<GeneratorCall>(
+                            *this, program, function, std::move(args))});
+                    break;
+                }
+                if (jit_ && call_compiled_(program, code, argc)) {
+                    break;
+                }
+
+                auto base = stack_.size() - argc;
+                frames_.emplace_back(Frame {function, 0, base, base,
+                                            function, iterators_.size()});
+                frame = &frames_.back();
+                break;
+            }
+            case OpCode::kCallBuiltin:
+            case OpCode::kCallBuiltinInPlace: {
+                auto argc = static_cast<size_t>(instruction.extra);
+                if (builtin_args_.size() == builtin_depth_) {
+                    builtin_args_.emplace_back();
+                }
+                auto& buffer = builtin_args_[builtin_depth_];
+                auto first = stack_.end() - static_cast<ptrdiff_t>(argc);
+                buffer.assign(std::make_move_iterator(first),
+                              std::make_move_iterator(stack_.end()));
+                stack_.erase(first, stack_.end());
+                auto args = std::span<BoxedValue> {buffer};
+
+                // The value of the global stored to next is handed over to
+                // the call, not copied, and given back if the call throws.
+                auto* variable = static_cast<Global*>(nullptr);
+                if (instruction.op == OpCode::kCallBuiltinInPlace) {
+                    auto& global
+                        = globals_[frame->function->code[frame->ip].operand];
+                    if (global.defined && global.lazy < 0
+                        && interpreter::can_hand_over(args, global.value)) {
+                        args.front()
+                            = std::exchange(global.value, BoxedValue {Null {}});
+                        variable = &global;
+                    }
+                }
+                auto restore = ScopeExit {[&] {
+                    if (variable) {
+                        variable->value = std::move(args.front());
+                    }
+                }};
+
+                ++builtin_depth_;
+                auto result = interpreter::builtin_of(
+                    static_cast<parser::BuiltinFunction>(instruction.operand))(
+                    args, Callback {*this, program});
+                variable = nullptr;
+                --builtin_depth_;
+                builtin_args_[builtin_depth_].clear();
+
+                stack_.emplace_back(std::move(result));
+                // Callbacks may have grown the frames.
+                frame = &frames_.back();
+                break;
+            }
+            case OpCode::kCallHost: {
+                auto argc = static_cast<size_t>(instruction.extra);
+                auto args = std::span<const BoxedValue> {
+                    stack_.data() + stack_.size() - argc, argc};
+
+                const auto& host = program.host_functions[instruction.operand];
+                if (!host.boxed) {
+                    interpreter::throw_unbound_host_function(host.name, argc);
+                }
+                auto result = host.boxed(args);
+
+                stack_.resize(stack_.size() - argc);
+                stack_.emplace_back(std::move(result));
+                break;
+            }
+            case OpCode::kReturn: {
+                auto result = std::move(stack_.back());
+                stack_.resize(frame->sp);
+                iterators_.erase(iterators_.begin()
+                                     + static_cast<ptrdiff_t>(frame->iterators),
+                                 iterators_.end());
+                frames_.pop_back();
+                if (frames_.size() == depth) {
+                    return result;
+                }
+
+                stack_.emplace_back(std::move(result));
+                frame = &frames_.back();
+                break;
+            }
+            case OpCode::kYield: {
+                // Only the frame of a generator call yields, and it is the
+                // one its resume dispatches.
+                auto& generator = *generators_.back();
+                auto first = iterators_.begin()
+                             + static_cast<ptrdiff_t>(frame->iterators);
+                generator.ip_ = frame->ip;
+                generator.iterators_.assign(
+                    std::make_move_iterator(first),
+                    std::make_move_iterator(iterators_.end()));
+                generator.suspended_ = true;
+                iterators_.erase(first, iterators_.end());
+
+                auto value = std::move(stack_.back());
+                stack_.resize(frame->sp);
+                frames_.pop_back();
+                return value;
+            }
+        }
+    }
+}
+
+BoxedValue VirtualMachine::call_(const Program& program,
+                                 const BoxedValue& callee,
+                                 std::span<const BoxedValue> args) {
+    auto code = code_of(callee);
+    if (code < 0) {
+        auto type_name
+            = boost::typeindex::type_id<decltype(callee)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(
+            fmt::format("Object '{}' references to '{}' is not callable.",
+                        "callable", type_name)));
+    }
+    const auto* function = &program.functions[code];
+    if (function->params.size() != args.size()) {
+        auto type_name
+            = boost::typeindex::type_id<decltype(callee)>().pretty_name();
+        THROW_EXCEPTION(std::runtime_error(fmt::format(
+            "Failed to call object '{}' references to '{}'. It "
+            "takes {} arguments "
+            "but {} were given.",
+            "callable", type_name, function->params.size(), args.size())));
+    }
+
+    if (function->generator) {
+        return interpreter::Generator {std::make_shared<GeneratorCall>(
+            *this, program, function,
+            std::vector<BoxedValue> {args.begin(), args.end()})};
+    }
+
+    stack_.insert(stack_.end(), args.begin(), args.end());
+    if (jit_ && call_compiled_(program, code, args.size())) {
+        auto result = std::move(stack_.back());
+        stack_.pop_back();
+        return result;
+    }
+
+    auto base = stack_.size() - args.size();
+    frames_.emplace_back(
+        Frame {function, 0, base, base, function, iterators_.size()});
+
+    return dispatch_(program, frames_.size() - 1);
+}
+
+void VirtualMachine::load_global_(const Program& program, int32_t slot) {
+    const auto& global = globals_[slot];
+    if (!global.defined) {
+        const auto& name = program.globals[slot];
+        fmt::print("Symbol {} not found.\n", name);
+        stack_.emplace_back(interpreter::Name {name});
+        return;
+    }
+
+    if (global.lazy < 0) {
+        stack_.emplace_back(global.value);
+        return;
+    }
+
+    // Lazy code is evaluated on every read, in the scope of the reader.
+    const auto& reader = frames_.back();
+    const auto* function = &program.functions[global.lazy];
+    frames_.emplace_back(
+        Frame {function, 0, reader.base, stack_.size(), reader.scope,
+               iterators_.size()});
+}
+
+bool VirtualMachine::call_compiled_(const Program& program, int32_t code,
+                                    size_t argc) {
+    if (!link_(program, code)) {
+        return false;
+    }
+    auto& compiled_code = compiled_[code];
+
+    auto args = stack_.end() - static_cast<ptrdiff_t>(argc);
+    signature_.clear();
+    for (auto it = args; it != stack_.end(); ++it) {
+        auto type = jit::value_type_of(*it);
+        if (type == jit::ValueType::kUndefined) {
+            return false;
+        }
+        signature_.emplace_back(type);
+    }
+    for (const auto& [index, slot] : enumerate(compiled_code.slots)) {
+        const auto& global = globals_[slot];
+        if (compiled_code.callable[index]) {
+            signature_.emplace_back(jit::ValueType::kFunction);
+        } else if (global.lazy >= 0) {
+            return false;
+        } else {
+            signature_.emplace_back(global.defined
+                                        ? jit::value_type_of(global.value)
+                                        : jit::ValueType::kUndefined);
+        }
+    }
+
+    auto& specializations = compiled_code.specializations;
+    auto it = std::find_if(specializations.begin(), specializations.end(),
+                           [&](const auto& specialization) {
+                               return specialization.signature == signature_;
+                           });
+    if (it == specializations.end()) {
+        if (specializations.size() >= kMaxSpecializations) {
+            return false;
+        }
+        specializations.emplace_back(Specialization {
+            signature_,
+            jit_->compile(compiled_code.function, compiled_code.callees,
+                          compiled_code.names, signature_),
+        });
+        it = specializations.end() - 1;
+    }
+    if (!it->compiled) {
+        return false;
+    }
+
+    const auto& compiled = *it->compiled;
+    inputs_.clear();
+    for (auto arg = args; arg != stack_.end(); ++arg) {
+        inputs_.emplace_back(jit::to_bits(*arg));
+    }
+    for (auto slot : compiled_code.slots) {
+        inputs_.emplace_back(jit::to_bits(globals_[slot].value));
+    }
+    outputs_.assign(1 + 2 * compiled_code.slots.size(), 0);
+
+    compiled.entry(inputs_.data(), outputs_.data());
+
+    for (const auto& [index, slot] : enumerate(compiled_code.slots)) {
+        if (outputs_[2 + 2 * index] != 0) {
+            auto& global = globals_[slot];
+            global.value
+                = jit::from_bits(outputs_[1 + 2 * index], compiled.stores[index]);
+            global.lazy = -1;
+            global.defined = true;
+        }
+    }
+
+    stack_.erase(args, stack_.end());
+    stack_.emplace_back(jit::from_bits(outputs_[0], compiled.result));
+
+    return true;
+}
+
+bool VirtualMachine::link_(const Program& program, int32_t code) {
+    auto code_of = [&](int32_t slot) {
+        const auto& global = globals_[slot];
+        if (!global.defined || global.lazy >= 0) {
+            return -1;
+        } else if (const auto* func
+                   = boost::get<interpreter::Function>(&global.value)) {
+            return func->code;
+        } else if (const auto* lambda
+                   = boost::get<interpreter::Lambda>(&global.value)) {
+            return lambda->code;
+        }
+        return -1;
+    };
+    auto slot_of = [&](const std::string& name) {
+        auto it = std::find(program.globals.begin(), program.globals.end(),
+                            name);
+        if (it == program.globals.end()) {
+            return -1;
+        }
+        return static_cast<int32_t>(std::distance(program.globals.begin(), it));
+    };
+    auto source_of = [&](int32_t function_code) {
+        const auto& function = program.functions[function_code];
+        return jit::FunctionSource {function.name, function.params,
+                                    function.body};
+    };
+    auto add_name = [](std::vector<std::string>& names,
+                       const std::string& name) {
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.emplace_back(name);
+        }
+    };
+
+    auto& compiled_code = compiled_[code];
+    if (compiled_code.linked) {
+        auto valid = std::all_of(
+            compiled_code.guards.begin(), compiled_code.guards.end(),
+            [&](const auto& guard) {
+                return code_of(guard.first) == guard.second;
+            });
+        if (valid) {
+            return compiled_code.supported;
+        }
+    }
+
+    // Relinking drops the code compiled for the previous callees.
+    auto linked = CompiledCode {};
+    linked.analyzed = compiled_code.analyzed;
+    linked.analysis = std::move(compiled_code.analysis);
+    linked.linked = true;
+    compiled_code = std::move(linked);
+
+    auto functions = std::vector<int32_t> {code};
+    for (size_t i = 0; i < functions.size(); ++i) {
+        const auto& analysis = analyze_(program, functions[i]);
+        if (!analysis) {
+            return false;
+        }
+        for (const auto& name : analysis->names) {
+            add_name(compiled_code.names, name);
+        }
+        for (const auto& callee : analysis->callees) {
+            add_name(compiled_code.names, callee);
+            if (compiled_code.callees.contains(callee)) {
+                continue;
+            }
+
+            auto slot = slot_of(callee);
+            auto callee_code = slot < 0 ? -1 : code_of(slot);
+            if (callee_code < 0) {
+                return false;
+            }
+            compiled_code.guards.emplace_back(slot, callee_code);
+            compiled_code.callees[callee] = source_of(callee_code);
+            if (std::find(functions.begin(), functions.end(), callee_code)
+                == functions.end()) {
+                functions.emplace_back(callee_code);
+            }
+        }
+    }
+
+    for (const auto& name : compiled_code.names) {
+        auto slot = slot_of(name);
+        if (slot < 0) {
+            return false;
+        }
+        compiled_code.slots.emplace_back(slot);
+        compiled_code.callable.emplace_back(
+            compiled_code.callees.contains(name));
+    }
+    compiled_code.function = source_of(code);
+    compiled_code.supported = true;
+
+    return true;
+}
+
+auto VirtualMachine::analyze_(const Program& program, int32_t code)
+    -> const std::optional<jit::FunctionAnalysis>& {
+    auto& compiled_code = compiled_[code];
+    if (!compiled_code.analyzed) {
+        compiled_code.analyzed = true;
+
+        const auto& function = program.functions[code];
+        if (function.body) {
+            compiled_code.analysis
+                = jit::JITCompiler::analyze(function.params, *function.body);
+        }
+    }
+
+    return compiled_code.analysis;
+}
+
+}    // namespace expressions::vm
@@ -0,0 +1,136 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_VM_VIRTUAL_MACHINE_HPP__
+#define __EXPRESSIONS_VM_VIRTUAL_MACHINE_HPP__
+
+#include <expressions/ast/ast.hpp>
+#include <expressions/interpreter/iterator.hpp>
+#include <expressions/jit/jit_compiler.hpp>
+#include <expressions/vm/bytecode.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace expressions::vm {
+
+// Stack-based virtual machine running the bytecode produced by
+// BytecodeCompiler. A compiled Program is immutable and can be executed any
+// number of times, by any number of machines.
+//
+// When constructed with a JITCompiler, functions are compiled to native code
+// on their first call and run natively whenever the types of their arguments
+// and of the globals they use are supported by the JIT.
+class VirtualMachine {
+public:
+    VirtualMachine() = default;
+    explicit VirtualMachine(std::shared_ptr<jit::JITCompiler> jit)
+        : jit_ {std::move(jit)} {}
+
+    BoxedValue execute(const Program& program);
+    BoxedValue execute(const ast::Entry& node);
+
+private:
+    struct Frame {
+        const FunctionCode* function = nullptr;
+        size_t ip = 0;
+        // Index of the first local slot on the value stack.
+        size_t base = 0;
+        // Stack height to restore when the frame returns.
+        size_t sp = 0;
+        // Function whose locals are visible to dynamic name lookups.
+        const FunctionCode* scope = nullptr;
+        // Iterator stack height to restore when the frame returns.
+        size_t iterators = 0;
+    };
+
+    struct Global {
+        BoxedValue value {};
+        int32_t lazy = -1;
+        bool defined = false;
+    };
+
+    struct Specialization {
+        std::vector<jit::ValueType> signature {};
+        // Empty if the function cannot be compiled for the signature.
+        std::optional<jit::CompiledFunction> compiled {};
+    };
+
+    struct CompiledCode {
+        bool analyzed = false;
+        std::optional<jit::FunctionAnalysis> analysis {};
+
+        // The function is compiled together with every function it calls.
+        // The callees are resolved through the globals when the function is
+        // linked, and the guards record the (slot, function) pairs the link
+        // depends on.
+        bool linked = false;
+        bool supported = false;
+        jit::FunctionSource function {};
+        std::unordered_map<std::string, jit::FunctionSource> callees {};
+        std::vector<std::pair<int32_t, int32_t>> guards {};
+        std::vector<std::string> names {};
+        std::vector<int32_t> slots {};
+        std::vector<bool> callable {};
+        std::vector<Specialization> specializations {};
+    };
+
+    // Upper bound of the signatures compiled for a single function.
+    static constexpr size_t kMaxSpecializations = 8;
+
+    class Callback;
+    class GeneratorCall;
+
+    BoxedValue run_(const Program& program);
+    // Runs the frames from frames_[depth] on until that one returns, and
+    // returns its result.
+    BoxedValue dispatch_(const Program& program, size_t depth);
+    // Calls a Lambda or a Function from a builtin taking a callable.
+    BoxedValue call_(const Program& program, const BoxedValue& callee,
+                     std::span<const BoxedValue> args);
+    void load_global_(const Program& program, int32_t slot);
+    // Runs functions[code] natively on the argc values on top of the stack
+    // and replaces them with the result. Returns false, leaving the stack
+    // untouched, if there is no native code for the current types.
+    bool call_compiled_(const Program& program, int32_t code, size_t argc);
+    bool link_(const Program& program, int32_t code);
+    auto analyze_(const Program& program, int32_t code)
+        -> const std::optional<jit::FunctionAnalysis>&;
+
+private:
+    std::vector<BoxedValue> stack_ {};
+    std::vector<Frame> frames_ {};
+    std::vector<Global> globals_ {};
+    // The iterators of the range-based for statements in progress. They keep
+    // their address while a generator they resume runs loops of its own.
+    std::deque<interpreter::Iterator> iterators_ {};
+    // The generator calls running, the innermost last.
+    std::vector<GeneratorCall*> generators_ {};
+    // The arguments of the builtin calls in progress, by nesting level. They
+    // are moved off the stack, which the callbacks of a builtin may grow.
+    std::vector<std::vector<BoxedValue>> builtin_args_ {};
+    size_t builtin_depth_ = 0;
+
+    std::shared_ptr<jit::JITCompiler> jit_ {};
+    uint64_t compiled_program_ = 0;
+    std::vector<CompiledCode> compiled_ {};
+    std::vector<jit::ValueType> signature_ {};
+    std::vector<uint64_t> inputs_ {};
+    std::vector<uint64_t> outputs_ {};
+};
+
+}    // namespace expressions::vm
+
+#endif
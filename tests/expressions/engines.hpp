@@ -0,0 +1,146 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#ifndef __EXPRESSIONS_TESTS_ENGINES_HPP__
+#define __EXPRESSIONS_TESTS_ENGINES_HPP__
+
+#include <expressions/closure/closure_compiler.hpp>
+#include <expressions/closure/closure_interpreter.hpp>
+#include <expressions/interpreter/ast_interpreter.hpp>
+#include <expressions/interpreter/host_functions.hpp>
+#include <expressions/jit/jit_compiler.hpp>
+#include <expressions/parser/parser.hpp>
+#include <expressions/vm/compiler.hpp>
+#include <expressions/vm/virtual_machine.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+namespace expressions::tests {
+
+enum class Engine : int32_t {
+    kAST,
+    kVM,
+    kJIT,
+    kTiered,
+    kClosure,
+};
+
+inline constexpr auto kEngines = std::array {
+    Engine::kAST, Engine::kVM, Engine::kJIT, Engine::kTiered, Engine::kClosure,
+};
+
+inline std::string_view name_of(Engine engine) {
+    switch (engine) {
+        case Engine::kAST: {
+            return "ast";
+        }
+        case Engine::kVM: {
+            return "vm";
+        }
+        case Engine::kJIT: {
+            return "jit";
+        }
+        case Engine::kTiered: {
+            return "tiered";
+        }
+        case Engine::kClosure: {
+            return "closure";
+        }
+    }
+
+    return "unknown";
+}
+
+// Runs the script on the engine and returns the value it exits with. The
+// tiered engine compiles functions and loops after two calls or iterations,
+// so that short scripts cross the thresholds too.
+inline interpreter::BoxedValue run(
+    Engine engine, std::string_view script,
+    std::shared_ptr<const interpreter::HostFunctions> hosts = {}) {
+    auto tree = parser::ExpressionsParser {}.parse_to_ast(script);
+    if (!tree) {
+        THROW_EXCEPTION(std::invalid_argument("Failed to parse the script."));
+    }
+
+    switch (engine) {
+        case Engine::kAST: {
+            return interpreter::ASTInterpreter {hosts}.execute(*tree);
+        }
+        case Engine::kVM: {
+            auto program = vm::BytecodeCompiler {hosts}.compile(*tree);
+            return vm::VirtualMachine {}.execute(*program);
+        }
+        case Engine::kJIT: {
+            auto program = vm::BytecodeCompiler {hosts}.compile(*tree);
+            auto machine
+                = vm::VirtualMachine {std::make_shared<jit::JITCompiler>()};
+            return machine.execute(*program);
+        }
+        case Engine::kTiered: {
+            auto interp = interpreter::ASTInterpreter {
+                std::make_shared<jit::JITCompiler>(),
+                interpreter::TierPolicy {2, 2}, hosts};
+            return interp.execute(*tree);
+        }
+        case Engine::kClosure: {
+            auto program = closure::ClosureCompiler {hosts}.compile(*tree);
+            return closure::ClosureInterpreter {}.execute(*program);
+        }
+    }
+
+    return interpreter::Null {};
+}
+
+// The value as the tests spell it: scalars, strings and lists of them.
+inline std::string to_string(const interpreter::BoxedValue& value) {
+    using namespace interpreter;
+
+    if (boost::get<Null>(&value)) {
+        return "null";
+    } else if (const auto* boolean = boost::get<bool>(&value)) {
+        return *boolean ? "true" : "false";
+    } else if (const auto* value_i64 = boost::get<int64_t>(&value)) {
+        return fmt::format("{}", *value_i64);
+    } else if (const auto* value_u64 = boost::get<uint64_t>(&value)) {
+        return fmt::format("{}", *value_u64);
+    } else if (const auto* value_f64 = boost::get<double>(&value)) {
+        return fmt::format("{}", *value_f64);
+    } else if (const auto* string = boost::get<String>(&value)) {
+        return fmt::format("'{}'", string->view());
+    } else if (const auto* list = boost::get<Vector<BoxedValue>>(&value)) {
+        auto result = std::string {"["};
+        for (size_t index = 0; index < list->size(); ++index) {
+            if (index > 0) {
+                result += ", ";
+            }
+            result += to_string(list->get()[index]);
+        }
+        return result + "]";
+    } else if (const auto* tuple = boost::get<Tuple<BoxedValue>>(&value)) {
+        auto result = std::string {"("};
+        for (size_t index = 0; index < tuple->size(); ++index) {
+            if (index > 0) {
+                result += ", ";
+            }
+            result += to_string(tuple->get()[index]);
+        }
+        return result + ")";
+    }
+
+    return "<unprintable>";
+}
+
+}    // namespace expressions::tests
+
+#endif
@@ -0,0 +1,103 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/ast_interpreter.hpp>
+#include <expressions/parser/parser.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+namespace {
+
+using namespace expressions;
+
+// Every script performs kOperations function calls or loop iterations, so the
+// items per second of each benchmark compare directly. The scripts spell it
+// kOperations too, which is replaced with its value before they are parsed.
+constexpr auto kOperations = int64_t {20000};
+
+// A function returning a value, called once per iteration.
+constexpr auto kReturnScript = std::string_view {R"(
+package benchmark.calls;
+
+def square(x) {
+    return x * x;
+}
+
+total = 0;
+for (i = 0; i < kOperations; i += 1) {
+    total += square(i);
+}
+)"};
+
+// A lambda returning per element, in the style of examples/array.es.
+constexpr auto kLambdaScript = std::string_view {R"(
+package benchmark.lambdas;
+
+is_small = (e) => return e < 10000;
+
+count = 0;
+for (i = 0; i < kOperations; i += 1) {
+    if (is_small(i)) {
+        count += 1;
+    }
+}
+)"};
+
+// Every other iteration continues and the loop ends with a break.
+constexpr auto kLoopControlScript = std::string_view {R"(
+package benchmark.loops;
+
+count = 0;
+for (i = 0; i < kOperations; i += 1) {
+    if (i % 2 == 0) {
+        continue;
+    }
+    if (i == kOperations - 1) {
+        break;
+    }
+    count += 1;
+}
+)"};
+
+std::string with_operations(std::string_view script) {
+    constexpr auto kName = std::string_view {"kOperations"};
+    auto source = std::string {script};
+    for (auto at = source.find(kName); at != std::string::npos;
+         at = source.find(kName, at)) {
+        source.replace(at, kName.size(), std::to_string(kOperations));
+    }
+
+    return source;
+}
+
+void execute_script(benchmark::State& state, std::string_view script) {
+    auto tree = parser::ExpressionsParser {}.parse_to_ast(
+        with_operations(script));
+    if (!tree) {
+        state.SkipWithError("Failed to parse the script.");
+        return;
+    }
+
+    for (auto _ : state) {
+        auto interp = interpreter::ASTInterpreter {};
+        benchmark::DoNotOptimize(interp.execute(*tree));
+    }
+    state.SetItemsProcessed(state.iterations() * kOperations);
+}
+
+BENCHMARK_CAPTURE(execute_script, function_return, kReturnScript)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(execute_script, lambda_return, kLambdaScript)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(execute_script, break_continue, kLoopControlScript)
+    ->Unit(benchmark::kMillisecond);
+
+}    // namespace
@@ -0,0 +1,229 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/engines.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+namespace {
+
+using namespace expressions;
+
+std::shared_ptr<ast::Entry> parse(std::string_view script) {
+    auto tree = parser::ExpressionsParser {}.parse_to_ast(script);
+    if (!tree) {
+        ADD_FAILURE() << "Failed to parse:" << script;
+        return std::make_shared<ast::Entry>();
+    }
+
+    return tree;
+}
+
+// Hosts that keep an interpreter across scripts may parse each one into the
+// same Entry, so the state kept for a tree must not outlive it.
+class ASTInterpreterTest : public ::testing::Test {
+protected:
+    std::string execute(std::string_view script) {
+        return execute(interp_, script);
+    }
+    std::string execute(const interpreter::ASTInterpreter& interp,
+                        std::string_view script) {
+        *tree_ = *parse(script);
+        return tests::to_string(interp.execute(*tree_));
+    }
+
+    interpreter::ASTInterpreter interp_ {};
+    std::shared_ptr<ast::Entry> tree_ = std::make_shared<ast::Entry>();
+};
+
+TEST_F(ASTInterpreterTest, ReparsingIntoTheSameEntryRebindsTheGlobals) {
+    EXPECT_EQ(execute(R"(
+package test;
+
+a = 10;
+b = 20;
+return a;
+)"),
+              "10");
+    EXPECT_EQ(execute(R"(
+package test;
+
+b = 0;
+return [a, b];
+)"),
+              "[10, 0]");
+}
+
+TEST_F(ASTInterpreterTest, ReparsingIntoTheSameEntryRunsTheNewDefinitions) {
+    EXPECT_EQ(execute(R"(
+package test;
+
+def f() {
+    return "first";
+}
+return f();
+)"),
+              "'first'");
+    EXPECT_EQ(execute(R"(
+package test;
+
+def f() {
+    return "second";
+}
+return f();
+)"),
+              "'second'");
+}
+
+TEST_F(ASTInterpreterTest, ReparsingIntoTheSameEntryBuildsTheNewLiterals) {
+    EXPECT_EQ(execute(R"(
+package test;
+
+return [[1, 2], "ab", 3 in {3}];
+)"),
+              "[[1, 2], 'ab', true]");
+    EXPECT_EQ(execute(R"(
+package test;
+
+return [[3, 4], "cd", 3 in {4}];
+)"),
+              "[[3, 4], 'cd', false]");
+}
+
+// Functions and loops of the new tree start cold, and are compiled from their
+// own source once they get hot.
+TEST_F(ASTInterpreterTest, ReparsingIntoTheSameEntryStartsTheHotSpotsCold) {
+    auto tiered = interpreter::ASTInterpreter {
+        std::make_shared<jit::JITCompiler>(), interpreter::TierPolicy {2, 2}};
+    EXPECT_EQ(execute(tiered, R"(
+package test;
+
+def f(x) {
+    return x + 1;
+}
+total = 0;
+for (i = 0; i < 10; i += 1) {
+    total += f(i);
+}
+return total;
+)"),
+              "55");
+    EXPECT_EQ(execute(tiered, R"(
+package test;
+
+def f(x) {
+    return x * 10;
+}
+total = 0;
+for (i = 0; i < 10; i += 1) {
+    total += f(i);
+}
+return total;
+)"),
+              "450");
+}
+
+// Hot functions and loops run compiled code once past the thresholds, which
+// must give the interpreter's results whatever the types it meets.
+TEST_F(ASTInterpreterTest, TieringUpKeepsTheResults) {
+    constexpr auto kScript = R"(
+package test;
+
+def f(x) {
+    return x * 2 + 1;
+}
+ints = 0;
+doubles = 0.0;
+for (i = 0; i < 20; i += 1) {
+    ints += f(i);
+    doubles += f(i + 0.5);
+    if (i == 10) {
+        objects = f(2.0) + len([i, i]);
+    }
+}
+return [ints, doubles, objects, i];
+)";
+    auto tiered = interpreter::ASTInterpreter {
+        std::make_shared<jit::JITCompiler>(), interpreter::TierPolicy {1, 1}};
+    EXPECT_EQ(execute(kScript), "[400, 420, 7, 20]");
+    EXPECT_EQ(execute(tiered, kScript), "[400, 420, 7, 20]");
+}
+
+// Code inlining a function is dropped once the global holding it is given
+// another function.
+TEST_F(ASTInterpreterTest, TieringUpFollowsRedefinedCallees) {
+    auto tiered = interpreter::ASTInterpreter {
+        std::make_shared<jit::JITCompiler>(), interpreter::TierPolicy {2, 2}};
+    EXPECT_EQ(execute(tiered, R"(
+package test;
+
+def g(x) {
+    return x + 1;
+}
+def f(x) {
+    return g(x) * 10;
+}
+total = 0;
+for (i = 0; i < 10; i += 1) {
+    if (i == 5) {
+        g = (x) => return x + 2;
+    }
+    total += f(i);
+}
+return total;
+)"),
+              "600");
+}
+
+// Globals outlive a script that threw, so a variable handed over to an in
+// place call must get its value back.
+TEST_F(ASTInterpreterTest, InPlaceCallsThatThrowKeepTheVariable) {
+    EXPECT_THROW(execute(R"(
+package test;
+
+xs = [2, "a", 1];
+xs = nth_element(xs, 3);
+)"),
+                 std::out_of_range);
+    EXPECT_EQ(execute(R"(
+package test;
+
+return xs;
+)"),
+              "[2, 'a', 1]");
+}
+
+// A generator whose body threw is over: resuming it again ends the loop
+// instead of reporting that it is still running.
+TEST_F(ASTInterpreterTest, GeneratorsThatThrewAreExhausted) {
+    auto tree = parse(R"(
+package test;
+
+def dates(n) {
+    yield 1;
+    yield add_days(2022-01-01, n);
+    yield 3;
+}
+return dates(4294967296);
+)");
+    auto value = interp_.execute(*tree);
+    const auto* generator = boost::get<interpreter::Generator>(&value);
+    ASSERT_TRUE(generator);
+
+    auto first = generator->state->resume();
+    ASSERT_TRUE(first);
+    EXPECT_EQ(tests::to_string(*first), "1");
+    EXPECT_THROW(generator->state->resume(), std::out_of_range);
+    EXPECT_FALSE(generator->state->resume());
+}
+
+}    // namespace
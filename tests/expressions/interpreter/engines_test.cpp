@@ -0,0 +1,619 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/engines.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+namespace {
+
+using namespace expressions;
+using tests::Engine;
+
+// Every engine runs the same scripts and must exit with the same value.
+class EnginesTest : public ::testing::TestWithParam<Engine> {
+protected:
+    static std::string run(std::string_view script) {
+        return tests::to_string(tests::run(GetParam(), script));
+    }
+};
+
+TEST_P(EnginesTest, ReturnUnwindsNestedLoops) {
+    EXPECT_EQ(run(R"(
+package test;
+
+def find(n, target) {
+    for (i = 0; i < n; i += 1) {
+        j = 0;
+        while (j < n) {
+            if (i * j == target) {
+                return [i, j];
+            }
+            j += 1;
+        }
+    }
+    return [-1, -1];
+}
+
+return [find(10, 12), find(3, 100)];
+)"),
+              "[[2, 6], [-1, -1]]");
+}
+
+TEST_P(EnginesTest, BreakAndContinueStayInTheirLoop) {
+    EXPECT_EQ(run(R"(
+package test;
+
+count = 0;
+for (i = 0; i < 5; i += 1) {
+    for (j = 0; j < 5; j += 1) {
+        if (j == 3) {
+            break;
+        }
+        if (j == 1) {
+            continue;
+        }
+        count += 1;
+    }
+}
+
+def first_odd(xs) {
+    for (x : xs) {
+        if (x % 2 == 0) {
+            continue;
+        }
+        return x;
+    }
+    return -1;
+}
+
+return [count, first_odd([2, 4, 7, 9]), first_odd([2])];
+)"),
+              "[10, 7, -1]");
+}
+
+TEST_P(EnginesTest, AssignmentsShareContainersUntilWritten) {
+    EXPECT_EQ(run(R"(
+package test;
+
+a = [1, 2];
+b = a;
+a += [3];
+c = b;
+b += [4.5];
+
+s = "ab";
+t = s;
+s += "c";
+u = t;
+t += "d";
+
+def append(xs, x) {
+    return xs + [x];
+}
+d = append(c, 9);
+
+return [a, b, c, d, s, t, u];
+)"),
+              "[[1, 2, 3], [1, 2, 4.5], [1, 2], [1, 2, 9], 'abc', 'abd', "
+              "'ab']");
+}
+
+// Only names can be assigned to.
+TEST_P(EnginesTest, AssignmentsRejectTargetsOtherThanNames) {
+    EXPECT_EQ(run("package test;\n\na = [1];\na += [2];\nreturn a;\n"),
+              "[1, 2]");
+    EXPECT_THROW(run("package test;\n\na = [1];\na[0] = 2;\nreturn a;\n"),
+                 std::runtime_error);
+    EXPECT_THROW(run("package test;\n\na = [1];\na[0] += 2;\nreturn a;\n"),
+                 std::runtime_error);
+    EXPECT_THROW(run("package test;\n\na = [1];\na[0] := 2;\nreturn a;\n"),
+                 std::runtime_error);
+}
+
+TEST_P(EnginesTest, AppendsToMixedLists) {
+    EXPECT_EQ(run(R"(
+package test;
+
+out = ["start"];
+for (i = 0; i < 3000; i += 1) {
+    out += [i];
+}
+out += [1.5];
+
+return [len(out), out[0], out[2999], out[3001]];
+)"),
+              "[3002, 'start', 2998, 1.5]");
+}
+
+TEST_P(EnginesTest, AppendsReadTheTargetBeforeTheOperand) {
+    EXPECT_EQ(run(R"(
+package test;
+
+a = [1];
+b = a;
+a += a;
+
+def reset() {
+    a = [7];
+    return [2, 3];
+}
+a += reset();
+
+s = "x";
+t = s;
+s += s;
+
+return [a, b, s, t];
+)"),
+              "[[1, 1, 2, 3], [1], 'xx', 'x']");
+}
+
+TEST_P(EnginesTest, InPlaceCallsLeaveAliasesAlone) {
+    EXPECT_EQ(run(R"(
+package test;
+
+heap = [3, 1, 2];
+alias = heap;
+heap = make_heap(heap);
+heap = push_heap(heap + [5]);
+
+return [alias, heap[0], len(heap)];
+)"),
+              "[[3, 1, 2], 5, 4]");
+}
+
+// A callable argument may read the variable while the call runs, so the
+// variable keeps its value instead of handing it over.
+TEST_P(EnginesTest, InPlaceCallsLetCallablesReadTheVariable) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [3, 1, 2];
+xs = sort(xs, (x, y) => return len(xs) == 3 and x < y);
+ys = [3, 1, 2];
+ys = sort(ys, (x, y) => return x < y);
+
+return [xs, ys];
+)"),
+              "[[1, 2, 3], [1, 2, 3]]");
+}
+
+// Comparators of the form `a < b` or `a > b`, in either order of the
+// parameters, are recognized and compared natively.
+TEST_P(EnginesTest, SortsByRecognizedComparators) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [3, 1, 2];
+return [
+    sort(xs, (a, b) => return a < b),
+    sort(xs, (a, b) => return a > b),
+    sort(xs, (a, b) => return b < a),
+    sort(xs, (a, b) => return b > a),
+    sort([2.5, 0.5, 1.5], (a, b) => return a > b),
+    stable_sort(["b", "c", "a"]),
+    xs
+];
+)"),
+              "[[1, 2, 3], [3, 2, 1], [3, 2, 1], [1, 2, 3], [2.5, 1.5, 0.5], "
+              "['a', 'b', 'c'], [3, 1, 2]]");
+}
+
+// Maps and sets order like std::map and std::set do.
+TEST_P(EnginesTest, SortsMapsAndSets) {
+    EXPECT_EQ(run(R"(
+package test;
+
+maps = sort([{"b": 1}, {"a": 2}, {"a": 1, "c": 0}]);
+sets = sort([{3, 1}, {2}, {1}]);
+return [
+    len(maps[0]), "a" in maps[1], "b" in maps[2],
+    len(sets[0]), 3 in sets[1], 2 in sets[2]
+];
+)"),
+              "[2, true, true, 1, true, true]");
+}
+
+// Keys and comparisons of keys made of the parameters, literals, arithmetic
+// and subscripts are evaluated once per element; others call the script.
+TEST_P(EnginesTest, SortsByKeys) {
+    EXPECT_EQ(run(R"(
+package test;
+
+scale = -1;
+pairs = [[1, "b"], [2, "a"], [3, "b"], [4, "a"]];
+return [
+    stable_sort(pairs, (p) => return p[1]),
+    stable_sort(pairs, (p, q) => return p[1] > q[1]),
+    stable_sort(pairs, (p, q) => return q[0] % 2 < p[0] % 2),
+    sort([3, 1, 2], (x) => return x * scale),
+    sort([-3, 1, -2], (x) => return abs(x)),
+    sort([3, 1, 2], (x, y) => return x * 2 < y * 2)
+];
+)"),
+              "[[[2, 'a'], [4, 'a'], [1, 'b'], [3, 'b']], "
+              "[[1, 'b'], [3, 'b'], [2, 'a'], [4, 'a']], "
+              "[[1, 'b'], [3, 'b'], [2, 'a'], [4, 'a']], "
+              "[3, 2, 1], [1, -2, -3], [1, 2, 3]]");
+}
+
+// Orders that are not strict weak ones, like `<=` or NaNs, must not run the
+// sort past the list.
+TEST_P(EnginesTest, SortsWithoutAStrictWeakOrder) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [3, 1, 2, 1, 3, 2, 1, 3, 2, 1, 3, 2, 1, 3, 2, 1, 3, 2];
+ys = sort(xs, (a, b) => return a <= b);
+nans = sort([2.0, sqrt(-1.0), 1.0, sqrt(-1.0), 0.5]);
+return [ys, len(nans), stable_sort([2, "a", 1])];
+)"),
+              "[[1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3], 5, "
+              "[1, 2, 'a']]");
+}
+
+// Callables reading the variable sorted in place see its value.
+TEST_P(EnginesTest, SortsInPlaceLetCallablesReadTheVariable) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [3, 1, 2];
+xs = stable_sort(xs, (x) => return x * len(xs));
+ys = [3, 1, 2];
+ys = sort(ys, (a, b) => return a < b);
+return [xs, ys];
+)"),
+              "[[1, 2, 3], [1, 2, 3]]");
+}
+
+TEST_P(EnginesTest, TopKKeepsTheGreatestFirst) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [1, 3, 2, 3, 1];
+pairs = [[1, "b"], [2, "a"], [3, "b"], [4, "a"]];
+return [
+    top_k(xs, 0),
+    top_k(xs, 3),
+    top_k(xs, 10),
+    top_k([0.5, 2.5, 1.5], 2),
+    top_k(pairs, 3, (p) => return p[1]),
+    top_k([-3, 1, -2], 2, (x) => return abs(x)),
+    xs
+];
+)"),
+              "[[], [3, 3, 2], [3, 3, 2, 1, 1], [2.5, 1.5], "
+              "[[1, 'b'], [3, 'b'], [2, 'a']], [-3, -2], [1, 3, 2, 3, 1]]");
+    EXPECT_THROW(run(R"(
+package test;
+
+return top_k([1, 2], 0 - 1);
+)"),
+                 std::invalid_argument);
+}
+
+// Only the nth element is known: the others are compared through the sorted
+// list, which must still hold every element.
+TEST_P(EnginesTest, NthElementSelectsWhatSortingWouldPutThere) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [5, 1, 4, 2, 3, 2];
+first = nth_element(xs, 0);
+third = nth_element(xs, 2);
+last = nth_element(xs, 5);
+greatest = nth_element(xs, 0, (a, b) => return a > b);
+fallback = nth_element(xs, 3, (a, b) => return a <= b);
+keyed = nth_element([[1, "b"], [2, "a"]], 0, (p, q) => return p[1] < q[1]);
+return [
+    first[0], third[2], last[5], greatest[0], fallback[3], keyed[0],
+    sort(third) == sort(xs), xs
+];
+)"),
+              "[1, 2, 5, 5, 3, [2, 'a'], true, [5, 1, 4, 2, 3, 2]]");
+    EXPECT_THROW(run(R"(
+package test;
+
+return nth_element([1, 2], 2);
+)"),
+                 std::out_of_range);
+}
+
+// Callables reading the variable rearranged in place see its value.
+TEST_P(EnginesTest, NthElementInPlaceLetsCallablesReadTheVariable) {
+    EXPECT_EQ(run(R"(
+package test;
+
+xs = [3, 1, 2];
+xs = nth_element(xs, 0, (a, b) => return len(xs) == 3 and a < b);
+ys = [3, 1, 2];
+ys = nth_element(ys, 0);
+return [xs[0], len(xs), ys[0], len(ys)];
+)"),
+              "[1, 3, 1, 3]");
+}
+
+// Maps give their keys, or their items to two targets, and maps and sets
+// walk in insertion order.
+TEST_P(EnginesTest, RangeBasedForWalksMapsAndSets) {
+    EXPECT_EQ(run(R"(
+package test;
+
+m = {"b": 1, "a": 2, "c": 3};
+keys = [];
+for (k : m) {
+    keys += [k];
+}
+items = [];
+total = 0;
+for (k, v : m) {
+    items += [k];
+    total += v;
+}
+elements = [];
+for (e : {3, 1, 2, 1}) {
+    elements += [e];
+}
+empty = 0;
+for (k, v : {}) {
+    empty += 1;
+}
+return [keys, items, total, elements, empty];
+)"),
+              "[['b', 'a', 'c'], ['b', 'a', 'c'], 6, [3, 1, 2], 0]");
+}
+
+// Strings give their UTF-8 characters, as strings.
+TEST_P(EnginesTest, RangeBasedForWalksStrings) {
+    EXPECT_EQ(run(R"(
+package test;
+
+chars = [];
+for (c : "hé!") {
+    chars += [c];
+}
+count = 0;
+for (c : "") {
+    count += 1;
+}
+for (c : "abc") {
+    if (c == "b") {
+        continue;
+    }
+    count += 1;
+}
+return [chars, count];
+)"),
+              "[['h', 'é', '!'], 2]");
+}
+
+TEST_P(EnginesTest, GeneratorsResumeWhereTheyYielded) {
+    EXPECT_EQ(run(R"(
+package test;
+
+def count(n) {
+    i = 0;
+    while (i < n) {
+        yield i;
+        i += 1;
+    }
+}
+
+def evens(xs) {
+    for (x : xs) {
+        if (x % 2 == 0) {
+            yield x;
+        }
+    }
+}
+
+out = [];
+for (e : evens(count(10))) {
+    out += [e];
+}
+return out;
+)"),
+              "[0, 2, 4, 6, 8]");
+}
+
+TEST_P(EnginesTest, GeneratorsAreExhaustedOnce) {
+    EXPECT_EQ(run(R"(
+package test;
+
+def until(n) {
+    for (k : range(n)) {
+        yield k;
+        if (k == 2) {
+            return 100;
+        }
+    }
+}
+
+g = until(10);
+first = [];
+for (x : g) {
+    first += [x];
+    if (x == 1) {
+        break;
+    }
+}
+rest = [];
+for (x : g) {
+    rest += [x];
+}
+empty = [];
+for (x : g) {
+    empty += [x];
+}
+
+return [first, rest, empty];
+)"),
+              "[[0, 1], [2], []]");
+}
+
+TEST_P(EnginesTest, ScriptDefinitionsShadowBuiltins) {
+    EXPECT_EQ(run(R"(
+package test;
+
+def report(x) {
+    return log("value") + max(x, 1, 2);
+}
+
+def log(msg) {
+    return msg + "!";
+}
+
+def max(a, b, c) {
+    return "max";
+}
+
+sort = (xs) => return len(xs);
+
+def scale(abs) {
+    return abs(3);
+}
+
+return [report(5), sort([3, 1, 2]), scale((x) => return x * 2), min(4, 2)];
+)"),
+              "['value!max', 3, 6, 2]");
+}
+
+TEST_P(EnginesTest, BuiltinDeclarationsKeepTheBuiltin) {
+    EXPECT_EQ(run(R"(
+package test;
+
+@builtin
+def sqrt(x) -> double;
+
+return sqrt(16.0);
+)"),
+              "4");
+}
+
+// Host functions take and return scripts' values as C++ ones, and overload
+// on the number of arguments.
+TEST_P(EnginesTest, HostFunctionsMarshalTheirArguments) {
+    auto recorded = int64_t {0};
+    auto hosts = std::make_shared<interpreter::HostFunctions>();
+    hosts->define("scale", [](double x, int64_t k) { return x * k; });
+    hosts->define("greet", [](std::string_view name) {
+        return "hi " + std::string {name};
+    });
+    hosts->define("negate", [](bool value) { return !value; });
+    hosts->define("count", [](std::span<const interpreter::BoxedValue> args) {
+        return args.size();
+    });
+    hosts->define("pick", [](int64_t x) { return x; });
+    hosts->define("pick", [](int64_t x, int64_t y) { return x * 10 + y; });
+    hosts->define("record", [&](int64_t x) { recorded += x; });
+
+    EXPECT_EQ(tests::to_string(tests::run(GetParam(), R"(
+package test;
+
+extern def scale(x, k) -> double;
+extern def greet(name) -> string;
+extern def negate(value) -> bool;
+extern def count(args...) -> int;
+extern def pick(x) -> int;
+extern def pick(x, y) -> int;
+extern def record(x) -> void;
+
+for (i : [1, 2, 3]) {
+    record(i);
+}
+return [
+    scale(1.25, 2), scale(2, 3), greet("ab"), negate(1 == 2), count(),
+    count(1, "a", [2]), pick(4), pick(4, 2), record(0)
+];
+)",
+                                          hosts)),
+              "[2.5, 6, 'hi ab', true, 0, 3, 4, 42, null]");
+    EXPECT_EQ(recorded, 6);
+
+    EXPECT_THROW(tests::run(GetParam(), R"(
+package test;
+
+extern def scale(x, k) -> double;
+return scale("a", 2);
+)",
+                            hosts),
+                 std::invalid_argument);
+}
+
+// A call to a declared name nothing is bound to for its number of arguments
+// throws when it runs, not when the script is compiled.
+TEST_P(EnginesTest, UnboundHostFunctionsThrowWhenCalled) {
+    auto hosts = std::make_shared<interpreter::HostFunctions>();
+    hosts->define("pick", [](int64_t x) { return x; });
+
+    EXPECT_EQ(tests::to_string(tests::run(GetParam(), R"(
+package test;
+
+extern def missing(x) -> int;
+extern def pick(x, y, z) -> int;
+
+def never() {
+    return missing(1) + pick(1, 2, 3);
+}
+return 1;
+)",
+                                          hosts)),
+              "1");
+    EXPECT_THROW(tests::run(GetParam(), R"(
+package test;
+
+extern def missing(x) -> int;
+return missing(1);
+)",
+                            hosts),
+                 std::runtime_error);
+    EXPECT_THROW(tests::run(GetParam(), R"(
+package test;
+
+extern def pick(x, y, z) -> int;
+return pick(1, 2, 3);
+)",
+                            hosts),
+                 std::runtime_error);
+}
+
+TEST_P(EnginesTest, AddDaysRejectsDatesOutOfRange) {
+    EXPECT_EQ(run(R"(
+package test;
+
+return days_between(2022-01-01, add_days(2022-01-01, 100000));
+)"),
+              "100000");
+    EXPECT_THROW(run(R"(
+package test;
+
+return add_days(2022-01-01, 4294967296);
+)"),
+                 std::out_of_range);
+    EXPECT_THROW(run(R"(
+package test;
+
+return add_days(2022-01-01, -4294967296);
+)"),
+                 std::out_of_range);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllEngines, EnginesTest, ::testing::ValuesIn(tests::kEngines),
+    [](const ::testing::TestParamInfo<Engine>& param) {
+        return std::string {tests::name_of(param.param)};
+    });
+
+}    // namespace
@@ -0,0 +1,74 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/interpreter/hash_table.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+
+namespace {
+
+using namespace expressions::interpreter;
+
+HashSet<BoxedValue> make_set(std::initializer_list<int64_t> elements) {
+    auto set = HashSet<BoxedValue> {};
+    for (auto element : elements) {
+        set.emplace(element);
+    }
+    return set;
+}
+
+HashMap<BoxedValue, BoxedValue> make_map(
+    std::initializer_list<std::pair<int64_t, int64_t>> items) {
+    auto map = HashMap<BoxedValue, BoxedValue> {};
+    for (auto [key, value] : items) {
+        map.emplace(key, value);
+    }
+    return map;
+}
+
+TEST(HashSetTest, EqualityIgnoresTheOrderOfInsertion) {
+    EXPECT_TRUE(make_set({1, 2, 3}) == make_set({3, 1, 2}));
+    EXPECT_TRUE(make_set({1, 2}) != make_set({1, 3}));
+}
+
+// Sets must be strictly weakly ordered to be sorted or used as keys of an
+// ordered container, which inclusion alone is not.
+TEST(HashSetTest, OrdersDisjointSetsByTheirSortedElements) {
+    EXPECT_TRUE(make_set({1}) < make_set({2}));
+    EXPECT_FALSE(make_set({2}) < make_set({1}));
+    EXPECT_TRUE(make_set({3, 1}) < make_set({2}));
+    EXPECT_TRUE(make_set({1}) < make_set({1, 2}));
+    EXPECT_TRUE(make_set({2, 1}) <= make_set({1, 2}));
+    EXPECT_FALSE(make_set({2, 1}) < make_set({1, 2}));
+    EXPECT_TRUE(make_set({1, 3}) > make_set({2, 1}));
+    EXPECT_TRUE(make_set({}) < make_set({0}));
+}
+
+TEST(HashMapTest, EqualityIgnoresTheOrderOfInsertion) {
+    EXPECT_TRUE(make_map({{1, 10}, {2, 20}}) == make_map({{2, 20}, {1, 10}}));
+    EXPECT_TRUE(make_map({{1, 10}}) != make_map({{1, 20}}));
+}
+
+// Maps are ordered by their items sorted by key, as std::map is, so that
+// lists of maps can be sorted.
+TEST(HashMapTest, OrdersMapsByTheirSortedItems) {
+    EXPECT_TRUE(make_map({{1, 20}}) < make_map({{2, 10}}));
+    EXPECT_TRUE(make_map({{1, 10}}) < make_map({{1, 20}}));
+    EXPECT_TRUE(make_map({{3, 0}, {1, 10}}) < make_map({{2, 0}}));
+    EXPECT_TRUE(make_map({{1, 10}}) < make_map({{1, 10}, {2, 0}}));
+    EXPECT_FALSE(make_map({{2, 0}, {1, 10}}) < make_map({{1, 10}, {2, 0}}));
+    EXPECT_TRUE(make_map({{2, 0}, {1, 10}}) <= make_map({{1, 10}, {2, 0}}));
+    EXPECT_TRUE(make_map({{2, 0}}) > make_map({{1, 10}, {2, 0}}));
+    EXPECT_TRUE(make_map({}) < make_map({{0, 0}}));
+}
+
+}    // namespace
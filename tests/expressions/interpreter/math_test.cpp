@@ -0,0 +1,186 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/engines.hpp>
+#include <expressions/interpreter/math.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+
+namespace {
+
+using namespace expressions::interpreter;
+using expressions::tests::to_string;
+
+using Builtin = BoxedValue (*)(std::span<const BoxedValue>);
+
+// Longer than two vectors of any width, so that every length leaves a
+// different number of elements to the scalar loop.
+constexpr size_t kMaxLength = 19;
+
+template<typename E>
+BoxedValue list_of(std::vector<E> elements) {
+    auto list = Vector<BoxedValue> {};
+    list.mutate().assign(std::move(elements));
+
+    return list;
+}
+
+BoxedValue call(Builtin builtin, BoxedValue arg) {
+    return builtin(std::span<const BoxedValue> {&arg, 1});
+}
+BoxedValue call(Builtin builtin, BoxedValue arg, BoxedValue other) {
+    const BoxedValue args[] = {std::move(arg), std::move(other)};
+    return builtin(std::span<const BoxedValue> {args});
+}
+
+// The same double, NaNs being all the same.
+::testing::AssertionResult same_double(const BoxedValue& actual,
+                                       const BoxedValue& expected) {
+    const auto* lhs = boost::get<double>(&actual);
+    const auto* rhs = boost::get<double>(&expected);
+    if (!lhs || !rhs) {
+        return ::testing::AssertionFailure()
+               << to_string(actual) << " vs " << to_string(expected);
+    }
+    if ((std::isnan(*lhs) && std::isnan(*rhs))
+        || std::bit_cast<uint64_t>(*lhs) == std::bit_cast<uint64_t>(*rhs)) {
+        return ::testing::AssertionSuccess();
+    }
+
+    return ::testing::AssertionFailure() << *lhs << " vs " << *rhs;
+}
+
+// Negative and positive, zeros of both signs, and an infinity.
+std::vector<double> doubles(size_t length) {
+    auto values = std::vector<double> {};
+    for (size_t index = 0; index < length; ++index) {
+        values.emplace_back(static_cast<double>(index) * 1.75 - 8.0);
+    }
+    if (length > 3) {
+        values[3] = -0.0;
+    }
+    if (length > 6) {
+        values[length - 2] = std::numeric_limits<double>::infinity();
+    }
+
+    return values;
+}
+
+// The list kernels give every element what the builtin gives it alone, both
+// in the vector loop and in the scalar one that finishes it.
+TEST(MathTest, ListKernelsMatchTheScalarResults) {
+    const Builtin unary[] = {__builtin_sqrt, __builtin_exp, __builtin_log,
+                             __builtin_abs};
+    for (size_t length = 0; length <= kMaxLength; ++length) {
+        auto values = doubles(length);
+        for (auto builtin : unary) {
+            auto results = call(builtin, list_of(values));
+            const auto& list = boost::get<Vector<BoxedValue>>(results);
+            ASSERT_EQ(list.size(), length);
+            for (size_t index = 0; index < length; ++index) {
+                EXPECT_TRUE(same_double(list.get()[index],
+                                        call(builtin, values[index])))
+                    << "length " << length << ", index " << index;
+            }
+        }
+
+        for (auto exponent : {2.0, 3.0, 0.5}) {
+            auto results = call(__builtin_pow, list_of(values), exponent);
+            const auto& list = boost::get<Vector<BoxedValue>>(results);
+            ASSERT_EQ(list.size(), length);
+            for (size_t index = 0; index < length; ++index) {
+                EXPECT_TRUE(
+                    same_double(list.get()[index],
+                                call(__builtin_pow, values[index], exponent)))
+                    << "exponent " << exponent << ", length " << length
+                    << ", index " << index;
+            }
+        }
+    }
+}
+
+// pow(x, 2.0) squares instead of calling std::pow, on int64_t lists too, and
+// whether the exponent is written as an integer or not.
+TEST(MathTest, SquaresForTheExponentTwo) {
+    for (size_t length = 0; length <= kMaxLength; ++length) {
+        auto values = std::vector<int64_t> {};
+        for (size_t index = 0; index < length; ++index) {
+            values.emplace_back(static_cast<int64_t>(index) * 3'000'001 - 7);
+        }
+
+        for (auto exponent : {BoxedValue {2.0}, BoxedValue {int64_t {2}}}) {
+            auto results = call(__builtin_pow, list_of(values), exponent);
+            const auto& list = boost::get<Vector<BoxedValue>>(results);
+            ASSERT_EQ(list.size(), length);
+            for (size_t index = 0; index < length; ++index) {
+                auto value = static_cast<double>(values[index]);
+                EXPECT_TRUE(same_double(list.get()[index], value * value))
+                    << "length " << length << ", index " << index;
+            }
+        }
+    }
+}
+
+TEST(MathTest, AbsKeepsInt64Lists) {
+    constexpr auto kLeast = std::numeric_limits<int64_t>::min();
+    for (size_t length = 0; length <= kMaxLength; ++length) {
+        auto values = std::vector<int64_t> {};
+        for (size_t index = 0; index < length; ++index) {
+            values.emplace_back(static_cast<int64_t>(index % 3) - 1
+                                - static_cast<int64_t>(index));
+        }
+        if (length > 0) {
+            values[length - 1] = kLeast;
+        }
+
+        auto results = call(__builtin_abs, list_of(values));
+        const auto& list = boost::get<Vector<BoxedValue>>(results);
+        ASSERT_EQ(list.size(), length);
+        for (size_t index = 0; index < length; ++index) {
+            auto expected = call(__builtin_abs, values[index]);
+            EXPECT_TRUE(list.get()[index] == expected)
+                << "length " << length << ", index " << index;
+        }
+    }
+}
+
+// The extremum is found wherever it is: in any lane of the vector loop, or
+// in the elements left to the scalar loop.
+TEST(MathTest, MinAndMaxFindTheExtremumAtEveryPosition) {
+    for (size_t length = 1; length <= kMaxLength; ++length) {
+        for (size_t position = 0; position < length; ++position) {
+            auto values = std::vector<int64_t>(length, 5);
+            auto reals = std::vector<double>(length, 5.0);
+            values[position] = 9;
+            reals[position] = 9.5;
+            EXPECT_EQ(to_string(call(__builtin_max, list_of(values))), "9");
+            EXPECT_EQ(to_string(call(__builtin_max, list_of(reals))), "9.5");
+
+            values[position] = -9;
+            reals[position] = -9.5;
+            EXPECT_EQ(to_string(call(__builtin_min, list_of(values))), "-9");
+            EXPECT_EQ(to_string(call(__builtin_min, list_of(reals))), "-9.5");
+
+            reals[position] = std::nan("");
+            EXPECT_EQ(to_string(call(__builtin_min, list_of(reals))), "nan")
+                << "length " << length << ", position " << position;
+            EXPECT_EQ(to_string(call(__builtin_max, list_of(reals))), "nan")
+                << "length " << length << ", position " << position;
+        }
+    }
+}
+
+}    // namespace
@@ -0,0 +1,79 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/engines.hpp>
+#include <expressions/interpreter/typed_array.hpp>
+#include <expressions/interpreter/value.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+using namespace expressions::interpreter;
+using expressions::tests::to_string;
+
+TEST(TypedArrayTest, StaysUnboxedWhileTheElementsShareAType) {
+    auto array = TypedArray<BoxedValue> {};
+    array.push_back(int64_t {1});
+    array.push_back(int64_t {2});
+
+    EXPECT_EQ(array.element_type(), ElementType::kInt64);
+    EXPECT_EQ(array.size(), 2);
+}
+
+TEST(TypedArrayTest, AppendingToAMixedListKeepsEveryElement) {
+    auto array = TypedArray<BoxedValue> {};
+    array.push_back(String {std::string {"start"}});
+    ASSERT_EQ(array.element_type(), ElementType::kBoxed);
+
+    auto tail = TypedArray<BoxedValue> {};
+    tail.push_back(int64_t {0});
+    for (int64_t i = 0; i < 1000; ++i) {
+        tail.assign(std::vector<int64_t> {i});
+        array.append(tail);
+        array.push_back(static_cast<double>(i) + 0.5);
+    }
+
+    ASSERT_EQ(array.size(), 2001);
+    EXPECT_EQ(to_string(array[0]), "'start'");
+    EXPECT_EQ(to_string(array[1999]), "999");
+    EXPECT_EQ(to_string(array[2000]), "999.5");
+}
+
+// Appends to boxed storage must grow it geometrically, not to the exact new
+// size, or accumulating into a mixed list is quadratic.
+TEST(TypedArrayTest, AppendingToAMixedListGrowsGeometrically) {
+    auto array = TypedArray<BoxedValue> {};
+    array.push_back(String {std::string {"start"}});
+
+    auto tail = TypedArray<BoxedValue> {};
+    tail.push_back(int64_t {1});
+
+    auto reallocations = 0;
+    auto capacity = array.capacity();
+    for (auto i = 0; i < 10000; ++i) {
+        if (i % 2 == 0) {
+            array.append(tail);
+        } else {
+            array.push_back(int64_t {2});
+        }
+        if (array.capacity() != capacity) {
+            capacity = array.capacity();
+            ++reallocations;
+        }
+    }
+
+    EXPECT_EQ(array.size(), 10001);
+    EXPECT_LT(reallocations, 64);
+}
+
+}    // namespace
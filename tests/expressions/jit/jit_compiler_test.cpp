@@ -0,0 +1,206 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <expressions/jit/jit_compiler.hpp>
+#include <expressions/parser/parser.hpp>
+
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+using namespace expressions;
+using jit::ValueType;
+
+const ast::FunctionDef* find_function(const ast::Value& node,
+                                      std::string_view name) {
+    if (const auto* func = ast::get_if<ast::FunctionDef>(&node)) {
+        return func->name.value == name ? func : nullptr;
+    } else if (const auto* assign = ast::get_if<ast::AssignStatement>(&node)) {
+        return find_function(assign->expr, name);
+    } else if (const auto* list = ast::get_if<ast::StatementList>(&node)) {
+        for (const auto& stmt : list->stmts) {
+            if (const auto* found = find_function(stmt, name)) {
+                return found;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+// The source of the function of the script with the name, which shares the
+// ownership of the tree.
+jit::FunctionSource source_of(const std::shared_ptr<ast::Entry>& tree,
+                              std::string_view name) {
+    const auto* func = find_function(tree->node, name);
+    if (!func) {
+        ADD_FAILURE() << "No function " << name;
+        return {};
+    }
+
+    auto params = std::vector<std::string> {};
+    for (const auto& param : func->params) {
+        const auto& arg = ast::get<ast::Argument>(param).arg;
+        params.emplace_back(ast::get<ast::Name>(arg).value);
+    }
+    return {func->name.value, std::move(params),
+            std::shared_ptr<const ast::Value> {tree, &func->body}};
+}
+
+std::shared_ptr<ast::Entry> parse(std::string_view script) {
+    auto tree = parser::ExpressionsParser {}.parse_to_ast(script);
+    if (!tree) {
+        ADD_FAILURE() << "Failed to parse:" << script;
+        return std::make_shared<ast::Entry>();
+    }
+
+    return tree;
+}
+
+class JITCompilerTest : public ::testing::Test {
+protected:
+    std::optional<jit::CompiledFunction> compile(
+        const jit::FunctionSource& function,
+        std::span<const ValueType> signature,
+        const std::vector<std::string>& names = {},
+        const std::unordered_map<std::string, jit::FunctionSource>& callees
+        = {}) {
+        return jit_.compile(function, callees, names, signature);
+    }
+
+    jit::JITCompiler jit_ {};
+};
+
+// The same body compiles to different code for each signature.
+TEST_F(JITCompilerTest, SpecializesForTheArgumentTypes) {
+    auto tree = parse(R"(
+package test;
+
+def f(x, y) {
+    return x * y + 1;
+}
+)");
+    auto function = source_of(tree, "f");
+    ASSERT_TRUE(jit::JITCompiler::analyze(function.params, *function.body));
+
+    const auto ints = std::vector {ValueType::kInt64, ValueType::kInt64};
+    auto compiled = compile(function, ints);
+    ASSERT_TRUE(compiled);
+    EXPECT_EQ(compiled->result, ValueType::kInt64);
+    uint64_t inputs[] = {3, 4};
+    uint64_t outputs[1] = {};
+    compiled->entry(inputs, outputs);
+    EXPECT_EQ(static_cast<int64_t>(outputs[0]), 13);
+
+    const auto doubles = std::vector {ValueType::kDouble, ValueType::kDouble};
+    compiled = compile(function, doubles);
+    ASSERT_TRUE(compiled);
+    EXPECT_EQ(compiled->result, ValueType::kDouble);
+    inputs[0] = std::bit_cast<uint64_t>(2.5);
+    inputs[1] = std::bit_cast<uint64_t>(-2.0);
+    compiled->entry(inputs, outputs);
+    EXPECT_EQ(std::bit_cast<double>(outputs[0]), -4.0);
+}
+
+// Free names come in after the arguments, and go out after the result with
+// a flag telling whether the call stored them.
+TEST_F(JITCompilerTest, ReadsAndStoresTheFreeNames) {
+    auto tree = parse(R"(
+package test;
+
+def add(x) {
+    total = total + x * scale;
+    return total;
+}
+)");
+    auto function = source_of(tree, "add");
+    auto analysis = jit::JITCompiler::analyze(function.params, *function.body);
+    ASSERT_TRUE(analysis);
+    ASSERT_EQ(analysis->names.size(), 2);
+    EXPECT_TRUE(analysis->returns);
+
+    const auto signature = std::vector {ValueType::kInt64, ValueType::kInt64,
+                                        ValueType::kInt64};
+    auto compiled = compile(function, signature, analysis->names);
+    ASSERT_TRUE(compiled);
+    ASSERT_EQ(compiled->stores.size(), 2);
+
+    auto values = std::unordered_map<std::string, uint64_t> {
+        {"total", 100}, {"scale", 3}};
+    auto inputs = std::vector<uint64_t> {5};
+    for (const auto& name : analysis->names) {
+        inputs.emplace_back(values.at(name));
+    }
+    auto outputs = std::vector<uint64_t>(1 + 2 * analysis->names.size());
+    compiled->entry(inputs.data(), outputs.data());
+    EXPECT_EQ(static_cast<int64_t>(outputs[0]), 115);
+    for (size_t index = 0; index < analysis->names.size(); ++index) {
+        const auto& name = analysis->names[index];
+        auto stored = outputs[2 + 2 * index] != 0;
+        EXPECT_EQ(stored, name == "total") << name;
+        if (stored) {
+            EXPECT_EQ(static_cast<int64_t>(outputs[1 + 2 * index]), 115);
+        }
+    }
+}
+
+// Calls to the callees are inlined, so the callees need no code of their own.
+TEST_F(JITCompilerTest, InlinesTheCallees) {
+    auto tree = parse(R"(
+package test;
+
+def square(x) {
+    return x * x;
+}
+
+def f(x) {
+    return square(x) + square(x + 1);
+}
+)");
+    auto function = source_of(tree, "f");
+    auto analysis = jit::JITCompiler::analyze(function.params, *function.body);
+    ASSERT_TRUE(analysis);
+    ASSERT_EQ(analysis->callees, std::vector<std::string> {"square"});
+
+    auto callees = std::unordered_map<std::string, jit::FunctionSource> {
+        {"square", source_of(tree, "square")}};
+    const auto signature
+        = std::vector {ValueType::kInt64, ValueType::kFunction};
+    auto compiled = compile(function, signature, {"square"}, callees);
+    ASSERT_TRUE(compiled);
+    uint64_t inputs[] = {3, 0};
+    uint64_t outputs[3] = {};
+    compiled->entry(inputs, outputs);
+    EXPECT_EQ(static_cast<int64_t>(outputs[0]), 25);
+}
+
+// Bodies building objects stay on the interpreter.
+TEST_F(JITCompilerTest, LeavesObjectsToTheInterpreter) {
+    auto tree = parse(R"(
+package test;
+
+def f(x) {
+    return [x, x + 1];
+}
+)");
+    auto function = source_of(tree, "f");
+    const auto ints = std::vector {ValueType::kInt64};
+    EXPECT_TRUE(!jit::JITCompiler::analyze(function.params, *function.body)
+                || !compile(function, ints));
+}
+
+}    // namespace
@@ -0,0 +1,39 @@
+//
+// Expressions
+//
+// Copyright (c) 2022 Jaepil Jeong <jaepil@appspand.com>
+//
+
+#include <benchmark/benchmark.h>
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+
+// Runs the unit tests, then the benchmarks if --benchmark is given.
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::benchmark::Initialize(&argc, argv);
+
+    auto benchmarks = false;
+    auto count = 1;
+    for (auto i = 1; i < argc; ++i) {
+        if (std::string_view {argv[i]} == "--benchmark") {
+            benchmarks = true;
+        } else {
+            argv[count++] = argv[i];
+        }
+    }
+    argc = count;
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    auto result = RUN_ALL_TESTS();
+    if (result == 0 && benchmarks) {
+        ::benchmark::RunSpecifiedBenchmarks();
+        ::benchmark::Shutdown();
+    }
+
+    return result;
+}